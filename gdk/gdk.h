@@ -71,9 +71,11 @@
 #include <gdk/gdkrgba.h>
 #include <gdk/gdkseat.h>
 #include <gdk/gdksnapshot.h>
+#include <gdk/gdkstreampaintable.h>
 #include <gdk/gdksurface.h>
 #include <gdk/gdktexture.h>
 #include <gdk/gdktexturedownloader.h>
+#include <gdk/gdktextureloader.h>
 #include <gdk/gdktoplevel.h>
 #include <gdk/gdktoplevellayout.h>
 #include <gdk/gdktoplevelsize.h>
@@ -0,0 +1,716 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gdkstreampaintable.h"
+
+#include "gdkmemorytexture.h"
+#include "gdkpaintable.h"
+#include "gdksnapshot.h"
+#include "gdktexture.h"
+#include "loaders/gdkjpegprivate.h"
+#include "loaders/gdkpngprivate.h"
+
+#include <graphene.h>
+
+/* HACK: So we don't need to include any (not-yet-created) GSK or GTK headers */
+void
+gtk_snapshot_append_texture (GdkSnapshot            *snapshot,
+                             GdkTexture             *texture,
+                             const graphene_rect_t  *bounds);
+
+/**
+ * GdkStreamPaintable:
+ *
+ * `GdkStreamPaintable` is a [iface@Gdk.Paintable] that shows an image
+ * while it is being loaded from a `GInputStream`.
+ *
+ * PNG and JPEG images are decoded incrementally in a thread as data
+ * arrives, and the rows that have been decoded so far are shown right
+ * away. This
+ * makes large images on slow streams, such as network mounts, show
+ * up much sooner, and spreads the decoding work over the time it takes
+ * to load the data. Other formats are shown once they are complete.
+ *
+ * Once loading is done, [property@Gdk.StreamPaintable:loading] changes
+ * to %FALSE, and the paintable shows the complete image, available with
+ * [method@Gdk.StreamPaintable.get_texture]. If an error occurred, it can
+ * be retrieved with [method@Gdk.StreamPaintable.get_error].
+ *
+ * Since: 4.14
+ */
+
+#define CHUNK_SIZE (64 * 1024)
+
+typedef enum
+{
+  STREAM_FORMAT_UNKNOWN,
+  STREAM_FORMAT_PNG,
+  STREAM_FORMAT_JPEG,
+  STREAM_FORMAT_OTHER
+} StreamFormat;
+
+struct _GdkStreamPaintable
+{
+  GObject parent_instance;
+
+  GInputStream *stream;
+  GCancellable *cancellable;
+
+  /* Only used by the decoding thread while it runs */
+  StreamFormat format;
+  GByteArray *pending;          /* data we can't decode incrementally yet */
+  GdkPngDecoder *png;
+  GdkJpegDecoder *jpeg;
+  GdkProgressiveImage image;
+  GdkTexture *image_texture;    /* for formats that aren't decoded incrementally */
+  int n_band_rows;
+  int preview_end;
+  int preview_pass;
+
+  /* The textures the thread made for the main thread to pick up */
+  GMutex lock;
+  int published_width;
+  int published_height;
+  GPtrArray *published_bands;
+  GdkTexture *published_preview;
+  int published_preview_y;
+  gboolean progress_queued;
+
+  /* Used in the main thread */
+  int width;
+  int height;
+  GPtrArray *bands;             /* textures of the rows that won't change */
+  GdkTexture *preview;          /* the rows below, which may still change */
+  int preview_y;
+  GdkTexture *texture;          /* the complete image */
+  GError *error;
+
+  guint loading : 1;
+};
+
+struct _GdkStreamPaintableClass
+{
+  GObjectClass parent_class;
+};
+
+enum
+{
+  PROP_0,
+  PROP_LOADING,
+
+  N_PROPS
+};
+
+static GParamSpec *properties[N_PROPS] = { NULL, };
+
+static GdkTexture *
+gdk_stream_paintable_create_rows (GdkStreamPaintable *self,
+                                  int                 y,
+                                  int                 n_rows)
+{
+  GdkTexture *texture;
+  GBytes *bytes;
+
+  bytes = g_bytes_new (self->image.data + y * self->image.stride,
+                       n_rows * self->image.stride);
+  texture = gdk_memory_texture_new (self->image.width,
+                                    n_rows,
+                                    self->image.format,
+                                    bytes,
+                                    self->image.stride);
+  g_bytes_unref (bytes);
+
+  return texture;
+}
+
+/* Called in the decoding thread after new data was decoded.
+ * The new textures are collected in @band and @preview.
+ */
+static void
+gdk_stream_paintable_update_rows (GdkStreamPaintable  *self,
+                                  GdkTexture         **band,
+                                  GdkTexture         **preview,
+                                  int                 *preview_y)
+{
+  GdkProgressiveImage *image = &self->image;
+
+  if (image->data == NULL)
+    return;
+
+  /* Rows that won't change anymore are only uploaded once */
+  if (image->n_final_rows > self->n_band_rows)
+    {
+      *band = gdk_stream_paintable_create_rows (self,
+                                                self->n_band_rows,
+                                                image->n_final_rows - self->n_band_rows);
+      self->n_band_rows = image->n_final_rows;
+    }
+
+  /* The rows below them are still being refined by interlace passes.
+   * Copying them for every change would be quadratic in the number of
+   * rows, so only do that when a new pass starts or enough rows arrived.
+   */
+  if (image->n_rows > self->n_band_rows &&
+      (self->preview_end <= self->n_band_rows ||
+       image->pass != self->preview_pass ||
+       image->n_rows - self->preview_end >= MAX (1, image->height / 8)))
+    {
+      *preview = gdk_stream_paintable_create_rows (self,
+                                                   self->n_band_rows,
+                                                   image->n_rows - self->n_band_rows);
+      *preview_y = self->n_band_rows;
+      self->preview_end = image->n_rows;
+      self->preview_pass = image->pass;
+    }
+}
+
+static void
+gdk_stream_paintable_snapshot (GdkPaintable *paintable,
+                               GdkSnapshot  *snapshot,
+                               double        width,
+                               double        height)
+{
+  GdkStreamPaintable *self = GDK_STREAM_PAINTABLE (paintable);
+  double scale_y;
+  int y;
+  guint i;
+
+  /* Everything used here is only changed in the main thread,
+   * the decoding thread hands over new rows in the progress callback.
+   */
+  if (self->texture)
+    {
+      gdk_paintable_snapshot (GDK_PAINTABLE (self->texture), snapshot, width, height);
+      return;
+    }
+
+  if (self->height == 0)
+    return;
+
+  scale_y = height / self->height;
+
+  /* The bands are drawn last, they cover the outdated part of the preview */
+  if (self->preview)
+    gtk_snapshot_append_texture (snapshot,
+                                 self->preview,
+                                 &GRAPHENE_RECT_INIT (0,
+                                                      self->preview_y * scale_y,
+                                                      width,
+                                                      gdk_texture_get_height (self->preview) * scale_y));
+
+  y = 0;
+  for (i = 0; i < self->bands->len; i++)
+    {
+      GdkTexture *band = g_ptr_array_index (self->bands, i);
+
+      gtk_snapshot_append_texture (snapshot,
+                                   band,
+                                   &GRAPHENE_RECT_INIT (0,
+                                                        y * scale_y,
+                                                        width,
+                                                        gdk_texture_get_height (band) * scale_y));
+      y += gdk_texture_get_height (band);
+    }
+}
+
+static int
+gdk_stream_paintable_get_intrinsic_width (GdkPaintable *paintable)
+{
+  GdkStreamPaintable *self = GDK_STREAM_PAINTABLE (paintable);
+
+  return self->width;
+}
+
+static int
+gdk_stream_paintable_get_intrinsic_height (GdkPaintable *paintable)
+{
+  GdkStreamPaintable *self = GDK_STREAM_PAINTABLE (paintable);
+
+  return self->height;
+}
+
+static void
+gdk_stream_paintable_paintable_init (GdkPaintableInterface *iface)
+{
+  iface->snapshot = gdk_stream_paintable_snapshot;
+  iface->get_intrinsic_width = gdk_stream_paintable_get_intrinsic_width;
+  iface->get_intrinsic_height = gdk_stream_paintable_get_intrinsic_height;
+}
+
+G_DEFINE_TYPE_WITH_CODE (GdkStreamPaintable, gdk_stream_paintable, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (GDK_TYPE_PAINTABLE,
+                                                gdk_stream_paintable_paintable_init))
+
+static void
+gdk_stream_paintable_clear_decoders (GdkStreamPaintable *self)
+{
+  g_clear_pointer (&self->png, gdk_png_decoder_free);
+  g_clear_pointer (&self->jpeg, gdk_jpeg_decoder_free);
+  g_clear_pointer (&self->pending, g_byte_array_unref);
+}
+
+static gboolean
+gdk_stream_paintable_feed (GdkStreamPaintable  *self,
+                           const guchar        *data,
+                           gsize                size,
+                           GError             **error)
+{
+  if (self->format == STREAM_FORMAT_UNKNOWN)
+    {
+      GBytes *bytes;
+
+      g_byte_array_append (self->pending, data, size);
+      if (self->pending->len < 8)
+        return TRUE;
+
+      bytes = g_bytes_new_static (self->pending->data, self->pending->len);
+      if (gdk_is_png (bytes))
+        {
+          self->format = STREAM_FORMAT_PNG;
+          self->png = gdk_png_decoder_new (&self->image);
+        }
+      else if (gdk_is_jpeg (bytes))
+        {
+          self->format = STREAM_FORMAT_JPEG;
+          self->jpeg = gdk_jpeg_decoder_new (&self->image);
+        }
+      else
+        {
+          self->format = STREAM_FORMAT_OTHER;
+        }
+      g_bytes_unref (bytes);
+
+      if (self->format == STREAM_FORMAT_OTHER)
+        return TRUE;
+
+      data = self->pending->data;
+      size = self->pending->len;
+    }
+
+  switch (self->format)
+    {
+    case STREAM_FORMAT_PNG:
+      if (!gdk_png_decoder_feed (self->png, data, size, error))
+        return FALSE;
+      break;
+
+    case STREAM_FORMAT_JPEG:
+      if (!gdk_jpeg_decoder_feed (self->jpeg, data, size, error))
+        return FALSE;
+      break;
+
+    case STREAM_FORMAT_OTHER:
+      g_byte_array_append (self->pending, data, size);
+      return TRUE;
+
+    case STREAM_FORMAT_UNKNOWN:
+    default:
+      g_assert_not_reached ();
+    }
+
+  if (self->pending)
+    g_byte_array_set_size (self->pending, 0);
+
+  return TRUE;
+}
+
+static gboolean
+gdk_stream_paintable_finish (GdkStreamPaintable  *self,
+                             GError             **error)
+{
+  switch (self->format)
+    {
+    case STREAM_FORMAT_PNG:
+      return gdk_png_decoder_finish (self->png, error);
+
+    case STREAM_FORMAT_JPEG:
+      return gdk_jpeg_decoder_finish (self->jpeg, error);
+
+    case STREAM_FORMAT_UNKNOWN:
+    case STREAM_FORMAT_OTHER:
+      {
+        GdkTexture *texture;
+        GBytes *bytes;
+
+        bytes = g_byte_array_free_to_bytes (g_steal_pointer (&self->pending));
+        texture = gdk_texture_new_from_bytes (bytes, error);
+        g_bytes_unref (bytes);
+        if (texture == NULL)
+          return FALSE;
+
+        g_set_object (&self->image_texture, texture);
+        self->image.width = gdk_texture_get_width (texture);
+        self->image.height = gdk_texture_get_height (texture);
+        self->image.n_rows = self->image.height;
+        self->image.n_final_rows = self->image.height;
+        self->image.done = TRUE;
+        g_object_unref (texture);
+      }
+      return TRUE;
+
+    default:
+      g_assert_not_reached ();
+      return FALSE;
+    }
+}
+
+static gboolean
+gdk_stream_paintable_progress_cb (gpointer data)
+{
+  GdkStreamPaintable *self = data;
+  gboolean size_changed;
+  guint i;
+
+  /* Loading may have finished in the meantime */
+  if (!self->loading)
+    return G_SOURCE_REMOVE;
+
+  g_mutex_lock (&self->lock);
+  self->progress_queued = FALSE;
+  size_changed = self->width != self->published_width ||
+                 self->height != self->published_height;
+  self->width = self->published_width;
+  self->height = self->published_height;
+  for (i = 0; i < self->published_bands->len; i++)
+    g_ptr_array_add (self->bands, g_object_ref (g_ptr_array_index (self->published_bands, i)));
+  g_ptr_array_set_size (self->published_bands, 0);
+  if (self->published_preview)
+    {
+      g_set_object (&self->preview, self->published_preview);
+      g_clear_object (&self->published_preview);
+      self->preview_y = self->published_preview_y;
+    }
+  g_mutex_unlock (&self->lock);
+
+  if (size_changed)
+    gdk_paintable_invalidate_size (GDK_PAINTABLE (self));
+  gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gdk_stream_paintable_decode_thread (GTask        *task,
+                                    gpointer      source_object,
+                                    gpointer      task_data,
+                                    GCancellable *cancellable)
+{
+  GdkStreamPaintable *self = source_object;
+  GError *error = NULL;
+
+  while (TRUE)
+    {
+      GdkTexture *band = NULL, *preview = NULL;
+      int preview_y = 0;
+      GBytes *bytes;
+      gboolean success;
+
+      bytes = g_input_stream_read_bytes (self->stream, CHUNK_SIZE, cancellable, &error);
+      if (bytes == NULL)
+        break;
+
+      if (g_bytes_get_size (bytes) == 0)
+        {
+          gdk_stream_paintable_finish (self, &error);
+          g_bytes_unref (bytes);
+          break;
+        }
+
+      /* Decoding and copying rows happens without the lock,
+       * it is only taken to hand over the results.
+       */
+      success = gdk_stream_paintable_feed (self,
+                                           g_bytes_get_data (bytes, NULL),
+                                           g_bytes_get_size (bytes),
+                                           &error);
+      g_bytes_unref (bytes);
+
+      if (!success)
+        break;
+
+      gdk_stream_paintable_update_rows (self, &band, &preview, &preview_y);
+
+      g_mutex_lock (&self->lock);
+
+      if (band)
+        g_ptr_array_add (self->published_bands, band);
+      if (preview)
+        {
+          g_set_object (&self->published_preview, preview);
+          g_object_unref (preview);
+          self->published_preview_y = preview_y;
+        }
+
+      if (!self->progress_queued &&
+          (band != NULL || preview != NULL ||
+           self->image.width != self->published_width ||
+           self->image.height != self->published_height))
+        {
+          GSource *source;
+
+          source = g_idle_source_new ();
+          g_source_set_callback (source,
+                                 gdk_stream_paintable_progress_cb,
+                                 g_object_ref (self),
+                                 g_object_unref);
+          g_source_set_static_name (source, "[gdk] stream paintable progress");
+          g_source_attach (source, g_task_get_context (task));
+          g_source_unref (source);
+          self->progress_queued = TRUE;
+        }
+
+      self->published_width = self->image.width;
+      self->published_height = self->image.height;
+
+      g_mutex_unlock (&self->lock);
+    }
+
+  if (error)
+    g_task_return_error (task, error);
+  else
+    g_task_return_boolean (task, TRUE);
+}
+
+static void
+gdk_stream_paintable_decode_done (GObject      *source,
+                                  GAsyncResult *result,
+                                  gpointer      data)
+{
+  GdkStreamPaintable *self = GDK_STREAM_PAINTABLE (source);
+  GError *error = NULL;
+  gboolean size_changed;
+
+  g_task_propagate_boolean (G_TASK (result), &error);
+
+  /* The thread is gone, no need to lock anymore */
+  self->error = error;
+  self->loading = FALSE;
+
+  gdk_stream_paintable_clear_decoders (self);
+  g_ptr_array_set_size (self->published_bands, 0);
+  g_clear_object (&self->published_preview);
+
+  if (self->image_texture)
+    {
+      g_set_object (&self->texture, self->image_texture);
+      g_clear_object (&self->image_texture);
+    }
+
+  /* Hand the decoded image over to the texture, without a copy */
+  if (self->image.done && self->image.data != NULL)
+    {
+      GBytes *bytes;
+
+      bytes = g_bytes_new_take (g_steal_pointer (&self->image.data),
+                                self->image.height * self->image.stride);
+      g_clear_object (&self->texture);
+      self->texture = gdk_memory_texture_new (self->image.width,
+                                              self->image.height,
+                                              self->image.format,
+                                              bytes,
+                                              self->image.stride);
+      g_bytes_unref (bytes);
+
+      g_ptr_array_set_size (self->bands, 0);
+      g_clear_object (&self->preview);
+    }
+
+  g_clear_object (&self->stream);
+  g_clear_object (&self->cancellable);
+
+  size_changed = self->width != self->image.width ||
+                 self->height != self->image.height;
+  self->width = self->image.width;
+  self->height = self->image.height;
+
+  if (size_changed)
+    gdk_paintable_invalidate_size (GDK_PAINTABLE (self));
+  gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_LOADING]);
+}
+
+static void
+gdk_stream_paintable_get_property (GObject    *object,
+                                   guint       prop_id,
+                                   GValue     *value,
+                                   GParamSpec *pspec)
+{
+  GdkStreamPaintable *self = GDK_STREAM_PAINTABLE (object);
+
+  switch (prop_id)
+    {
+    case PROP_LOADING:
+      g_value_set_boolean (value, self->loading);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+gdk_stream_paintable_finalize (GObject *object)
+{
+  GdkStreamPaintable *self = GDK_STREAM_PAINTABLE (object);
+
+  gdk_stream_paintable_clear_decoders (self);
+  g_free (self->image.data);
+  g_ptr_array_unref (self->bands);
+  g_clear_object (&self->preview);
+  g_ptr_array_unref (self->published_bands);
+  g_clear_object (&self->published_preview);
+  g_clear_object (&self->image_texture);
+  g_clear_object (&self->texture);
+  g_clear_error (&self->error);
+  g_clear_object (&self->stream);
+  g_clear_object (&self->cancellable);
+  g_mutex_clear (&self->lock);
+
+  G_OBJECT_CLASS (gdk_stream_paintable_parent_class)->finalize (object);
+}
+
+static void
+gdk_stream_paintable_class_init (GdkStreamPaintableClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = gdk_stream_paintable_finalize;
+  gobject_class->get_property = gdk_stream_paintable_get_property;
+
+  /**
+   * GdkStreamPaintable:loading:
+   *
+   * Whether the image is still being loaded.
+   *
+   * Since: 4.14
+   */
+  properties[PROP_LOADING] =
+    g_param_spec_boolean ("loading", NULL, NULL,
+                          FALSE,
+                          G_PARAM_READABLE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (gobject_class, N_PROPS, properties);
+}
+
+static void
+gdk_stream_paintable_init (GdkStreamPaintable *self)
+{
+  self->pending = g_byte_array_new ();
+  self->bands = g_ptr_array_new_with_free_func (g_object_unref);
+  self->published_bands = g_ptr_array_new_with_free_func (g_object_unref);
+  g_mutex_init (&self->lock);
+}
+
+/**
+ * gdk_stream_paintable_new:
+ * @stream: the stream to load the image from
+ * @cancellable: (nullable): optional `GCancellable` to stop loading
+ *
+ * Creates a new paintable that loads an image from @stream
+ * and shows it while it is being loaded.
+ *
+ * Loading starts right away in a thread. Progress is reported
+ * in the thread-default main context.
+ *
+ * Returns: a new `GdkStreamPaintable`
+ *
+ * Since: 4.14
+ */
+GdkStreamPaintable *
+gdk_stream_paintable_new (GInputStream *stream,
+                          GCancellable *cancellable)
+{
+  GdkStreamPaintable *self;
+  GTask *task;
+
+  g_return_val_if_fail (G_IS_INPUT_STREAM (stream), NULL);
+  g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+
+  self = g_object_new (GDK_TYPE_STREAM_PAINTABLE, NULL);
+
+  self->stream = g_object_ref (stream);
+  if (cancellable)
+    self->cancellable = g_object_ref (cancellable);
+  self->loading = TRUE;
+
+  task = g_task_new (self, self->cancellable, gdk_stream_paintable_decode_done, NULL);
+  g_task_set_source_tag (task, gdk_stream_paintable_new);
+  g_task_run_in_thread (task, gdk_stream_paintable_decode_thread);
+  g_object_unref (task);
+
+  return self;
+}
+
+/**
+ * gdk_stream_paintable_is_loading:
+ * @self: a `GdkStreamPaintable`
+ *
+ * Returns whether @self is still loading its image.
+ *
+ * Returns: %TRUE while the image is being loaded
+ *
+ * Since: 4.14
+ */
+gboolean
+gdk_stream_paintable_is_loading (GdkStreamPaintable *self)
+{
+  g_return_val_if_fail (GDK_IS_STREAM_PAINTABLE (self), FALSE);
+
+  return self->loading;
+}
+
+/**
+ * gdk_stream_paintable_get_error:
+ * @self: a `GdkStreamPaintable`
+ *
+ * Returns the error that stopped loading, if any.
+ *
+ * Returns: (nullable): the error
+ *
+ * Since: 4.14
+ */
+const GError *
+gdk_stream_paintable_get_error (GdkStreamPaintable *self)
+{
+  g_return_val_if_fail (GDK_IS_STREAM_PAINTABLE (self), NULL);
+
+  return self->error;
+}
+
+/**
+ * gdk_stream_paintable_get_texture:
+ * @self: a `GdkStreamPaintable`
+ *
+ * Returns the loaded image, once loading has completed
+ * successfully.
+ *
+ * Returns: (nullable) (transfer none): the texture
+ *
+ * Since: 4.14
+ */
+GdkTexture *
+gdk_stream_paintable_get_texture (GdkStreamPaintable *self)
+{
+  g_return_val_if_fail (GDK_IS_STREAM_PAINTABLE (self), NULL);
+
+  if (self->loading || self->error)
+    return NULL;
+
+  return self->texture;
+}
@@ -0,0 +1,41 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#if !defined (__GDK_H_INSIDE__) && !defined (GTK_COMPILATION)
+#error "Only <gdk/gdk.h> can be included directly."
+#endif
+
+#include <gdk/gdktypes.h>
+
+G_BEGIN_DECLS
+
+#define GDK_TYPE_STREAM_PAINTABLE (gdk_stream_paintable_get_type ())
+GDK_AVAILABLE_IN_4_14
+GDK_DECLARE_INTERNAL_TYPE (GdkStreamPaintable, gdk_stream_paintable, GDK, STREAM_PAINTABLE, GObject)
+
+GDK_AVAILABLE_IN_4_14
+GdkStreamPaintable *    gdk_stream_paintable_new                (GInputStream           *stream,
+                                                                 GCancellable           *cancellable);
+
+GDK_AVAILABLE_IN_4_14
+gboolean                gdk_stream_paintable_is_loading         (GdkStreamPaintable     *self);
+GDK_AVAILABLE_IN_4_14
+const GError *          gdk_stream_paintable_get_error          (GdkStreamPaintable     *self);
+GDK_AVAILABLE_IN_4_14
+GdkTexture *            gdk_stream_paintable_get_texture        (GdkStreamPaintable     *self);
+
+G_END_DECLS
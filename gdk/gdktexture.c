@@ -49,6 +49,7 @@
 #include "loaders/gdkpngprivate.h"
 #include "loaders/gdktiffprivate.h"
 #include "loaders/gdkjpegprivate.h"
+#include "loaders/gdkgtexprivate.h"
 
 G_DEFINE_QUARK (gdk-texture-error-quark, gdk_texture_error)
 
@@ -68,6 +69,13 @@ enum {
 
 static GParamSpec *properties[N_PROPS];
 
+/* All textures with mipmaps, most recently used first */
+#define MIPMAP_CACHE_MAX_SIZE (32 * 1024 * 1024)
+
+G_LOCK_DEFINE_STATIC (mipmaps);
+static GQueue mipmap_textures = G_QUEUE_INIT;
+static gsize mipmap_cache_size;
+
 static GdkTextureChain *
 gdk_texture_chain_new (void)
 {
@@ -305,10 +313,38 @@ gdk_texture_get_property (GObject    *gobject,
     }
 }
 
+/* must be called with the mipmap lock held.
+ * The textures of the levels are added to @garbage, as disposing them
+ * takes the mipmap lock, they must be unreffed after dropping it.
+ */
+static void
+gdk_texture_clear_mipmaps (GdkTexture  *self,
+                           GSList     **garbage)
+{
+  guint i;
+
+  if (self->mipmaps == NULL)
+    return;
+
+  for (i = 0; i < self->n_mipmaps; i++)
+    {
+      g_clear_pointer (&self->mipmaps[i].surface, cairo_surface_destroy);
+      if (self->mipmaps[i].texture)
+        *garbage = g_slist_prepend (*garbage, self->mipmaps[i].texture);
+    }
+  g_clear_pointer (&self->mipmaps, g_free);
+  self->n_mipmaps = 0;
+
+  g_queue_unlink (&mipmap_textures, &self->mipmap_link);
+  mipmap_cache_size -= self->mipmap_size;
+  self->mipmap_size = 0;
+}
+
 static void
 gdk_texture_dispose (GObject *object)
 {
   GdkTexture *self = GDK_TEXTURE (object);
+  GSList *garbage = NULL;
 
   if (self->chain)
     {
@@ -337,6 +373,11 @@ gdk_texture_dispose (GObject *object)
 
   gdk_texture_clear_render_data (self);
 
+  G_LOCK (mipmaps);
+  gdk_texture_clear_mipmaps (self, &garbage);
+  G_UNLOCK (mipmaps);
+  g_slist_free_full (garbage, g_object_unref);
+
   G_OBJECT_CLASS (gdk_texture_parent_class)->dispose (object);
 }
 
@@ -387,6 +428,7 @@ gdk_texture_class_init (GdkTextureClass *klass)
 static void
 gdk_texture_init (GdkTexture *self)
 {
+  self->mipmap_link.data = self;
 }
 
 /**
@@ -510,6 +552,45 @@ gdk_texture_new_from_resource (const char *resource_path)
   return texture;
 }
 
+/* Map gtex files instead of reading them into memory. Their
+ * texture data is used in place, so its pages can be shared
+ * between processes.
+ *
+ * Other files are read into memory, so that the loaders never
+ * touch a mapping of a file that gets truncated while it is
+ * being decoded, which would crash with SIGBUS.
+ */
+static GBytes *
+gdk_texture_load_file_bytes (GFile   *file,
+                             GError **error)
+{
+  char *path;
+
+  path = g_file_get_path (file);
+  if (path)
+    {
+      GMappedFile *mapped;
+
+      mapped = g_mapped_file_new (path, FALSE, NULL);
+      g_free (path);
+
+      if (mapped)
+        {
+          GBytes *bytes;
+
+          bytes = g_mapped_file_get_bytes (mapped);
+          g_mapped_file_unref (mapped);
+
+          if (gdk_is_gtex (bytes))
+            return bytes;
+
+          g_bytes_unref (bytes);
+        }
+    }
+
+  return g_file_load_bytes (file, NULL, NULL, error);
+}
+
 /**
  * gdk_texture_new_from_file:
  * @file: `GFile` to load
@@ -538,7 +619,7 @@ gdk_texture_new_from_file (GFile   *file,
   g_return_val_if_fail (G_IS_FILE (file), NULL);
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-  bytes = g_file_load_bytes (file, NULL, NULL, error);
+  bytes = gdk_texture_load_file_bytes (file, error);
   if (bytes == NULL)
     return NULL;
 
@@ -554,24 +635,32 @@ gdk_texture_can_load (GBytes *bytes)
 {
   return gdk_is_png (bytes) ||
          gdk_is_jpeg (bytes) ||
-         gdk_is_tiff (bytes);
+         gdk_is_tiff (bytes) ||
+         gdk_is_gtex (bytes);
 }
 
 static GdkTexture *
 gdk_texture_new_from_bytes_internal (GBytes  *bytes,
+                                     int      width,
+                                     int      height,
                                      GError **error)
 {
   if (gdk_is_png (bytes))
     {
-      return gdk_load_png (bytes, error);
+      return gdk_load_png_at_size (bytes, width, height, error);
     }
   else if (gdk_is_jpeg (bytes))
     {
-      return gdk_load_jpeg (bytes, error);
+      return gdk_load_jpeg_at_size (bytes, width, height, error);
     }
   else if (gdk_is_tiff (bytes))
     {
-      return gdk_load_tiff (bytes, error);
+      return gdk_load_tiff_at_size (bytes, width, height, error);
+    }
+  else if (gdk_is_gtex (bytes))
+    {
+      /* There is no decoding to save, so always load it as-is */
+      return gdk_load_gtex (bytes, error);
     }
   else
     {
@@ -582,19 +671,73 @@ gdk_texture_new_from_bytes_internal (GBytes  *bytes,
     }
 }
 
+typedef struct
+{
+  int width;
+  int height;
+} TargetSize;
+
+static void
+pixbuf_size_prepared (GdkPixbufLoader *loader,
+                      int              width,
+                      int              height,
+                      gpointer         data)
+{
+  TargetSize *target = data;
+  guint factor;
+
+  factor = gdk_texture_get_downscale_factor (width, height, target->width, target->height);
+  if (factor > 1)
+    gdk_pixbuf_loader_set_size (loader, MAX (width / factor, 1), MAX (height / factor, 1));
+}
+
 static GdkTexture *
 gdk_texture_new_from_bytes_pixbuf (GBytes  *bytes,
+                                   int      width,
+                                   int      height,
                                    GError **error)
 {
   GInputStream *stream;
   GdkPixbuf *pixbuf;
   GdkTexture *texture;
 
-  stream = g_memory_input_stream_new_from_bytes (bytes);
-  pixbuf = gdk_pixbuf_new_from_stream (stream, NULL, error);
-  g_object_unref (stream);
-  if (pixbuf == NULL)
-    return NULL;
+  if (width > 0 || height > 0)
+    {
+      GdkPixbufLoader *loader;
+      TargetSize target = { width, height };
+
+      loader = gdk_pixbuf_loader_new ();
+      g_signal_connect (loader, "size-prepared", G_CALLBACK (pixbuf_size_prepared), &target);
+
+      if (!gdk_pixbuf_loader_write_bytes (loader, bytes, error) ||
+          !gdk_pixbuf_loader_close (loader, error))
+        {
+          gdk_pixbuf_loader_close (loader, NULL);
+          g_object_unref (loader);
+          return NULL;
+        }
+
+      pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+      if (pixbuf == NULL)
+        {
+          g_set_error_literal (error,
+                               GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_CORRUPT_IMAGE,
+                               _("Image file contains no image data"));
+          g_object_unref (loader);
+          return NULL;
+        }
+
+      g_object_ref (pixbuf);
+      g_object_unref (loader);
+    }
+  else
+    {
+      stream = g_memory_input_stream_new_from_bytes (bytes);
+      pixbuf = gdk_pixbuf_new_from_stream (stream, NULL, error);
+      g_object_unref (stream);
+      if (pixbuf == NULL)
+        return NULL;
+    }
 
   texture = gdk_texture_new_for_pixbuf (pixbuf);
   g_object_unref (pixbuf);
@@ -602,6 +745,30 @@ gdk_texture_new_from_bytes_pixbuf (GBytes  *bytes,
   return texture;
 }
 
+static GdkTexture *
+gdk_texture_new_from_bytes_with_size (GBytes  *bytes,
+                                      int      width,
+                                      int      height,
+                                      GError **error)
+{
+  GdkTexture *texture;
+  GError *internal_error = NULL;
+
+  texture = gdk_texture_new_from_bytes_internal (bytes, width, height, &internal_error);
+  if (texture)
+    return texture;
+
+  if (!g_error_matches (internal_error, GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_UNSUPPORTED_CONTENT) &&
+      !g_error_matches (internal_error, GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_UNSUPPORTED_FORMAT))
+    {
+      g_propagate_error (error, internal_error);
+      return NULL;
+    }
+
+  g_clear_error (&internal_error);
+
+  return gdk_texture_new_from_bytes_pixbuf (bytes, width, height, error);
+}
 
 /**
  * gdk_texture_new_from_bytes:
@@ -627,26 +794,92 @@ GdkTexture *
 gdk_texture_new_from_bytes (GBytes  *bytes,
                             GError **error)
 {
-  GdkTexture *texture;
-  GError *internal_error = NULL;
+  g_return_val_if_fail (bytes != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
+  return gdk_texture_new_from_bytes_with_size (bytes, -1, -1, error);
+}
+
+/**
+ * gdk_texture_new_from_bytes_at_size:
+ * @bytes: a `GBytes` containing the data to load
+ * @width: the width the texture will be drawn at, or -1
+ * @height: the height the texture will be drawn at, or -1
+ * @error: Return location for an error
+ *
+ * Creates a new texture by loading an image from memory,
+ * decoding it at a reduced size if it is much larger than
+ * @width x @height.
+ *
+ * Downscaling happens while decoding, where the image format
+ * allows it, so this is a lot cheaper than loading the image at
+ * full size and scaling it afterwards. The aspect ratio is kept
+ * and images are never scaled up. The resulting texture is not
+ * smaller than the requested size, but it may be larger, so callers
+ * should still be prepared to scale it when drawing.
+ *
+ * Pass -1 for @width or @height to not constrain that dimension.
+ *
+ * This function is threadsafe, like [ctor@Gdk.Texture.new_from_bytes].
+ *
+ * Return value: A newly-created `GdkTexture`
+ *
+ * Since: 4.14
+ */
+GdkTexture *
+gdk_texture_new_from_bytes_at_size (GBytes  *bytes,
+                                    int      width,
+                                    int      height,
+                                    GError **error)
+{
   g_return_val_if_fail (bytes != NULL, NULL);
+  g_return_val_if_fail (width == -1 || width > 0, NULL);
+  g_return_val_if_fail (height == -1 || height > 0, NULL);
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-  texture = gdk_texture_new_from_bytes_internal (bytes, &internal_error);
-  if (texture)
-    return texture;
+  return gdk_texture_new_from_bytes_with_size (bytes, width, height, error);
+}
 
-  if (!g_error_matches (internal_error, GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_UNSUPPORTED_CONTENT) &&
-      !g_error_matches (internal_error, GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_UNSUPPORTED_FORMAT))
-    {
-      g_propagate_error (error, internal_error);
-      return NULL;
-    }
+/**
+ * gdk_texture_new_from_file_at_size:
+ * @file: `GFile` to load
+ * @width: the width the texture will be drawn at, or -1
+ * @height: the height the texture will be drawn at, or -1
+ * @error: Return location for an error
+ *
+ * Creates a new texture by loading an image from a file,
+ * decoding it at a reduced size if it is much larger than
+ * @width x @height.
+ *
+ * See [ctor@Gdk.Texture.new_from_bytes_at_size] for details.
+ *
+ * Return value: A newly-created `GdkTexture`
+ *
+ * Since: 4.14
+ */
+GdkTexture *
+gdk_texture_new_from_file_at_size (GFile   *file,
+                                   int      width,
+                                   int      height,
+                                   GError **error)
+{
+  GBytes *bytes;
+  GdkTexture *texture;
 
-  g_clear_error (&internal_error);
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (width == -1 || width > 0, NULL);
+  g_return_val_if_fail (height == -1 || height > 0, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  bytes = gdk_texture_load_file_bytes (file, error);
+  if (bytes == NULL)
+    return NULL;
+
+  texture = gdk_texture_new_from_bytes_with_size (bytes, width, height, error);
+
+  g_bytes_unref (bytes);
 
-  return gdk_texture_new_from_bytes_pixbuf (bytes, error);
+  return texture;
 }
 
 /**
@@ -843,6 +1076,243 @@ gdk_texture_download_surface (GdkTexture *texture)
   return surface;
 }
 
+/* Averages 2x2 blocks of premultiplied ARGB32 pixels, the last row
+ * and column are repeated for odd sizes.
+ */
+static cairo_surface_t *
+downscale_surface_by_half (cairo_surface_t *source)
+{
+  cairo_surface_t *surface;
+  int src_width, src_height, src_stride;
+  int width, height, stride;
+  const guchar *src_data;
+  guchar *data;
+  int x, y, c;
+
+  src_width = cairo_image_surface_get_width (source);
+  src_height = cairo_image_surface_get_height (source);
+  src_stride = cairo_image_surface_get_stride (source);
+  src_data = cairo_image_surface_get_data (source);
+
+  width = MAX (1, (src_width + 1) / 2);
+  height = MAX (1, (src_height + 1) / 2);
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+    return surface;
+
+  stride = cairo_image_surface_get_stride (surface);
+  data = cairo_image_surface_get_data (surface);
+
+  for (y = 0; y < height; y++)
+    {
+      const guchar *row0 = src_data + 2 * y * src_stride;
+      const guchar *row1 = src_data + MIN (2 * y + 1, src_height - 1) * src_stride;
+      guchar *dest = data + y * stride;
+
+      for (x = 0; x < width; x++)
+        {
+          int x0 = 2 * x * 4;
+          int x1 = MIN (2 * x + 1, src_width - 1) * 4;
+
+          for (c = 0; c < 4; c++)
+            dest[4 * x + c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4;
+        }
+    }
+
+  cairo_surface_mark_dirty (surface);
+
+  return surface;
+}
+
+/* must be called with the mipmap lock held */
+static void
+gdk_texture_trim_mipmaps (GdkTexture  *keep,
+                          GSList     **garbage)
+{
+  GList *l, *prev;
+
+  for (l = mipmap_textures.tail; l && mipmap_cache_size > MIPMAP_CACHE_MAX_SIZE; l = prev)
+    {
+      prev = l->prev;
+      if (l->data != keep)
+        gdk_texture_clear_mipmaps (l->data, garbage);
+    }
+}
+
+/*
+ * gdk_texture_get_mipmap_level:
+ * @self: a texture
+ * @width: the width the texture is drawn at, in pixels
+ * @height: the height the texture is drawn at, in pixels
+ *
+ * Picks the smallest mipmap level that is still at least as big
+ * as the given size, so drawing it has the least to filter.
+ *
+ * Returns: the mipmap level or 0 if the texture should be drawn
+ *   at its own size
+ */
+guint
+gdk_texture_get_mipmap_level (GdkTexture *self,
+                              double      width,
+                              double      height)
+{
+  double factor;
+  guint level;
+
+  if (width < 1 || height < 1)
+    return 0;
+
+  factor = MIN (self->width / width, self->height / height);
+  for (level = 0; factor >= 2; level++)
+    factor /= 2;
+
+  return level;
+}
+
+/*
+ * gdk_texture_get_mipmap_surface:
+ * @self: a texture
+ * @level: the mipmap level, must be at least 1
+ *
+ * Gets a copy of the texture downscaled by 2^@level for drawing
+ * with cairo.
+ *
+ * The levels are cached with the texture, so drawing a texture
+ * at a small size repeatedly does not need to filter the full
+ * image every time. They are shared with gdk_texture_get_mipmap(),
+ * the total size of all cached levels is limited and the least
+ * recently used textures drop their levels first.
+ *
+ * Returns: (transfer full): a cairo image surface
+ */
+cairo_surface_t *
+gdk_texture_get_mipmap_surface (GdkTexture *self,
+                                guint       level)
+{
+  cairo_surface_t *surface;
+  GSList *garbage = NULL;
+  guint i, start;
+
+  g_return_val_if_fail (level > 0, NULL);
+
+  G_LOCK (mipmaps);
+
+  start = MIN (level, self->n_mipmaps);
+  while (start > 0 && self->mipmaps[start - 1].surface == NULL)
+    start--;
+
+  if (start == level)
+    {
+      surface = cairo_surface_reference (self->mipmaps[level - 1].surface);
+      g_queue_unlink (&mipmap_textures, &self->mipmap_link);
+      g_queue_push_head_link (&mipmap_textures, &self->mipmap_link);
+      G_UNLOCK (mipmaps);
+      return surface;
+    }
+
+  if (start > 0)
+    surface = cairo_surface_reference (self->mipmaps[start - 1].surface);
+  else
+    surface = NULL;
+
+  G_UNLOCK (mipmaps);
+
+  if (surface == NULL)
+    surface = gdk_texture_download_surface (self);
+
+  for (i = start + 1; i <= level; i++)
+    {
+      cairo_surface_t *next = downscale_surface_by_half (surface);
+      cairo_surface_destroy (surface);
+      surface = next;
+    }
+
+  if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+    return surface;
+
+  G_LOCK (mipmaps);
+
+  if (level > self->n_mipmaps)
+    {
+      self->mipmaps = g_renew (GdkTextureMipmap, self->mipmaps, level);
+      for (i = self->n_mipmaps; i < level; i++)
+        self->mipmaps[i] = (GdkTextureMipmap) { NULL, NULL };
+      self->n_mipmaps = level;
+    }
+
+  if (self->mipmaps[level - 1].surface == NULL)
+    {
+      gsize size = (gsize) cairo_image_surface_get_stride (surface) * cairo_image_surface_get_height (surface);
+
+      self->mipmaps[level - 1].surface = cairo_surface_reference (surface);
+      if (self->mipmap_size == 0)
+        g_queue_push_head_link (&mipmap_textures, &self->mipmap_link);
+      self->mipmap_size += size;
+      mipmap_cache_size += size;
+
+      gdk_texture_trim_mipmaps (self, &garbage);
+    }
+
+  G_UNLOCK (mipmaps);
+
+  g_slist_free_full (garbage, g_object_unref);
+
+  return surface;
+}
+
+/*
+ * gdk_texture_get_mipmap:
+ * @self: a texture
+ * @level: the mipmap level, must be at least 1
+ *
+ * Gets the texture downscaled by 2^@level as a memory texture.
+ *
+ * This is the same level that gdk_texture_get_mipmap_surface()
+ * returns, the texture shares its pixels and is cached with it.
+ * So renderers uploading the level can keep their copy attached
+ * to the returned texture, and it goes away with the level.
+ *
+ * Returns: (transfer full) (nullable): a memory texture or %NULL
+ *   if the level could not be created
+ */
+GdkTexture *
+gdk_texture_get_mipmap (GdkTexture *self,
+                        guint       level)
+{
+  cairo_surface_t *surface;
+  GdkTexture *texture;
+
+  g_return_val_if_fail (level > 0, NULL);
+
+  surface = gdk_texture_get_mipmap_surface (self, level);
+  if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS)
+    {
+      cairo_surface_destroy (surface);
+      return NULL;
+    }
+
+  G_LOCK (mipmaps);
+
+  /* The level might already have been trimmed again */
+  if (level <= self->n_mipmaps && self->mipmaps[level - 1].surface == surface)
+    {
+      if (self->mipmaps[level - 1].texture == NULL)
+        self->mipmaps[level - 1].texture = gdk_texture_new_for_surface (surface);
+      texture = g_object_ref (self->mipmaps[level - 1].texture);
+    }
+  else
+    texture = NULL;
+
+  G_UNLOCK (mipmaps);
+
+  if (texture == NULL)
+    texture = gdk_texture_new_for_surface (surface);
+
+  cairo_surface_destroy (surface);
+
+  return texture;
+}
+
 /**
  * gdk_texture_download:
  * @texture: a `GdkTexture`
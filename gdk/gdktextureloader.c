@@ -0,0 +1,626 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gdktextureloader.h"
+
+#include "gdkmemoryformatprivate.h"
+#include "gdktexture.h"
+
+#define DEFAULT_MEMORY_BUDGET (128 * 1024 * 1024)
+
+/**
+ * GdkTextureLoader:
+ *
+ * `GdkTextureLoader` decodes images into [class@Gdk.Texture]s on a
+ * bounded pool of worker threads.
+ *
+ * It is meant for views that show many images at once, such as
+ * thumbnail grids. Unlike [method@Gio.LoadableIcon.load_async], it does
+ * not start a thread per image. Pending requests are started in order
+ * of priority, and the priority of a request can be changed with
+ * [method@Gdk.TextureLoader.set_priority] while it is waiting, for
+ * example when its item scrolls into view. Requests that are cancelled
+ * before they are started are removed from the queue right away and
+ * complete without decoding anything.
+ *
+ * To limit the memory used by decoded images that have not been
+ * handed to the application yet, the loader stops starting new work
+ * while more than [property@Gdk.TextureLoader:memory-budget] bytes are
+ * waiting to be delivered.
+ *
+ * Since: 4.14
+ */
+
+typedef struct _LoadRequest LoadRequest;
+
+struct _LoadRequest
+{
+  GdkTextureLoader *loader;
+  GTask *task;
+  GFile *file;
+  guint id;
+  int width;
+  int height;
+  int priority;
+  guint64 serial;
+  gulong cancelled_id;
+  gsize size;
+};
+
+struct _GdkTextureLoader
+{
+  GObject parent_instance;
+
+  guint max_threads;
+  GThreadPool *pool;
+
+  GMutex lock;
+  GCond cond;
+  GPtrArray *pending;         /* LoadRequest, guarded by lock */
+  guint64 serial;             /* guarded by lock */
+  guint last_id;              /* guarded by lock */
+  gsize memory_budget;        /* guarded by lock */
+  gsize bytes_in_flight;      /* guarded by lock */
+};
+
+struct _GdkTextureLoaderClass
+{
+  GObjectClass parent_class;
+};
+
+enum
+{
+  PROP_0,
+  PROP_MAX_THREADS,
+  PROP_MEMORY_BUDGET,
+
+  N_PROPS
+};
+
+G_DEFINE_TYPE (GdkTextureLoader, gdk_texture_loader, G_TYPE_OBJECT)
+
+static GParamSpec *properties[N_PROPS] = { NULL, };
+
+static void
+load_request_free (gpointer data)
+{
+  LoadRequest *request = data;
+
+  g_object_unref (request->file);
+  g_free (request);
+}
+
+/* Returns the index of the request to start next.
+ * Must be called with the lock held.
+ */
+static guint
+gdk_texture_loader_find_next (GdkTextureLoader *self)
+{
+  LoadRequest *best = NULL;
+  guint i, best_index = 0;
+
+  for (i = 0; i < self->pending->len; i++)
+    {
+      LoadRequest *request = g_ptr_array_index (self->pending, i);
+
+      if (best == NULL ||
+          request->priority < best->priority ||
+          (request->priority == best->priority && request->serial < best->serial))
+        {
+          best = request;
+          best_index = i;
+        }
+    }
+
+  g_assert (best != NULL);
+
+  return best_index;
+}
+
+static void
+gdk_texture_loader_task_completed (GObject    *object,
+                                   GParamSpec *pspec,
+                                   gpointer    data)
+{
+  GdkTextureLoader *self = data;
+  LoadRequest *request = g_task_get_task_data (G_TASK (object));
+
+  g_mutex_lock (&self->lock);
+  self->bytes_in_flight -= request->size;
+  g_cond_broadcast (&self->cond);
+  g_mutex_unlock (&self->lock);
+}
+
+static void
+gdk_texture_loader_worker (gpointer data,
+                           gpointer user_data)
+{
+  GdkTextureLoader *self = user_data;
+  LoadRequest *request;
+  GCancellable *cancellable;
+  GdkTexture *texture;
+  GBytes *bytes;
+  GError *error = NULL;
+  guint index;
+
+  /* Every item pushed to the pool has a matching request, but
+   * cancelled requests are removed from the queue without waiting
+   * for a worker, so there may be nothing left for us to do.
+   */
+  g_mutex_lock (&self->lock);
+  while (self->pending->len > 0 &&
+         self->memory_budget > 0 &&
+         self->bytes_in_flight >= self->memory_budget)
+    g_cond_wait (&self->cond, &self->lock);
+
+  if (self->pending->len == 0)
+    {
+      g_mutex_unlock (&self->lock);
+      return;
+    }
+
+  index = gdk_texture_loader_find_next (self);
+  request = g_ptr_array_index (self->pending, index);
+  g_ptr_array_remove_index_fast (self->pending, index);
+  g_mutex_unlock (&self->lock);
+
+  cancellable = g_task_get_cancellable (request->task);
+  g_cancellable_disconnect (cancellable, request->cancelled_id);
+
+  if (g_task_return_error_if_cancelled (request->task))
+    {
+      g_object_unref (request->task);
+      return;
+    }
+
+  bytes = g_file_load_bytes (request->file, cancellable, NULL, &error);
+  if (bytes == NULL)
+    {
+      g_task_return_error (request->task, error);
+      g_object_unref (request->task);
+      return;
+    }
+
+  texture = gdk_texture_new_from_bytes_at_size (bytes, request->width, request->height, &error);
+  g_bytes_unref (bytes);
+  if (texture == NULL)
+    {
+      g_task_return_error (request->task, error);
+      g_object_unref (request->task);
+      return;
+    }
+
+  request->size = (gsize) gdk_texture_get_width (texture) *
+                  gdk_texture_get_height (texture) *
+                  gdk_memory_format_bytes_per_pixel (gdk_texture_get_format (texture));
+
+  g_mutex_lock (&self->lock);
+  self->bytes_in_flight += request->size;
+  g_mutex_unlock (&self->lock);
+
+  g_signal_connect_object (request->task, "notify::completed",
+                           G_CALLBACK (gdk_texture_loader_task_completed), self, 0);
+
+  g_task_return_pointer (request->task, texture, g_object_unref);
+  g_object_unref (request->task);
+}
+
+static gboolean
+gdk_texture_loader_return_cancelled (gpointer data)
+{
+  LoadRequest *request = data;
+
+  g_cancellable_disconnect (g_task_get_cancellable (request->task), request->cancelled_id);
+  g_task_return_error_if_cancelled (request->task);
+  g_object_unref (request->task);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Takes a cancelled request out of the queue, so it doesn't keep
+ * its place until a worker gets to it. The task is returned from
+ * an idle, since the cancellable can't be disconnected from here.
+ */
+static void
+gdk_texture_loader_request_cancelled (GCancellable *cancellable,
+                                      gpointer      data)
+{
+  LoadRequest *request = data;
+  GdkTextureLoader *self = request->loader;
+  GSource *source;
+  gboolean removed;
+
+  g_mutex_lock (&self->lock);
+  removed = g_ptr_array_remove_fast (self->pending, request);
+  g_cond_broadcast (&self->cond);
+  g_mutex_unlock (&self->lock);
+
+  /* A worker already took it */
+  if (!removed)
+    return;
+
+  source = g_idle_source_new ();
+  g_source_set_priority (source, G_PRIORITY_DEFAULT);
+  g_source_set_callback (source, gdk_texture_loader_return_cancelled, request, NULL);
+  g_source_set_static_name (source, "[gtk] gdk_texture_loader_return_cancelled");
+  g_source_attach (source, g_task_get_context (request->task));
+  g_source_unref (source);
+}
+
+static void
+gdk_texture_loader_constructed (GObject *object)
+{
+  GdkTextureLoader *self = GDK_TEXTURE_LOADER (object);
+
+  G_OBJECT_CLASS (gdk_texture_loader_parent_class)->constructed (object);
+
+  self->pool = g_thread_pool_new (gdk_texture_loader_worker,
+                                  self,
+                                  self->max_threads > 0 ? self->max_threads : g_get_num_processors (),
+                                  FALSE,
+                                  NULL);
+}
+
+static void
+gdk_texture_loader_finalize (GObject *object)
+{
+  GdkTextureLoader *self = GDK_TEXTURE_LOADER (object);
+
+  /* Every pending request holds a reference on us */
+  g_assert (self->pending->len == 0);
+
+  g_thread_pool_free (self->pool, FALSE, TRUE);
+  g_ptr_array_unref (self->pending);
+  g_mutex_clear (&self->lock);
+  g_cond_clear (&self->cond);
+
+  G_OBJECT_CLASS (gdk_texture_loader_parent_class)->finalize (object);
+}
+
+static void
+gdk_texture_loader_get_property (GObject    *object,
+                                 guint       prop_id,
+                                 GValue     *value,
+                                 GParamSpec *pspec)
+{
+  GdkTextureLoader *self = GDK_TEXTURE_LOADER (object);
+
+  switch (prop_id)
+    {
+    case PROP_MAX_THREADS:
+      g_value_set_uint (value, self->max_threads);
+      break;
+
+    case PROP_MEMORY_BUDGET:
+      g_value_set_uint64 (value, gdk_texture_loader_get_memory_budget (self));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+gdk_texture_loader_set_property (GObject      *object,
+                                 guint         prop_id,
+                                 const GValue *value,
+                                 GParamSpec   *pspec)
+{
+  GdkTextureLoader *self = GDK_TEXTURE_LOADER (object);
+
+  switch (prop_id)
+    {
+    case PROP_MAX_THREADS:
+      self->max_threads = g_value_get_uint (value);
+      break;
+
+    case PROP_MEMORY_BUDGET:
+      gdk_texture_loader_set_memory_budget (self, g_value_get_uint64 (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+gdk_texture_loader_class_init (GdkTextureLoaderClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->constructed = gdk_texture_loader_constructed;
+  gobject_class->finalize = gdk_texture_loader_finalize;
+  gobject_class->get_property = gdk_texture_loader_get_property;
+  gobject_class->set_property = gdk_texture_loader_set_property;
+
+  /**
+   * GdkTextureLoader:max-threads:
+   *
+   * The maximum number of images that are decoded at the same time.
+   *
+   * If 0, the number of processors is used.
+   *
+   * Since: 4.14
+   */
+  properties[PROP_MAX_THREADS] =
+    g_param_spec_uint ("max-threads", NULL, NULL,
+                       0, G_MAXINT, 0,
+                       G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * GdkTextureLoader:memory-budget:
+   *
+   * The number of bytes of decoded image data that may be waiting
+   * to be delivered before the loader stops decoding more images.
+   *
+   * If 0, the memory use is not limited.
+   *
+   * Since: 4.14
+   */
+  properties[PROP_MEMORY_BUDGET] =
+    g_param_spec_uint64 ("memory-budget", NULL, NULL,
+                         0, G_MAXUINT64, DEFAULT_MEMORY_BUDGET,
+                         G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (gobject_class, N_PROPS, properties);
+}
+
+static void
+gdk_texture_loader_init (GdkTextureLoader *self)
+{
+  g_mutex_init (&self->lock);
+  g_cond_init (&self->cond);
+  self->pending = g_ptr_array_new ();
+  self->memory_budget = DEFAULT_MEMORY_BUDGET;
+}
+
+/**
+ * gdk_texture_loader_new:
+ * @max_threads: the maximum number of images to decode at the same
+ *   time, or 0 to use the number of processors
+ *
+ * Creates a new `GdkTextureLoader`.
+ *
+ * Returns: the new `GdkTextureLoader`
+ *
+ * Since: 4.14
+ */
+GdkTextureLoader *
+gdk_texture_loader_new (guint max_threads)
+{
+  return g_object_new (GDK_TYPE_TEXTURE_LOADER,
+                       "max-threads", max_threads,
+                       NULL);
+}
+
+/**
+ * gdk_texture_loader_get_max_threads:
+ * @self: a `GdkTextureLoader`
+ *
+ * Returns the maximum number of images that @self decodes
+ * at the same time, as passed to [ctor@Gdk.TextureLoader.new].
+ *
+ * Returns: the maximum number of threads
+ *
+ * Since: 4.14
+ */
+guint
+gdk_texture_loader_get_max_threads (GdkTextureLoader *self)
+{
+  g_return_val_if_fail (GDK_IS_TEXTURE_LOADER (self), 0);
+
+  return self->max_threads;
+}
+
+/**
+ * gdk_texture_loader_get_memory_budget:
+ * @self: a `GdkTextureLoader`
+ *
+ * Returns the memory budget of @self.
+ *
+ * Returns: the memory budget, in bytes
+ *
+ * Since: 4.14
+ */
+gsize
+gdk_texture_loader_get_memory_budget (GdkTextureLoader *self)
+{
+  gsize memory_budget;
+
+  g_return_val_if_fail (GDK_IS_TEXTURE_LOADER (self), 0);
+
+  g_mutex_lock (&self->lock);
+  memory_budget = self->memory_budget;
+  g_mutex_unlock (&self->lock);
+
+  return memory_budget;
+}
+
+/**
+ * gdk_texture_loader_set_memory_budget:
+ * @self: a `GdkTextureLoader`
+ * @memory_budget: the budget, in bytes, or 0 for no limit
+ *
+ * Sets the number of bytes of decoded image data that may be
+ * waiting to be delivered before @self stops decoding more images.
+ *
+ * Since: 4.14
+ */
+void
+gdk_texture_loader_set_memory_budget (GdkTextureLoader *self,
+                                      gsize             memory_budget)
+{
+  g_return_if_fail (GDK_IS_TEXTURE_LOADER (self));
+
+  g_mutex_lock (&self->lock);
+  if (self->memory_budget == memory_budget)
+    {
+      g_mutex_unlock (&self->lock);
+      return;
+    }
+
+  self->memory_budget = memory_budget;
+  g_cond_broadcast (&self->cond);
+  g_mutex_unlock (&self->lock);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_MEMORY_BUDGET]);
+}
+
+/**
+ * gdk_texture_loader_load_async:
+ * @self: a `GdkTextureLoader`
+ * @file: the file to load
+ * @width: the width the texture will be drawn at, or -1
+ * @height: the height the texture will be drawn at, or -1
+ * @priority: the priority of the request. Lower values are
+ *   loaded first
+ * @cancellable: (nullable): optional `GCancellable` object
+ * @callback: (scope async): callback to call when the texture is loaded
+ * @user_data: (closure): data to pass to @callback
+ *
+ * Loads @file into a texture on one of the worker threads of @self.
+ *
+ * The image is decoded at a reduced size if it is much larger than
+ * @width x @height, see [ctor@Gdk.Texture.new_from_bytes_at_size].
+ *
+ * The returned ID can be passed to [method@Gdk.TextureLoader.set_priority]
+ * while the request is waiting to be started.
+ *
+ * Returns: the ID of the request
+ *
+ * Since: 4.14
+ */
+guint
+gdk_texture_loader_load_async (GdkTextureLoader    *self,
+                               GFile               *file,
+                               int                  width,
+                               int                  height,
+                               int                  priority,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
+{
+  LoadRequest *request;
+  guint id;
+
+  g_return_val_if_fail (GDK_IS_TEXTURE_LOADER (self), 0);
+  g_return_val_if_fail (G_IS_FILE (file), 0);
+  g_return_val_if_fail (width == -1 || width > 0, 0);
+  g_return_val_if_fail (height == -1 || height > 0, 0);
+  g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), 0);
+
+  request = g_new0 (LoadRequest, 1);
+  request->loader = self;
+  request->file = g_object_ref (file);
+  request->width = width;
+  request->height = height;
+  request->priority = priority;
+
+  request->task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (request->task, gdk_texture_loader_load_async);
+  g_task_set_priority (request->task, priority);
+  g_task_set_task_data (request->task, request, load_request_free);
+
+  /* The queue owns the task reference until a worker picks it up,
+   * or the request is cancelled.
+   */
+  g_mutex_lock (&self->lock);
+  request->serial = self->serial++;
+  if (++self->last_id == 0)
+    self->last_id = 1;
+  request->id = id = self->last_id;
+  g_ptr_array_add (self->pending, request);
+  g_mutex_unlock (&self->lock);
+
+  /* This calls the handler right away if we're already cancelled */
+  if (cancellable)
+    {
+      request->cancelled_id = g_cancellable_connect (cancellable,
+                                                     G_CALLBACK (gdk_texture_loader_request_cancelled),
+                                                     request, NULL);
+    }
+
+  g_thread_pool_push (self->pool, GUINT_TO_POINTER (1), NULL);
+
+  return id;
+}
+
+/**
+ * gdk_texture_loader_load_finish:
+ * @self: a `GdkTextureLoader`
+ * @result: a `GAsyncResult`
+ * @error: return location for an error
+ *
+ * Finishes a call to [method@Gdk.TextureLoader.load_async].
+ *
+ * Returns: (transfer full) (nullable): the loaded texture
+ *
+ * Since: 4.14
+ */
+GdkTexture *
+gdk_texture_loader_load_finish (GdkTextureLoader  *self,
+                                GAsyncResult      *result,
+                                GError           **error)
+{
+  g_return_val_if_fail (GDK_IS_TEXTURE_LOADER (self), NULL);
+  g_return_val_if_fail (g_task_is_valid (result, self), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == gdk_texture_loader_load_async, NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * gdk_texture_loader_set_priority:
+ * @self: a `GdkTextureLoader`
+ * @request_id: the ID of a request, as returned by
+ *   [method@Gdk.TextureLoader.load_async]
+ * @priority: the new priority
+ *
+ * Changes the priority of a request that is still waiting
+ * to be started. If the request has already been started,
+ * or was cancelled, nothing happens.
+ *
+ * This is useful to move images that have just become
+ * visible ahead of the ones that are scrolled out of view.
+ *
+ * Since: 4.14
+ */
+void
+gdk_texture_loader_set_priority (GdkTextureLoader *self,
+                                 guint             request_id,
+                                 int               priority)
+{
+  guint i;
+
+  g_return_if_fail (GDK_IS_TEXTURE_LOADER (self));
+  g_return_if_fail (request_id != 0);
+
+  g_mutex_lock (&self->lock);
+  for (i = 0; i < self->pending->len; i++)
+    {
+      LoadRequest *request = g_ptr_array_index (self->pending, i);
+
+      if (request->id == request_id)
+        {
+          request->priority = priority;
+          break;
+        }
+    }
+  g_mutex_unlock (&self->lock);
+}
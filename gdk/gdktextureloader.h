@@ -0,0 +1,61 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#if !defined (__GDK_H_INSIDE__) && !defined (GTK_COMPILATION)
+#error "Only <gdk/gdk.h> can be included directly."
+#endif
+
+#include <gdk/gdktypes.h>
+
+G_BEGIN_DECLS
+
+#define GDK_TYPE_TEXTURE_LOADER (gdk_texture_loader_get_type ())
+GDK_AVAILABLE_IN_4_14
+GDK_DECLARE_INTERNAL_TYPE (GdkTextureLoader, gdk_texture_loader, GDK, TEXTURE_LOADER, GObject)
+
+GDK_AVAILABLE_IN_4_14
+GdkTextureLoader *      gdk_texture_loader_new                  (guint                   max_threads);
+
+GDK_AVAILABLE_IN_4_14
+guint                   gdk_texture_loader_get_max_threads      (GdkTextureLoader       *self) G_GNUC_PURE;
+
+GDK_AVAILABLE_IN_4_14
+gsize                   gdk_texture_loader_get_memory_budget    (GdkTextureLoader       *self);
+GDK_AVAILABLE_IN_4_14
+void                    gdk_texture_loader_set_memory_budget    (GdkTextureLoader       *self,
+                                                                 gsize                   memory_budget);
+
+GDK_AVAILABLE_IN_4_14
+guint                   gdk_texture_loader_load_async           (GdkTextureLoader       *self,
+                                                                 GFile                  *file,
+                                                                 int                     width,
+                                                                 int                     height,
+                                                                 int                     priority,
+                                                                 GCancellable           *cancellable,
+                                                                 GAsyncReadyCallback     callback,
+                                                                 gpointer                user_data);
+GDK_AVAILABLE_IN_4_14
+GdkTexture *            gdk_texture_loader_load_finish          (GdkTextureLoader       *self,
+                                                                 GAsyncResult           *result,
+                                                                 GError                **error);
+
+GDK_AVAILABLE_IN_4_14
+void                    gdk_texture_loader_set_priority         (GdkTextureLoader       *self,
+                                                                 guint                   request_id,
+                                                                 int                     priority);
+
+G_END_DECLS
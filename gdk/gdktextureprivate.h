@@ -14,6 +14,14 @@ struct _GdkTextureChain
   GMutex lock;
 };
 
+typedef struct _GdkTextureMipmap GdkTextureMipmap;
+
+struct _GdkTextureMipmap
+{
+  cairo_surface_t *surface;
+  GdkTexture *texture;  /* lazy, shares the surface's pixels */
+};
+
 #define GDK_TEXTURE_CLASS(klass)            (G_TYPE_CHECK_CLASS_CAST ((klass), GDK_TYPE_TEXTURE, GdkTextureClass))
 #define GDK_IS_TEXTURE_CLASS(klass)         (G_TYPE_CHECK_CLASS_TYPE ((klass), GDK_TYPE_TEXTURE))
 #define GDK_TEXTURE_GET_CLASS(obj)          (G_TYPE_INSTANCE_GET_CLASS ((obj), GDK_TYPE_TEXTURE, GdkTextureClass))
@@ -38,6 +46,12 @@ struct _GdkTexture
   GdkTexture *next_texture;  /* no reference, guarded by chain lock */
   GdkTexture *previous_texture;  /* no reference, guarded by chain lock */
   cairo_region_t *diff_to_previous;  /* guarded by chain lock */
+
+  /* downscaled copies shared by all renderers, guarded by the mipmap lock */
+  GdkTextureMipmap *mipmaps;
+  guint n_mipmaps;
+  gsize mipmap_size;
+  GList mipmap_link;
 };
 
 struct _GdkTextureClass {
@@ -67,6 +81,14 @@ void                    gdk_texture_set_diff            (GdkTexture
                                                          GdkTexture             *previous,
                                                          cairo_region_t         *diff);
 
+guint                   gdk_texture_get_mipmap_level    (GdkTexture             *self,
+                                                         double                  width,
+                                                         double                  height);
+cairo_surface_t *       gdk_texture_get_mipmap_surface  (GdkTexture             *self,
+                                                         guint                   level);
+GdkTexture *            gdk_texture_get_mipmap          (GdkTexture             *self,
+                                                         guint                   level);
+
 gboolean                gdk_texture_set_render_data     (GdkTexture             *self,
                                                          gpointer                key,
                                                          gpointer                data,
@@ -75,5 +97,28 @@ void                    gdk_texture_clear_render_data   (GdkTexture
 gpointer                gdk_texture_get_render_data     (GdkTexture             *self,
                                                          gpointer                key);
 
+/* Returns the largest integer factor by which an image of the
+ * given size can be shrunk without becoming smaller than the
+ * target size. A target dimension of -1 is unconstrained.
+ */
+static inline guint
+gdk_texture_get_downscale_factor (guint width,
+                                  guint height,
+                                  int   target_width,
+                                  int   target_height)
+{
+  guint factor = G_MAXUINT;
+
+  if (target_width > 0)
+    factor = MIN (factor, width / target_width);
+  if (target_height > 0)
+    factor = MIN (factor, height / target_height);
+
+  if (factor == G_MAXUINT)
+    return 1;
+
+  return MAX (factor, 1);
+}
+
 G_END_DECLS
 
@@ -0,0 +1,192 @@
+/* GDK - The GIMP Drawing Kit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gdkgtexprivate.h"
+
+#include <glib/gi18n-lib.h>
+#include "gdkmemoryformatprivate.h"
+#include "gdkmemorytexture.h"
+#include "gdktextureprivate.h"
+#include "gdktexturedownloaderprivate.h"
+
+#include <string.h>
+
+/* {{{ File format */
+
+/* All header fields are stored in the byte order of the machine
+ * that wrote the file, which is also the byte order of the pixel
+ * data. The byte_order field lets us detect files from machines
+ * of the other endianness, which we refuse to load.
+ */
+#define GTEX_BYTE_ORDER 0x01020304
+
+/* Pixel data is aligned to this, so the pixels can be used in place */
+#define GTEX_DATA_ALIGNMENT 16
+
+typedef struct
+{
+  char signature[8];
+  guint32 byte_order;
+  guint32 format;
+  guint32 width;
+  guint32 height;
+  guint32 stride;
+  guint32 offset;
+} GtexHeader;
+
+G_STATIC_ASSERT (sizeof (GtexHeader) == 32);
+
+/* }}} */
+/* {{{ Public API */
+
+GdkTexture *
+gdk_load_gtex (GBytes  *bytes,
+               GError **error)
+{
+  GtexHeader header;
+  const guchar *data;
+  gsize size, bpp;
+  guint64 required;
+  GBytes *pixels;
+  GdkTexture *texture;
+
+  data = g_bytes_get_data (bytes, &size);
+
+  if (size < sizeof (GtexHeader))
+    {
+      g_set_error_literal (error,
+                           GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_CORRUPT_IMAGE,
+                           _("Image file is truncated"));
+      return NULL;
+    }
+
+  memcpy (&header, data, sizeof (GtexHeader));
+
+  if (header.byte_order != GTEX_BYTE_ORDER)
+    {
+      g_set_error_literal (error,
+                           GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_UNSUPPORTED_CONTENT,
+                           _("Image data was written with a different byte order"));
+      return NULL;
+    }
+
+  if (header.format >= GDK_MEMORY_N_FORMATS)
+    {
+      g_set_error (error,
+                   GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_UNSUPPORTED_CONTENT,
+                   _("Unsupported memory format %u"), header.format);
+      return NULL;
+    }
+
+  if (header.width == 0 || header.height == 0 ||
+      header.width > G_MAXINT || header.height > G_MAXINT)
+    {
+      g_set_error (error,
+                   GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_CORRUPT_IMAGE,
+                   _("Invalid image size %ux%u"), header.width, header.height);
+      return NULL;
+    }
+
+  if (header.offset % GTEX_DATA_ALIGNMENT != 0 ||
+      header.stride % gdk_memory_format_alignment (header.format) != 0)
+    {
+      g_set_error_literal (error,
+                           GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_CORRUPT_IMAGE,
+                           _("Image data is not aligned"));
+      return NULL;
+    }
+
+  bpp = gdk_memory_format_bytes_per_pixel (header.format);
+  required = (guint64) header.offset +
+             (guint64) (header.height - 1) * header.stride +
+             (guint64) header.width * bpp;
+
+  if (header.stride < (guint64) header.width * bpp ||
+      header.offset < sizeof (GtexHeader) ||
+      header.offset > size ||
+      required > size)
+    {
+      g_set_error_literal (error,
+                           GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_CORRUPT_IMAGE,
+                           _("Image file is truncated"));
+      return NULL;
+    }
+
+  /* This keeps a reference on the original bytes, which for
+   * resources and mapped files means the pixels stay in place
+   */
+  pixels = g_bytes_new_from_bytes (bytes,
+                                   header.offset,
+                                   (gsize) (header.height - 1) * header.stride + header.width * bpp);
+
+  texture = gdk_memory_texture_new (header.width, header.height,
+                                    header.format,
+                                    pixels,
+                                    header.stride);
+
+  g_bytes_unref (pixels);
+
+  return texture;
+}
+
+GBytes *
+gdk_save_gtex (GdkTexture *texture)
+{
+  GdkTextureDownloader downloader;
+  GdkMemoryFormat format;
+  GtexHeader header;
+  GBytes *bytes;
+  const guchar *pixels;
+  guchar *data;
+  gsize stride, row_size, out_stride;
+  int width, height, y;
+
+  width = gdk_texture_get_width (texture);
+  height = gdk_texture_get_height (texture);
+  format = gdk_texture_get_format (texture);
+
+  gdk_texture_downloader_init (&downloader, texture);
+  gdk_texture_downloader_set_format (&downloader, format);
+  bytes = gdk_texture_downloader_download_bytes (&downloader, &stride);
+  gdk_texture_downloader_finish (&downloader);
+  pixels = g_bytes_get_data (bytes, NULL);
+
+  row_size = width * gdk_memory_format_bytes_per_pixel (format);
+  out_stride = (row_size + gdk_memory_format_alignment (format) - 1) & ~(gdk_memory_format_alignment (format) - 1);
+
+  memcpy (header.signature, GTEX_SIGNATURE, sizeof (header.signature));
+  header.byte_order = GTEX_BYTE_ORDER;
+  header.format = format;
+  header.width = width;
+  header.height = height;
+  header.stride = out_stride;
+  header.offset = (sizeof (GtexHeader) + GTEX_DATA_ALIGNMENT - 1) & ~(GTEX_DATA_ALIGNMENT - 1);
+
+  data = g_malloc0 (header.offset + out_stride * height);
+  memcpy (data, &header, sizeof (GtexHeader));
+  for (y = 0; y < height; y++)
+    memcpy (data + header.offset + y * out_stride, pixels + y * stride, row_size);
+
+  g_bytes_unref (bytes);
+
+  return g_bytes_new_take (data, header.offset + out_stride * height);
+}
+
+/* }}} */
+
+/* vim:set foldmethod=marker expandtab: */
@@ -0,0 +1,43 @@
+/* GDK - The GIMP Drawing Kit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "gdktexture.h"
+#include <gio/gio.h>
+
+/* A trivial container for uncompressed pixel data in one of the
+ * GdkMemoryFormats, meant for shipping pre-decoded images in
+ * resources. Loading it does not copy the pixel data.
+ */
+#define GTEX_SIGNATURE "\x89GTEX\r\n\x1a"
+
+GdkTexture *gdk_load_gtex         (GBytes           *bytes,
+                                   GError          **error);
+
+GBytes *    gdk_save_gtex         (GdkTexture       *texture);
+
+static inline gboolean
+gdk_is_gtex (GBytes *bytes)
+{
+  const char *data;
+  gsize size;
+
+  data = g_bytes_get_data (bytes, &size);
+
+  return size > strlen (GTEX_SIGNATURE) &&
+         memcmp (data, GTEX_SIGNATURE, strlen (GTEX_SIGNATURE)) == 0;
+}
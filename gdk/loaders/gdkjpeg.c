@@ -22,7 +22,7 @@
 #include "gdkjpegprivate.h"
 
 #include <glib/gi18n-lib.h>
-#include "gdktexture.h"
+#include "gdktextureprivate.h"
 #include "gdktexturedownloaderprivate.h"
 
 #include "gdkprofilerprivate.h"
@@ -137,6 +137,15 @@ convert_cmyk_to_rgba (guchar *data,
 GdkTexture *
 gdk_load_jpeg (GBytes  *input_bytes,
                GError **error)
+{
+  return gdk_load_jpeg_at_size (input_bytes, -1, -1, error);
+}
+
+GdkTexture *
+gdk_load_jpeg_at_size (GBytes  *input_bytes,
+                       int      target_width,
+                       int      target_height,
+                       GError **error)
 {
   struct jpeg_decompress_struct info;
   struct error_handler_data jerr;
@@ -146,6 +155,7 @@ gdk_load_jpeg (GBytes  *input_bytes,
   GBytes *bytes;
   GdkTexture *texture;
   GdkMemoryFormat format;
+  guint factor;
   G_GNUC_UNUSED guint64 before = GDK_PROFILER_CURRENT_TIME;
 
   info.err = jpeg_std_error (&jerr.pub);
@@ -170,6 +180,22 @@ gdk_load_jpeg (GBytes  *input_bytes,
                 g_bytes_get_size (input_bytes));
 
   jpeg_read_header (&info, TRUE);
+
+  /* libjpeg can downscale by 1/2, 1/4 and 1/8 while doing the
+   * inverse DCT, which is a lot cheaper than decoding at full size.
+   */
+  factor = gdk_texture_get_downscale_factor (info.image_width, info.image_height,
+                                             target_width, target_height);
+  info.scale_num = 1;
+  if (factor >= 8)
+    info.scale_denom = 8;
+  else if (factor >= 4)
+    info.scale_denom = 4;
+  else if (factor >= 2)
+    info.scale_denom = 2;
+  else
+    info.scale_denom = 1;
+
   jpeg_start_decompress (&info);
 
   width = info.output_width;
@@ -313,6 +339,288 @@ gdk_save_jpeg (GdkTexture *texture)
   return g_bytes_new_with_free_func (data, size, (GDestroyNotify) free, NULL);
 }
 
+/* }}} */
+/* {{{ Incremental decoding */
+
+/* A data source that suspends the decoder when it runs out of
+ * data, as described in libjpeg.txt. Unconsumed data is kept at
+ * the end of the buffer until more data is appended.
+ */
+typedef struct
+{
+  struct jpeg_source_mgr pub;
+  GByteArray *buffer;
+  gsize skip;
+  gboolean eof;
+} StreamSource;
+
+static void
+stream_source_init (j_decompress_ptr cinfo)
+{
+}
+
+static boolean
+stream_source_fill (j_decompress_ptr cinfo)
+{
+  StreamSource *src = (StreamSource *) cinfo->src;
+  static const JOCTET eoi[2] = { 0xFF, JPEG_EOI };
+
+  if (!src->eof)
+    return FALSE;
+
+  /* Pretend the image ends here, to get whatever was decoded */
+  WARNMS (cinfo, JWRN_JPEG_EOF);
+  src->pub.next_input_byte = eoi;
+  src->pub.bytes_in_buffer = 2;
+
+  return TRUE;
+}
+
+static void
+stream_source_skip (j_decompress_ptr cinfo,
+                    long             num_bytes)
+{
+  StreamSource *src = (StreamSource *) cinfo->src;
+
+  if (num_bytes <= 0)
+    return;
+
+  if ((gsize) num_bytes > src->pub.bytes_in_buffer)
+    {
+      src->skip += num_bytes - src->pub.bytes_in_buffer;
+      src->pub.next_input_byte += src->pub.bytes_in_buffer;
+      src->pub.bytes_in_buffer = 0;
+    }
+  else
+    {
+      src->pub.next_input_byte += num_bytes;
+      src->pub.bytes_in_buffer -= num_bytes;
+    }
+}
+
+static void
+stream_source_term (j_decompress_ptr cinfo)
+{
+}
+
+static void
+stream_source_append (StreamSource *src,
+                      const guchar *data,
+                      gsize         size)
+{
+  gsize skip;
+
+  g_byte_array_remove_range (src->buffer, 0, src->buffer->len - src->pub.bytes_in_buffer);
+
+  skip = MIN (src->skip, size);
+  src->skip -= skip;
+  g_byte_array_append (src->buffer, data + skip, size - skip);
+
+  src->pub.next_input_byte = src->buffer->data;
+  src->pub.bytes_in_buffer = src->buffer->len;
+}
+
+typedef enum
+{
+  DECODER_HEADER,
+  DECODER_START,
+  DECODER_SCANLINES,
+  DECODER_FINISH,
+  DECODER_DONE,
+  DECODER_ERROR
+} DecoderState;
+
+struct _GdkJpegDecoder
+{
+  struct jpeg_decompress_struct info;
+  struct error_handler_data jerr;
+  StreamSource src;
+  GdkProgressiveImage *image;
+  DecoderState state;
+};
+
+GdkJpegDecoder *
+gdk_jpeg_decoder_new (GdkProgressiveImage *image)
+{
+  GdkJpegDecoder *self;
+
+  self = g_new0 (GdkJpegDecoder, 1);
+  self->image = image;
+  self->state = DECODER_HEADER;
+
+  self->info.err = jpeg_std_error (&self->jerr.pub);
+  self->jerr.pub.error_exit = fatal_error_handler;
+  self->jerr.pub.output_message = output_message_handler;
+
+  jpeg_create_decompress (&self->info);
+
+  /* Limit to 1GB to avoid OOM with large images */
+  self->info.mem->max_memory_to_use = 1024 * 1024 * 1024;
+
+  self->src.buffer = g_byte_array_new ();
+  self->src.pub.init_source = stream_source_init;
+  self->src.pub.fill_input_buffer = stream_source_fill;
+  self->src.pub.skip_input_data = stream_source_skip;
+  self->src.pub.resync_to_restart = jpeg_resync_to_restart;
+  self->src.pub.term_source = stream_source_term;
+  self->info.src = &self->src.pub;
+
+  return self;
+}
+
+/* Runs the decoder until it runs out of data */
+static gboolean
+gdk_jpeg_decoder_run (GdkJpegDecoder  *self,
+                      GError         **error)
+{
+  GdkProgressiveImage *image = self->image;
+
+  if (self->state == DECODER_ERROR)
+    {
+      g_set_error_literal (error,
+                           GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_CORRUPT_IMAGE,
+                           _("Error interpreting JPEG image file"));
+      return FALSE;
+    }
+
+  self->jerr.error = error;
+
+  if (sigsetjmp (self->jerr.setjmp_buffer, 1))
+    {
+      self->state = DECODER_ERROR;
+      return FALSE;
+    }
+
+  switch (self->state)
+    {
+    case DECODER_HEADER:
+      if (jpeg_read_header (&self->info, TRUE) == JPEG_SUSPENDED)
+        return TRUE;
+      self->state = DECODER_START;
+      G_GNUC_FALLTHROUGH;
+
+    case DECODER_START:
+      /* For progressive jpegs, this only returns once all
+       * scans have been read.
+       */
+      if (!jpeg_start_decompress (&self->info))
+        return TRUE;
+
+      image->width = self->info.output_width;
+      image->height = self->info.output_height;
+
+      switch ((int)self->info.out_color_space)
+        {
+        case JCS_GRAYSCALE:
+        case JCS_RGB:
+          image->stride = 3 * image->width;
+          image->format = GDK_MEMORY_R8G8B8;
+          break;
+        case JCS_CMYK:
+          image->stride = 4 * image->width;
+          image->format = GDK_MEMORY_R8G8B8A8_PREMULTIPLIED;
+          break;
+        default:
+          g_set_error (error,
+                       GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_UNSUPPORTED_CONTENT,
+                       _("Unsupported JPEG colorspace (%d)"), self->info.out_color_space);
+          self->state = DECODER_ERROR;
+          return FALSE;
+        }
+
+      image->data = g_try_malloc0_n (image->height, image->stride);
+      if (image->data == NULL)
+        {
+          g_set_error (error,
+                       GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_TOO_LARGE,
+                       _("Not enough memory for image size %ux%u"),
+                       (guint) image->width, (guint) image->height);
+          self->state = DECODER_ERROR;
+          return FALSE;
+        }
+
+      image->n_rows = 0;
+      image->n_final_rows = 0;
+      image->pass = 0;
+      self->state = DECODER_SCANLINES;
+      G_GNUC_FALLTHROUGH;
+
+    case DECODER_SCANLINES:
+      while (self->info.output_scanline < self->info.output_height)
+        {
+          guchar *row = image->data + self->info.output_scanline * image->stride;
+
+          if (jpeg_read_scanlines (&self->info, &row, 1) == 0)
+            return TRUE;
+
+          if (self->info.out_color_space == JCS_GRAYSCALE)
+            convert_grayscale_to_rgb (row, image->width, 1, image->stride);
+          else if (self->info.out_color_space == JCS_CMYK)
+            convert_cmyk_to_rgba (row, image->width, 1, image->stride);
+
+          image->n_rows = self->info.output_scanline;
+          image->n_final_rows = image->n_rows;
+        }
+      self->state = DECODER_FINISH;
+      G_GNUC_FALLTHROUGH;
+
+    case DECODER_FINISH:
+      if (!jpeg_finish_decompress (&self->info))
+        return TRUE;
+      image->done = TRUE;
+      self->state = DECODER_DONE;
+      G_GNUC_FALLTHROUGH;
+
+    case DECODER_DONE:
+      break;
+
+    case DECODER_ERROR:
+    default:
+      g_assert_not_reached ();
+    }
+
+  return TRUE;
+}
+
+gboolean
+gdk_jpeg_decoder_feed (GdkJpegDecoder  *self,
+                       const guchar    *data,
+                       gsize            size,
+                       GError         **error)
+{
+  stream_source_append (&self->src, data, size);
+
+  return gdk_jpeg_decoder_run (self, error);
+}
+
+gboolean
+gdk_jpeg_decoder_finish (GdkJpegDecoder  *self,
+                         GError         **error)
+{
+  self->src.eof = TRUE;
+
+  if (!gdk_jpeg_decoder_run (self, error))
+    return FALSE;
+
+  if (!self->image->done)
+    {
+      g_set_error_literal (error,
+                           GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_CORRUPT_IMAGE,
+                           _("Image data is truncated"));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+void
+gdk_jpeg_decoder_free (GdkJpegDecoder *self)
+{
+  jpeg_destroy_decompress (&self->info);
+  g_byte_array_unref (self->src.buffer);
+  g_free (self);
+}
+
 /* }}} */
 
 /* vim:set foldmethod=marker expandtab: */
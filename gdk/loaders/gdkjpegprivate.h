@@ -18,15 +18,31 @@
 #pragma once
 
 #include "gdkmemorytexture.h"
+#include "gdkprogressiveimageprivate.h"
 #include <gio/gio.h>
 
 #define JPEG_SIGNATURE "\xff\xd8"
 
 GdkTexture *gdk_load_jpeg         (GBytes           *bytes,
                                    GError          **error);
+GdkTexture *gdk_load_jpeg_at_size (GBytes           *bytes,
+                                   int               width,
+                                   int               height,
+                                   GError          **error);
 
 GBytes     *gdk_save_jpeg         (GdkTexture     *texture);
 
+typedef struct _GdkJpegDecoder GdkJpegDecoder;
+
+GdkJpegDecoder *gdk_jpeg_decoder_new    (GdkProgressiveImage  *image);
+gboolean        gdk_jpeg_decoder_feed   (GdkJpegDecoder       *self,
+                                         const guchar         *data,
+                                         gsize                 size,
+                                         GError              **error);
+gboolean        gdk_jpeg_decoder_finish (GdkJpegDecoder       *self,
+                                         GError              **error);
+void            gdk_jpeg_decoder_free   (GdkJpegDecoder       *self);
+
 static inline gboolean
 gdk_is_jpeg (GBytes *bytes)
 {
@@ -23,6 +23,7 @@
 #include "gdkmemoryformatprivate.h"
 #include "gdkmemorytexture.h"
 #include "gdkprofilerprivate.h"
+#include "gdktextureprivate.h"
 #include "gdktexturedownloaderprivate.h"
 #include "gsk/gl/fp16private.h"
 #include <png.h>
@@ -126,25 +127,235 @@ png_simple_warning_callback (png_structp     png,
 {
 }
 
+/* }}} */
+/* {{{ Format handling */
+
+/* Set up the transformations that turn any png into one
+ * of the memory formats handled by png_get_memory_format()
+ */
+static void
+png_set_transformations (png_struct *png,
+                         png_info   *info,
+                         int         color_type,
+                         int         depth)
+{
+  if (color_type == PNG_COLOR_TYPE_PALETTE)
+    png_set_palette_to_rgb (png);
+
+  if (color_type == PNG_COLOR_TYPE_GRAY)
+    png_set_expand_gray_1_2_4_to_8 (png);
+
+  if (png_get_valid (png, info, PNG_INFO_tRNS))
+    png_set_tRNS_to_alpha (png);
+
+  if (depth < 8)
+    png_set_packing (png);
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+  png_set_swap (png);
+#endif
+}
+
+static gboolean
+png_get_memory_format (int              color_type,
+                       int              depth,
+                       GdkMemoryFormat *format)
+{
+  if (depth != 8 && depth != 16)
+    return FALSE;
+
+  switch (color_type)
+    {
+    case PNG_COLOR_TYPE_RGB_ALPHA:
+      *format = depth == 8 ? GDK_MEMORY_R8G8B8A8 : GDK_MEMORY_R16G16B16A16;
+      return TRUE;
+    case PNG_COLOR_TYPE_RGB:
+      *format = depth == 8 ? GDK_MEMORY_R8G8B8 : GDK_MEMORY_R16G16B16;
+      return TRUE;
+    case PNG_COLOR_TYPE_GRAY:
+      *format = depth == 8 ? GDK_MEMORY_G8 : GDK_MEMORY_G16;
+      return TRUE;
+    case PNG_COLOR_TYPE_GRAY_ALPHA:
+      *format = depth == 8 ? GDK_MEMORY_G8A8 : GDK_MEMORY_G16A16;
+      return TRUE;
+    default:
+      return FALSE;
+    }
+}
+
+/* }}} */
+/* {{{ Downscaling */
+
+/* Box-filters rows of 8 or 16 bit samples by an integer factor
+ * as they are decoded, so we never need the full-size image in
+ * memory. Color is weighted by alpha, so that fully transparent
+ * pixels don't bleed into their neighbours.
+ */
+typedef struct
+{
+  guint factor;
+  guint src_width;
+  guint width;
+  guint n_channels;
+  gboolean has_alpha;
+  gboolean is_16bit;
+  guint64 *sums;
+  guint n_rows;
+  guchar *dest;
+  gsize dest_stride;
+} Downscaler;
+
+static void
+downscaler_init (Downscaler *ds,
+                 guint       factor,
+                 guint       src_width,
+                 guint       n_channels,
+                 gboolean    has_alpha,
+                 gboolean    is_16bit,
+                 guchar     *dest,
+                 gsize       dest_stride)
+{
+  ds->factor = factor;
+  ds->src_width = src_width;
+  ds->width = (src_width + factor - 1) / factor;
+  ds->n_channels = n_channels;
+  ds->has_alpha = has_alpha;
+  ds->is_16bit = is_16bit;
+  ds->sums = g_new0 (guint64, ds->width * n_channels);
+  ds->n_rows = 0;
+  ds->dest = dest;
+  ds->dest_stride = dest_stride;
+}
+
+static inline guint
+downscaler_get (Downscaler   *ds,
+                const guchar *row,
+                gsize         i)
+{
+  if (ds->is_16bit)
+    return ((const guint16 *) row)[i];
+  else
+    return row[i];
+}
+
+static inline void
+downscaler_set (Downscaler *ds,
+                guchar     *row,
+                gsize       i,
+                guint       value)
+{
+  if (ds->is_16bit)
+    ((guint16 *) row)[i] = value;
+  else
+    row[i] = value;
+}
+
+static void
+downscaler_flush (Downscaler *ds)
+{
+  guint n = ds->n_channels;
+  guint x, c;
+
+  if (ds->n_rows == 0)
+    return;
+
+  for (x = 0; x < ds->width; x++)
+    {
+      guint64 *sum = &ds->sums[x * n];
+      guint64 count = MIN (ds->factor, ds->src_width - x * ds->factor) * ds->n_rows;
+
+      if (ds->has_alpha)
+        {
+          guint64 alpha = sum[n - 1];
+
+          for (c = 0; c < n - 1; c++)
+            downscaler_set (ds, ds->dest, x * n + c, alpha ? sum[c] / alpha : 0);
+          downscaler_set (ds, ds->dest, x * n + n - 1, alpha / count);
+        }
+      else
+        {
+          for (c = 0; c < n; c++)
+            downscaler_set (ds, ds->dest, x * n + c, sum[c] / count);
+        }
+    }
+
+  memset (ds->sums, 0, sizeof (guint64) * ds->width * n);
+  ds->n_rows = 0;
+  ds->dest += ds->dest_stride;
+}
+
+static void
+downscaler_push_row (Downscaler   *ds,
+                     const guchar *row)
+{
+  guint n = ds->n_channels;
+  guint x, c;
+
+  for (x = 0; x < ds->src_width; x++)
+    {
+      guint64 *sum = &ds->sums[(x / ds->factor) * n];
+
+      if (ds->has_alpha)
+        {
+          guint alpha = downscaler_get (ds, row, x * n + n - 1);
+
+          for (c = 0; c < n - 1; c++)
+            sum[c] += (guint64) downscaler_get (ds, row, x * n + c) * alpha;
+          sum[n - 1] += alpha;
+        }
+      else
+        {
+          for (c = 0; c < n; c++)
+            sum[c] += downscaler_get (ds, row, x * n + c);
+        }
+    }
+
+  ds->n_rows++;
+  if (ds->n_rows == ds->factor)
+    downscaler_flush (ds);
+}
+
+static void
+downscaler_finish (Downscaler *ds)
+{
+  downscaler_flush (ds);
+  g_clear_pointer (&ds->sums, g_free);
+}
+
 /* }}} */
 /* {{{ Public API */ 
 
 GdkTexture *
 gdk_load_png (GBytes  *bytes,
               GError **error)
+{
+  return gdk_load_png_at_size (bytes, -1, -1, error);
+}
+
+GdkTexture *
+gdk_load_png_at_size (GBytes  *bytes,
+                      int      target_width,
+                      int      target_height,
+                      GError **error)
 {
   png_io io;
   png_struct *png = NULL;
   png_info *info;
   guint width, height;
-  gsize i, stride;
+  guint src_width, src_height;
+  guint out_width, out_height;
+  gsize i, stride, out_stride;
   int depth, color_type;
   int interlace;
   GdkMemoryFormat format;
   guchar *buffer = NULL;
+  guchar *out_buffer = NULL;
   guchar **row_pointers = NULL;
+  Downscaler ds = { 0, };
   GBytes *out_bytes;
   GdkTexture *texture;
+  guint factor;
+  gboolean first_pass_only = FALSE;
   int bpp;
   G_GNUC_UNUSED gint64 before = GDK_PROFILER_CURRENT_TIME;
 
@@ -170,7 +381,9 @@ gdk_load_png (GBytes  *bytes,
   if (sigsetjmp (png_jmpbuf (png), 1))
     {
       g_free (buffer);
+      g_free (out_buffer);
       g_free (row_pointers);
+      g_free (ds.sums);
       png_destroy_read_struct (&png, &info, NULL);
       return NULL;
     }
@@ -181,24 +394,20 @@ gdk_load_png (GBytes  *bytes,
                 &width, &height, &depth,
                 &color_type, &interlace, NULL, NULL);
 
-  if (color_type == PNG_COLOR_TYPE_PALETTE)
-    png_set_palette_to_rgb (png);
-
-  if (color_type == PNG_COLOR_TYPE_GRAY)
-    png_set_expand_gray_1_2_4_to_8 (png);
-
-  if (png_get_valid (png, info, PNG_INFO_tRNS))
-    png_set_tRNS_to_alpha (png);
+  factor = gdk_texture_get_downscale_factor (width, height, target_width, target_height);
 
-  if (depth < 8)
-    png_set_packing (png);
+  png_set_transformations (png, info, color_type, depth);
 
   if (interlace != PNG_INTERLACE_NONE)
-    png_set_interlace_handling (png);
-
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-  png_set_swap (png);
-#endif
+    {
+      /* The first Adam7 pass is a 1:8 subsampled image of its own,
+       * so for big reductions we can stop decoding after it.
+       */
+      if (factor >= 8)
+        first_pass_only = TRUE;
+      else
+        png_set_interlace_handling (png);
+    }
 
   png_read_update_info (png, info);
   png_get_IHDR (png, info,
@@ -213,49 +422,8 @@ gdk_load_png (GBytes  *bytes,
       return NULL;
     }
 
-  switch (color_type)
+  if (!png_get_memory_format (color_type, depth, &format))
     {
-    case PNG_COLOR_TYPE_RGB_ALPHA:
-      if (depth == 8)
-        {
-          format = GDK_MEMORY_R8G8B8A8;
-        }
-      else
-        {
-          format = GDK_MEMORY_R16G16B16A16;
-        }
-      break;
-    case PNG_COLOR_TYPE_RGB:
-      if (depth == 8)
-        {
-          format = GDK_MEMORY_R8G8B8;
-        }
-      else if (depth == 16)
-        {
-          format = GDK_MEMORY_R16G16B16;
-        }
-      break;
-    case PNG_COLOR_TYPE_GRAY:
-      if (depth == 8)
-        {
-          format = GDK_MEMORY_G8;
-        }
-      else if (depth == 16)
-        {
-          format = GDK_MEMORY_G16;
-        }
-      break;
-    case PNG_COLOR_TYPE_GRAY_ALPHA:
-      if (depth == 8)
-        {
-          format = GDK_MEMORY_G8A8;
-        }
-      else if (depth == 16)
-        {
-          format = GDK_MEMORY_G16A16;
-        }
-      break;
-    default:
       png_destroy_read_struct (&png, &info, NULL);
       g_set_error (error,
                    GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_UNSUPPORTED_CONTENT,
@@ -273,31 +441,110 @@ gdk_load_png (GBytes  *bytes,
       return NULL;
     }
 
-  buffer = g_try_malloc_n (height, stride);
-  row_pointers = g_try_malloc_n (height, sizeof (char *));
+  if (first_pass_only)
+    {
+      src_width = PNG_PASS_COLS (width, 0);
+      src_height = PNG_PASS_ROWS (height, 0);
+      factor /= 8;
+    }
+  else
+    {
+      src_width = width;
+      src_height = height;
+    }
+
+  out_width = (src_width + factor - 1) / factor;
+  out_height = (src_height + factor - 1) / factor;
+  out_stride = out_width * bpp;
+  out_stride += (8 - out_stride % 8) % 8;
 
-  if (!buffer || !row_pointers)
+  if (first_pass_only || (factor > 1 && interlace == PNG_INTERLACE_NONE))
     {
+      /* Decode row by row, only keeping the downscaled image */
+      buffer = g_try_malloc (stride);
+      out_buffer = g_try_malloc_n (out_height, out_stride);
+
+      if (!buffer || !out_buffer)
+        {
+          g_free (buffer);
+          g_free (out_buffer);
+          png_destroy_read_struct (&png, &info, NULL);
+          g_set_error (error,
+                       GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_TOO_LARGE,
+                       _("Not enough memory for image size %ux%u"), out_width, out_height);
+          return NULL;
+        }
+
+      downscaler_init (&ds, factor, src_width,
+                       bpp / (depth / 8), color_type & PNG_COLOR_MASK_ALPHA, depth == 16,
+                       out_buffer, out_stride);
+
+      for (i = 0; i < src_height; i++)
+        {
+          png_read_row (png, buffer, NULL);
+          downscaler_push_row (&ds, buffer);
+        }
+
+      downscaler_finish (&ds);
+
+      /* Don't bother decoding the remaining passes */
+      if (!first_pass_only)
+        png_read_end (png, info);
+
       g_free (buffer);
-      g_free (row_pointers);
-      png_destroy_read_struct (&png, &info, NULL);
-      g_set_error (error,
-                   GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_TOO_LARGE,
-                   _("Not enough memory for image size %ux%u"), width, height);
-      return NULL;
     }
+  else
+    {
+      buffer = g_try_malloc_n (height, stride);
+      row_pointers = g_try_malloc_n (height, sizeof (char *));
+
+      if (!buffer || !row_pointers)
+        {
+          g_free (buffer);
+          g_free (row_pointers);
+          png_destroy_read_struct (&png, &info, NULL);
+          g_set_error (error,
+                       GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_TOO_LARGE,
+                       _("Not enough memory for image size %ux%u"), width, height);
+          return NULL;
+        }
+
+      for (i = 0; i < height; i++)
+        row_pointers[i] = &buffer[i * stride];
 
-  for (i = 0; i < height; i++)
-    row_pointers[i] = &buffer[i * stride];
+      png_read_image (png, row_pointers);
+      png_read_end (png, info);
 
-  png_read_image (png, row_pointers);
-  png_read_end (png, info);
+      if (factor > 1)
+        {
+          /* Interlaced images need to be fully decoded, but we can
+           * still avoid keeping them around at full size.
+           */
+          out_buffer = g_malloc_n (out_height, out_stride);
+
+          downscaler_init (&ds, factor, width,
+                           bpp / (depth / 8), color_type & PNG_COLOR_MASK_ALPHA, depth == 16,
+                           out_buffer, out_stride);
+
+          for (i = 0; i < height; i++)
+            downscaler_push_row (&ds, row_pointers[i]);
 
-  out_bytes = g_bytes_new_take (buffer, height * stride);
-  texture = gdk_memory_texture_new (width, height, format, out_bytes, stride);
+          downscaler_finish (&ds);
+
+          g_free (buffer);
+        }
+      else
+        {
+          out_buffer = buffer;
+        }
+
+      g_free (row_pointers);
+    }
+
+  out_bytes = g_bytes_new_take (out_buffer, out_height * out_stride);
+  texture = gdk_memory_texture_new (out_width, out_height, format, out_bytes, out_stride);
   g_bytes_unref (out_bytes);
 
-  g_free (row_pointers);
   png_destroy_read_struct (&png, &info, NULL);
 
   if (GDK_PROFILER_IS_RUNNING)
@@ -310,26 +557,40 @@ gdk_load_png (GBytes  *bytes,
   return texture;
 }
 
-GBytes *
-gdk_save_png (GdkTexture *texture)
-{
-  png_struct *png = NULL;
-  png_info *info;
-  png_io io = { NULL, 0, 0 };
-  int width, height;
-  int y;
+/* The memory formats that libpng can write without us converting
+ * them first, with the transformations needed to do so.
+ */
+static const struct {
   GdkMemoryFormat format;
-  GdkTextureDownloader downloader;
-  GBytes *bytes;
-  gsize stride;
-  const guchar *data;
   int png_format;
   int depth;
-
-  width = gdk_texture_get_width (texture);
-  height = gdk_texture_get_height (texture);
-  format = gdk_texture_get_format (texture);
-
+  guint bgr : 1;
+  guint swap_alpha : 1;
+  guint strip_filler : 1;
+  int filler_location;
+} png_save_formats[] = {
+  { GDK_MEMORY_R8G8B8A8,     PNG_COLOR_TYPE_RGB_ALPHA,  8,  0, 0, 0, 0 },
+  { GDK_MEMORY_B8G8R8A8,     PNG_COLOR_TYPE_RGB_ALPHA,  8,  1, 0, 0, 0 },
+  { GDK_MEMORY_A8R8G8B8,     PNG_COLOR_TYPE_RGB_ALPHA,  8,  0, 1, 0, 0 },
+  { GDK_MEMORY_A8B8G8R8,     PNG_COLOR_TYPE_RGB_ALPHA,  8,  1, 1, 0, 0 },
+  { GDK_MEMORY_R8G8B8,       PNG_COLOR_TYPE_RGB,        8,  0, 0, 0, 0 },
+  { GDK_MEMORY_B8G8R8,       PNG_COLOR_TYPE_RGB,        8,  1, 0, 0, 0 },
+  { GDK_MEMORY_R8G8B8X8,     PNG_COLOR_TYPE_RGB,        8,  0, 0, 1, PNG_FILLER_AFTER },
+  { GDK_MEMORY_B8G8R8X8,     PNG_COLOR_TYPE_RGB,        8,  1, 0, 1, PNG_FILLER_AFTER },
+  { GDK_MEMORY_X8R8G8B8,     PNG_COLOR_TYPE_RGB,        8,  0, 0, 1, PNG_FILLER_BEFORE },
+  { GDK_MEMORY_X8B8G8R8,     PNG_COLOR_TYPE_RGB,        8,  1, 0, 1, PNG_FILLER_BEFORE },
+  { GDK_MEMORY_G8,           PNG_COLOR_TYPE_GRAY,       8,  0, 0, 0, 0 },
+  { GDK_MEMORY_G8A8,         PNG_COLOR_TYPE_GRAY_ALPHA, 8,  0, 0, 0, 0 },
+  { GDK_MEMORY_R16G16B16A16, PNG_COLOR_TYPE_RGB_ALPHA,  16, 0, 0, 0, 0 },
+  { GDK_MEMORY_R16G16B16,    PNG_COLOR_TYPE_RGB,        16, 0, 0, 0, 0 },
+  { GDK_MEMORY_G16,          PNG_COLOR_TYPE_GRAY,       16, 0, 0, 0, 0 },
+  { GDK_MEMORY_G16A16,       PNG_COLOR_TYPE_GRAY_ALPHA, 16, 0, 0, 0, 0 },
+};
+
+/* The format to convert to for formats that png can't store */
+static GdkMemoryFormat
+png_get_save_conversion_format (GdkMemoryFormat format)
+{
   switch (format)
     {
     case GDK_MEMORY_B8G8R8A8_PREMULTIPLIED:
@@ -340,10 +601,7 @@ gdk_save_png (GdkTexture *texture)
     case GDK_MEMORY_A8R8G8B8:
     case GDK_MEMORY_R8G8B8A8:
     case GDK_MEMORY_A8B8G8R8:
-      format = GDK_MEMORY_R8G8B8A8;
-      png_format = PNG_COLOR_TYPE_RGB_ALPHA;
-      depth = 8;
-      break;
+      return GDK_MEMORY_R8G8B8A8;
 
     case GDK_MEMORY_R8G8B8:
     case GDK_MEMORY_B8G8R8:
@@ -351,10 +609,7 @@ gdk_save_png (GdkTexture *texture)
     case GDK_MEMORY_X8R8G8B8:
     case GDK_MEMORY_B8G8R8X8:
     case GDK_MEMORY_X8B8G8R8:
-      format = GDK_MEMORY_R8G8B8;
-      png_format = PNG_COLOR_TYPE_RGB;
-      depth = 8;
-      break;
+      return GDK_MEMORY_R8G8B8;
 
     case GDK_MEMORY_R16G16B16A16:
     case GDK_MEMORY_R16G16B16A16_PREMULTIPLIED:
@@ -362,54 +617,82 @@ gdk_save_png (GdkTexture *texture)
     case GDK_MEMORY_R16G16B16A16_FLOAT_PREMULTIPLIED:
     case GDK_MEMORY_R32G32B32A32_FLOAT:
     case GDK_MEMORY_R32G32B32A32_FLOAT_PREMULTIPLIED:
-      format = GDK_MEMORY_R16G16B16A16;
-      png_format = PNG_COLOR_TYPE_RGB_ALPHA;
-      depth = 16;
-      break;
+      return GDK_MEMORY_R16G16B16A16;
 
     case GDK_MEMORY_R16G16B16:
     case GDK_MEMORY_R16G16B16_FLOAT:
     case GDK_MEMORY_R32G32B32_FLOAT:
-      format = GDK_MEMORY_R16G16B16;
-      png_format = PNG_COLOR_TYPE_RGB;
-      depth = 16;
-      break;
+      return GDK_MEMORY_R16G16B16;
 
     case GDK_MEMORY_G8:
-      format = GDK_MEMORY_G8;
-      png_format = PNG_COLOR_TYPE_GRAY;
-      depth = 8;
-      break;
+      return GDK_MEMORY_G8;
 
     case GDK_MEMORY_G8A8_PREMULTIPLIED:
     case GDK_MEMORY_G8A8:
     case GDK_MEMORY_A8:
-      format = GDK_MEMORY_G8A8;
-      png_format = PNG_COLOR_TYPE_GRAY_ALPHA;
-      depth = 8;
-      break;
+      return GDK_MEMORY_G8A8;
 
     case GDK_MEMORY_G16:
-      format = GDK_MEMORY_G16;
-      png_format = PNG_COLOR_TYPE_GRAY;
-      depth = 16;
-      break;
+      return GDK_MEMORY_G16;
 
     case GDK_MEMORY_G16A16_PREMULTIPLIED:
     case GDK_MEMORY_G16A16:
     case GDK_MEMORY_A16:
     case GDK_MEMORY_A16_FLOAT:
     case GDK_MEMORY_A32_FLOAT:
-      format = GDK_MEMORY_G16A16;
-      png_format = PNG_COLOR_TYPE_GRAY_ALPHA;
-      depth = 16;
-      break;
+      return GDK_MEMORY_G16A16;
 
     case GDK_MEMORY_N_FORMATS:
     default:
       g_assert_not_reached ();
+      return GDK_MEMORY_R8G8B8A8;
+    }
+}
+
+static int
+png_find_save_format (GdkMemoryFormat format)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (png_save_formats); i++)
+    {
+      if (png_save_formats[i].format == format)
+        return i;
     }
 
+  return -1;
+}
+
+GBytes *
+gdk_save_png (GdkTexture *texture)
+{
+  return gdk_save_png_with_flags (texture, GDK_PNG_SAVE_DEFAULT);
+}
+
+GBytes *
+gdk_save_png_with_flags (GdkTexture      *texture,
+                         GdkPngSaveFlags  flags)
+{
+  png_struct *png = NULL;
+  png_info *info;
+  png_io io = { NULL, 0, 0 };
+  int width, height;
+  int y;
+  GdkTextureDownloader downloader;
+  GBytes *bytes;
+  gsize stride;
+  const guchar *data;
+  int f;
+
+  width = gdk_texture_get_width (texture);
+  height = gdk_texture_get_height (texture);
+
+  /* Avoid a conversion if libpng can deal with the format itself */
+  f = png_find_save_format (gdk_texture_get_format (texture));
+  if (f < 0)
+    f = png_find_save_format (png_get_save_conversion_format (gdk_texture_get_format (texture)));
+  g_assert (f >= 0);
+
   png = png_create_write_struct_2 (PNG_LIBPNG_VER_STRING, NULL,
                                    png_simple_error_callback,
                                    png_simple_warning_callback,
@@ -430,7 +713,7 @@ gdk_save_png (GdkTexture *texture)
     }
 
   gdk_texture_downloader_init (&downloader, texture);
-  gdk_texture_downloader_set_format (&downloader, format);
+  gdk_texture_downloader_set_format (&downloader, png_save_formats[f].format);
   bytes = gdk_texture_downloader_download_bytes (&downloader, &stride);
   gdk_texture_downloader_finish (&downloader);
   data = g_bytes_get_data (bytes, NULL);
@@ -445,16 +728,35 @@ gdk_save_png (GdkTexture *texture)
 
   png_set_write_fn (png, &io, png_write_func, png_flush_func);
 
-  png_set_IHDR (png, info, width, height, depth,
-                png_format,
+  if (flags & GDK_PNG_SAVE_FAST)
+    {
+      /* Screenshots and other UI content have large flat areas,
+       * which the sub filter and fast deflate handle well. Trying
+       * all filters on every row is what makes the default slow.
+       */
+      png_set_filter (png, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB);
+      png_set_compression_level (png, 1);
+    }
+
+  png_set_IHDR (png, info, width, height,
+                png_save_formats[f].depth,
+                png_save_formats[f].png_format,
                 PNG_INTERLACE_NONE,
                 PNG_COMPRESSION_TYPE_DEFAULT,
                 PNG_FILTER_TYPE_DEFAULT);
 
   png_write_info (png, info);
 
+  if (png_save_formats[f].bgr)
+    png_set_bgr (png);
+  if (png_save_formats[f].swap_alpha)
+    png_set_swap_alpha (png);
+  if (png_save_formats[f].strip_filler)
+    png_set_filler (png, 0, png_save_formats[f].filler_location);
+
 #if G_BYTE_ORDER == G_LITTLE_ENDIAN
-  png_set_swap (png);
+  if (png_save_formats[f].depth == 16)
+    png_set_swap (png);
 #endif
 
   for (y = 0; y < height; y++)
@@ -469,6 +771,202 @@ gdk_save_png (GdkTexture *texture)
   return g_bytes_new_take (io.data, io.size);
 }
 
+/* }}} */
+/* {{{ Incremental decoding */
+
+struct _GdkPngDecoder
+{
+  png_struct *png;
+  png_info *info;
+  GdkProgressiveImage *image;
+  GError *error;
+  gboolean interlaced;
+};
+
+static void
+png_decoder_info_callback (png_structp png,
+                           png_infop   info)
+{
+  GdkPngDecoder *self = png_get_progressive_ptr (png);
+  GdkProgressiveImage *image = self->image;
+  guint32 width, height;
+  int depth, color_type, interlace;
+  GdkMemoryFormat format;
+  gsize stride;
+
+  png_get_IHDR (png, info,
+                &width, &height, &depth,
+                &color_type, &interlace, NULL, NULL);
+
+  png_set_transformations (png, info, color_type, depth);
+
+  self->interlaced = interlace != PNG_INTERLACE_NONE;
+  if (self->interlaced)
+    png_set_interlace_handling (png);
+
+  png_read_update_info (png, info);
+  png_get_IHDR (png, info,
+                &width, &height, &depth,
+                &color_type, &interlace, NULL, NULL);
+
+  if (!png_get_memory_format (color_type, depth, &format))
+    {
+      g_set_error (&self->error,
+                   GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_UNSUPPORTED_CONTENT,
+                   _("Unsupported color type %u in png image"), color_type);
+      png_error (png, "unsupported format");
+    }
+
+  if (!g_size_checked_mul (&stride, width, gdk_memory_format_bytes_per_pixel (format)) ||
+      !g_size_checked_add (&stride, stride, (8 - stride % 8) % 8))
+    {
+      g_set_error (&self->error,
+                   GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_TOO_LARGE,
+                   _("Image stride too large for image size %ux%u"), width, height);
+      png_error (png, "image too large");
+    }
+
+  image->data = g_try_malloc0_n (height, stride);
+  if (image->data == NULL)
+    {
+      g_set_error (&self->error,
+                   GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_TOO_LARGE,
+                   _("Not enough memory for image size %ux%u"), width, height);
+      png_error (png, "image too large");
+    }
+
+  image->width = width;
+  image->height = height;
+  image->format = format;
+  image->stride = stride;
+  image->n_rows = 0;
+  image->n_final_rows = 0;
+  image->pass = 0;
+}
+
+static void
+png_decoder_row_callback (png_structp png,
+                          png_bytep   new_row,
+                          png_uint_32 row_num,
+                          int         pass)
+{
+  GdkPngDecoder *self = png_get_progressive_ptr (png);
+  GdkProgressiveImage *image = self->image;
+
+  image->pass = pass;
+
+  /* Only the last interlace pass completes rows */
+  if (!self->interlaced || pass == 6)
+    image->n_final_rows = MAX (image->n_final_rows, row_num + 1);
+
+  if (new_row == NULL)
+    {
+      /* Rows that don't change in this interlace pass. In the
+       * first pass, show the row above instead of a blank one.
+       */
+      if (row_num > 0 && row_num >= image->n_rows)
+        {
+          memcpy (image->data + row_num * image->stride,
+                  image->data + (row_num - 1) * image->stride,
+                  image->stride);
+          image->n_rows = row_num + 1;
+        }
+      return;
+    }
+
+  png_progressive_combine_row (png, image->data + row_num * image->stride, new_row);
+  image->n_rows = MAX (image->n_rows, row_num + 1);
+}
+
+static void
+png_decoder_end_callback (png_structp png,
+                          png_infop   info)
+{
+  GdkPngDecoder *self = png_get_progressive_ptr (png);
+
+  self->image->n_rows = self->image->height;
+  self->image->n_final_rows = self->image->height;
+  self->image->done = TRUE;
+}
+
+GdkPngDecoder *
+gdk_png_decoder_new (GdkProgressiveImage *image)
+{
+  GdkPngDecoder *self;
+
+  self = g_new0 (GdkPngDecoder, 1);
+  self->image = image;
+
+  self->png = png_create_read_struct_2 (PNG_LIBPNG_VER_STRING,
+                                        &self->error,
+                                        png_simple_error_callback,
+                                        png_simple_warning_callback,
+                                        NULL,
+                                        png_malloc_callback,
+                                        png_free_callback);
+  if (self->png == NULL)
+    g_error ("Out of memory");
+
+  self->info = png_create_info_struct (self->png);
+  if (self->info == NULL)
+    g_error ("Out of memory");
+
+  png_set_progressive_read_fn (self->png, self,
+                               png_decoder_info_callback,
+                               png_decoder_row_callback,
+                               png_decoder_end_callback);
+
+  return self;
+}
+
+/* Decodes as much as possible of @data, and keeps
+ * the rest around until more data is fed.
+ */
+gboolean
+gdk_png_decoder_feed (GdkPngDecoder *self,
+                      const guchar  *data,
+                      gsize          size,
+                      GError       **error)
+{
+  if (sigsetjmp (png_jmpbuf (self->png), 1))
+    {
+      if (self->error)
+        g_propagate_error (error, g_steal_pointer (&self->error));
+      else
+        g_set_error_literal (error,
+                             GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_CORRUPT_IMAGE,
+                             _("Error reading png"));
+      return FALSE;
+    }
+
+  png_process_data (self->png, self->info, (png_bytep) data, size);
+
+  return TRUE;
+}
+
+gboolean
+gdk_png_decoder_finish (GdkPngDecoder  *self,
+                        GError        **error)
+{
+  if (!self->image->done)
+    {
+      g_set_error_literal (error,
+                           GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_CORRUPT_IMAGE,
+                           _("Image data is truncated"));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+void
+gdk_png_decoder_free (GdkPngDecoder *self)
+{
+  png_destroy_read_struct (&self->png, &self->info, NULL);
+  g_clear_error (&self->error);
+  g_free (self);
+}
+
 /* }}} */
 
 /* vim:set foldmethod=marker expandtab: */
@@ -18,14 +18,37 @@
 #pragma once
 
 #include "gdktexture.h"
+#include "gdkprogressiveimageprivate.h"
 #include <gio/gio.h>
 
 #define PNG_SIGNATURE "\x89PNG"
 
-GdkTexture *gdk_load_png        (GBytes         *bytes,
-                                 GError        **error);
+GdkTexture *gdk_load_png          (GBytes         *bytes,
+                                   GError        **error);
+GdkTexture *gdk_load_png_at_size  (GBytes         *bytes,
+                                   int             width,
+                                   int             height,
+                                   GError        **error);
 
-GBytes     *gdk_save_png        (GdkTexture     *texture);
+typedef enum {
+  GDK_PNG_SAVE_DEFAULT = 0,
+  GDK_PNG_SAVE_FAST    = 1 << 0,
+} GdkPngSaveFlags;
+
+GBytes     *gdk_save_png          (GdkTexture     *texture);
+GBytes     *gdk_save_png_with_flags (GdkTexture     *texture,
+                                     GdkPngSaveFlags flags);
+
+typedef struct _GdkPngDecoder GdkPngDecoder;
+
+GdkPngDecoder *gdk_png_decoder_new    (GdkProgressiveImage  *image);
+gboolean       gdk_png_decoder_feed   (GdkPngDecoder        *self,
+                                       const guchar         *data,
+                                       gsize                 size,
+                                       GError              **error);
+gboolean       gdk_png_decoder_finish (GdkPngDecoder        *self,
+                                       GError              **error);
+void           gdk_png_decoder_free   (GdkPngDecoder        *self);
 
 static inline gboolean
 gdk_is_png (GBytes *bytes)
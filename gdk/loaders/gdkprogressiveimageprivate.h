@@ -0,0 +1,46 @@
+/* GDK - The GIMP Drawing Kit
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "gdkmemorytexture.h"
+
+G_BEGIN_DECLS
+
+typedef struct _GdkProgressiveImage GdkProgressiveImage;
+
+/* The image that an incremental decoder writes into.
+ *
+ * The decoder allocates @data as soon as it knows the size of
+ * the image, and fills it from the top. Rows at or below @n_rows
+ * have not been decoded yet. Rows above @n_final_rows won't change
+ * anymore, the ones between may still be refined by a later
+ * interlace @pass. @data is owned by the caller.
+ */
+struct _GdkProgressiveImage
+{
+  int width;
+  int height;
+  GdkMemoryFormat format;
+  gsize stride;
+  guchar *data;
+  int n_rows;
+  int n_final_rows;
+  int pass;
+  gboolean done;
+};
+
+G_END_DECLS
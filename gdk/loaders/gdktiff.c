@@ -23,6 +23,7 @@
 #include "gdkmemoryformatprivate.h"
 #include "gdkmemorytexture.h"
 #include "gdkprofilerprivate.h"
+#include "gdktextureprivate.h"
 #include "gdktexturedownloaderprivate.h"
 
 #include <tiffio.h>
@@ -372,9 +373,64 @@ load_fallback (TIFF    *tif,
   return texture;
 }
 
+/* Pick the smallest reduced-resolution subfile that is still
+ * at least as large as the requested size, or the main image.
+ */
+static tdir_t
+find_directory_for_size (TIFF *tif,
+                         int   target_width,
+                         int   target_height)
+{
+  tdir_t dir, best;
+  guint32 best_width, width, height, subfile_type;
+
+  if (target_width <= 0 && target_height <= 0)
+    return 0;
+
+  if (!TIFFSetDirectory (tif, 0))
+    return 0;
+
+  TIFFGetFieldDefaulted (tif, TIFFTAG_IMAGEWIDTH, &best_width);
+
+  dir = 0;
+  best = 0;
+  while (TIFFReadDirectory (tif))
+    {
+      dir++;
+
+      if (!TIFFGetField (tif, TIFFTAG_SUBFILETYPE, &subfile_type) ||
+          (subfile_type & FILETYPE_REDUCEDIMAGE) == 0)
+        continue;
+
+      TIFFGetFieldDefaulted (tif, TIFFTAG_IMAGEWIDTH, &width);
+      TIFFGetFieldDefaulted (tif, TIFFTAG_IMAGELENGTH, &height);
+
+      if ((target_width > 0 && width < (guint32) target_width) ||
+          (target_height > 0 && height < (guint32) target_height))
+        continue;
+
+      if (width < best_width)
+        {
+          best = dir;
+          best_width = width;
+        }
+    }
+
+  return best;
+}
+
 GdkTexture *
 gdk_load_tiff (GBytes  *input_bytes,
                GError **error)
+{
+  return gdk_load_tiff_at_size (input_bytes, -1, -1, error);
+}
+
+GdkTexture *
+gdk_load_tiff_at_size (GBytes  *input_bytes,
+                       int      target_width,
+                       int      target_height,
+                       GError **error)
 {
   TIFF *tif;
   guint16 samples_per_pixel;
@@ -402,7 +458,7 @@ gdk_load_tiff (GBytes  *input_bytes,
       return NULL;
     }
 
-  TIFFSetDirectory (tif, 0);
+  TIFFSetDirectory (tif, find_directory_for_size (tif, target_width, target_height));
 
   TIFFGetFieldDefaulted (tif, TIFFTAG_SAMPLESPERPIXEL, &samples_per_pixel);
   TIFFGetFieldDefaulted (tif, TIFFTAG_BITSPERSAMPLE, &bits_per_sample);
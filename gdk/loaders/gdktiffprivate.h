@@ -25,6 +25,10 @@
 
 GdkTexture *gdk_load_tiff         (GBytes           *bytes,
                                    GError          **error);
+GdkTexture *gdk_load_tiff_at_size (GBytes           *bytes,
+                                   int               width,
+                                   int               height,
+                                   GError          **error);
 
 GBytes *    gdk_save_tiff         (GdkTexture       *texture);
 
@@ -145,10 +145,25 @@ gsk_gl_texture_library_real_compact (GskGLTextureLibrary *self,
       gint64 now = g_get_monotonic_time ();
       if (now - last_message > G_USEC_PER_SEC)
         {
+          GString *ratios = g_string_new ("");
+
+          for (guint i = 0; i < self->atlases->len; i++)
+            {
+              GskGLTextureAtlas *atlas = g_ptr_array_index (self->atlases, i);
+
+              g_string_append (ratios, i == 0 ? " (unused " : ", ");
+              g_string_append_printf (ratios, "%.2f", gsk_gl_texture_atlas_get_unused_ratio (atlas));
+            }
+          if (ratios->len > 0)
+            g_string_append (ratios, ")");
+
           last_message = now;
-          gdk_debug_message ("%s contains %d atlases",
+          gdk_debug_message ("%s contains %d atlases%s",
                              G_OBJECT_TYPE_NAME (self),
-                             self->atlases->len);
+                             self->atlases->len,
+                             ratios->str);
+
+          g_string_free (ratios, TRUE);
         }
     }
 
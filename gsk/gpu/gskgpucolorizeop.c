@@ -8,6 +8,8 @@
 
 #include "gpu/shaders/gskgpucolorizeinstance.h"
 
+#define VARIATION_SDF 1
+
 typedef struct _GskGpuColorizeOp GskGpuColorizeOp;
 
 struct _GskGpuColorizeOp
@@ -26,10 +28,13 @@ gsk_gpu_colorize_op_print (GskGpuOp    *op,
 
   instance = (GskGpuColorizeInstance *) gsk_gpu_frame_get_vertex_data (frame, shader->vertex_offset);
 
-  gsk_gpu_print_op (string, indent, "colorize");
+  gsk_gpu_print_op (string, indent, shader->variation & VARIATION_SDF ? "colorize-sdf" : "colorize");
   gsk_gpu_print_rect (string, instance->rect);
   gsk_gpu_print_image_descriptor (string, shader->desc, instance->tex_id);
-  gsk_gpu_print_rgba (string, instance->color);
+  if (instance->color_glyph)
+    g_string_append_printf (string, "color-glyph %g ", instance->color[3]);
+  else
+    gsk_gpu_print_rgba (string, instance->color);
   gsk_gpu_print_newline (string);
 }
 
@@ -53,21 +58,23 @@ static const GskGpuShaderOpClass GSK_GPU_COLORIZE_OP_CLASS = {
   gsk_gpu_colorize_setup_vao
 };
 
-void
-gsk_gpu_colorize_op (GskGpuFrame            *frame,
-                     GskGpuShaderClip        clip,
-                     GskGpuDescriptors      *descriptors,
-                     guint32                 descriptor,
-                     const graphene_rect_t  *rect,
-                     const graphene_point_t *offset,
-                     const graphene_rect_t  *tex_rect,
-                     const GdkRGBA          *color)
+static void
+gsk_gpu_colorize_op_alloc (GskGpuFrame            *frame,
+                           guint32                 variation,
+                           GskGpuShaderClip        clip,
+                           GskGpuDescriptors      *descriptors,
+                           guint32                 descriptor,
+                           const graphene_rect_t  *rect,
+                           const graphene_point_t *offset,
+                           const graphene_rect_t  *tex_rect,
+                           gboolean                color_glyph,
+                           const GdkRGBA          *color)
 {
   GskGpuColorizeInstance *instance;
 
   gsk_gpu_shader_op_alloc (frame,
                            &GSK_GPU_COLORIZE_OP_CLASS,
-                           0,
+                           variation,
                            clip,
                            descriptors,
                            &instance);
@@ -75,5 +82,64 @@ gsk_gpu_colorize_op (GskGpuFrame            *frame,
   gsk_gpu_rect_to_float (rect, offset, instance->rect);
   gsk_gpu_rect_to_float (tex_rect, offset, instance->tex_rect);
   instance->tex_id = descriptor;
+  instance->color_glyph = color_glyph;
   gsk_gpu_rgba_to_float (color, instance->color);
 }
+
+void
+gsk_gpu_colorize_op (GskGpuFrame            *frame,
+                     GskGpuShaderClip        clip,
+                     GskGpuDescriptors      *descriptors,
+                     guint32                 descriptor,
+                     const graphene_rect_t  *rect,
+                     const graphene_point_t *offset,
+                     const graphene_rect_t  *tex_rect,
+                     const GdkRGBA          *color)
+{
+  gsk_gpu_colorize_op_alloc (frame, 0, clip, descriptors, descriptor, rect, offset, tex_rect, FALSE, color);
+}
+
+/* Like gsk_gpu_colorize_op(), but the alpha channel of the texture
+ * is a signed distance field as created for GSK_GPU_GLYPH_SDF */
+void
+gsk_gpu_colorize_sdf_op (GskGpuFrame            *frame,
+                         GskGpuShaderClip        clip,
+                         GskGpuDescriptors      *descriptors,
+                         guint32                 descriptor,
+                         const graphene_rect_t  *rect,
+                         const graphene_point_t *offset,
+                         const graphene_rect_t  *tex_rect,
+                         const GdkRGBA          *color)
+{
+  gsk_gpu_colorize_op_alloc (frame, VARIATION_SDF, clip, descriptors, descriptor, rect, offset, tex_rect, FALSE, color);
+}
+
+/* Draws a color glyph from the glyph cache, keeping its colors.
+ *
+ * This uses the same shader as the other colorize ops, so color glyphs
+ * get batched with the other glyphs of the text. If @sdf is set, the
+ * glyph is batched with gsk_gpu_colorize_sdf_op() glyphs, but the glyph
+ * itself must not be a distance field.
+ */
+void
+gsk_gpu_colorize_color_glyph_op (GskGpuFrame            *frame,
+                                 GskGpuShaderClip        clip,
+                                 GskGpuDescriptors      *descriptors,
+                                 guint32                 descriptor,
+                                 const graphene_rect_t  *rect,
+                                 const graphene_point_t *offset,
+                                 const graphene_rect_t  *tex_rect,
+                                 gboolean                sdf,
+                                 float                   opacity)
+{
+  gsk_gpu_colorize_op_alloc (frame,
+                             sdf ? VARIATION_SDF : 0,
+                             clip,
+                             descriptors,
+                             descriptor,
+                             rect,
+                             offset,
+                             tex_rect,
+                             TRUE,
+                             &(GdkRGBA) { 1, 1, 1, opacity });
+}
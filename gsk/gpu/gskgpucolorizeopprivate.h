@@ -14,6 +14,23 @@ void                    gsk_gpu_colorize_op                             (GskGpuF
                                                                          const graphene_point_t         *offset,
                                                                          const graphene_rect_t          *tex_rect,
                                                                          const GdkRGBA                  *color);
+void                    gsk_gpu_colorize_sdf_op                         (GskGpuFrame                    *frame,
+                                                                         GskGpuShaderClip                clip,
+                                                                         GskGpuDescriptors              *desc,
+                                                                         guint32                         descriptor,
+                                                                         const graphene_rect_t          *rect,
+                                                                         const graphene_point_t         *offset,
+                                                                         const graphene_rect_t          *tex_rect,
+                                                                         const GdkRGBA                  *color);
+void                    gsk_gpu_colorize_color_glyph_op                 (GskGpuFrame                    *frame,
+                                                                         GskGpuShaderClip                clip,
+                                                                         GskGpuDescriptors              *desc,
+                                                                         guint32                         descriptor,
+                                                                         const graphene_rect_t          *rect,
+                                                                         const graphene_point_t         *offset,
+                                                                         const graphene_rect_t          *tex_rect,
+                                                                         gboolean                        sdf,
+                                                                         float                           opacity);
 
 
 G_END_DECLS
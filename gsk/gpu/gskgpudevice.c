@@ -2,15 +2,19 @@
 
 #include "gskgpudeviceprivate.h"
 
+#include "gskgpublitopprivate.h"
 #include "gskgpuframeprivate.h"
 #include "gskgpuimageprivate.h"
 #include "gskgpuuploadopprivate.h"
 
 #include "gdk/gdkdisplayprivate.h"
+#include "gdk/gdkmemoryformatprivate.h"
 #include "gdk/gdktextureprivate.h"
 #include "gdk/gdkprofilerprivate.h"
 
 #include "gsk/gskdebugprivate.h"
+#include "gsk/gskpath.h"
+#include "gsk/gskstrokeprivate.h"
 
 #define MAX_SLICES_PER_ATLAS 64
 
@@ -22,14 +26,21 @@ G_STATIC_ASSERT (MAX_ATLAS_ITEM_SIZE < ATLAS_SIZE);
 
 #define MAX_DEAD_PIXELS (ATLAS_SIZE * ATLAS_SIZE / 2)
 
+/* Atlases with more dead pixels than this get compacted */
+#define MAX_FRAGMENTED_PIXELS (ATLAS_SIZE * ATLAS_SIZE / 4)
+
 #define CACHE_GC_TIMEOUT 15  /* seconds */
 
 #define CACHE_MAX_AGE (G_TIME_SPAN_SECOND * 4)  /* 4 seconds, in µs */
 
+/* Path masks can be big, so bound their memory, too */
+#define PATH_CACHE_MAX_BYTES (32 * 1024 * 1024)
+
 typedef struct _GskGpuCached GskGpuCached;
 typedef struct _GskGpuCachedClass GskGpuCachedClass;
 typedef struct _GskGpuCachedAtlas GskGpuCachedAtlas;
 typedef struct _GskGpuCachedGlyph GskGpuCachedGlyph;
+typedef struct _GskGpuCachedPath GskGpuCachedPath;
 typedef struct _GskGpuCachedTexture GskGpuCachedTexture;
 typedef struct _GskGpuDevicePrivate GskGpuDevicePrivate;
 
@@ -44,8 +55,15 @@ struct _GskGpuDevicePrivate
 
   GHashTable *texture_cache;
   GHashTable *glyph_cache;
+  GHashTable *path_cache;
+  GQueue path_lru;          /* cached paths with a mask, most recently used first */
+  gsize path_cache_bytes;
 
   GskGpuCachedAtlas *current_atlas;
+
+  /* atlas compaction stats, since the last GC */
+  guint compacted_glyphs;
+  gsize compacted_pixels;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (GskGpuDevice, gsk_gpu_device, G_TYPE_OBJECT)
@@ -145,6 +163,30 @@ gsk_gpu_cached_new (GskGpuDevice            *device,
   return cached;
 }
 
+/* Moves @cached to the end of the cache, so that it is freed before
+ * the atlas it was moved to.
+ */
+static void
+gsk_gpu_cached_move_to_end (GskGpuDevice *device,
+                            GskGpuCached *cached)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (device);
+
+  if (cached->next == NULL)
+    return;
+
+  cached->next->prev = cached->prev;
+  if (cached->prev)
+    cached->prev->next = cached->next;
+  else
+    priv->first_cached = cached->next;
+
+  cached->prev = priv->last_cached;
+  cached->next = NULL;
+  priv->last_cached->next = cached;
+  priv->last_cached = cached;
+}
+
 static void
 gsk_gpu_cached_use (GskGpuDevice *device,
                     GskGpuCached *cached,
@@ -163,6 +205,9 @@ struct _GskGpuCachedAtlas
 
   GskGpuImage *image;
 
+  gsize used_pixels;  /* pixels allocated to glyphs */
+  gboolean compact;   /* move used glyphs to the current atlas */
+
   gsize n_slices;
   struct {
     gsize width;
@@ -199,7 +244,23 @@ gsk_gpu_cached_atlas_should_collect (GskGpuDevice *device,
                                      GskGpuCached *cached,
                                      gint64        timestamp)
 {
-  return cached->pixels > MAX_DEAD_PIXELS;
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (device);
+  GskGpuCachedAtlas *self = (GskGpuCachedAtlas *) cached;
+
+  if (cached->pixels > MAX_DEAD_PIXELS)
+    return TRUE;
+
+  if (self == priv->current_atlas)
+    return FALSE;
+
+  /* All glyphs have been moved away or are stale */
+  if (self->compact && cached->pixels >= self->used_pixels)
+    return TRUE;
+
+  if (cached->pixels > MAX_FRAGMENTED_PIXELS)
+    self->compact = TRUE;
+
+  return FALSE;
 }
 
 static const GskGpuCachedClass GSK_GPU_CACHED_ATLAS_CLASS =
@@ -376,6 +437,109 @@ static const GskGpuCachedClass GSK_GPU_CACHED_GLYPH_CLASS =
   gsk_gpu_cached_glyph_should_collect
 };
 
+/* }}} */
+/* {{{ CachedPath */
+
+/* Paths only get a mask once they are drawn in a second frame, so
+ * that paths that are recreated every frame don't fill the cache.
+ * Until then, the entry has no image and doesn't hold a reference
+ * to the path, it only remembers that the path has been seen.
+ */
+struct _GskGpuCachedPath
+{
+  GskGpuCached parent;
+
+  GskPath *path;
+  gboolean is_stroke;
+  GskStroke stroke;
+  GskFillRule fill_rule;
+  float scale_x;
+  float scale_y;
+  graphene_rect_t rect;
+
+  GskGpuImage *image;
+  gsize bytes;
+  GList lru_link;
+};
+
+static void
+gsk_gpu_cached_path_free (GskGpuDevice *device,
+                          GskGpuCached *cached)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (device);
+  GskGpuCachedPath *self = (GskGpuCachedPath *) cached;
+
+  g_hash_table_remove (priv->path_cache, self);
+
+  if (self->image)
+    {
+      g_queue_unlink (&priv->path_lru, &self->lru_link);
+      priv->path_cache_bytes -= self->bytes;
+      gsk_path_unref (self->path);
+      g_object_unref (self->image);
+    }
+  gsk_stroke_clear (&self->stroke);
+
+  g_free (self);
+}
+
+static gboolean
+gsk_gpu_cached_path_should_collect (GskGpuDevice *device,
+                                    GskGpuCached *cached,
+                                    gint64        timestamp)
+{
+  return timestamp - cached->timestamp > CACHE_MAX_AGE;
+}
+
+static guint
+gsk_gpu_cached_path_hash (gconstpointer data)
+{
+  const GskGpuCachedPath *path = data;
+  guint hash;
+
+  hash = GPOINTER_TO_UINT (path->path);
+  if (path->is_stroke)
+    hash ^= ((guint) (path->stroke.line_width * 16) << 8) ^
+            (path->stroke.line_cap << 4) ^
+            path->stroke.line_join ^
+            (path->stroke.n_dash << 16);
+  else
+    hash ^= path->fill_rule;
+
+  /* Go through int, the origin can be negative */
+  return hash ^
+         ((guint) (path->scale_x * 16) << 24) ^
+         ((guint) (int) (path->rect.origin.x * 4) << 16) ^
+         (guint) (int) (path->rect.origin.y * 4);
+}
+
+static gboolean
+gsk_gpu_cached_path_equal (gconstpointer v1,
+                           gconstpointer v2)
+{
+  const GskGpuCachedPath *path1 = v1;
+  const GskGpuCachedPath *path2 = v2;
+
+  if (path1->path != path2->path ||
+      path1->is_stroke != path2->is_stroke ||
+      path1->scale_x != path2->scale_x ||
+      path1->scale_y != path2->scale_y ||
+      !graphene_rect_equal (&path1->rect, &path2->rect))
+    return FALSE;
+
+  if (path1->is_stroke)
+    return gsk_stroke_equal (&path1->stroke, &path2->stroke);
+  else
+    return path1->fill_rule == path2->fill_rule;
+}
+
+static const GskGpuCachedClass GSK_GPU_CACHED_PATH_CLASS =
+{
+  sizeof (GskGpuCachedPath),
+  gsk_gpu_cached_path_free,
+  gsk_gpu_cached_path_should_collect
+};
+
 /* }}} */
 /* {{{ GskGpuDevice */
 
@@ -387,7 +551,9 @@ print_cache_stats (GskGpuDevice *self)
   guint glyphs = 0;
   guint stale_glyphs = 0;
   guint textures = 0;
+  guint paths = 0;
   guint atlases = 0;
+  guint compacting = 0;
   GString *ratios = g_string_new ("");
 
   for (cached = priv->first_cached; cached != NULL; cached = cached->next)
@@ -400,19 +566,25 @@ print_cache_stats (GskGpuDevice *self)
         }
       else if (cached->class == &GSK_GPU_CACHED_TEXTURE_CLASS)
         textures++;
+      else if (cached->class == &GSK_GPU_CACHED_PATH_CLASS)
+        paths++;
       else if (cached->class == &GSK_GPU_CACHED_ATLAS_CLASS)
         {
-          double ratio;
+          GskGpuCachedAtlas *atlas = (GskGpuCachedAtlas *) cached;
+          double ratio, occupancy;
 
           atlases++;
+          if (atlas->compact)
+            compacting++;
 
           ratio = (double) cached->pixels / (double) (ATLAS_SIZE * ATLAS_SIZE);
+          occupancy = (double) (atlas->used_pixels - MIN (cached->pixels, atlas->used_pixels)) / (double) (ATLAS_SIZE * ATLAS_SIZE);
 
           if (ratios->len == 0)
-            g_string_append (ratios, " (ratios ");
+            g_string_append (ratios, " (dead/live ");
           else
             g_string_append (ratios, ", ");
-          g_string_append_printf (ratios, "%.2f", ratio);
+          g_string_append_printf (ratios, "%.2f/%.2f%s", ratio, occupancy, atlas->compact ? "*" : "");
         }
     }
 
@@ -422,12 +594,54 @@ print_cache_stats (GskGpuDevice *self)
   gdk_debug_message ("cached items\n"
                      "  glyphs:   %5u (%u stale)\n"
                      "  textures: %5u\n"
-                     "  atlases:  %5u%s",
-                     glyphs, stale_glyphs, textures, atlases, ratios->str);
+                     "  paths:    %5u\n"
+                     "  atlases:  %5u%s\n"
+                     "  compacting %u atlases, moved %u glyphs (%" G_GSIZE_FORMAT " pixels)",
+                     glyphs, stale_glyphs, textures, paths, atlases, ratios->str,
+                     compacting, priv->compacted_glyphs, priv->compacted_pixels);
 
   g_string_free (ratios, TRUE);
 }
 
+/*
+ * gsk_gpu_device_get_atlas_stats:
+ * @self: a device
+ * @stats: (out): the statistics
+ *
+ * Sums up how the glyph atlases are used, for debugging and tests.
+ *
+ * The live pixels are counted from the glyphs, so they must always
+ * be the used pixels minus the dead pixels.
+ */
+void
+gsk_gpu_device_get_atlas_stats (GskGpuDevice     *self,
+                                GskGpuAtlasStats *stats)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+  GskGpuCached *cached;
+
+  *stats = (GskGpuAtlasStats) { 0, };
+  stats->compacted_glyphs = priv->compacted_glyphs;
+
+  for (cached = priv->first_cached; cached != NULL; cached = cached->next)
+    {
+      if (cached->class == &GSK_GPU_CACHED_ATLAS_CLASS)
+        {
+          GskGpuCachedAtlas *atlas = (GskGpuCachedAtlas *) cached;
+
+          stats->n_atlases++;
+          if (atlas->compact)
+            stats->n_compacting++;
+          stats->used_pixels += atlas->used_pixels;
+          stats->dead_pixels += cached->pixels;
+        }
+      else if (cached->atlas && !cached->stale)
+        {
+          stats->live_pixels += cached->pixels;
+        }
+    }
+}
+
 void
 gsk_gpu_device_gc (GskGpuDevice *self,
                    gint64        timestamp)
@@ -449,6 +663,9 @@ gsk_gpu_device_gc (GskGpuDevice *self,
   if (GSK_DEBUG_CHECK (GLYPH_CACHE))
     print_cache_stats (self);
 
+  priv->compacted_glyphs = 0;
+  priv->compacted_pixels = 0;
+
   gdk_profiler_end_mark (before, "Glyph cache GC", NULL);
 }
 
@@ -485,6 +702,7 @@ gsk_gpu_device_dispose (GObject *object)
   gsk_gpu_device_clear_cache (self);
   g_hash_table_unref (priv->glyph_cache);
   g_hash_table_unref (priv->texture_cache);
+  g_hash_table_unref (priv->path_cache);
   g_clear_handle_id (&priv->cache_gc_source, g_source_remove);
 
   G_OBJECT_CLASS (gsk_gpu_device_parent_class)->dispose (object);
@@ -519,6 +737,8 @@ gsk_gpu_device_init (GskGpuDevice *self)
                                         gsk_gpu_cached_glyph_equal);
   priv->texture_cache = g_hash_table_new (g_direct_hash,
                                           g_direct_equal);
+  priv->path_cache = g_hash_table_new (gsk_gpu_cached_path_hash,
+                                       gsk_gpu_cached_path_equal);
 }
 
 static gboolean
@@ -732,10 +952,12 @@ gsk_gpu_device_lookup_texture_image (GskGpuDevice *self,
   if (cache == NULL)
     cache = g_hash_table_lookup (priv->texture_cache, texture);
 
-  if (cache && cache->image)
-    return g_object_ref (cache->image);
+  if (cache == NULL || cache->image == NULL)
+    return NULL;
 
-  return NULL;
+  gsk_gpu_cached_use (self, (GskGpuCached *) cache, timestamp);
+
+  return g_object_ref (cache->image);
 }
 
 void
@@ -751,6 +973,188 @@ gsk_gpu_device_cache_texture_image (GskGpuDevice *self,
   gsk_gpu_cached_use (self, (GskGpuCached *) cache, timestamp);
 }
 
+/*
+ * gsk_gpu_device_lookup_path_image:
+ * @self: a device
+ * @path: the path
+ * @stroke: (nullable): the stroke for stroked paths or %NULL for fills
+ * @fill_rule: the fill rule for fills
+ * @scale: the scale the mask was rendered at
+ * @rect: the area covered by the mask, in the path's coordinates
+ * @timestamp: the frame's timestamp
+ *
+ * Looks up a mask previously cached with gsk_gpu_device_cache_path_image().
+ *
+ * As the mask covers @rect at @scale, the position of @rect also
+ * takes care of the path's offset to the pixel grid.
+ *
+ * Returns: (nullable) (transfer full): the mask image
+ */
+GskGpuImage *
+gsk_gpu_device_lookup_path_image (GskGpuDevice          *self,
+                                  GskPath               *path,
+                                  const GskStroke       *stroke,
+                                  GskFillRule            fill_rule,
+                                  const graphene_vec2_t *scale,
+                                  const graphene_rect_t *rect,
+                                  gint64                 timestamp)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+  GskGpuCachedPath lookup = {
+    .path = path,
+    .is_stroke = stroke != NULL,
+    .stroke = stroke ? *stroke : (GskStroke) { 0, },
+    .fill_rule = fill_rule,
+    .scale_x = graphene_vec2_get_x (scale),
+    .scale_y = graphene_vec2_get_y (scale),
+    .rect = *rect,
+  };
+  GskGpuCachedPath *cache;
+
+  cache = g_hash_table_lookup (priv->path_cache, &lookup);
+  if (cache == NULL || cache->image == NULL)
+    return NULL;
+
+  gsk_gpu_cached_use (self, (GskGpuCached *) cache, timestamp);
+  g_queue_unlink (&priv->path_lru, &cache->lru_link);
+  g_queue_push_head_link (&priv->path_lru, &cache->lru_link);
+
+  return g_object_ref (cache->image);
+}
+
+/*
+ * gsk_gpu_device_cache_path_image:
+ * @self: a device
+ * @path: the path
+ * @stroke: (nullable): the stroke for stroked paths or %NULL for fills
+ * @fill_rule: the fill rule for fills
+ * @scale: the scale the mask was rendered at
+ * @rect: the area covered by the mask, in the path's coordinates
+ * @timestamp: the frame's timestamp
+ * @image: the mask
+ *
+ * Offers a mask for caching after a failed lookup.
+ *
+ * The mask is only kept if the same path has already been drawn
+ * in an earlier frame. The least recently used masks are dropped
+ * when the masks take up too much memory.
+ */
+void
+gsk_gpu_device_cache_path_image (GskGpuDevice          *self,
+                                 GskPath               *path,
+                                 const GskStroke       *stroke,
+                                 GskFillRule            fill_rule,
+                                 const graphene_vec2_t *scale,
+                                 const graphene_rect_t *rect,
+                                 gint64                 timestamp,
+                                 GskGpuImage           *image)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+  GskGpuCachedPath lookup = {
+    .path = path,
+    .is_stroke = stroke != NULL,
+    .stroke = stroke ? *stroke : (GskStroke) { 0, },
+    .fill_rule = fill_rule,
+    .scale_x = graphene_vec2_get_x (scale),
+    .scale_y = graphene_vec2_get_y (scale),
+    .rect = *rect,
+  };
+  GskGpuCachedPath *cache;
+
+  cache = g_hash_table_lookup (priv->path_cache, &lookup);
+  if (cache == NULL)
+    {
+      cache = gsk_gpu_cached_new (self, &GSK_GPU_CACHED_PATH_CLASS, NULL);
+
+      /* No reference, see the comment on GskGpuCachedPath */
+      cache->path = path;
+      cache->is_stroke = stroke != NULL;
+      if (stroke)
+        cache->stroke = GSK_STROKE_INIT_COPY (stroke);
+      cache->fill_rule = fill_rule;
+      cache->scale_x = graphene_vec2_get_x (scale);
+      cache->scale_y = graphene_vec2_get_y (scale);
+      cache->rect = *rect;
+      cache->lru_link.data = cache;
+
+      g_hash_table_insert (priv->path_cache, cache, cache);
+      gsk_gpu_cached_use (self, (GskGpuCached *) cache, timestamp);
+      return;
+    }
+
+  if (cache->image != NULL || ((GskGpuCached *) cache)->timestamp == timestamp)
+    return;
+
+  cache->path = gsk_path_ref (path);
+  cache->image = g_object_ref (image);
+  cache->bytes = gsk_gpu_image_get_width (image) * gsk_gpu_image_get_height (image) *
+                 gdk_memory_format_bytes_per_pixel (gsk_gpu_image_get_format (image));
+  gsk_gpu_cached_use (self, (GskGpuCached *) cache, timestamp);
+
+  g_queue_push_head_link (&priv->path_lru, &cache->lru_link);
+  priv->path_cache_bytes += cache->bytes;
+
+  while (priv->path_cache_bytes > PATH_CACHE_MAX_BYTES && priv->path_lru.length > 1)
+    gsk_gpu_cached_free (self, g_queue_peek_tail (&priv->path_lru));
+}
+
+/* Copies a glyph from an atlas that is being compacted to the
+ * current atlas, so the old atlas can be freed once all its
+ * glyphs that are still in use have been moved.
+ */
+static void
+gsk_gpu_device_compact_glyph (GskGpuDevice      *self,
+                              GskGpuFrame       *frame,
+                              GskGpuCachedGlyph *glyph)
+{
+  GskGpuDevicePrivate *priv = gsk_gpu_device_get_instance_private (self);
+  GskGpuCached *cached = (GskGpuCached *) glyph;
+  GskGpuImage *image;
+  gsize atlas_x, atlas_y, padding;
+  cairo_rectangle_int_t area;
+
+  if (!gsk_gpu_frame_should_optimize (frame, GSK_GPU_OPTIMIZE_BLIT) ||
+      (gsk_gpu_image_get_flags (glyph->image) & GSK_GPU_IMAGE_NO_BLIT))
+    return;
+
+  padding = 1;
+  area = (cairo_rectangle_int_t) {
+    .x = glyph->bounds.origin.x - padding,
+    .y = glyph->bounds.origin.y - padding,
+    .width = glyph->bounds.size.width + 2 * padding,
+    .height = glyph->bounds.size.height + 2 * padding,
+  };
+
+  image = gsk_gpu_device_add_atlas_image (self,
+                                          gsk_gpu_frame_get_timestamp (frame),
+                                          area.width, area.height,
+                                          &atlas_x, &atlas_y);
+  if (image == NULL)
+    return;
+
+  gsk_gpu_blit_op (frame,
+                   glyph->image,
+                   image,
+                   &area,
+                   &(cairo_rectangle_int_t) { atlas_x, atlas_y, area.width, area.height },
+                   GSK_GPU_BLIT_NEAREST);
+
+  /* The glyph's pixels on the old atlas are dead now */
+  mark_as_stale (cached, TRUE);
+  cached->atlas = priv->current_atlas;
+  cached->stale = FALSE;
+  priv->current_atlas->used_pixels += cached->pixels;
+  gsk_gpu_cached_move_to_end (self, cached);
+
+  g_object_unref (glyph->image);
+  glyph->image = g_object_ref (image);
+  glyph->bounds.origin.x = atlas_x + padding;
+  glyph->bounds.origin.y = atlas_y + padding;
+
+  priv->compacted_glyphs++;
+  priv->compacted_pixels += cached->pixels;
+}
+
 GskGpuImage *
 gsk_gpu_device_lookup_glyph_image (GskGpuDevice           *self,
                                    GskGpuFrame            *frame,
@@ -779,6 +1183,9 @@ gsk_gpu_device_lookup_glyph_image (GskGpuDevice           *self,
   cache = g_hash_table_lookup (priv->glyph_cache, &lookup);
   if (cache)
     {
+      if (((GskGpuCached *) cache)->atlas && ((GskGpuCached *) cache)->atlas->compact)
+        gsk_gpu_device_compact_glyph (self, frame, cache);
+
       gsk_gpu_cached_use (self, (GskGpuCached *) cache, gsk_gpu_frame_get_timestamp (frame));
 
       *out_bounds = cache->bounds;
@@ -793,6 +1200,14 @@ gsk_gpu_device_lookup_glyph_image (GskGpuDevice           *self,
   origin.y = floor (ink_rect.y * scale / PANGO_SCALE + subpixel_y);
   rect.size.width = ceil ((ink_rect.x + ink_rect.width) * scale / PANGO_SCALE + subpixel_x) - origin.x;
   rect.size.height = ceil ((ink_rect.y + ink_rect.height) * scale / PANGO_SCALE + subpixel_y) - origin.y;
+  if (flags & GSK_GPU_GLYPH_SDF)
+    {
+      /* The distance field extends beyond the glyph's ink */
+      origin.x -= GSK_GPU_GLYPH_SDF_SPREAD;
+      origin.y -= GSK_GPU_GLYPH_SDF_SPREAD;
+      rect.size.width += 2 * GSK_GPU_GLYPH_SDF_SPREAD;
+      rect.size.height += 2 * GSK_GPU_GLYPH_SDF_SPREAD;
+    }
   padding = 1;
 
   image = gsk_gpu_device_add_atlas_image (self,
@@ -824,6 +1239,8 @@ gsk_gpu_device_lookup_glyph_image (GskGpuDevice           *self,
   cache->origin = GRAPHENE_POINT_INIT (- origin.x + subpixel_x,
                                        - origin.y + subpixel_y);
   ((GskGpuCached *) cache)->pixels = (rect.size.width + 2 * padding) * (rect.size.height + 2 * padding);
+  if (((GskGpuCached *) cache)->atlas)
+    ((GskGpuCached *) cache)->atlas->used_pixels += ((GskGpuCached *) cache)->pixels;
 
   gsk_gpu_upload_glyph_op (frame,
                            cache->image,
@@ -837,7 +1254,8 @@ gsk_gpu_device_lookup_glyph_image (GskGpuDevice           *self,
                            },
                            scale,
                            &GRAPHENE_POINT_INIT (cache->origin.x + padding,
-                                                 cache->origin.y + padding));
+                                                 cache->origin.y + padding),
+                           flags & GSK_GPU_GLYPH_SDF ? TRUE : FALSE);
 
   g_hash_table_insert (priv->glyph_cache, cache, cache);
   gsk_gpu_cached_use (self, (GskGpuCached *) cache, gsk_gpu_frame_get_timestamp (frame));
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "gskgputypesprivate.h"
+#include "gsktypes.h"
 
 #include <graphene.h>
 
@@ -78,6 +79,22 @@ void                    gsk_gpu_device_cache_texture_image              (GskGpuD
                                                                          gint64                  timestamp,
                                                                          GskGpuImage            *image);
 
+GskGpuImage *           gsk_gpu_device_lookup_path_image                (GskGpuDevice           *self,
+                                                                         GskPath                *path,
+                                                                         const GskStroke        *stroke,
+                                                                         GskFillRule             fill_rule,
+                                                                         const graphene_vec2_t  *scale,
+                                                                         const graphene_rect_t  *rect,
+                                                                         gint64                  timestamp);
+void                    gsk_gpu_device_cache_path_image                 (GskGpuDevice           *self,
+                                                                         GskPath                *path,
+                                                                         const GskStroke        *stroke,
+                                                                         GskFillRule             fill_rule,
+                                                                         const graphene_vec2_t  *scale,
+                                                                         const graphene_rect_t  *rect,
+                                                                         gint64                  timestamp,
+                                                                         GskGpuImage            *image);
+
 typedef enum
 {
   GSK_GPU_GLYPH_X_OFFSET_1 = 0x1,
@@ -85,7 +102,8 @@ typedef enum
   GSK_GPU_GLYPH_X_OFFSET_3 = 0x3,
   GSK_GPU_GLYPH_Y_OFFSET_1 = 0x4,
   GSK_GPU_GLYPH_Y_OFFSET_2 = 0x8,
-  GSK_GPU_GLYPH_Y_OFFSET_3 = 0xC
+  GSK_GPU_GLYPH_Y_OFFSET_3 = 0xC,
+  GSK_GPU_GLYPH_SDF        = 0x10
 } GskGpuGlyphLookupFlags;
 
 GskGpuImage *           gsk_gpu_device_lookup_glyph_image               (GskGpuDevice           *self,
@@ -97,6 +115,21 @@ GskGpuImage *           gsk_gpu_device_lookup_glyph_image               (GskGpuD
                                                                          graphene_rect_t        *out_bounds,
                                                                          graphene_point_t       *out_origin);
 
+typedef struct _GskGpuAtlasStats GskGpuAtlasStats;
+
+struct _GskGpuAtlasStats
+{
+  guint n_atlases;
+  guint n_compacting;        /* atlases whose glyphs are being moved */
+  guint compacted_glyphs;    /* glyphs moved since the last GC */
+  gsize used_pixels;         /* pixels allocated on all atlases */
+  gsize dead_pixels;         /* pixels of stale or moved glyphs */
+  gsize live_pixels;         /* pixels of the glyphs in use */
+};
+
+void                    gsk_gpu_device_get_atlas_stats                  (GskGpuDevice           *self,
+                                                                         GskGpuAtlasStats       *stats);
+
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(GskGpuDevice, g_object_unref)
 
@@ -589,6 +589,8 @@ gsk_gpu_frame_submit (GskGpuFrame *self)
   gsk_gpu_frame_sort_ops (self);
   gsk_gpu_frame_verbose_print (self, "after sort");
 
+  gsk_gpu_upload_glyph_ops_prepare (priv->first_op);
+
   if (priv->vertex_buffer)
     {
       gsk_gpu_buffer_unmap (priv->vertex_buffer);
@@ -23,6 +23,7 @@
 #include "gskgpulineargradientopprivate.h"
 #include "gskgpumaskopprivate.h"
 #include "gskgpumipmapopprivate.h"
+#include "gskgpupathopprivate.h"
 #include "gskgpuradialgradientopprivate.h"
 #include "gskgpurenderpassopprivate.h"
 #include "gskgpuroundedcoloropprivate.h"
@@ -35,6 +36,7 @@
 #include "gskcairoblurprivate.h"
 #include "gskdebugprivate.h"
 #include "gskpath.h"
+#include "gskpathprivate.h"
 #include "gskrectprivate.h"
 #include "gskrendernodeprivate.h"
 #include "gskroundedrectprivate.h"
@@ -42,6 +44,7 @@
 #include "gsktransformprivate.h"
 
 #include "gdk/gdkrgbaprivate.h"
+#include "gdk/gdktextureprivate.h"
 
 /* A note about coordinate systems
  *
@@ -108,6 +111,7 @@ struct _GskGpuNodeProcessor
   graphene_point_t               offset;
   graphene_matrix_t              projection;
   graphene_vec2_t                scale;
+  float                          zoom;
   GskTransform                  *modelview;
   GskGpuClip                     clip;
   float                          opacity;
@@ -191,6 +195,7 @@ gsk_gpu_node_processor_init (GskGpuNodeProcessor         *self,
   graphene_vec2_init (&self->scale,
                       width / viewport->size.width,
                       height / viewport->size.height);
+  self->zoom = 1.0;
   self->offset = GRAPHENE_POINT_INIT (-viewport->origin.x,
                                       -viewport->origin.y);
   self->opacity = 1.0;
@@ -304,6 +309,31 @@ gsk_gpu_node_processor_add_images (GskGpuNodeProcessor *self,
   while (desc != self->desc);
 }
 
+static guint32
+gsk_gpu_node_processor_add_buffer (GskGpuNodeProcessor *self,
+                                   GskGpuBuffer        *buffer)
+{
+  guint32 descriptor;
+
+  if (self->desc != NULL)
+    {
+      if (gsk_gpu_descriptors_add_buffer (self->desc, buffer, &descriptor))
+        return descriptor;
+
+      g_object_unref (self->desc);
+    }
+
+  self->desc = gsk_gpu_frame_create_descriptors (self->frame);
+
+  if (!gsk_gpu_descriptors_add_buffer (self->desc, buffer, &descriptor))
+    {
+      g_assert_not_reached ();
+      return 0;
+    }
+
+  return descriptor;
+}
+
 static void
 rect_round_to_pixels (const graphene_rect_t  *src,
                       const graphene_vec2_t  *pixel_scale,
@@ -1536,6 +1566,7 @@ gsk_gpu_node_processor_add_transform_node (GskGpuNodeProcessor *self,
   GskTransform *transform;
   graphene_point_t old_offset;
   graphene_vec2_t old_scale;
+  float old_zoom;
   GskTransform *old_modelview;
   GskGpuClip old_clip;
 
@@ -1661,8 +1692,13 @@ gsk_gpu_node_processor_add_transform_node (GskGpuNodeProcessor *self,
 
   self->pending_globals |= GSK_GPU_GLOBAL_MATRIX | GSK_GPU_GLOBAL_SCALE | GSK_GPU_GLOBAL_CLIP;
 
+  old_zoom = self->zoom;
+  self->zoom *= MAX (graphene_vec2_get_x (&self->scale), graphene_vec2_get_y (&self->scale)) /
+                MAX (graphene_vec2_get_x (&old_scale), graphene_vec2_get_y (&old_scale));
+
   gsk_gpu_node_processor_add_node (self, child);
 
+  self->zoom = old_zoom;
   self->offset = old_offset;
   self->scale = old_scale;
   gsk_transform_unref (self->modelview);
@@ -2038,7 +2074,7 @@ gsk_gpu_node_processor_add_texture_scale_node (GskGpuNodeProcessor *self,
                                                GskRenderNode       *node)
 {
   GskGpuDevice *device;
-  GskGpuImage *image;
+  GskGpuImage *image, *cached_image;
   GdkTexture *texture;
   GskScalingFilter scaling_filter;
   gint64 timestamp;
@@ -2072,30 +2108,60 @@ gsk_gpu_node_processor_add_texture_scale_node (GskGpuNodeProcessor *self,
     }
 
   device = gsk_gpu_frame_get_device (self->frame);
-  texture = gsk_texture_scale_node_get_texture (node);
+  texture = g_object_ref (gsk_texture_scale_node_get_texture (node));
   scaling_filter = gsk_texture_scale_node_get_filter (node);
   timestamp = gsk_gpu_frame_get_timestamp (self->frame);
   need_mipmap = scaling_filter == GSK_SCALING_FILTER_TRILINEAR;
 
-  image = gsk_gpu_device_lookup_texture_image (device, texture, timestamp);
-  if (image == NULL)
+  cached_image = gsk_gpu_device_lookup_texture_image (device, texture, timestamp);
+
+  /* Unless the full image is on the GPU already, draw strongly downscaled
+   * memory textures from the mipmap levels shared with the cairo renderer.
+   * That way only the small level gets uploaded and the levels are kept
+   * once, within the texture's mipmap budget.
+   */
+  if (cached_image == NULL && need_mipmap && GDK_IS_MEMORY_TEXTURE (texture))
     {
-      image = gsk_gpu_frame_upload_texture (self->frame, need_mipmap, texture);
-      if (image == NULL)
+      guint level = gdk_texture_get_mipmap_level (texture,
+                                                  node->bounds.size.width,
+                                                  node->bounds.size.height);
+      if (level > 0)
+        {
+          GdkTexture *mipmap = gdk_texture_get_mipmap (texture, level);
+
+          if (mipmap)
+            {
+              g_object_unref (texture);
+              texture = mipmap;
+              cached_image = gsk_gpu_device_lookup_texture_image (device, texture, timestamp);
+            }
+        }
+    }
+
+  if (cached_image == NULL)
+    {
+      cached_image = gsk_gpu_frame_upload_texture (self->frame, need_mipmap, texture);
+      if (cached_image == NULL)
         {
           GSK_DEBUG (FALLBACK, "Unsupported texture format %u for size %dx%d",
                      gdk_texture_get_format (texture),
                      gdk_texture_get_width (texture),
                      gdk_texture_get_height (texture));
           gsk_gpu_node_processor_add_fallback_node (self, node);
+          g_object_unref (texture);
           return;
         }
     }
 
   image = gsk_gpu_node_processor_ensure_image (self->frame,
-                                               image,
+                                               cached_image,
                                                need_mipmap ? (GSK_GPU_IMAGE_CAN_MIPMAP | GSK_GPU_IMAGE_MIPMAP) : 0,
                                                GSK_GPU_IMAGE_STRAIGHT_ALPHA);
+  /* Keep the mipmapped copy around, so we don't have to create it again
+   * every frame.
+   */
+  if (need_mipmap && image != cached_image)
+    gsk_gpu_device_cache_texture_image (device, texture, timestamp, image);
 
   switch (scaling_filter)
     {
@@ -2125,6 +2191,7 @@ gsk_gpu_node_processor_add_texture_scale_node (GskGpuNodeProcessor *self,
                       &node->bounds);
 
   g_object_unref (image);
+  g_object_unref (texture);
 }
 
 static void
@@ -2967,6 +3034,56 @@ gsk_gpu_node_processor_create_mask_pattern (GskGpuPatternWriter *self,
   return TRUE;
 }
 
+/* The range of font sizes in pixels that distance field glyphs are
+ * rendered at */
+#define GSK_GPU_SDF_MIN_SIZE 32.f
+#define GSK_GPU_SDF_MAX_SIZE 128.f
+
+/*
+ * gsk_gpu_node_processor_get_sdf_scale:
+ * @self: a node processor
+ * @font: the font of the glyphs
+ * @scale: the scale the glyphs would be drawn at
+ *
+ * Text that is scaled by a transform, like in a zoom animation,
+ * would need new glyphs for every scale. So for such text, we
+ * use distance fields that are rendered at a scale rounded up to
+ * a power of 2 and can be used for all scales below that.
+ *
+ * Only the zoom applied by transforms counts here. The scale of
+ * the target itself, be it a fractional monitor scale or an
+ * offscreen, is what glyphs are rasterized for anyway.
+ *
+ * Returns: the scale to render distance fields at, or 0 if glyphs
+ *   should be rendered normally
+ */
+static float
+gsk_gpu_node_processor_get_sdf_scale (GskGpuNodeProcessor *self,
+                                      PangoFont           *font,
+                                      float                scale)
+{
+  PangoFontDescription *desc;
+  float zoom, size;
+
+  if (!gsk_gpu_frame_should_optimize (self->frame, GSK_GPU_OPTIMIZE_SDF_GLYPHS))
+    return 0;
+
+  /* Keep sharp glyphs for text that is not zoomed or enlarged by an integer */
+  zoom = roundf (self->zoom);
+  if (zoom >= 1 && fabsf (self->zoom - zoom) < 0.01)
+    return 0;
+
+  desc = pango_font_describe_with_absolute_size (font);
+  size = (float) pango_font_description_get_size (desc) / PANGO_SCALE;
+  pango_font_description_free (desc);
+  if (size <= 0)
+    return 0;
+
+  return CLAMP (exp2f (ceilf (log2f (scale))),
+                GSK_GPU_SDF_MIN_SIZE / size,
+                GSK_GPU_SDF_MAX_SIZE / size);
+}
+
 static void
 gsk_gpu_node_processor_add_glyph_node (GskGpuNodeProcessor *self,
                                        GskRenderNode       *node)
@@ -2976,17 +3093,10 @@ gsk_gpu_node_processor_add_glyph_node (GskGpuNodeProcessor *self,
   PangoFont *font;
   graphene_point_t offset;
   guint i, num_glyphs;
-  float scale, inv_scale;
+  float scale, inv_scale, sdf_scale;
   GdkRGBA color;
   gboolean glyph_align;
 
-  if (self->opacity < 1.0 &&
-      gsk_text_node_has_color_glyphs (node))
-    {
-      gsk_gpu_node_processor_add_without_opacity (self, node);
-      return;
-    }
-
   glyph_align = gsk_gpu_frame_should_optimize (self->frame, GSK_GPU_OPTIMIZE_GLYPH_ALIGN) &&
                 gsk_transform_get_category (self->modelview) >= GSK_TRANSFORM_CATEGORY_2D;
   device = gsk_gpu_frame_get_device (self->frame);
@@ -3001,6 +3111,7 @@ gsk_gpu_node_processor_add_glyph_node (GskGpuNodeProcessor *self,
 
   scale = MAX (graphene_vec2_get_x (&self->scale), graphene_vec2_get_y (&self->scale));
   inv_scale = 1.f / scale;
+  sdf_scale = gsk_gpu_node_processor_get_sdf_scale (self, font, scale);
 
   for (i = 0; i < num_glyphs; i++)
     {
@@ -3009,10 +3120,18 @@ gsk_gpu_node_processor_add_glyph_node (GskGpuNodeProcessor *self,
       graphene_point_t glyph_offset, glyph_origin;
       guint32 descriptor;
       GskGpuGlyphLookupFlags flags;
+      float glyph_scale, inv_glyph_scale;
+      gboolean sdf;
 
       glyph_origin = GRAPHENE_POINT_INIT (offset.x + (float) glyphs[i].geometry.x_offset / PANGO_SCALE,
                                           offset.y + (float) glyphs[i].geometry.y_offset / PANGO_SCALE);
-      if (glyph_align)
+      sdf = sdf_scale > 0 && !glyphs[i].attr.is_color;
+      if (sdf)
+        {
+          /* distance fields can be placed anywhere */
+          flags = GSK_GPU_GLYPH_SDF;
+        }
+      else if (glyph_align)
         {
           glyph_origin.x = roundf (glyph_origin.x * scale * 4);
           glyph_origin.y = roundf (glyph_origin.y * scale * 4);
@@ -3026,28 +3145,42 @@ gsk_gpu_node_processor_add_glyph_node (GskGpuNodeProcessor *self,
           flags = 0;
         }
 
+      glyph_scale = sdf ? sdf_scale : scale;
+      inv_glyph_scale = 1.f / glyph_scale;
+
       image = gsk_gpu_device_lookup_glyph_image (device,
                                                  self->frame,
                                                  font,
                                                  glyphs[i].glyph,
                                                  flags,
-                                                 scale,
+                                                 glyph_scale,
                                                  &glyph_bounds,
                                                  &glyph_offset);
 
-      gsk_rect_scale (&GRAPHENE_RECT_INIT (-glyph_bounds.origin.x, -glyph_bounds.origin.y, gsk_gpu_image_get_width (image), gsk_gpu_image_get_height (image)), inv_scale, inv_scale, &glyph_tex_rect);
-      gsk_rect_scale (&GRAPHENE_RECT_INIT(0, 0, glyph_bounds.size.width, glyph_bounds.size.height), inv_scale, inv_scale, &glyph_bounds);
-      glyph_origin = GRAPHENE_POINT_INIT (glyph_origin.x - glyph_offset.x * inv_scale,
-                                          glyph_origin.y - glyph_offset.y * inv_scale);
+      gsk_rect_scale (&GRAPHENE_RECT_INIT (-glyph_bounds.origin.x, -glyph_bounds.origin.y, gsk_gpu_image_get_width (image), gsk_gpu_image_get_height (image)), inv_glyph_scale, inv_glyph_scale, &glyph_tex_rect);
+      gsk_rect_scale (&GRAPHENE_RECT_INIT(0, 0, glyph_bounds.size.width, glyph_bounds.size.height), inv_glyph_scale, inv_glyph_scale, &glyph_bounds);
+      glyph_origin = GRAPHENE_POINT_INIT (glyph_origin.x - glyph_offset.x * inv_glyph_scale,
+                                          glyph_origin.y - glyph_offset.y * inv_glyph_scale);
       descriptor = gsk_gpu_node_processor_add_image (self, image, GSK_GPU_SAMPLER_DEFAULT);
-      if (glyphs[i].attr.is_color)
-        gsk_gpu_texture_op (self->frame,
-                            gsk_gpu_clip_get_shader_clip (&self->clip, &glyph_offset, &glyph_bounds),
-                            self->desc,
-                            descriptor,
-                            &glyph_bounds,
-                            &glyph_origin,
-                            &glyph_tex_rect);
+      if (sdf)
+        gsk_gpu_colorize_sdf_op (self->frame,
+                                 gsk_gpu_clip_get_shader_clip (&self->clip, &glyph_offset, &glyph_bounds),
+                                 self->desc,
+                                 descriptor,
+                                 &glyph_bounds,
+                                 &glyph_origin,
+                                 &glyph_tex_rect,
+                                 &color);
+      else if (glyphs[i].attr.is_color)
+        gsk_gpu_colorize_color_glyph_op (self->frame,
+                                         gsk_gpu_clip_get_shader_clip (&self->clip, &glyph_offset, &glyph_bounds),
+                                         self->desc,
+                                         descriptor,
+                                         &glyph_bounds,
+                                         &glyph_origin,
+                                         &glyph_tex_rect,
+                                         sdf_scale > 0,
+                                         self->opacity);
       else
         gsk_gpu_colorize_op (self->frame,
                              gsk_gpu_clip_get_shader_clip (&self->clip, &glyph_offset, &glyph_bounds),
@@ -3076,9 +3209,6 @@ gsk_gpu_node_processor_create_glyph_pattern (GskGpuPatternWriter *self,
   GskGpuImage *last_image;
   graphene_point_t offset;
 
-  if (gsk_text_node_has_color_glyphs (node))
-    return FALSE;
-
   device = gsk_gpu_frame_get_device (self->frame);
   num_glyphs = gsk_text_node_get_num_glyphs (node);
   glyphs = gsk_text_node_get_glyphs (node, NULL);
@@ -3122,6 +3252,7 @@ gsk_gpu_node_processor_create_glyph_pattern (GskGpuPatternWriter *self,
                                           offset.y - glyph_offset.y * inv_scale + (float) glyphs[i].geometry.y_offset / PANGO_SCALE);
 
       gsk_gpu_pattern_writer_append_uint (self, tex_id);
+      gsk_gpu_pattern_writer_append_uint (self, glyphs[i].attr.is_color);
       gsk_gpu_pattern_writer_append_rect (self,
                                           &GRAPHENE_RECT_INIT (
                                               0,
@@ -3456,7 +3587,6 @@ typedef struct _FillData FillData;
 struct _FillData
 {
   GskPath *path;
-  GdkRGBA color;
   GskFillRule fill_rule;
 };
 
@@ -3488,51 +3618,157 @@ gsk_gpu_node_processor_fill_path (gpointer  data,
       break;
   }
   gsk_path_to_cairo (fill->path, cr);
-  gdk_cairo_set_source_rgba (cr, &fill->color);
+  cairo_set_source_rgb (cr, 1, 1, 1);
   cairo_fill (cr);
 }
 
+typedef struct _StrokeData StrokeData;
+struct _StrokeData
+{
+  GskPath *path;
+  GskStroke stroke;
+};
+
 static void
-gsk_gpu_node_processor_add_fill_node (GskGpuNodeProcessor *self,
-                                      GskRenderNode       *node)
+gsk_stroke_data_free (gpointer data)
 {
-  graphene_rect_t clip_bounds, source_rect;
-  GskGpuImage *mask_image, *source_image;
-  guint32 descriptors[2];
-  GskRenderNode *child;
+  StrokeData *stroke = data;
 
-  if (!gsk_gpu_node_processor_clip_node_bounds (self, node, &clip_bounds))
-    return;
-  rect_round_to_pixels (&clip_bounds, &self->scale, &self->offset, &clip_bounds);
+  gsk_path_unref (stroke->path);
+  gsk_stroke_clear (&stroke->stroke);
+  g_free (stroke);
+}
 
-  child = gsk_fill_node_get_child (node);
+static void
+gsk_gpu_node_processor_stroke_path (gpointer  data,
+                                    cairo_t  *cr)
+{
+  StrokeData *stroke = data;
+
+  gsk_stroke_to_cairo (&stroke->stroke, cr);
+  gsk_path_to_cairo (stroke->path, cr);
+  cairo_set_source_rgb (cr, 1, 1, 1);
+  cairo_stroke (cr);
+}
+
+/*
+ * gsk_gpu_node_processor_get_path_mask:
+ * @self: a node processor
+ * @bounds: the area of the mask, rounded to the pixel grid
+ * @path: the path
+ * @stroke: (nullable): the stroke or %NULL to fill the path
+ * @fill_rule: the fill rule when filling
+ *
+ * Rasterizes the path into an alpha mask with cairo.
+ *
+ * The mask is cached with the device, so drawing the same path
+ * in the same place again doesn't need to rasterize it again.
+ * Use gsk_gpu_node_processor_get_path_mask_bounds() for @bounds,
+ * so that the mask can be reused when the visible part changes.
+ *
+ * Returns: (nullable) (transfer full): the mask
+ */
+static GskGpuImage *
+gsk_gpu_node_processor_get_path_mask (GskGpuNodeProcessor   *self,
+                                      const graphene_rect_t *bounds,
+                                      GskPath               *path,
+                                      const GskStroke       *stroke,
+                                      GskFillRule            fill_rule)
+{
+  GskGpuDevice *device;
+  GskGpuImage *image;
+  gint64 timestamp;
+
+  device = gsk_gpu_frame_get_device (self->frame);
+  timestamp = gsk_gpu_frame_get_timestamp (self->frame);
+
+  image = gsk_gpu_device_lookup_path_image (device, path, stroke, fill_rule, &self->scale, bounds, timestamp);
+  if (image)
+    return image;
+
+  if (stroke)
+    image = gsk_gpu_upload_cairo_op (self->frame,
+                                     &self->scale,
+                                     bounds,
+                                     gsk_gpu_node_processor_stroke_path,
+                                     g_memdup (&(StrokeData) {
+                                         .path = gsk_path_ref (path),
+                                         .stroke = GSK_STROKE_INIT_COPY (stroke)
+                                     }, sizeof (StrokeData)),
+                                     (GDestroyNotify) gsk_stroke_data_free);
+  else
+    image = gsk_gpu_upload_cairo_op (self->frame,
+                                     &self->scale,
+                                     bounds,
+                                     gsk_gpu_node_processor_fill_path,
+                                     g_memdup (&(FillData) {
+                                         .path = gsk_path_ref (path),
+                                         .fill_rule = fill_rule
+                                     }, sizeof (FillData)),
+                                     (GDestroyNotify) gsk_fill_data_free);
+  if (image == NULL)
+    return NULL;
+
+  gsk_gpu_device_cache_path_image (device, path, stroke, fill_rule, &self->scale, bounds, timestamp, image);
+
+  return g_object_ref (image);
+}
+
+/*
+ * gsk_gpu_node_processor_get_path_mask_bounds:
+ * @self: a node processor
+ * @node: the fill or stroke node
+ * @clip_bounds: the visible part of the node, rounded to the pixel grid
+ * @mask_bounds: (out): the area to rasterize the path mask for
+ *
+ * Masks cover the whole node, not just the visible part, so they stay
+ * valid when the clip changes. Nodes that are a lot bigger than what
+ * is visible only get a mask for the visible part.
+ */
+static void
+gsk_gpu_node_processor_get_path_mask_bounds (GskGpuNodeProcessor   *self,
+                                             GskRenderNode         *node,
+                                             const graphene_rect_t *clip_bounds,
+                                             graphene_rect_t       *mask_bounds)
+{
+  rect_round_to_pixels (&node->bounds, &self->scale, &self->offset, mask_bounds);
+
+  if (mask_bounds->size.width * mask_bounds->size.height >
+      4 * clip_bounds->size.width * clip_bounds->size.height)
+    *mask_bounds = *clip_bounds;
+}
+
+static void
+gsk_gpu_node_processor_add_path_mask (GskGpuNodeProcessor   *self,
+                                      const graphene_rect_t *bounds,
+                                      GskGpuImage           *mask_image,
+                                      const graphene_rect_t *mask_bounds,
+                                      GskRenderNode         *child)
+{
+  graphene_rect_t source_rect;
+  GskGpuImage *source_image;
+  guint32 descriptors[2];
 
-  mask_image = gsk_gpu_upload_cairo_op (self->frame,
-                                        &self->scale,
-                                        &clip_bounds,
-                                        gsk_gpu_node_processor_fill_path,
-                                        g_memdup (&(FillData) {
-                                            .path = gsk_path_ref (gsk_fill_node_get_path (node)),
-                                            .color = GSK_RENDER_NODE_TYPE (child) == GSK_COLOR_NODE
-                                                   ? *gsk_color_node_get_color (child)
-                                                   : GDK_RGBA_WHITE,
-                                            .fill_rule = gsk_fill_node_get_fill_rule (node)
-                                        }, sizeof (FillData)),
-                                        (GDestroyNotify) gsk_fill_data_free);
-  g_return_if_fail (mask_image != NULL);
   if (GSK_RENDER_NODE_TYPE (child) == GSK_COLOR_NODE)
     {
-      gsk_gpu_node_processor_image_op (self,
-                                       mask_image,
-                                       &clip_bounds,
-                                       &clip_bounds);
+      const GdkRGBA *rgba = gsk_color_node_get_color (child);
+      guint32 descriptor = gsk_gpu_node_processor_add_image (self, mask_image, GSK_GPU_SAMPLER_DEFAULT);
+
+      gsk_gpu_colorize_op (self->frame,
+                           gsk_gpu_clip_get_shader_clip (&self->clip, &self->offset, bounds),
+                           self->desc,
+                           descriptor,
+                           bounds,
+                           &self->offset,
+                           mask_bounds,
+                           &GDK_RGBA_INIT_ALPHA (rgba, self->opacity));
       return;
     }
 
   source_image = gsk_gpu_node_processor_get_node_as_image (self,
                                                            0,
                                                            GSK_GPU_IMAGE_STRAIGHT_ALPHA,
-                                                           &clip_bounds,
+                                                           bounds,
                                                            child,
                                                            &source_rect);
   if (source_image == NULL)
@@ -3545,57 +3781,294 @@ gsk_gpu_node_processor_add_fill_node (GskGpuNodeProcessor *self,
                                      descriptors);
 
   gsk_gpu_mask_op (self->frame,
-                   gsk_gpu_clip_get_shader_clip (&self->clip, &self->offset, &clip_bounds),
+                   gsk_gpu_clip_get_shader_clip (&self->clip, &self->offset, bounds),
                    self->desc,
-                   &clip_bounds,
+                   bounds,
                    &self->offset,
                    self->opacity,
                    GSK_MASK_MODE_ALPHA,
                    descriptors[0],
                    &source_rect,
                    descriptors[1],
-                   &clip_bounds);
+                   mask_bounds);
 
   g_object_unref (source_image);
 }
 
-typedef struct _StrokeData StrokeData;
-struct _StrokeData
+/* The shader looks at every line for every pixel, so paths with
+ * more lines than this are rasterized with cairo. So are paths where
+ * lines times pixels exceeds the maximum work, the cairo mask for
+ * those is cheaper, in particular as it is cached between frames.
+ */
+#define GSK_GPU_PATH_MAX_LINES 1024
+#define GSK_GPU_PATH_MAX_WORK (16 * 1024 * 1024)
+/* in pixels */
+#define GSK_GPU_PATH_TOLERANCE 0.25
+
+typedef struct _PathLines PathLines;
+struct _PathLines
 {
-  GskPath *path;
-  GdkRGBA color;
-  GskStroke stroke;
+  PatternBuffer buffer;
+  graphene_point_t start;
+  graphene_point_t current;
+  guint32 n_lines;
 };
 
-static void
-gsk_stroke_data_free (gpointer data)
+static gboolean
+path_lines_add_line (PathLines              *self,
+                     const graphene_point_t *from,
+                     const graphene_point_t *to)
 {
-  StrokeData *stroke = data;
+  float line[4] = { from->x, from->y, to->x, to->y };
 
-  gsk_path_unref (stroke->path);
-  gsk_stroke_clear (&stroke->stroke);
-  g_free (stroke);
+  if (self->n_lines >= GSK_GPU_PATH_MAX_LINES)
+    return FALSE;
+
+  pattern_buffer_splice (&self->buffer,
+                         pattern_buffer_get_size (&self->buffer),
+                         0,
+                         FALSE,
+                         (guchar *) line,
+                         sizeof (line));
+  self->n_lines++;
+
+  return TRUE;
+}
+
+static gboolean
+path_lines_close (PathLines *self)
+{
+  if (graphene_point_equal (&self->current, &self->start))
+    return TRUE;
+
+  if (!path_lines_add_line (self, &self->current, &self->start))
+    return FALSE;
+
+  self->current = self->start;
+  return TRUE;
+}
+
+static gboolean
+path_lines_foreach_cb (GskPathOperation        op,
+                       const graphene_point_t *pts,
+                       gsize                   n_pts,
+                       float                   weight,
+                       gpointer                data)
+{
+  PathLines *self = data;
+
+  switch (op)
+    {
+    case GSK_PATH_MOVE:
+      /* filling closes all contours */
+      if (!path_lines_close (self))
+        return FALSE;
+      self->start = pts[0];
+      self->current = pts[0];
+      return TRUE;
+
+    case GSK_PATH_CLOSE:
+      return path_lines_close (self);
+
+    case GSK_PATH_LINE:
+      self->current = pts[1];
+      return path_lines_add_line (self, &pts[0], &pts[1]);
+
+    case GSK_PATH_QUAD:
+    case GSK_PATH_CUBIC:
+    case GSK_PATH_CONIC:
+    default:
+      g_assert_not_reached ();
+      return FALSE;
+    }
+}
+
+/*
+ * gsk_gpu_node_processor_fill_path_on_gpu:
+ * @self: a node processor
+ * @bounds: the area to fill, in the node processor's coordinates
+ * @path: the path to fill
+ * @fill_rule: the fill rule
+ * @color: the color to fill with
+ *
+ * Flattens the path into lines and fills it with the path shader.
+ *
+ * Returns: %FALSE if the path can't be drawn this way and needs
+ *   to be rasterized with cairo
+ */
+static gboolean
+gsk_gpu_node_processor_fill_path_on_gpu (GskGpuNodeProcessor   *self,
+                                         const graphene_rect_t *bounds,
+                                         GskPath               *path,
+                                         GskFillRule            fill_rule,
+                                         const GdkRGBA         *color)
+{
+  PathLines lines;
+  GskGpuBuffer *buffer;
+  gsize offset;
+  guint32 path_id;
+  GdkRGBA fill_color;
+  float scale;
+
+  if (!gsk_gpu_frame_should_optimize (self->frame, GSK_GPU_OPTIMIZE_PATHS))
+    return FALSE;
+
+  scale = MAX (graphene_vec2_get_x (&self->scale), graphene_vec2_get_y (&self->scale));
+  if (scale <= 0)
+    return FALSE;
+
+  pattern_buffer_init (&lines.buffer);
+  lines.n_lines = 0;
+  lines.start = lines.current = GRAPHENE_POINT_INIT (0, 0);
+  /* the number of lines goes first */
+  pattern_buffer_splice (&lines.buffer, 0, 0, FALSE, (guchar *) &lines.n_lines, sizeof (guint32));
+
+  if (!gsk_path_foreach_with_tolerance (path,
+                                        GSK_PATH_FOREACH_ALLOW_ONLY_LINES,
+                                        GSK_GPU_PATH_TOLERANCE / scale,
+                                        path_lines_foreach_cb,
+                                        &lines) ||
+      !path_lines_close (&lines))
+    {
+      GSK_DEBUG (FALLBACK, "Path with more than %u lines", GSK_GPU_PATH_MAX_LINES);
+      pattern_buffer_clear (&lines.buffer);
+      return FALSE;
+    }
+
+  if ((double) lines.n_lines * bounds->size.width * graphene_vec2_get_x (&self->scale)
+                             * bounds->size.height * graphene_vec2_get_y (&self->scale) > GSK_GPU_PATH_MAX_WORK)
+    {
+      GSK_DEBUG (FALLBACK, "Path with %u lines is too expensive to fill on the GPU", lines.n_lines);
+      pattern_buffer_clear (&lines.buffer);
+      return FALSE;
+    }
+
+  memcpy (pattern_buffer_get_data (&lines.buffer), &lines.n_lines, sizeof (guint32));
+
+  buffer = gsk_gpu_frame_write_storage_buffer (self->frame,
+                                               pattern_buffer_get_data (&lines.buffer),
+                                               pattern_buffer_get_size (&lines.buffer),
+                                               &offset);
+  pattern_buffer_clear (&lines.buffer);
+
+  path_id = gsk_gpu_node_processor_add_buffer (self, buffer);
+  path_id = (path_id << 22) | (offset / sizeof (float));
+
+  fill_color = *color;
+  fill_color.alpha *= self->opacity;
+
+  gsk_gpu_path_op (self->frame,
+                   gsk_gpu_clip_get_shader_clip (&self->clip, &self->offset, bounds),
+                   self->desc,
+                   bounds,
+                   &self->offset,
+                   &fill_color,
+                   fill_rule,
+                   path_id);
+
+  return TRUE;
+}
+
+static gboolean
+path_count_lines_cb (GskPathOperation        op,
+                     const graphene_point_t *pts,
+                     gsize                   n_pts,
+                     float                   weight,
+                     gpointer                data)
+{
+  guint *n_lines = data;
+
+  if (op != GSK_PATH_MOVE)
+    (*n_lines)++;
+
+  return *n_lines <= GSK_GPU_PATH_MAX_LINES;
+}
+
+/*
+ * gsk_gpu_node_processor_stroke_fits_on_gpu:
+ * @self: a node processor
+ * @path: the path to stroke
+ * @stroke: the stroke
+ * @scale: the scale the outline will be flattened for
+ *
+ * Estimates the number of lines in the outline of the stroke,
+ * so we don't compute outlines that are too big for the path
+ * shader anyway.
+ *
+ * Returns: %TRUE if the outline is likely to fit
+ */
+static gboolean
+gsk_gpu_node_processor_stroke_fits_on_gpu (GskGpuNodeProcessor *self,
+                                           GskPath             *path,
+                                           const GskStroke     *stroke,
+                                           float                scale)
+{
+  guint n_lines, lines_per_line;
+
+  /* The number of dashes depends on the length of the path */
+  if (stroke->n_dash > 0)
+    return FALSE;
+
+  n_lines = 0;
+  if (!gsk_path_foreach_with_tolerance (path,
+                                        GSK_PATH_FOREACH_ALLOW_ONLY_LINES,
+                                        GSK_GPU_PATH_TOLERANCE / scale,
+                                        path_count_lines_cb,
+                                        &n_lines))
+    return FALSE;
+
+  /* Every line gets an offset line on both sides and a join on one of
+   * them. Round joins and caps get flattened into more lines, the
+   * bigger they are.
+   */
+  lines_per_line = 4;
+  if (stroke->line_join == GSK_LINE_JOIN_ROUND || stroke->line_cap == GSK_LINE_CAP_ROUND)
+    lines_per_line += ceil (sqrt (stroke->line_width * scale / GSK_GPU_PATH_TOLERANCE));
+
+  return (guint64) n_lines * lines_per_line <= GSK_GPU_PATH_MAX_LINES;
 }
 
 static void
-gsk_gpu_node_processor_stroke_path (gpointer  data,
-                                    cairo_t  *cr)
+gsk_gpu_node_processor_add_fill_node (GskGpuNodeProcessor *self,
+                                      GskRenderNode       *node)
 {
-  StrokeData *stroke = data;
+  graphene_rect_t clip_bounds, mask_bounds;
+  GskGpuImage *mask_image;
+  GskRenderNode *child;
 
-  gsk_stroke_to_cairo (&stroke->stroke, cr);
-  gsk_path_to_cairo (stroke->path, cr);
-  gdk_cairo_set_source_rgba (cr, &stroke->color);
-  cairo_stroke (cr);
+  if (!gsk_gpu_node_processor_clip_node_bounds (self, node, &clip_bounds))
+    return;
+  rect_round_to_pixels (&clip_bounds, &self->scale, &self->offset, &clip_bounds);
+
+  child = gsk_fill_node_get_child (node);
+
+  if (GSK_RENDER_NODE_TYPE (child) == GSK_COLOR_NODE &&
+      gsk_gpu_node_processor_fill_path_on_gpu (self,
+                                               &clip_bounds,
+                                               gsk_fill_node_get_path (node),
+                                               gsk_fill_node_get_fill_rule (node),
+                                               gsk_color_node_get_color (child)))
+    return;
+
+  gsk_gpu_node_processor_get_path_mask_bounds (self, node, &clip_bounds, &mask_bounds);
+  mask_image = gsk_gpu_node_processor_get_path_mask (self,
+                                                     &mask_bounds,
+                                                     gsk_fill_node_get_path (node),
+                                                     NULL,
+                                                     gsk_fill_node_get_fill_rule (node));
+  g_return_if_fail (mask_image != NULL);
+
+  gsk_gpu_node_processor_add_path_mask (self, &clip_bounds, mask_image, &mask_bounds, child);
+
+  g_object_unref (mask_image);
 }
 
 static void
 gsk_gpu_node_processor_add_stroke_node (GskGpuNodeProcessor *self,
                                         GskRenderNode       *node)
 {
-  graphene_rect_t clip_bounds, source_rect;
-  GskGpuImage *mask_image, *source_image;
-  guint32 descriptors[2];
+  graphene_rect_t clip_bounds, mask_bounds;
+  GskGpuImage *mask_image;
   GskRenderNode *child;
 
   if (!gsk_gpu_node_processor_clip_node_bounds (self, node, &clip_bounds))
@@ -3604,56 +4077,44 @@ gsk_gpu_node_processor_add_stroke_node (GskGpuNodeProcessor *self,
 
   child = gsk_stroke_node_get_child (node);
 
-  mask_image = gsk_gpu_upload_cairo_op (self->frame,
-                                        &self->scale,
-                                        &clip_bounds,
-                                        gsk_gpu_node_processor_stroke_path,
-                                        g_memdup (&(StrokeData) {
-                                            .path = gsk_path_ref (gsk_stroke_node_get_path (node)),
-                                            .color = GSK_RENDER_NODE_TYPE (child) == GSK_COLOR_NODE
-                                                   ? *gsk_color_node_get_color (child)
-                                                   : GDK_RGBA_WHITE,
-                                            .stroke = GSK_STROKE_INIT_COPY (gsk_stroke_node_get_stroke (node))
-                                        }, sizeof (StrokeData)),
-                                        (GDestroyNotify) gsk_stroke_data_free);
-  g_return_if_fail (mask_image != NULL);
-  if (GSK_RENDER_NODE_TYPE (child) == GSK_COLOR_NODE)
+  if (GSK_RENDER_NODE_TYPE (child) == GSK_COLOR_NODE &&
+      gsk_gpu_frame_should_optimize (self->frame, GSK_GPU_OPTIMIZE_PATHS))
     {
-      gsk_gpu_node_processor_image_op (self,
-                                       mask_image,
-                                       &clip_bounds,
-                                       &clip_bounds);
-      return;
+      GskPath *outline;
+      float scale;
+      gboolean success;
+
+      scale = MAX (MAX (graphene_vec2_get_x (&self->scale), graphene_vec2_get_y (&self->scale)), 1.0);
+      if (gsk_gpu_node_processor_stroke_fits_on_gpu (self,
+                                                     gsk_stroke_node_get_path (node),
+                                                     gsk_stroke_node_get_stroke (node),
+                                                     scale))
+        {
+          outline = gsk_path_stroke_with_tolerance (gsk_stroke_node_get_path (node),
+                                                    gsk_stroke_node_get_stroke (node),
+                                                    GSK_GPU_PATH_TOLERANCE / scale);
+          success = gsk_gpu_node_processor_fill_path_on_gpu (self,
+                                                             &clip_bounds,
+                                                             outline,
+                                                             GSK_FILL_RULE_WINDING,
+                                                             gsk_color_node_get_color (child));
+          gsk_path_unref (outline);
+          if (success)
+            return;
+        }
     }
 
-  source_image = gsk_gpu_node_processor_get_node_as_image (self,
-                                                           0,
-                                                           GSK_GPU_IMAGE_STRAIGHT_ALPHA,
-                                                           &clip_bounds,
-                                                           child,
-                                                           &source_rect);
-  if (source_image == NULL)
-    return;
-
-  gsk_gpu_node_processor_add_images (self,
-                                     2,
-                                     (GskGpuImage *[2]) { source_image, mask_image },
-                                     (GskGpuSampler[2]) { GSK_GPU_SAMPLER_DEFAULT, GSK_GPU_SAMPLER_DEFAULT },
-                                     descriptors);
+  gsk_gpu_node_processor_get_path_mask_bounds (self, node, &clip_bounds, &mask_bounds);
+  mask_image = gsk_gpu_node_processor_get_path_mask (self,
+                                                     &mask_bounds,
+                                                     gsk_stroke_node_get_path (node),
+                                                     gsk_stroke_node_get_stroke (node),
+                                                     GSK_FILL_RULE_WINDING);
+  g_return_if_fail (mask_image != NULL);
 
-  gsk_gpu_mask_op (self->frame,
-                   gsk_gpu_clip_get_shader_clip (&self->clip, &self->offset, &clip_bounds),
-                   self->desc,
-                   &clip_bounds,
-                   &self->offset,
-                   self->opacity,
-                   GSK_MASK_MODE_ALPHA,
-                   descriptors[0],
-                   &source_rect,
-                   descriptors[1],
-                   &clip_bounds);
+  gsk_gpu_node_processor_add_path_mask (self, &clip_bounds, mask_image, &mask_bounds, child);
 
-  g_object_unref (source_image);
+  g_object_unref (mask_image);
 }
 
 static void
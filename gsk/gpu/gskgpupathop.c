@@ -0,0 +1,92 @@
+#include "config.h"
+
+#include "gskgpupathopprivate.h"
+
+#include "gskenumtypes.h"
+#include "gskgpuframeprivate.h"
+#include "gskgpuprintprivate.h"
+#include "gskgpushaderopprivate.h"
+#include "gskrectprivate.h"
+
+#include "gpu/shaders/gskgpupathinstance.h"
+
+#define VARIATION_EVEN_ODD 1
+
+typedef struct _GskGpuPathOp GskGpuPathOp;
+
+struct _GskGpuPathOp
+{
+  GskGpuShaderOp op;
+};
+
+static void
+gsk_gpu_path_op_print (GskGpuOp    *op,
+                       GskGpuFrame *frame,
+                       GString     *string,
+                       guint        indent)
+{
+  GskGpuShaderOp *shader = (GskGpuShaderOp *) op;
+  GskGpuPathInstance *instance;
+
+  instance = (GskGpuPathInstance *) gsk_gpu_frame_get_vertex_data (frame, shader->vertex_offset);
+
+  gsk_gpu_print_op (string, indent, "path");
+  gsk_gpu_print_rect (string, instance->rect);
+  gsk_gpu_print_rgba (string, instance->color);
+  gsk_gpu_print_enum (string, GSK_TYPE_FILL_RULE, shader->variation & VARIATION_EVEN_ODD ? GSK_FILL_RULE_EVEN_ODD : GSK_FILL_RULE_WINDING);
+  gsk_gpu_print_newline (string);
+}
+
+static const GskGpuShaderOpClass GSK_GPU_PATH_OP_CLASS = {
+  {
+    GSK_GPU_OP_SIZE (GskGpuPathOp),
+    GSK_GPU_STAGE_SHADER,
+    gsk_gpu_shader_op_finish,
+    gsk_gpu_path_op_print,
+#ifdef GDK_RENDERING_VULKAN
+    gsk_gpu_shader_op_vk_command,
+#endif
+    gsk_gpu_shader_op_gl_command
+  },
+  "gskgpupath",
+  sizeof (GskGpuPathInstance),
+#ifdef GDK_RENDERING_VULKAN
+  &gsk_gpu_path_info,
+#endif
+  gsk_gpu_path_setup_attrib_locations,
+  gsk_gpu_path_setup_vao
+};
+
+/*
+ * gsk_gpu_path_op:
+ * @path_id: the lines of the path in a storage buffer, see
+ *   gskgpupath.glsl for the format
+ *
+ * Fills a path that has been flattened into lines by computing
+ * the coverage of every pixel in the shader.
+ */
+void
+gsk_gpu_path_op (GskGpuFrame            *frame,
+                 GskGpuShaderClip        clip,
+                 GskGpuDescriptors      *desc,
+                 const graphene_rect_t  *rect,
+                 const graphene_point_t *offset,
+                 const GdkRGBA          *color,
+                 GskFillRule             fill_rule,
+                 guint32                 path_id)
+{
+  GskGpuPathInstance *instance;
+
+  gsk_gpu_shader_op_alloc (frame,
+                           &GSK_GPU_PATH_OP_CLASS,
+                           fill_rule == GSK_FILL_RULE_EVEN_ODD ? VARIATION_EVEN_ODD : 0,
+                           clip,
+                           desc,
+                           &instance);
+
+  gsk_gpu_rect_to_float (rect, offset, instance->rect);
+  gsk_gpu_rgba_to_float (color, instance->color);
+  instance->offset[0] = offset->x;
+  instance->offset[1] = offset->y;
+  instance->path_id = path_id;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "gskgpushaderopprivate.h"
+
+#include <graphene.h>
+
+G_BEGIN_DECLS
+
+void                    gsk_gpu_path_op                                 (GskGpuFrame                    *frame,
+                                                                         GskGpuShaderClip                clip,
+                                                                         GskGpuDescriptors              *desc,
+                                                                         const graphene_rect_t          *rect,
+                                                                         const graphene_point_t         *offset,
+                                                                         const GdkRGBA                  *color,
+                                                                         GskFillRule                     fill_rule,
+                                                                         guint32                         path_id);
+
+
+G_END_DECLS
+
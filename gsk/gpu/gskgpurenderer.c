@@ -31,6 +31,8 @@ static const GdkDebugKey gsk_gpu_optimization_keys[] = {
   { "gradients", GSK_GPU_OPTIMIZE_GRADIENTS, "Don't supersample gradients" },
   { "mipmap", GSK_GPU_OPTIMIZE_MIPMAP, "Avoid creating mipmaps" },
   { "glyph-align", GSK_GPU_OPTIMIZE_GLYPH_ALIGN, "Never align glyphs to the subpixel grid" },
+  { "paths", GSK_GPU_OPTIMIZE_PATHS, "Rasterize fill and stroke paths with cairo" },
+  { "sdf-glyphs", GSK_GPU_OPTIMIZE_SDF_GLYPHS, "Never use distance fields for scaled glyphs" },
 
   { "gl-baseinstance", GSK_GPU_OPTIMIZE_GL_BASE_INSTANCE, "Assume no ARB/EXT_base_instance support" },
 };
@@ -59,7 +61,7 @@ gsk_gpu_renderer_make_current (GskGpuRenderer *self)
   GSK_GPU_RENDERER_GET_CLASS (self)->make_current (self);
 }
 
-static GskGpuFrame *
+GskGpuFrame *
 gsk_gpu_renderer_create_frame (GskGpuRenderer *self)
 {
   GskGpuRendererPrivate *priv = gsk_gpu_renderer_get_instance_private (self);
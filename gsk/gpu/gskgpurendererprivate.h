@@ -45,6 +45,7 @@ struct _GskGpuRendererClass
 
 GdkDrawContext *        gsk_gpu_renderer_get_context                    (GskGpuRenderer         *self);
 GskGpuDevice *          gsk_gpu_renderer_get_device                     (GskGpuRenderer         *self);
+GskGpuFrame *           gsk_gpu_renderer_create_frame                   (GskGpuRenderer         *self);
 double                  gsk_gpu_renderer_get_scale                      (GskGpuRenderer         *self);
 
 G_END_DECLS
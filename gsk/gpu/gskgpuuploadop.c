@@ -9,6 +9,7 @@
 #include "gskglimageprivate.h"
 #ifdef GDK_RENDERING_VULKAN
 #include "gskvulkanbufferprivate.h"
+#include "gskvulkanframeprivate.h"
 #include "gskvulkanimageprivate.h"
 #endif
 
@@ -101,16 +102,29 @@ gsk_gpu_upload_op_vk_command_with_area (GskGpuOp                    *op,
                                         void           (* draw_func) (GskGpuOp *, guchar *, gsize),
                                         GskGpuBuffer               **buffer)
 {
-  gsize stride;
+  gsize bpp, stride, offset, size;
+  GskGpuBuffer *upload_buffer;
   guchar *data;
 
-  stride = area->width * gdk_memory_format_bytes_per_pixel (gsk_gpu_image_get_format (GSK_GPU_IMAGE (image)));
-  *buffer = gsk_vulkan_buffer_new_write (GSK_VULKAN_DEVICE (gsk_gpu_frame_get_device (frame)),
-                                         area->height * stride);
+  bpp = gdk_memory_format_bytes_per_pixel (gsk_gpu_image_get_format (GSK_GPU_IMAGE (image)));
+  stride = area->width * bpp;
+  size = area->height * stride;
+
+  /* bufferOffset must be a multiple of 4 and of the texel size */
+  upload_buffer = gsk_vulkan_frame_reserve_upload_data (GSK_VULKAN_FRAME (frame), size, 4 * bpp, &offset);
+  if (upload_buffer)
+    {
+      *buffer = g_object_ref (upload_buffer);
+    }
+  else
+    {
+      *buffer = gsk_vulkan_buffer_new_write (GSK_VULKAN_DEVICE (gsk_gpu_frame_get_device (frame)), size);
+      offset = 0;
+    }
   data = gsk_gpu_buffer_map (*buffer);
 
-  draw_func (op, data, stride);
-  
+  draw_func (op, data + offset, stride);
+
   gsk_gpu_buffer_unmap (*buffer);
 
   vkCmdPipelineBarrier (state->vk_command_buffer,
@@ -125,8 +139,8 @@ gsk_gpu_upload_op_vk_command_with_area (GskGpuOp                    *op,
                             .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
                             .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
                             .buffer = gsk_vulkan_buffer_get_vk_buffer (GSK_VULKAN_BUFFER (*buffer)),
-                            .offset = 0,
-                            .size = VK_WHOLE_SIZE,
+                            .offset = offset,
+                            .size = size,
                         },
                         0, NULL);
   gsk_vulkan_image_transition (image, 
@@ -143,7 +157,7 @@ gsk_gpu_upload_op_vk_command_with_area (GskGpuOp                    *op,
                           1,
                           (VkBufferImageCopy[1]) {
                                {
-                                   .bufferOffset = 0,
+                                   .bufferOffset = offset,
                                    .bufferRowLength = area->width,
                                    .bufferImageHeight = area->height,
                                    .imageSubresource = {
@@ -487,6 +501,10 @@ struct _GskGpuUploadGlyphOp
   PangoGlyph glyph;
   float scale;
   graphene_point_t origin;
+  gboolean sdf;
+
+  /* set when the distance field was computed ahead of time */
+  guchar *pixels;
 
   GskGpuBuffer *buffer;
 };
@@ -498,6 +516,7 @@ gsk_gpu_upload_glyph_op_finish (GskGpuOp *op)
 
   g_object_unref (self->image);
   g_object_unref (self->font);
+  g_clear_pointer (&self->pixels, g_free);
 
   g_clear_object (&self->buffer);
 }
@@ -513,15 +532,16 @@ gsk_gpu_upload_glyph_op_print (GskGpuOp    *op,
   gsk_gpu_print_op (string, indent, "upload-glyph");
   gsk_gpu_print_int_rect (string, &self->area);
   g_string_append_printf (string, "glyph %u @ %g ", self->glyph, self->scale);
+  if (self->sdf)
+    g_string_append (string, "sdf ");
   gsk_gpu_print_newline (string);
 }
 
 static void
-gsk_gpu_upload_glyph_op_draw (GskGpuOp *op,
-                              guchar   *data,
-                              gsize     stride)
+gsk_gpu_upload_glyph_op_rasterize (GskGpuUploadGlyphOp *self,
+                                   guchar              *data,
+                                   gsize                stride)
 {
-  GskGpuUploadGlyphOp *self = (GskGpuUploadGlyphOp *) op;
   cairo_surface_t *surface;
   cairo_t *cr;
 
@@ -561,6 +581,122 @@ gsk_gpu_upload_glyph_op_draw (GskGpuOp *op,
   cairo_surface_destroy (surface);
 }
 
+/*
+ * gsk_gpu_glyph_convert_to_sdf:
+ * @data: ARGB32 pixels of a rasterized glyph
+ * @width: the width of the glyph
+ * @height: the height of the glyph
+ * @stride: the stride of @data
+ *
+ * Replaces the coverage in the alpha channel with the signed
+ * distance to the outline. 0.5 is on the outline, and 0 and 1
+ * are GSK_GPU_GLYPH_SDF_SPREAD pixels outside or inside.
+ *
+ * This only touches @data, so it can run in any thread.
+ */
+void
+gsk_gpu_glyph_convert_to_sdf (guchar *data,
+                              int     width,
+                              int     height,
+                              gsize   stride)
+{
+  const int spread = GSK_GPU_GLYPH_SDF_SPREAD;
+  float *coverage;
+  int x, y, dx, dy;
+
+  coverage = g_new (float, width * height);
+  for (y = 0; y < height; y++)
+    {
+      guint32 *row = (guint32 *) (data + y * stride);
+
+      for (x = 0; x < width; x++)
+        coverage[y * width + x] = (row[x] >> 24) / 255.f;
+    }
+
+  for (y = 0; y < height; y++)
+    {
+      guint32 *row = (guint32 *) (data + y * stride);
+
+      for (x = 0; x < width; x++)
+        {
+          float a = coverage[y * width + x];
+          gboolean inside = a >= 0.5;
+          float dist, value;
+          guint32 v;
+
+          /* Pixels on the edge know how far they are from it */
+          if (a > 0 && a < 1)
+            dist = fabsf (a - 0.5f);
+          else
+            dist = spread;
+
+          for (dy = MAX (-spread, -y); dy <= MIN (spread, height - 1 - y); dy++)
+            {
+              for (dx = MAX (-spread, -x); dx <= MIN (spread, width - 1 - x); dx++)
+                {
+                  float b = coverage[(y + dy) * width + x + dx];
+
+                  if ((b >= 0.5) != inside)
+                    dist = MIN (dist, sqrtf (dx * dx + dy * dy) - 0.5f);
+                }
+            }
+
+          value = 0.5f + (inside ? dist : -dist) / (2 * spread);
+          v = CLAMP (value * 255.f + 0.5f, 0, 255);
+          row[x] = (v << 24) | (v << 16) | (v << 8) | v;
+        }
+    }
+
+  g_free (coverage);
+}
+
+static void
+gsk_gpu_upload_glyph_op_rasterize_pixels (GskGpuUploadGlyphOp *self)
+{
+  gsize stride;
+
+  stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, self->area.width);
+  self->pixels = g_malloc (stride * self->area.height);
+  gsk_gpu_upload_glyph_op_rasterize (self, self->pixels, stride);
+}
+
+static void
+gsk_gpu_upload_glyph_op_convert_pixels (GskGpuUploadGlyphOp *self)
+{
+  gsk_gpu_glyph_convert_to_sdf (self->pixels,
+                                self->area.width,
+                                self->area.height,
+                                cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, self->area.width));
+}
+
+static void
+gsk_gpu_upload_glyph_op_draw (GskGpuOp *op,
+                              guchar   *data,
+                              gsize     stride)
+{
+  GskGpuUploadGlyphOp *self = (GskGpuUploadGlyphOp *) op;
+  gsize pixels_stride;
+  int y;
+
+  if (self->pixels == NULL)
+    {
+      /* Distance fields read back the pixels, so we can't draw
+       * them straight into mapped memory */
+      if (!self->sdf)
+        {
+          gsk_gpu_upload_glyph_op_rasterize (self, data, stride);
+          return;
+        }
+
+      gsk_gpu_upload_glyph_op_rasterize_pixels (self);
+      gsk_gpu_upload_glyph_op_convert_pixels (self);
+    }
+
+  pixels_stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, self->area.width);
+  for (y = 0; y < self->area.height; y++)
+    memcpy (data + y * stride, self->pixels + y * pixels_stride, self->area.width * 4);
+}
+
 #ifdef GDK_RENDERING_VULKAN
 static GskGpuOp *
 gsk_gpu_upload_glyph_op_vk_command (GskGpuOp              *op,
@@ -604,6 +740,144 @@ static const GskGpuOpClass GSK_GPU_UPLOAD_GLYPH_OP_CLASS = {
   gsk_gpu_upload_glyph_op_gl_command,
 };
 
+/* Below this number of distance fields, handing them to
+ * threads is more expensive than just computing them */
+#define SDF_BATCH_MIN_GLYPHS 4
+
+typedef struct _SdfBatch SdfBatch;
+typedef struct _SdfJob SdfJob;
+
+struct _SdfBatch
+{
+  GMutex mutex;
+  GCond cond;
+  guint n_pending;
+};
+
+struct _SdfJob
+{
+  SdfBatch *batch;
+  GskGpuUploadGlyphOp **ops;
+  gsize n_ops;
+};
+
+static void
+gsk_gpu_upload_glyph_ops_worker (gpointer data,
+                                 gpointer unused)
+{
+  SdfJob *job = data;
+  SdfBatch *batch = job->batch;
+  gsize i;
+
+  for (i = 0; i < job->n_ops; i++)
+    gsk_gpu_upload_glyph_op_convert_pixels (job->ops[i]);
+
+  g_mutex_lock (&batch->mutex);
+  batch->n_pending--;
+  if (batch->n_pending == 0)
+    g_cond_signal (&batch->cond);
+  g_mutex_unlock (&batch->mutex);
+}
+
+static GThreadPool *
+gsk_gpu_upload_glyph_ops_get_pool (void)
+{
+  static GThreadPool *pool;
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      pool = g_thread_pool_new (gsk_gpu_upload_glyph_ops_worker,
+                                NULL,
+                                g_get_num_processors (),
+                                FALSE,
+                                NULL);
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return pool;
+}
+
+/*
+ * gsk_gpu_upload_glyph_ops_prepare:
+ * @first_op: the first op of a sorted frame
+ *
+ * Computes the distance fields of all glyph upload ops in the
+ * frame in parallel, so that uploading them only needs to copy
+ * the pixels.
+ *
+ * The glyphs themselves are rasterized in this thread: Pango is
+ * not threadsafe, and cairo serializes rasterization for each
+ * font face, so that wouldn't get faster with more threads.
+ * Computing the distance fields is where the time goes, and
+ * that only needs the pixels.
+ */
+void
+gsk_gpu_upload_glyph_ops_prepare (GskGpuOp *first_op)
+{
+  GPtrArray *ops;
+  SdfBatch batch;
+  SdfJob *jobs;
+  GskGpuOp *op;
+  gsize i, n_jobs, n_per_job;
+  GThreadPool *pool;
+
+  if (g_get_num_processors () < 2)
+    return;
+
+  ops = g_ptr_array_new ();
+
+  for (op = first_op; op; op = op->next)
+    {
+      GskGpuUploadGlyphOp *self;
+
+      if (op->op_class != &GSK_GPU_UPLOAD_GLYPH_OP_CLASS)
+        continue;
+
+      self = (GskGpuUploadGlyphOp *) op;
+      if (!self->sdf || self->pixels != NULL)
+        continue;
+
+      g_ptr_array_add (ops, self);
+    }
+
+  if (ops->len < SDF_BATCH_MIN_GLYPHS)
+    {
+      g_ptr_array_unref (ops);
+      return;
+    }
+
+  for (i = 0; i < ops->len; i++)
+    gsk_gpu_upload_glyph_op_rasterize_pixels (g_ptr_array_index (ops, i));
+
+  pool = gsk_gpu_upload_glyph_ops_get_pool ();
+  n_jobs = MIN (g_get_num_processors (), ops->len);
+  n_per_job = (ops->len + n_jobs - 1) / n_jobs;
+  jobs = g_new (SdfJob, n_jobs);
+
+  g_mutex_init (&batch.mutex);
+  g_cond_init (&batch.cond);
+  batch.n_pending = n_jobs;
+
+  for (i = 0; i < n_jobs; i++)
+    {
+      jobs[i].batch = &batch;
+      jobs[i].ops = (GskGpuUploadGlyphOp **) ops->pdata + i * n_per_job;
+      jobs[i].n_ops = MIN (n_per_job, ops->len - MIN (i * n_per_job, ops->len));
+      g_thread_pool_push (pool, &jobs[i], NULL);
+    }
+
+  g_mutex_lock (&batch.mutex);
+  while (batch.n_pending > 0)
+    g_cond_wait (&batch.cond, &batch.mutex);
+  g_mutex_unlock (&batch.mutex);
+
+  g_mutex_clear (&batch.mutex);
+  g_cond_clear (&batch.cond);
+  g_free (jobs);
+  g_ptr_array_unref (ops);
+}
+
 void
 gsk_gpu_upload_glyph_op (GskGpuFrame                 *frame,
                          GskGpuImage                 *image,
@@ -611,7 +885,8 @@ gsk_gpu_upload_glyph_op (GskGpuFrame                 *frame,
                          const PangoGlyph             glyph,
                          const cairo_rectangle_int_t *area,
                          float                        scale,
-                         const graphene_point_t      *origin)
+                         const graphene_point_t      *origin,
+                         gboolean                     sdf)
 {
   GskGpuUploadGlyphOp *self;
 
@@ -623,4 +898,6 @@ gsk_gpu_upload_glyph_op (GskGpuFrame                 *frame,
   self->glyph = glyph;
   self->scale = scale;
   self->origin = *origin;
+  self->sdf = sdf;
+  self->pixels = NULL;
 }
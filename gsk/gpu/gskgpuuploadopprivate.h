@@ -6,6 +6,10 @@
 
 G_BEGIN_DECLS
 
+/* The distance in pixels that signed distance field glyphs cover
+ * on either side of the outline */
+#define GSK_GPU_GLYPH_SDF_SPREAD 4
+
 typedef void            (* GskGpuCairoFunc)                             (gpointer                        user_data,
                                                                          cairo_t                        *cr);
 
@@ -26,7 +30,15 @@ void                    gsk_gpu_upload_glyph_op                         (GskGpuF
                                                                          PangoGlyph                      glyph,
                                                                          const cairo_rectangle_int_t    *area,
                                                                          float                           scale,
-                                                                         const graphene_point_t         *origin);
+                                                                         const graphene_point_t         *origin,
+                                                                         gboolean                        sdf);
+
+void                    gsk_gpu_upload_glyph_ops_prepare                (GskGpuOp                       *first_op);
+
+void                    gsk_gpu_glyph_convert_to_sdf                    (guchar                         *data,
+                                                                         int                             width,
+                                                                         int                             height,
+                                                                         gsize                           stride);
 
 G_END_DECLS
 
@@ -57,9 +57,9 @@ gsk_ngl_renderer_create_context (GskGpuRenderer       *renderer,
 
   /* Shader compilation takes too long when texture() and get_float() calls
    * use if/else ladders to avoid non-uniform indexing.
-   * And that is always true with GL.
+   * And that is always true with GL. Paths need get_float() for their lines.
    */
-  *supported &= ~GSK_GPU_OPTIMIZE_UBER;
+  *supported &= ~(GSK_GPU_OPTIMIZE_UBER | GSK_GPU_OPTIMIZE_PATHS);
 
   if (!gdk_gl_context_check_version (context, "4.2", "9.9") &&
       !epoxy_has_gl_extension ("GL_EXT_base_instance") &&
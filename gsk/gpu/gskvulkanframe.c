@@ -34,6 +34,16 @@
 #define GDK_ARRAY_NO_MEMSET 1
 #include "gdk/gdkarrayimpl.c"
 
+/* Texture uploads are staged in a buffer that is kept with the frame
+ * and reused once the frame's fence has signaled, so uploads don't
+ * need to allocate memory. It grows up to the max size if a frame
+ * needed more than it had, and shrinks again once that many frames
+ * in a row used less than half of it.
+ */
+#define DEFAULT_UPLOAD_BUFFER_SIZE (4 * 1024 * 1024)
+#define MAX_UPLOAD_BUFFER_SIZE (64 * 1024 * 1024)
+#define UPLOAD_BUFFER_SHRINK_FRAMES 60
+
 struct _GskVulkanSemaphores
 {
   GskSemaphores wait_semaphores;
@@ -54,6 +64,11 @@ struct _GskVulkanFrame
   gsize pool_n_sets;
   gsize pool_n_images;
   gsize pool_n_buffers;
+
+  GskGpuBuffer *upload_buffer;
+  gsize upload_buffer_used;
+  gsize upload_buffer_needed;
+  guint upload_buffer_idle_frames;
 };
 
 struct _GskVulkanFrameClass
@@ -136,6 +151,32 @@ gsk_vulkan_frame_cleanup (GskGpuFrame *frame)
 
   gsk_descriptors_set_size (&self->descriptors, 0);
 
+  /* The GPU is done with the frame, so the upload buffer can be reused,
+   * unless the last frame needed more or it has been mostly unused for
+   * a while. Then the next frame gets a new buffer, sized by
+   * upload_buffer_needed.
+   */
+  if (self->upload_buffer)
+    {
+      gsize buffer_size = gsk_gpu_buffer_get_size (self->upload_buffer);
+
+      if (buffer_size > DEFAULT_UPLOAD_BUFFER_SIZE &&
+          self->upload_buffer_needed <= buffer_size / 2)
+        self->upload_buffer_idle_frames++;
+      else
+        self->upload_buffer_idle_frames = 0;
+
+      if (self->upload_buffer_needed > buffer_size ||
+          self->upload_buffer_idle_frames > UPLOAD_BUFFER_SHRINK_FRAMES)
+        {
+          g_clear_object (&self->upload_buffer);
+          self->upload_buffer_idle_frames = 0;
+        }
+      else
+        self->upload_buffer_needed = 0;
+    }
+  self->upload_buffer_used = 0;
+
   GSK_GPU_FRAME_CLASS (gsk_vulkan_frame_parent_class)->cleanup (frame);
 }
 
@@ -370,6 +411,8 @@ gsk_vulkan_frame_finalize (GObject *object)
     }
   gsk_descriptors_clear (&self->descriptors);
 
+  g_clear_object (&self->upload_buffer);
+
   vkFreeCommandBuffers (vk_device,
                         vk_command_pool,
                         1, &self->vk_command_buffer);
@@ -414,6 +457,55 @@ gsk_vulkan_frame_get_vk_fence (GskVulkanFrame *self)
   return self->vk_fence;
 }
 
+/*
+ * gsk_vulkan_frame_reserve_upload_data:
+ * @self: the frame
+ * @size: the number of bytes needed
+ * @alignment: required alignment of the offset
+ * @out_offset: (out): offset into the buffer to write the data to
+ *
+ * Reserves space for staging data in the frame's upload buffer.
+ *
+ * Returns: (nullable) (transfer none): the upload buffer or %NULL
+ *   if there is not enough space left in it
+ */
+GskGpuBuffer *
+gsk_vulkan_frame_reserve_upload_data (GskVulkanFrame *self,
+                                      gsize           size,
+                                      gsize           alignment,
+                                      gsize          *out_offset)
+{
+  gsize offset;
+
+  offset = (self->upload_buffer_used + alignment - 1) / alignment * alignment;
+
+  if (self->upload_buffer == NULL)
+    {
+      gsize buffer_size = DEFAULT_UPLOAD_BUFFER_SIZE;
+
+      while (buffer_size < self->upload_buffer_needed && buffer_size < MAX_UPLOAD_BUFFER_SIZE)
+        buffer_size *= 2;
+
+      self->upload_buffer = gsk_vulkan_buffer_new_write (GSK_VULKAN_DEVICE (gsk_gpu_frame_get_device (GSK_GPU_FRAME (self))),
+                                                         buffer_size);
+      self->upload_buffer_needed = 0;
+    }
+
+  /* Remember how much we would have liked, so we can grow next time.
+   * Never more than the maximum, or we'd replace the buffer every frame.
+   */
+  self->upload_buffer_needed = MIN (MAX (self->upload_buffer_needed, offset + size),
+                                    MAX_UPLOAD_BUFFER_SIZE);
+
+  if (offset + size > gsk_gpu_buffer_get_size (self->upload_buffer))
+    return NULL;
+
+  self->upload_buffer_used = offset + size;
+  *out_offset = offset;
+
+  return self->upload_buffer;
+}
+
 void
 gsk_vulkan_semaphores_add_wait (GskVulkanSemaphores  *self,
                                 VkSemaphore           semaphore,
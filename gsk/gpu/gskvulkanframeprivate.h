@@ -11,6 +11,10 @@ G_BEGIN_DECLS
 G_DECLARE_FINAL_TYPE (GskVulkanFrame, gsk_vulkan_frame, GSK, VULKAN_FRAME, GskGpuFrame)
 
 VkFence                 gsk_vulkan_frame_get_vk_fence                   (GskVulkanFrame         *self) G_GNUC_PURE;
+GskGpuBuffer *          gsk_vulkan_frame_reserve_upload_data            (GskVulkanFrame         *self,
+                                                                         gsize                   size,
+                                                                         gsize                   alignment,
+                                                                         gsize                  *out_offset);
 
 void                    gsk_vulkan_semaphores_add_wait                  (GskVulkanSemaphores    *self,
                                                                          VkSemaphore             semaphore,
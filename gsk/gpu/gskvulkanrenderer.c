@@ -108,7 +108,7 @@ gsk_vulkan_renderer_create_context (GskGpuRenderer       *renderer,
    */
   if (!gdk_display_has_vulkan_feature (display, GDK_VULKAN_FEATURE_DYNAMIC_INDEXING) ||
       !gdk_display_has_vulkan_feature (display, GDK_VULKAN_FEATURE_NONUNIFORM_INDEXING))
-    *supported &= ~GSK_GPU_OPTIMIZE_UBER;
+    *supported &= ~(GSK_GPU_OPTIMIZE_UBER | GSK_GPU_OPTIMIZE_PATHS);
 
   return GDK_DRAW_CONTEXT (context);
 }
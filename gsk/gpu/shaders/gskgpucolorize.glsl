@@ -1,10 +1,13 @@
 #include "common.glsl"
 
+#define VARIATION_SDF ((GSK_VARIATION & 1u) == 1u)
+
 PASS(0) vec2 _pos;
 PASS_FLAT(1) Rect _rect;
 PASS_FLAT(2) vec4 _color;
 PASS(3) vec2 _tex_coord;
 PASS_FLAT(4) uint _tex_id;
+PASS_FLAT(5) uint _color_glyph;
 
 
 
@@ -14,6 +17,7 @@ IN(0) vec4 in_rect;
 IN(1) vec4 in_color;
 IN(2) vec4 in_tex_rect;
 IN(3) uint in_tex_id;
+IN(4) uint in_color_glyph;
 
 void
 run (out vec2 pos)
@@ -27,6 +31,7 @@ run (out vec2 pos)
   _color = color_premultiply (in_color);
   _tex_coord = rect_get_coord (rect_from_gsk (in_tex_rect), pos);
   _tex_id = in_tex_id;
+  _color_glyph = in_color_glyph;
 }
 
 #endif
@@ -39,8 +44,24 @@ void
 run (out vec4 color,
      out vec2 position)
 {
-  float alpha = gsk_texture (_tex_id, _tex_coord).a * rect_coverage (_rect, _pos);
-  color = _color * alpha;
+  vec4 tex = gsk_texture (_tex_id, _tex_coord);
+  float alpha = tex.a;
+
+  if (VARIATION_SDF)
+    {
+      /* antialias the outline at 0.5 over one pixel */
+      float width = max (fwidth (alpha), 1.0 / 255.0);
+      alpha = clamp ((alpha - 0.5) / width + 0.5, 0.0, 1.0);
+    }
+
+  /* color glyphs are never distance fields and keep their colors,
+   * only the opacity is applied to them */
+  if (_color_glyph != 0u)
+    color = tex * _color.a;
+  else
+    color = _color * alpha;
+
+  color *= rect_coverage (_rect, _pos);
   position = _pos;
 }
 
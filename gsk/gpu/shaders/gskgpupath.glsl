@@ -0,0 +1,101 @@
+#include "common.glsl"
+
+#define VARIATION_EVEN_ODD ((GSK_VARIATION & 1u) == 1u)
+
+PASS(0) vec2 _pos;
+PASS_FLAT(1) vec4 _color;
+PASS(2) vec2 _path_pos;
+PASS_FLAT(3) uint _path_id;
+
+
+
+#ifdef GSK_VERTEX_SHADER
+
+IN(0) vec4 in_rect;
+IN(1) vec4 in_color;
+IN(2) vec2 in_offset;
+IN(3) uint in_path_id;
+
+void
+run (out vec2 pos)
+{
+  Rect r = rect_from_gsk (in_rect);
+  
+  pos = rect_get_position (r);
+
+  _pos = pos;
+  _color = color_premultiply (in_color);
+  _path_pos = pos / GSK_GLOBAL_SCALE - in_offset;
+  _path_id = in_path_id;
+}
+
+#endif
+
+
+
+#ifdef GSK_FRAGMENT_SHADER
+
+/* The integral of clamp (t, 0, 1) */
+float
+coverage_integral (float t)
+{
+  if (t <= 0.0)
+    return 0.0;
+  else if (t <= 1.0)
+    return 0.5 * t * t;
+  else
+    return t - 0.5;
+}
+
+/* The path is stored as the number of lines, followed by
+ * 4 floats for the start and end point of each line.
+ *
+ * Every line adds the area of the pixel that is left of it,
+ * signed by its direction. The sum is the winding number
+ * integrated over the pixel, so lines that don't change the
+ * fill state, like the shared edge of overlapping shapes,
+ * cancel out instead of leaving seams.
+ */
+void
+run (out vec4 color,
+     out vec2 position)
+{
+  uint n_lines = gsk_get_uint (_path_id);
+  vec2 pixel = max (abs (fwidth (_path_pos)), vec2 (1.0e-6));
+  float area = 0.0;
+
+  for (uint i = 0u; i < n_lines; i++)
+    {
+      uint id = _path_id + 1u + 4u * i;
+      /* in pixels, relative to the left edge and vertical center of the pixel */
+      vec2 a = (vec2 (gsk_get_float (id), gsk_get_float (id + 1u)) - _path_pos) / pixel + vec2 (0.5, 0.0);
+      vec2 b = (vec2 (gsk_get_float (id + 2u), gsk_get_float (id + 3u)) - _path_pos) / pixel + vec2 (0.5, 0.0);
+
+      float y0 = max (min (a.y, b.y), -0.5);
+      float y1 = min (max (a.y, b.y), 0.5);
+      if (y1 <= y0)
+        continue;
+
+      float dxdy = (b.x - a.x) / (b.y - a.y);
+      float t0 = a.x + (y0 - a.y) * dxdy;
+      float t1 = a.x + (y1 - a.y) * dxdy;
+      float covered;
+      if (abs (t1 - t0) < 1.0e-4)
+        covered = clamp (0.5 * (t0 + t1), 0.0, 1.0);
+      else
+        covered = (coverage_integral (t1) - coverage_integral (t0)) / (t1 - t0);
+
+      area += (b.y > a.y ? 1.0 : -1.0) * covered * (y1 - y0);
+    }
+
+  float alpha;
+  if (VARIATION_EVEN_ODD)
+    alpha = 1.0 - abs (mod (area, 2.0) - 1.0);
+  else
+    alpha = min (abs (area), 1.0);
+
+  color = _color * alpha;
+  position = _pos;
+}
+
+#endif
@@ -236,7 +236,7 @@ vec4
 glyphs_pattern (inout uint reader,
                 Position   pos)
 {
-  float opacity = 0.0;
+  vec4 result = vec4 (0.0);
   vec4 color = color_premultiply (read_vec4 (reader));
   uint num_glyphs = read_uint (reader);
   uint i;
@@ -246,15 +246,22 @@ glyphs_pattern (inout uint reader,
   for (i = 0u; i < num_glyphs; i++)
     {
       uint tex_id = read_uint (reader);
+      uint color_glyph = read_uint (reader);
       Rect glyph_bounds = read_rect (reader);
       vec4 tex_rect = read_vec4 (reader);
 
       float coverage = rect_coverage (glyph_bounds, p, dFdp);
       if (coverage > 0.0)
-        opacity += coverage * gsk_texture (tex_id, (p - tex_rect.xy) / tex_rect.zw).a;
+        {
+          vec4 tex = gsk_texture (tex_id, (p - tex_rect.xy) / tex_rect.zw);
+          if (color_glyph != 0u)
+            result += coverage * tex;
+          else
+            result += coverage * tex.a * color;
+        }
     }
 
-  return color * opacity;
+  return result;
 }
 
 vec4
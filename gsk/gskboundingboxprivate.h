@@ -70,6 +70,20 @@ gsk_bounding_box_contains_point (const GskBoundingBox   *self,
          self->min.y <= p->y && p->y <= self->max.y;
 }
 
+/* Returns the distance from @p to the closest point of the box,
+ * which is 0 if @p is inside */
+static inline float
+gsk_bounding_box_get_distance (const GskBoundingBox   *self,
+                               const graphene_point_t *p)
+{
+  float dx, dy;
+
+  dx = MAX (MAX (self->min.x - p->x, p->x - self->max.x), 0);
+  dy = MAX (MAX (self->min.y - p->y, p->y - self->max.y), 0);
+
+  return sqrtf (dx * dx + dy * dy);
+}
+
 static inline gboolean
 gsk_bounding_box_contains_point_with_epsilon (const GskBoundingBox   *self,
                                               const graphene_point_t *p,
@@ -97,6 +97,12 @@ struct _GskContourClass
   float                 (* get_distance)        (const GskContour       *contour,
                                                  const GskPathPoint     *point,
                                                  gpointer                measure_data);
+  gboolean              (* get_closest_point_with_measure) (const GskContour       *contour,
+                                                            gpointer                measure_data,
+                                                            const graphene_point_t *point,
+                                                            float                   threshold,
+                                                            GskPathPoint           *result,
+                                                            float                  *out_dist);
 };
 
 /* {{{ Utilities */
@@ -464,6 +470,17 @@ gsk_contour_get_size_default (const GskContour *contour)
   return contour->klass->struct_size;
 }
 
+static gboolean
+gsk_contour_get_closest_point_with_measure_default (const GskContour       *contour,
+                                                    gpointer                measure_data,
+                                                    const graphene_point_t *point,
+                                                    float                   threshold,
+                                                    GskPathPoint           *result,
+                                                    float                  *out_dist)
+{
+  return contour->klass->get_closest_point (contour, point, threshold, result, out_dist);
+}
+
 static gboolean
 foreach_print (GskPathOperation        op,
                const graphene_point_t *pts,
@@ -965,11 +982,28 @@ typedef struct
   float length;
 } CurvePoint;
 
+/* A node in the bounding volume hierarchy over the curves
+ * of a contour. The left child of an inner node directly
+ * follows it, so we only need to store the right child.
+ */
+typedef struct
+{
+  GskBoundingBox bounds;
+  guint first; /* first curve for leaves, right child for inner nodes */
+  guint n_curves; /* 0 for inner nodes */
+} BvhNode;
+
 typedef struct
 {
   GArray *curves;
   GArray *points;
   float tolerance;
+
+  /* created on demand by closest point queries,
+   * guarded by g_once_init_enter() since measures are shared
+   */
+  GArray *bvh;
+  guint *bvh_curves;
 } GskStandardContourMeasure;
 
 static void
@@ -1087,6 +1121,8 @@ gsk_standard_contour_init_measure (const GskContour *contour,
   measure->curves = g_array_new (FALSE, FALSE, sizeof (CurveMeasure));
   measure->points = g_array_new (FALSE, FALSE, sizeof (CurvePoint));
   measure->tolerance = tolerance;
+  measure->bvh = NULL;
+  measure->bvh_curves = NULL;
 
   /* Add a placeholder for the move, so indexes match up */
   g_array_append_val (measure->curves, ((CurveMeasure) { 0, -1, -1, 0, 0 } ));
@@ -1119,6 +1155,9 @@ gsk_standard_contour_free_measure (const GskContour *contour,
 
   g_array_free (measure->curves, TRUE);
   g_array_free (measure->points, TRUE);
+  if (measure->bvh)
+    g_array_free (measure->bvh, TRUE);
+  g_free (measure->bvh_curves);
   g_free (measure);
 }
 
@@ -1257,6 +1296,204 @@ gsk_standard_contour_get_distance (const GskContour   *contour,
   return p0->length * (1 - fraction) + p1->length * fraction;
 }
 
+#define BVH_LEAF_SIZE 4
+
+typedef struct
+{
+  guint idx;
+  GskBoundingBox bounds;
+  graphene_point_t center;
+} BvhCurve;
+
+static int
+bvh_curve_compare_x (const void *p1,
+                     const void *p2)
+{
+  const BvhCurve *c1 = p1;
+  const BvhCurve *c2 = p2;
+
+  return c1->center.x < c2->center.x ? -1 : (c1->center.x > c2->center.x ? 1 : 0);
+}
+
+static int
+bvh_curve_compare_y (const void *p1,
+                     const void *p2)
+{
+  const BvhCurve *c1 = p1;
+  const BvhCurve *c2 = p2;
+
+  return c1->center.y < c2->center.y ? -1 : (c1->center.y > c2->center.y ? 1 : 0);
+}
+
+static void
+bvh_build (GArray   *nodes,
+           BvhCurve *curves,
+           guint     first,
+           guint     n_curves)
+{
+  BvhNode node;
+  GskBoundingBox centers;
+  guint i, idx, half;
+
+  node.bounds = curves[first].bounds;
+  gsk_bounding_box_init (&centers, &curves[first].center, &curves[first].center);
+  for (i = first + 1; i < first + n_curves; i++)
+    {
+      gsk_bounding_box_union (&node.bounds, &curves[i].bounds, &node.bounds);
+      gsk_bounding_box_expand (&centers, &curves[i].center);
+    }
+
+  idx = nodes->len;
+
+  if (n_curves <= BVH_LEAF_SIZE)
+    {
+      node.first = first;
+      node.n_curves = n_curves;
+      g_array_append_val (nodes, node);
+      return;
+    }
+
+  node.first = 0;
+  node.n_curves = 0;
+  g_array_append_val (nodes, node);
+
+  /* Split at the median along the longer axis */
+  if (centers.max.x - centers.min.x > centers.max.y - centers.min.y)
+    qsort (&curves[first], n_curves, sizeof (BvhCurve), bvh_curve_compare_x);
+  else
+    qsort (&curves[first], n_curves, sizeof (BvhCurve), bvh_curve_compare_y);
+
+  half = n_curves / 2;
+  bvh_build (nodes, curves, first, half);
+  g_array_index (nodes, BvhNode, idx).first = nodes->len;
+  bvh_build (nodes, curves, first + half, n_curves - half);
+}
+
+static void
+ensure_bvh (const GskStandardContour  *self,
+            GskStandardContourMeasure *measure)
+{
+  BvhCurve *curves;
+  GArray *bvh;
+  guint i, n_curves;
+
+  if (!g_once_init_enter (&measure->bvh))
+    return;
+
+  g_assert (self->n_ops > 1);
+
+  n_curves = self->n_ops - 1;
+  curves = g_new (BvhCurve, n_curves);
+
+  for (i = 0; i < n_curves; i++)
+    {
+      GskCurve curve;
+
+      gsk_curve_init (&curve, self->ops[i + 1]);
+      curves[i].idx = i + 1;
+      gsk_curve_get_bounds (&curve, &curves[i].bounds);
+      curves[i].center = GRAPHENE_POINT_INIT ((curves[i].bounds.min.x + curves[i].bounds.max.x) / 2,
+                                              (curves[i].bounds.min.y + curves[i].bounds.max.y) / 2);
+    }
+
+  bvh = g_array_sized_new (FALSE, FALSE, sizeof (BvhNode), 2 * (n_curves / BVH_LEAF_SIZE) + 1);
+  bvh_build (bvh, curves, 0, n_curves);
+
+  measure->bvh_curves = g_new (guint, n_curves);
+  for (i = 0; i < n_curves; i++)
+    measure->bvh_curves[i] = curves[i].idx;
+
+  g_free (curves);
+
+  /* Publish the array last, so other threads see complete data */
+  g_once_init_leave (&measure->bvh, bvh);
+}
+
+static gboolean
+gsk_standard_contour_get_closest_point_with_measure (const GskContour       *contour,
+                                                     gpointer                measure_data,
+                                                     const graphene_point_t *point,
+                                                     float                   threshold,
+                                                     GskPathPoint           *result,
+                                                     float                  *out_dist)
+{
+  const GskStandardContour *self = (const GskStandardContour *) contour;
+  GskStandardContourMeasure *measure = measure_data;
+  guint stack[64];
+  guint n_stack;
+  unsigned int best_idx = G_MAXUINT;
+  float best_t = 0;
+
+  if (self->n_ops == 1)
+    return gsk_standard_contour_get_closest_point (contour, point, threshold, result, out_dist);
+
+  ensure_bvh (self, measure);
+
+  stack[0] = 0;
+  n_stack = 1;
+
+  while (n_stack > 0)
+    {
+      const BvhNode *node;
+      guint idx;
+
+      idx = stack[--n_stack];
+      node = &g_array_index (measure->bvh, BvhNode, idx);
+
+      if (gsk_bounding_box_get_distance (&node->bounds, point) > threshold)
+        continue;
+
+      if (node->n_curves > 0)
+        {
+          for (guint i = node->first; i < node->first + node->n_curves; i++)
+            {
+              guint curve_idx = measure->bvh_curves[i];
+              GskCurve c;
+              float distance, t;
+
+              gsk_curve_init (&c, self->ops[curve_idx]);
+              if (gsk_curve_get_closest_point (&c, point, threshold, &distance, &t) &&
+                  (distance < threshold ||
+                   (best_idx != G_MAXUINT && distance == threshold && curve_idx < best_idx)))
+                {
+                  best_idx = curve_idx;
+                  best_t = t;
+                  threshold = distance;
+                }
+            }
+        }
+      else
+        {
+          const BvhNode *left = node + 1;
+          const BvhNode *right = &g_array_index (measure->bvh, BvhNode, node->first);
+
+          g_assert (n_stack + 2 <= G_N_ELEMENTS (stack));
+
+          /* Visit the closer child first, so we can prune more */
+          if (gsk_bounding_box_get_distance (&left->bounds, point) < gsk_bounding_box_get_distance (&right->bounds, point))
+            {
+              stack[n_stack++] = node->first;
+              stack[n_stack++] = idx + 1;
+            }
+          else
+            {
+              stack[n_stack++] = idx + 1;
+              stack[n_stack++] = node->first;
+            }
+        }
+    }
+
+  if (best_idx != G_MAXUINT)
+    {
+      *out_dist = threshold;
+      result->idx = best_idx;
+      result->t = best_t;
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
 static const GskContourClass GSK_STANDARD_CONTOUR_CLASS =
 {
   sizeof (GskStandardContour),
@@ -1280,6 +1517,7 @@ static const GskContourClass GSK_STANDARD_CONTOUR_CLASS =
   gsk_standard_contour_free_measure,
   gsk_standard_contour_get_point,
   gsk_standard_contour_get_distance,
+  gsk_standard_contour_get_closest_point_with_measure,
 };
 
 /* You must ensure the contour has enough size allocated,
@@ -1730,6 +1968,7 @@ static const GskContourClass GSK_CIRCLE_CONTOUR_CLASS =
   gsk_circle_contour_free_measure,
   gsk_circle_contour_get_point,
   gsk_circle_contour_get_distance,
+  gsk_contour_get_closest_point_with_measure_default,
 };
 
 GskContour *
@@ -2063,6 +2302,7 @@ static const GskContourClass GSK_RECT_CONTOUR_CLASS =
   gsk_rect_contour_free_measure,
   gsk_rect_contour_get_point,
   gsk_rect_contour_get_distance,
+  gsk_contour_get_closest_point_with_measure_default,
 };
 
 GskContour *
@@ -2397,6 +2637,7 @@ static const GskContourClass GSK_ROUNDED_RECT_CONTOUR_CLASS =
   gsk_rounded_rect_contour_free_measure,
   gsk_rounded_rect_contour_get_point,
   gsk_rounded_rect_contour_get_distance,
+  gsk_contour_get_closest_point_with_measure_default,
 };
 
 static gsize
@@ -2549,6 +2790,17 @@ gsk_contour_get_closest_point (const GskContour       *self,
   return self->klass->get_closest_point (self, point, threshold, result, out_dist);
 }
 
+gboolean
+gsk_contour_get_closest_point_with_measure (const GskContour       *self,
+                                            gpointer                measure_data,
+                                            const graphene_point_t *point,
+                                            float                   threshold,
+                                            GskPathPoint           *result,
+                                            float                  *out_dist)
+{
+  return self->klass->get_closest_point_with_measure (self, measure_data, point, threshold, result, out_dist);
+}
+
 /* Not related to how many curves foreach produces.
  *
  * GskPath assumes that the start- and endpoints
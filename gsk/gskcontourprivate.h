@@ -94,5 +94,12 @@ void                    gsk_contour_get_point                   (const GskContou
 float                   gsk_contour_get_distance                (const GskContour       *self,
                                                                  const GskPathPoint     *point,
                                                                  gpointer                measure_data);
+gboolean                gsk_contour_get_closest_point_with_measure
+                                                                (const GskContour       *self,
+                                                                 gpointer                measure_data,
+                                                                 const graphene_point_t *point,
+                                                                 float                   threshold,
+                                                                 GskPathPoint           *result,
+                                                                 float                  *out_dist);
 
 G_END_DECLS
@@ -593,8 +593,15 @@ gsk_path_get_closest_point (GskPath                *self,
 
   for (int i = 0; i < self->n_contours; i++)
     {
+      GskBoundingBox bounds;
       float dist;
 
+      /* Skip contours that can't be close enough. The bounds
+       * are valid even if the contour is flat. */
+      gsk_contour_get_bounds (self->contours[i], &bounds);
+      if (gsk_bounding_box_get_distance (&bounds, point) > threshold)
+        continue;
+
       if (gsk_contour_get_closest_point (self->contours[i], point, threshold, result, &dist))
         {
           found = TRUE;
@@ -144,6 +144,10 @@ gboolean                gsk_path_foreach                        (GskPath
                                                                  GskPathForeachFunc      func,
                                                                  gpointer                user_data);
 
+GDK_AVAILABLE_IN_4_14
+GskPath *               gsk_path_stroke                         (GskPath                *self,
+                                                                 const GskStroke        *stroke);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(GskPath, gsk_path_unref)
 
 G_END_DECLS
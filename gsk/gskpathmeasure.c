@@ -47,7 +47,9 @@ typedef struct _GskContourMeasure GskContourMeasure;
 
 struct _GskContourMeasure
 {
+  float start;
   float length;
+  GskBoundingBox bounds;
   gpointer contour_data;
 };
 
@@ -117,9 +119,14 @@ gsk_path_measure_new_with_tolerance (GskPath *path,
 
   for (i = 0; i < n_contours; i++)
     {
-      self->measures[i].contour_data = gsk_contour_init_measure (gsk_path_get_contour (path, i),
+      const GskContour *contour = gsk_path_get_contour (path, i);
+
+      self->measures[i].contour_data = gsk_contour_init_measure (contour,
                                                                  self->tolerance,
                                                                  &self->measures[i].length);
+      /* This returns FALSE for flat contours, but the bounds are still valid */
+      gsk_contour_get_bounds (contour, &self->measures[i].bounds);
+      self->measures[i].start = self->length;
       self->length += self->measures[i].length;
     }
 
@@ -259,7 +266,7 @@ gsk_path_measure_get_point (GskPathMeasure *self,
                             float           distance,
                             GskPathPoint   *result)
 {
-  gsize i;
+  gsize i, lo, hi;
   const GskContour *contour;
 
   g_return_val_if_fail (self != NULL, FALSE);
@@ -270,17 +277,23 @@ gsk_path_measure_get_point (GskPathMeasure *self,
 
   distance = gsk_path_measure_clamp_distance (self, distance);
 
-  for (i = 0; i < self->n_contours - 1; i++)
+  /* Find the first contour that ends after distance */
+  lo = 0;
+  hi = self->n_contours - 1;
+  while (lo < hi)
     {
-      if (distance < self->measures[i].length)
-        break;
+      gsize mid = (lo + hi) / 2;
 
-      distance -= self->measures[i].length;
+      if (distance < self->measures[mid].start + self->measures[mid].length)
+        hi = mid;
+      else
+        lo = mid + 1;
     }
+  i = lo;
 
   g_assert (0 <= i && i < self->n_contours);
 
-  distance = CLAMP (distance, 0, self->measures[i].length);
+  distance = CLAMP (distance - self->measures[i].start, 0, self->measures[i].length);
 
   contour = gsk_path_get_contour (self->path, i);
 
@@ -293,6 +306,74 @@ gsk_path_measure_get_point (GskPathMeasure *self,
   return TRUE;
 }
 
+/**
+ * gsk_path_measure_get_closest_point:
+ * @self: a `GskPathMeasure`
+ * @point: the point
+ * @threshold: maximum allowed distance
+ * @result: (out caller-allocates): return location for the closest point
+ * @distance: (out) (optional): return location for the distance
+ *
+ * Computes the closest point on the path to the given point
+ * and sets the @result to it.
+ *
+ * This gives the same result as [method@Gsk.Path.get_closest_point],
+ * but uses the measure to skip contours and curves that are too far
+ * away. The first query builds a spatial index of the curves, so
+ * this is useful when the same path is queried many times, like
+ * for hit testing.
+ *
+ * If there is no point closer than the given threshold,
+ * `FALSE` is returned.
+ *
+ * Returns: `TRUE` if @point was set to the closest point
+ *   on the path, `FALSE` if no point is closer than @threshold
+ *
+ * Since: 4.14
+ */
+gboolean
+gsk_path_measure_get_closest_point (GskPathMeasure         *self,
+                                    const graphene_point_t *point,
+                                    float                   threshold,
+                                    GskPathPoint           *result,
+                                    float                  *distance)
+{
+  gboolean found;
+
+  g_return_val_if_fail (self != NULL, FALSE);
+  g_return_val_if_fail (point != NULL, FALSE);
+  g_return_val_if_fail (threshold >= 0, FALSE);
+  g_return_val_if_fail (result != NULL, FALSE);
+
+  found = FALSE;
+
+  for (gsize i = 0; i < self->n_contours; i++)
+    {
+      float dist;
+
+      if (gsk_bounding_box_get_distance (&self->measures[i].bounds, point) > threshold)
+        continue;
+
+      if (gsk_contour_get_closest_point_with_measure (gsk_path_get_contour (self->path, i),
+                                                      self->measures[i].contour_data,
+                                                      point,
+                                                      threshold,
+                                                      result,
+                                                      &dist))
+        {
+          found = TRUE;
+          g_assert (0 <= result->t && result->t <= 1);
+          result->contour = i;
+          threshold = dist;
+
+          if (distance)
+            *distance = dist;
+        }
+    }
+
+  return found;
+}
+
 /**
  * gsk_path_point_get_distance:
  * @point: a `GskPathPoint on the path
@@ -309,20 +390,14 @@ float
 gsk_path_point_get_distance (const GskPathPoint *point,
                              GskPathMeasure     *measure)
 {
-  float contour_offset = 0;
+  const GskContourMeasure *contour_measure;
 
   g_return_val_if_fail (measure != NULL, 0);
   g_return_val_if_fail (gsk_path_point_valid (point, measure->path), 0);
 
-  for (gsize i = 0; i < measure->n_contours; i++)
-    {
-      if (i == point->contour)
-        return contour_offset + gsk_contour_get_distance (gsk_path_get_contour (measure->path, i),
-                                                          point,
-                                                          measure->measures[i].contour_data);
-
-      contour_offset += measure->measures[i].length;
-    }
+  contour_measure = &measure->measures[point->contour];
 
-  g_return_val_if_reached (0);
+  return contour_measure->start + gsk_contour_get_distance (gsk_path_get_contour (measure->path, point->contour),
+                                                            point,
+                                                            contour_measure->contour_data);
 }
@@ -57,6 +57,13 @@ gboolean                gsk_path_measure_get_point              (GskPathMeasure
                                                                  float                   distance,
                                                                  GskPathPoint           *result);
 
+GDK_AVAILABLE_IN_4_14
+gboolean                gsk_path_measure_get_closest_point      (GskPathMeasure         *self,
+                                                                 const graphene_point_t *point,
+                                                                 float                   threshold,
+                                                                 GskPathPoint           *result,
+                                                                 float                  *distance);
+
 G_DEFINE_AUTOPTR_CLEANUP_FUNC(GskPathMeasure, gsk_path_measure_unref)
 
 G_END_DECLS
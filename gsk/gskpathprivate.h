@@ -52,6 +52,9 @@ gboolean                gsk_path_foreach_with_tolerance         (GskPath
                                                                  GskPathForeachFunc      func,
                                                                  gpointer                user_data);
 
+GskPath *               gsk_path_stroke_with_tolerance          (GskPath                *self,
+                                                                 const GskStroke        *stroke,
+                                                                 double                  tolerance);
 
 void                    gsk_path_builder_add_contour            (GskPathBuilder         *builder,
                                                                  GskContour             *contour);
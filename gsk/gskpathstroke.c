@@ -0,0 +1,662 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gskpathprivate.h"
+
+#include "gskpathbuilder.h"
+#include "gskstrokeprivate.h"
+
+#include <math.h>
+
+/* The stroker flattens the path into polylines and traces the
+ * outline of each of them: the offset line on one side, the cap at
+ * the end, the offset line on the other side back to the start and
+ * the start cap. Closed polylines get one loop for each side, in
+ * opposite directions. Round joins and caps are emitted as conics.
+ *
+ * At the inside of a corner, the outline goes through the corner
+ * point itself. That makes the outline overlap itself there, but
+ * it never leaves the stroked area, so filling it with
+ * GSK_FILL_RULE_WINDING covers exactly what the stroke covers.
+ */
+
+typedef struct _Stroker Stroker;
+
+struct _Stroker
+{
+  GskPathBuilder *builder;
+  const GskStroke *stroke;
+  float half_width;
+
+  /* the contour being collected */
+  GArray *points;
+  gboolean has_segment;
+  graphene_vec2_t last_direction;
+
+  /* for dashing */
+  GArray *dash_points;
+  GArray *first_dash;
+};
+
+static inline graphene_point_t
+point_add (const graphene_point_t *p,
+           float                   x,
+           float                   y)
+{
+  return GRAPHENE_POINT_INIT (p->x + x, p->y + y);
+}
+
+static void
+get_direction (const graphene_point_t *from,
+               const graphene_point_t *to,
+               graphene_vec2_t        *direction)
+{
+  graphene_vec2_init (direction, to->x - from->x, to->y - from->y);
+  graphene_vec2_normalize (direction, direction);
+}
+
+/* The offset to the left of the direction of travel */
+static inline graphene_vec2_t
+stroker_get_offset (Stroker               *self,
+                    const graphene_vec2_t *d)
+{
+  graphene_vec2_t n;
+
+  graphene_vec2_init (&n,
+                      - graphene_vec2_get_y (d) * self->half_width,
+                      graphene_vec2_get_x (d) * self->half_width);
+
+  return n;
+}
+
+static inline void
+stroker_line_to (Stroker                *self,
+                 const graphene_point_t *p,
+                 const graphene_vec2_t  *offset)
+{
+  gsk_path_builder_line_to (self->builder,
+                            p->x + graphene_vec2_get_x (offset),
+                            p->y + graphene_vec2_get_y (offset));
+}
+
+/* Adds an arc of at most 90 degrees around @p, from the current
+ * point at @p + @from to @p + @to.
+ */
+static void
+stroker_arc_to (Stroker                *self,
+                const graphene_point_t *p,
+                const graphene_vec2_t  *from,
+                const graphene_vec2_t  *to)
+{
+  graphene_vec2_t mid;
+  float cos_half, len;
+
+  /* cos (angle / 2) = sqrt ((1 + cos (angle)) / 2) */
+  cos_half = sqrtf (MAX ((1 + graphene_vec2_dot (from, to) / (self->half_width * self->half_width)) / 2, 0));
+  graphene_vec2_add (from, to, &mid);
+  len = graphene_vec2_length (&mid);
+
+  if (cos_half < 1e-3 || len < 1e-6)
+    {
+      stroker_line_to (self, p, to);
+      return;
+    }
+
+  graphene_vec2_scale (&mid, self->half_width / (len * cos_half), &mid);
+
+  gsk_path_builder_conic_to (self->builder,
+                             p->x + graphene_vec2_get_x (&mid),
+                             p->y + graphene_vec2_get_y (&mid),
+                             p->x + graphene_vec2_get_x (to),
+                             p->y + graphene_vec2_get_y (to),
+                             cos_half);
+}
+
+/* Adds a half circle around @p, from the current point at
+ * @p + @from to @p - @from, bulging in direction @d.
+ */
+static void
+stroker_half_circle_to (Stroker                *self,
+                        const graphene_point_t *p,
+                        const graphene_vec2_t  *from,
+                        const graphene_vec2_t  *d)
+{
+  graphene_vec2_t tip, to;
+
+  graphene_vec2_scale (d, self->half_width, &tip);
+  graphene_vec2_negate (from, &to);
+
+  stroker_arc_to (self, p, from, &tip);
+  stroker_arc_to (self, p, &tip, &to);
+}
+
+/* Adds the cap at @p, from the current point at @p + @from
+ * to @p - @from. @d is the direction the cap points to.
+ */
+static void
+stroker_add_cap (Stroker                *self,
+                 const graphene_point_t *p,
+                 const graphene_vec2_t  *from,
+                 const graphene_vec2_t  *d)
+{
+  graphene_vec2_t to, v;
+
+  graphene_vec2_negate (from, &to);
+
+  switch (self->stroke->line_cap)
+    {
+    case GSK_LINE_CAP_BUTT:
+      stroker_line_to (self, p, &to);
+      break;
+
+    case GSK_LINE_CAP_ROUND:
+      stroker_half_circle_to (self, p, from, d);
+      break;
+
+    case GSK_LINE_CAP_SQUARE:
+      graphene_vec2_scale (d, self->half_width, &v);
+      graphene_vec2_add (&v, from, &v);
+      stroker_line_to (self, p, &v);
+      graphene_vec2_scale (d, self->half_width, &v);
+      graphene_vec2_add (&v, &to, &v);
+      stroker_line_to (self, p, &v);
+      stroker_line_to (self, p, &to);
+      break;
+
+    default:
+      g_assert_not_reached ();
+      break;
+    }
+}
+
+/* Adds the join at @p on the left side of the direction of travel,
+ * from the current point at the offset of @d0 to the offset of @d1.
+ */
+static void
+stroker_add_join (Stroker                *self,
+                  const graphene_point_t *p,
+                  const graphene_vec2_t  *d0,
+                  const graphene_vec2_t  *d1)
+{
+  graphene_vec2_t n0, n1, m;
+  float cross, dot, cos_half, len;
+
+  cross = graphene_vec2_get_x (d0) * graphene_vec2_get_y (d1) - graphene_vec2_get_y (d0) * graphene_vec2_get_x (d1);
+  dot = graphene_vec2_dot (d0, d1);
+  n0 = stroker_get_offset (self, d0);
+  n1 = stroker_get_offset (self, d1);
+
+  /* no corner */
+  if (fabsf (cross) < 1e-6 && dot > 0)
+    {
+      stroker_line_to (self, p, &n1);
+      return;
+    }
+
+  /* The inside of the corner, go through the corner point */
+  if (cross > 1e-6)
+    {
+      gsk_path_builder_line_to (self->builder, p->x, p->y);
+      stroker_line_to (self, p, &n1);
+      return;
+    }
+
+  switch (self->stroke->line_join)
+    {
+    case GSK_LINE_JOIN_ROUND:
+      if (dot >= 0)
+        stroker_arc_to (self, p, &n0, &n1);
+      else
+        {
+          /* split it so every arc is at most 90 degrees */
+          graphene_vec2_add (&n0, &n1, &m);
+          len = graphene_vec2_length (&m);
+          if (len > 1e-6)
+            graphene_vec2_scale (&m, self->half_width / len, &m);
+          else
+            graphene_vec2_scale (d0, self->half_width, &m);
+          stroker_arc_to (self, p, &n0, &m);
+          stroker_arc_to (self, p, &m, &n1);
+        }
+      return;
+
+    case GSK_LINE_JOIN_MITER:
+      /* the ratio of the miter length to the line width is 1 / cos (angle / 2) */
+      cos_half = sqrtf (MAX ((1 + dot) / 2, 0));
+      graphene_vec2_add (&n0, &n1, &m);
+      len = graphene_vec2_length (&m);
+      if (cos_half > 0 && 1 / cos_half <= self->stroke->miter_limit && len > 0)
+        {
+          graphene_vec2_scale (&m, self->half_width / (cos_half * len), &m);
+          stroker_line_to (self, p, &m);
+        }
+      G_GNUC_FALLTHROUGH;
+
+    case GSK_LINE_JOIN_BEVEL:
+    default:
+      stroker_line_to (self, p, &n1);
+      return;
+    }
+}
+
+/*
+ * @direction: the direction to use for caps if the polyline
+ *   is a single point
+ */
+static void
+stroker_add_polyline (Stroker                *self,
+                      const graphene_point_t *pts,
+                      gsize                   n_pts,
+                      gboolean                closed,
+                      const graphene_vec2_t  *direction)
+{
+  graphene_vec2_t *d, n, reverse;
+  gsize i, n_segments;
+
+  if (n_pts == 0)
+    return;
+
+  if (n_pts == 1)
+    {
+      if (closed || self->stroke->line_cap == GSK_LINE_CAP_BUTT)
+        return;
+
+      n = stroker_get_offset (self, direction);
+      graphene_vec2_negate (direction, &reverse);
+      gsk_path_builder_move_to (self->builder,
+                                pts[0].x + graphene_vec2_get_x (&n),
+                                pts[0].y + graphene_vec2_get_y (&n));
+      stroker_add_cap (self, &pts[0], &n, direction);
+      graphene_vec2_negate (&n, &n);
+      stroker_add_cap (self, &pts[0], &n, &reverse);
+      gsk_path_builder_close (self->builder);
+      return;
+    }
+
+  n_segments = closed ? n_pts : n_pts - 1;
+  /* the directions of the segments, and reversed */
+  d = g_new (graphene_vec2_t, 2 * n_segments);
+  for (i = 0; i < n_segments; i++)
+    {
+      get_direction (&pts[i], &pts[(i + 1) % n_pts], &d[i]);
+      graphene_vec2_negate (&d[i], &d[n_segments + i]);
+    }
+
+  if (closed)
+    {
+      /* One side forward... */
+      n = stroker_get_offset (self, &d[0]);
+      gsk_path_builder_move_to (self->builder,
+                                pts[0].x + graphene_vec2_get_x (&n),
+                                pts[0].y + graphene_vec2_get_y (&n));
+      for (i = 0; i < n_segments; i++)
+        {
+          n = stroker_get_offset (self, &d[i]);
+          stroker_line_to (self, &pts[(i + 1) % n_pts], &n);
+          stroker_add_join (self, &pts[(i + 1) % n_pts], &d[i], &d[(i + 1) % n_segments]);
+        }
+      gsk_path_builder_close (self->builder);
+
+      /* ...and the other side backward */
+      n = stroker_get_offset (self, &d[n_segments + n_segments - 1]);
+      gsk_path_builder_move_to (self->builder,
+                                pts[0].x + graphene_vec2_get_x (&n),
+                                pts[0].y + graphene_vec2_get_y (&n));
+      for (i = n_segments; i-- > 0; )
+        {
+          n = stroker_get_offset (self, &d[n_segments + i]);
+          stroker_line_to (self, &pts[i], &n);
+          stroker_add_join (self, &pts[i], &d[n_segments + i], &d[n_segments + (i + n_segments - 1) % n_segments]);
+        }
+      gsk_path_builder_close (self->builder);
+
+      g_free (d);
+      return;
+    }
+
+  /* Start on the right, with the start cap */
+  n = stroker_get_offset (self, &d[n_segments]);
+  gsk_path_builder_move_to (self->builder,
+                            pts[0].x + graphene_vec2_get_x (&n),
+                            pts[0].y + graphene_vec2_get_y (&n));
+  stroker_add_cap (self, &pts[0], &n, &d[n_segments]);
+
+  /* forward on the left */
+  for (i = 0; i < n_segments; i++)
+    {
+      n = stroker_get_offset (self, &d[i]);
+      stroker_line_to (self, &pts[i + 1], &n);
+      if (i + 1 < n_segments)
+        stroker_add_join (self, &pts[i + 1], &d[i], &d[i + 1]);
+    }
+
+  stroker_add_cap (self, &pts[n_pts - 1], &n, &d[n_segments - 1]);
+
+  /* and back on the right */
+  for (i = n_segments; i-- > 0; )
+    {
+      n = stroker_get_offset (self, &d[n_segments + i]);
+      stroker_line_to (self, &pts[i], &n);
+      if (i > 0)
+        stroker_add_join (self, &pts[i], &d[n_segments + i], &d[n_segments + i - 1]);
+    }
+
+  gsk_path_builder_close (self->builder);
+
+  g_free (d);
+}
+
+static void
+dash_points_add (Stroker                *self,
+                 const graphene_point_t *p)
+{
+  GArray *points = self->dash_points;
+
+  if (points->len > 0 &&
+      graphene_point_equal (&g_array_index (points, graphene_point_t, points->len - 1), p))
+    return;
+
+  g_array_append_vals (points, p, 1);
+}
+
+static void
+dash_points_emit (Stroker               *self,
+                  const graphene_vec2_t *direction)
+{
+  stroker_add_polyline (self,
+                        (graphene_point_t *) self->dash_points->data,
+                        self->dash_points->len,
+                        FALSE,
+                        direction);
+  g_array_set_size (self->dash_points, 0);
+}
+
+static void
+stroker_add_dashed (Stroker                *self,
+                    const graphene_point_t *pts,
+                    gsize                   n_pts,
+                    gboolean                closed)
+{
+  const GskStroke *stroke = self->stroke;
+  float period, offset, remaining;
+  gboolean on, keep_first;
+  gsize dash, i, n_segments;
+  graphene_vec2_t d, first_direction;
+
+  /* An odd number of dashes swaps on and off in every other repetition */
+  period = stroke->n_dash % 2 ? 2 * stroke->dash_length : stroke->dash_length;
+  offset = fmodf (stroke->dash_offset, period);
+  if (offset < 0)
+    offset += period;
+
+  dash = 0;
+  on = TRUE;
+  while (offset >= stroke->dash[dash])
+    {
+      offset -= stroke->dash[dash];
+      dash = (dash + 1) % stroke->n_dash;
+      on = !on;
+    }
+  remaining = stroke->dash[dash] - offset;
+
+  g_array_set_size (self->dash_points, 0);
+  g_array_set_size (self->first_dash, 0);
+  if (on)
+    dash_points_add (self, &pts[0]);
+
+  /* On closed contours, the last dash may continue in the first one,
+   * so keep that around until the end.
+   */
+  keep_first = closed && on;
+
+  n_segments = closed ? n_pts : n_pts - 1;
+  graphene_vec2_init (&d, 1, 0);
+  first_direction = d;
+
+  for (i = 0; i < n_segments; i++)
+    {
+      const graphene_point_t *from = &pts[i];
+      const graphene_point_t *to = &pts[(i + 1) % n_pts];
+      float length, pos;
+
+      length = graphene_point_distance (from, to, NULL, NULL);
+      if (length == 0)
+        continue;
+      get_direction (from, to, &d);
+
+      pos = 0;
+      while (length - pos > remaining)
+        {
+          graphene_point_t p;
+
+          pos += remaining;
+          graphene_point_interpolate (from, to, pos / length, &p);
+
+          if (on && keep_first)
+            {
+              dash_points_add (self, &p);
+              g_array_append_vals (self->first_dash, self->dash_points->data, self->dash_points->len);
+              g_array_set_size (self->dash_points, 0);
+              first_direction = d;
+              keep_first = FALSE;
+            }
+          else if (on)
+            {
+              dash_points_add (self, &p);
+              dash_points_emit (self, &d);
+            }
+          else
+            {
+              g_array_set_size (self->dash_points, 0);
+              g_array_append_vals (self->dash_points, &p, 1);
+            }
+
+          on = !on;
+          dash = (dash + 1) % stroke->n_dash;
+          remaining = stroke->dash[dash];
+        }
+
+      remaining -= length - pos;
+      if (on)
+        dash_points_add (self, to);
+    }
+
+  if (on && keep_first)
+    {
+      /* The dash covers the whole contour */
+      stroker_add_polyline (self,
+                            (graphene_point_t *) self->dash_points->data,
+                            self->dash_points->len - 1,
+                            TRUE,
+                            &d);
+      g_array_set_size (self->dash_points, 0);
+    }
+  else if (on)
+    {
+      for (i = 0; i < self->first_dash->len; i++)
+        dash_points_add (self, &g_array_index (self->first_dash, graphene_point_t, i));
+      dash_points_emit (self, &d);
+    }
+  else if (self->first_dash->len > 0)
+    {
+      stroker_add_polyline (self,
+                            (graphene_point_t *) self->first_dash->data,
+                            self->first_dash->len,
+                            FALSE,
+                            &first_direction);
+    }
+}
+
+static void
+stroker_end_contour (Stroker  *self,
+                     gboolean  closed)
+{
+  GArray *points = self->points;
+  graphene_point_t *pts = (graphene_point_t *) points->data;
+  gsize n_pts = points->len;
+
+  if (n_pts == 0)
+    return;
+
+  if (closed && n_pts > 1 && graphene_point_equal (&pts[0], &pts[n_pts - 1]))
+    n_pts--;
+
+  if (self->has_segment)
+    {
+      if (self->stroke->dash_length > 0)
+        stroker_add_dashed (self, pts, n_pts, closed && n_pts > 1);
+      else
+        stroker_add_polyline (self, pts, n_pts, closed && n_pts > 1, &self->last_direction);
+    }
+
+  g_array_set_size (points, 0);
+  self->has_segment = FALSE;
+  graphene_vec2_init (&self->last_direction, 1, 0);
+}
+
+static void
+stroker_add_point (Stroker                *self,
+                   const graphene_point_t *p)
+{
+  GArray *points = self->points;
+
+  if (points->len > 0)
+    {
+      const graphene_point_t *last = &g_array_index (points, graphene_point_t, points->len - 1);
+
+      if (graphene_point_equal (last, p))
+        return;
+
+      get_direction (last, p, &self->last_direction);
+    }
+
+  g_array_append_vals (points, p, 1);
+}
+
+static gboolean
+stroker_foreach_cb (GskPathOperation        op,
+                    const graphene_point_t *pts,
+                    gsize                   n_pts,
+                    float                   weight,
+                    gpointer                data)
+{
+  Stroker *self = data;
+
+  switch (op)
+    {
+    case GSK_PATH_MOVE:
+      stroker_end_contour (self, FALSE);
+      stroker_add_point (self, &pts[0]);
+      break;
+
+    case GSK_PATH_CLOSE:
+      self->has_segment = TRUE;
+      stroker_end_contour (self, TRUE);
+      break;
+
+    case GSK_PATH_LINE:
+      self->has_segment = TRUE;
+      stroker_add_point (self, &pts[1]);
+      break;
+
+    case GSK_PATH_QUAD:
+    case GSK_PATH_CUBIC:
+    case GSK_PATH_CONIC:
+    default:
+      g_assert_not_reached ();
+      break;
+    }
+
+  return TRUE;
+}
+
+/*
+ * gsk_path_stroke_with_tolerance:
+ * @self: a path
+ * @stroke: the stroke parameters
+ * @tolerance: the tolerance for flattening curves
+ *
+ * Computes the outline of stroking the path with @stroke.
+ *
+ * Filling the returned path with %GSK_FILL_RULE_WINDING covers
+ * the same area as stroking @self. Curves are approximated with
+ * lines, using @tolerance.
+ *
+ * Returns: (transfer full): the outline of the stroke
+ */
+GskPath *
+gsk_path_stroke_with_tolerance (GskPath         *self,
+                                const GskStroke *stroke,
+                                double           tolerance)
+{
+  Stroker stroker;
+
+  stroker.builder = gsk_path_builder_new ();
+  stroker.stroke = stroke;
+  stroker.half_width = stroke->line_width / 2;
+  stroker.points = g_array_new (FALSE, FALSE, sizeof (graphene_point_t));
+  stroker.has_segment = FALSE;
+  graphene_vec2_init (&stroker.last_direction, 1, 0);
+  stroker.dash_points = g_array_new (FALSE, FALSE, sizeof (graphene_point_t));
+  stroker.first_dash = g_array_new (FALSE, FALSE, sizeof (graphene_point_t));
+
+  if (stroker.half_width > 0)
+    {
+      gsk_path_foreach_with_tolerance (self,
+                                       GSK_PATH_FOREACH_ALLOW_ONLY_LINES,
+                                       tolerance,
+                                       stroker_foreach_cb,
+                                       &stroker);
+      stroker_end_contour (&stroker, FALSE);
+    }
+
+  g_array_unref (stroker.points);
+  g_array_unref (stroker.dash_points);
+  g_array_unref (stroker.first_dash);
+
+  return gsk_path_builder_free_to_path (stroker.builder);
+}
+
+/**
+ * gsk_path_stroke:
+ * @self: a `GskPath`
+ * @stroke: the stroke parameters
+ *
+ * Computes the outline of stroking the path with @stroke.
+ *
+ * Filling the returned path with %GSK_FILL_RULE_WINDING covers
+ * the same area as stroking @self. This is useful to draw strokes
+ * with code that can only fill paths, or to check if a point is
+ * on the stroke with [method@Gsk.Path.in_fill].
+ *
+ * Curves are approximated with lines. The returned path can
+ * overlap itself at the inside of corners, so it is not suitable
+ * to be stroked itself or filled with %GSK_FILL_RULE_EVEN_ODD.
+ *
+ * Returns: (transfer full): the outline of the stroke
+ *
+ * Since: 4.14
+ */
+GskPath *
+gsk_path_stroke (GskPath         *self,
+                 const GskStroke *stroke)
+{
+  g_return_val_if_fail (self != NULL, NULL);
+  g_return_val_if_fail (stroke != NULL, NULL);
+
+  return gsk_path_stroke_with_tolerance (self, stroke, GSK_PATH_TOLERANCE_DEFAULT);
+}
@@ -39,6 +39,7 @@
 #include "gdk/gdksubsurfaceprivate.h"
 #include "gdk/gdktextureprivate.h"
 #include "gdk/gdktexturedownloaderprivate.h"
+#include "gdk/loaders/gdkpngprivate.h"
 
 #include <cairo.h>
 #ifdef CAIRO_HAS_SVG_SURFACE
@@ -1934,6 +1935,7 @@ gsk_texture_scale_node_draw (GskRenderNode *node,
   cairo_t *cr2;
   cairo_surface_t *surface2;
   graphene_rect_t clip_rect;
+  guint level;
 
   /* Make sure we draw the minimum region by using the clip */
   gsk_cairo_rectangle (cr, &node->bounds);
@@ -1948,13 +1950,24 @@ gsk_texture_scale_node_draw (GskRenderNode *node,
   cairo_surface_set_device_offset (surface2, -clip_rect.origin.x, -clip_rect.origin.y);
   cr2 = cairo_create (surface2);
 
-  surface = gdk_texture_download_surface (self->texture);
+  /* Draw from a smaller mipmap level, so cairo has less to filter */
+  if (self->filter == GSK_SCALING_FILTER_TRILINEAR)
+    level = gdk_texture_get_mipmap_level (self->texture,
+                                          node->bounds.size.width,
+                                          node->bounds.size.height);
+  else
+    level = 0;
+
+  if (level > 0)
+    surface = gdk_texture_get_mipmap_surface (self->texture, level);
+  else
+    surface = gdk_texture_download_surface (self->texture);
   pattern = cairo_pattern_create_for_surface (surface);
   cairo_pattern_set_extend (pattern, CAIRO_EXTEND_PAD);
 
   cairo_matrix_init_scale (&matrix,
-                           gdk_texture_get_width (self->texture) / node->bounds.size.width,
-                           gdk_texture_get_height (self->texture) / node->bounds.size.height);
+                           cairo_image_surface_get_width (surface) / node->bounds.size.width,
+                           cairo_image_surface_get_height (surface) / node->bounds.size.height);
   cairo_matrix_translate (&matrix, -node->bounds.origin.x, -node->bounds.origin.y);
   cairo_pattern_set_matrix (pattern, &matrix);
   cairo_pattern_set_filter (pattern, filters[self->filter]);
@@ -5656,6 +5669,205 @@ gsk_cross_fade_node_get_progress (const GskRenderNode *node)
 /* }}} */
 /* {{{ GSK_TEXT_NODE */
 
+typedef struct _GskTextNodeGlyphs GskTextNodeGlyphs;
+
+/* The glyphs of text nodes are immutable, so text nodes with the
+ * same glyphs share them, together with their extents. Snapshotting
+ * an unchanged label again then doesn't need to copy or measure its
+ * glyphs, as long as the previous nodes are still alive.
+ */
+struct _GskTextNodeGlyphs
+{
+  guint ref_count; /* protected by the text_node_glyphs lock */
+  gboolean in_cache;
+  guint hash;
+
+  PangoFont *font;
+  PangoRectangle ink_rect; /* in pixels */
+  gboolean has_color_glyphs;
+
+  guint num_glyphs;
+  PangoGlyphInfo *glyphs;
+};
+
+G_LOCK_DEFINE_STATIC (text_node_glyphs);
+static GHashTable *text_node_glyphs_cache; /* protected by the text_node_glyphs lock */
+
+static guint
+gsk_text_node_glyphs_hash (gconstpointer data)
+{
+  const GskTextNodeGlyphs *glyphs = data;
+
+  return glyphs->hash;
+}
+
+static gboolean
+gsk_text_node_glyphs_equal (gconstpointer data1,
+                            gconstpointer data2)
+{
+  const GskTextNodeGlyphs *glyphs1 = data1;
+  const GskTextNodeGlyphs *glyphs2 = data2;
+  guint i;
+
+  if (glyphs1->hash != glyphs2->hash ||
+      glyphs1->font != glyphs2->font ||
+      glyphs1->num_glyphs != glyphs2->num_glyphs)
+    return FALSE;
+
+  for (i = 0; i < glyphs1->num_glyphs; i++)
+    {
+      const PangoGlyphInfo *info1 = &glyphs1->glyphs[i];
+      const PangoGlyphInfo *info2 = &glyphs2->glyphs[i];
+
+      if (info1->glyph != info2->glyph ||
+          info1->geometry.width != info2->geometry.width ||
+          info1->geometry.x_offset != info2->geometry.x_offset ||
+          info1->geometry.y_offset != info2->geometry.y_offset ||
+          info1->attr.is_cluster_start != info2->attr.is_cluster_start ||
+          info1->attr.is_color != info2->attr.is_color)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static guint
+compute_glyphs_hash (PangoFont            *font,
+                     const PangoGlyphInfo *glyphs,
+                     guint                 num_glyphs)
+{
+  guint hash, i;
+
+  hash = g_direct_hash (font) ^ num_glyphs;
+  for (i = 0; i < num_glyphs; i++)
+    {
+      hash = hash * 31 + glyphs[i].glyph;
+      hash = hash * 31 + glyphs[i].geometry.width;
+      hash = hash * 31 + glyphs[i].geometry.x_offset;
+      hash = hash * 31 + glyphs[i].geometry.y_offset;
+    }
+
+  return hash;
+}
+
+static GskTextNodeGlyphs *
+gsk_text_node_glyphs_new (PangoFont        *font,
+                          PangoGlyphString *glyphs)
+{
+  GskTextNodeGlyphs *self;
+  guint i, n;
+
+  self = g_malloc (sizeof (GskTextNodeGlyphs) + glyphs->num_glyphs * sizeof (PangoGlyphInfo));
+  self->ref_count = 1;
+  self->in_cache = FALSE;
+  self->font = g_object_ref (font);
+  self->has_color_glyphs = FALSE;
+  self->glyphs = (PangoGlyphInfo *) (self + 1);
+
+  pango_glyph_string_extents (glyphs, font, &self->ink_rect, NULL);
+  pango_extents_to_pixels (&self->ink_rect, NULL);
+
+  n = 0;
+  for (i = 0; i < glyphs->num_glyphs; i++)
+    {
+      /* skip empty glyphs */
+      if (glyphs->glyphs[i].glyph == PANGO_GLYPH_EMPTY)
+        continue;
+
+      self->glyphs[n] = glyphs->glyphs[i];
+
+      if (glyphs->glyphs[i].attr.is_color)
+        self->has_color_glyphs = TRUE;
+
+      n++;
+    }
+
+  self->num_glyphs = n;
+  self->hash = compute_glyphs_hash (font, self->glyphs, n);
+
+  return self;
+}
+
+static void
+gsk_text_node_glyphs_unref (GskTextNodeGlyphs *self)
+{
+  G_LOCK (text_node_glyphs);
+
+  self->ref_count--;
+  if (self->ref_count > 0)
+    {
+      G_UNLOCK (text_node_glyphs);
+      return;
+    }
+
+  if (self->in_cache)
+    g_hash_table_remove (text_node_glyphs_cache, self);
+
+  G_UNLOCK (text_node_glyphs);
+
+  g_object_unref (self->font);
+  g_free (self);
+}
+
+/* Returns shared glyphs for @glyphs, or new ones if there are none */
+static GskTextNodeGlyphs *
+gsk_text_node_glyphs_lookup (PangoFont        *font,
+                             PangoGlyphString *glyphs)
+{
+  GskTextNodeGlyphs lookup, *result, *existing;
+  int i;
+
+  /* Empty glyphs get removed, but they affect the extents, so
+   * glyph strings that have them are not shared */
+  for (i = 0; i < glyphs->num_glyphs; i++)
+    {
+      if (glyphs->glyphs[i].glyph == PANGO_GLYPH_EMPTY)
+        return gsk_text_node_glyphs_new (font, glyphs);
+    }
+
+  lookup.font = font;
+  lookup.num_glyphs = glyphs->num_glyphs;
+  lookup.glyphs = glyphs->glyphs;
+  lookup.hash = compute_glyphs_hash (font, glyphs->glyphs, glyphs->num_glyphs);
+
+  G_LOCK (text_node_glyphs);
+
+  if (text_node_glyphs_cache == NULL)
+    text_node_glyphs_cache = g_hash_table_new (gsk_text_node_glyphs_hash,
+                                               gsk_text_node_glyphs_equal);
+
+  result = g_hash_table_lookup (text_node_glyphs_cache, &lookup);
+  if (result)
+    {
+      result->ref_count++;
+      G_UNLOCK (text_node_glyphs);
+      return result;
+    }
+
+  G_UNLOCK (text_node_glyphs);
+
+  result = gsk_text_node_glyphs_new (font, glyphs);
+
+  G_LOCK (text_node_glyphs);
+
+  /* Someone else might have been faster */
+  existing = g_hash_table_lookup (text_node_glyphs_cache, result);
+  if (existing)
+    {
+      existing->ref_count++;
+      G_UNLOCK (text_node_glyphs);
+      gsk_text_node_glyphs_unref (result);
+      return existing;
+    }
+
+  result->in_cache = TRUE;
+  g_hash_table_add (text_node_glyphs_cache, result);
+
+  G_UNLOCK (text_node_glyphs);
+
+  return result;
+}
+
 /**
  * GskTextNode:
  *
@@ -5672,6 +5884,7 @@ struct _GskTextNode
   GdkRGBA color;
   graphene_point_t offset;
 
+  GskTextNodeGlyphs *shared;
   guint num_glyphs;
   PangoGlyphInfo *glyphs;
 };
@@ -5684,7 +5897,7 @@ gsk_text_node_finalize (GskRenderNode *node)
 
   g_object_unref (self->font);
   g_object_unref (self->fontmap);
-  g_free (self->glyphs);
+  gsk_text_node_glyphs_unref (self->shared);
 
   parent_class->finalize (node);
 }
@@ -5724,6 +5937,9 @@ gsk_text_node_diff (GskRenderNode  *node1,
     {
       guint i;
 
+      if (self1->shared == self2->shared)
+        return;
+
       for (i = 0; i < self1->num_glyphs; i++)
         {
           PangoGlyphInfo *info1 = &self1->glyphs[i];
@@ -5782,16 +5998,18 @@ gsk_text_node_new (PangoFont              *font,
 {
   GskTextNode *self;
   GskRenderNode *node;
-  PangoRectangle ink_rect;
-  PangoGlyphInfo *glyph_infos;
-  int n;
+  GskTextNodeGlyphs *shared;
+  const PangoRectangle *ink_rect;
 
-  pango_glyph_string_extents (glyphs, font, &ink_rect, NULL);
-  pango_extents_to_pixels (&ink_rect, NULL);
+  shared = gsk_text_node_glyphs_lookup (font, glyphs);
+  ink_rect = &shared->ink_rect;
 
   /* Don't create nodes with empty bounds */
-  if (ink_rect.width == 0 || ink_rect.height == 0)
-    return NULL;
+  if (ink_rect->width == 0 || ink_rect->height == 0)
+    {
+      gsk_text_node_glyphs_unref (shared);
+      return NULL;
+    }
 
   self = gsk_render_node_alloc (GSK_TEXT_NODE);
   node = (GskRenderNode *) self;
@@ -5801,33 +6019,16 @@ gsk_text_node_new (PangoFont              *font,
   self->font = g_object_ref (font);
   self->color = *color;
   self->offset = *offset;
-  self->has_color_glyphs = FALSE;
-
-  glyph_infos = g_malloc_n (glyphs->num_glyphs, sizeof (PangoGlyphInfo));
-
-  n = 0;
-  for (int i = 0; i < glyphs->num_glyphs; i++)
-    {
-      /* skip empty glyphs */
-      if (glyphs->glyphs[i].glyph == PANGO_GLYPH_EMPTY)
-        continue;
-
-      glyph_infos[n] = glyphs->glyphs[i];
-
-      if (glyphs->glyphs[i].attr.is_color)
-        self->has_color_glyphs = TRUE;
-
-      n++;
-    }
-
-  self->glyphs = glyph_infos;
-  self->num_glyphs = n;
+  self->shared = shared;
+  self->has_color_glyphs = shared->has_color_glyphs;
+  self->glyphs = shared->glyphs;
+  self->num_glyphs = shared->num_glyphs;
 
   gsk_rect_init (&node->bounds,
-                 offset->x + ink_rect.x - 1,
-                 offset->y + ink_rect.y - 1,
-                 ink_rect.width + 2,
-                 ink_rect.height + 2);
+                 offset->x + ink_rect->x - 1,
+                 offset->y + ink_rect->y - 1,
+                 ink_rect->width + 2,
+                 ink_rect->height + 2);
 
   return node;
 }
@@ -7382,7 +7583,7 @@ gsk_render_node_png_serializer (GdkContentSerializer *serializer)
   gsk_renderer_unrealize (renderer);
   g_object_unref (renderer);
 
-  bytes = gdk_texture_save_to_png_bytes (texture);
+  bytes = gdk_save_png_with_flags (texture, GDK_PNG_SAVE_FAST);
   g_object_unref (texture);
 
   gsk_render_node_serialize_bytes (serializer, bytes);
@@ -16,6 +16,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <gdk/gdk.h>
 #include "gdktextureutilsprivate.h"
 #include "gtkscalerprivate.h"
@@ -281,15 +283,67 @@ extract_plane (GdkPixbuf *src,
     }
 }
 
-GdkPixbuf *
-gtk_make_symbolic_pixbuf_from_data (const char  *file_data,
-                                    gsize        file_len,
-                                    int          width,
-                                    int          height,
-                                    double       scale,
-                                    const char  *debug_output_basename,
-                                    GError     **error)
+static void
+find_symbolic_classes (GMarkupParseContext  *context,
+                       const char           *element_name,
+                       const char          **attribute_names,
+                       const char          **attribute_values,
+                       gpointer              user_data,
+                       GError              **error)
+{
+  gboolean *single_color = user_data;
+
+  for (int i = 0; attribute_names[i]; i++)
+    {
+      char **classes;
 
+      if (strcmp (attribute_names[i], "class") != 0)
+        continue;
+
+      classes = g_strsplit_set (attribute_values[i], " \t\r\n", 0);
+      for (int j = 0; classes[j]; j++)
+        {
+          if (strcmp (classes[j], "success") == 0 ||
+              strcmp (classes[j], "warning") == 0 ||
+              strcmp (classes[j], "error") == 0)
+            *single_color = FALSE;
+        }
+      g_strfreev (classes);
+    }
+}
+
+/* Symbolic icons can only use other colors than the foreground
+ * color via the style classes we set in load_symbolic_svg(). If
+ * no element has one of them, the icon is a plain mask.
+ *
+ * Icons that we can't parse are treated as using all colors.
+ */
+static gboolean
+symbolic_svg_is_single_color (const char *file_data,
+                              gsize       file_len)
+{
+  const GMarkupParser parser = { find_symbolic_classes, NULL, NULL, NULL, NULL };
+  GMarkupParseContext *context;
+  gboolean single_color = TRUE;
+
+  context = g_markup_parse_context_new (&parser, G_MARKUP_IGNORE_QUALIFIED, &single_color, NULL);
+  if (!g_markup_parse_context_parse (context, file_data, file_len, NULL) ||
+      !g_markup_parse_context_end_parse (context, NULL))
+    single_color = FALSE;
+  g_markup_parse_context_free (context);
+
+  return single_color;
+}
+
+static GdkPixbuf *
+make_symbolic_pixbuf (const char  *file_data,
+                      gsize        file_len,
+                      int          width,
+                      int          height,
+                      double       scale,
+                      gboolean     single_color,
+                      const char  *debug_output_basename,
+                      GError     **error)
 {
   const char *r_string = "rgb(255,0,0)";
   const char *g_string = "rgb(0,255,0)";
@@ -323,7 +377,10 @@ gtk_make_symbolic_pixbuf_from_data (const char  *file_data,
   if (height == 0)
     height = icon_height * scale;
 
-  for (plane = 0; plane < 3; plane++)
+  /* For single color icons, all 3 renderings would be the same,
+   * so we only need the first one for its alpha channel.
+   */
+  for (plane = 0; plane < (single_color ? 1 : 3); plane++)
     {
       /* Here we render the svg with all colors solid, this should
        * always make the alpha channel the same and it should match
@@ -369,7 +426,8 @@ gtk_make_symbolic_pixbuf_from_data (const char  *file_data,
       if (plane == 0)
         extract_plane (loaded, pixbuf, 3, 3);
 
-      extract_plane (loaded, pixbuf, 0, plane);
+      if (!single_color)
+        extract_plane (loaded, pixbuf, 0, plane);
 
       g_object_unref (loaded);
     }
@@ -383,17 +441,94 @@ out:
   return pixbuf;
 }
 
-static GdkPixbuf *
-make_symbolic_pixbuf_from_resource (const char  *path,
+GdkPixbuf *
+gtk_make_symbolic_pixbuf_from_data (const char  *file_data,
+                                    gsize        file_len,
                                     int          width,
                                     int          height,
                                     double       scale,
+                                    const char  *debug_output_basename,
                                     GError     **error)
+
+{
+  return make_symbolic_pixbuf (file_data, file_len,
+                               width, height, scale,
+                               FALSE,
+                               debug_output_basename,
+                               error);
+}
+
+/* Single color icons are stored as an alpha-only texture. Rendering
+ * them as a mask over a color lets the renderer colorize them in its
+ * shader, and they take a quarter of the memory.
+ */
+static GdkTexture *
+make_symbolic_texture_from_data (const char  *file_data,
+                                 gsize        file_len,
+                                 int          width,
+                                 int          height,
+                                 double       scale,
+                                 GError     **error)
+{
+  GdkPixbuf *pixbuf;
+  GdkTexture *texture;
+  gboolean single_color;
+
+  single_color = symbolic_svg_is_single_color (file_data, file_len);
+
+  pixbuf = make_symbolic_pixbuf (file_data, file_len,
+                                 width, height, scale,
+                                 single_color,
+                                 NULL,
+                                 error);
+  if (pixbuf == NULL)
+    return NULL;
+
+  if (single_color)
+    {
+      const guchar *pixels;
+      guchar *data;
+      gsize stride;
+      GBytes *bytes;
+      int x, y;
+
+      width = gdk_pixbuf_get_width (pixbuf);
+      height = gdk_pixbuf_get_height (pixbuf);
+      pixels = gdk_pixbuf_read_pixels (pixbuf);
+      stride = gdk_pixbuf_get_rowstride (pixbuf);
+
+      data = g_malloc ((gsize) width * height);
+      for (y = 0; y < height; y++)
+        {
+          for (x = 0; x < width; x++)
+            data[y * width + x] = pixels[y * stride + 4 * x + 3];
+        }
+
+      bytes = g_bytes_new_take (data, (gsize) width * height);
+      texture = gdk_memory_texture_new (width, height, GDK_MEMORY_A8, bytes, width);
+      g_bytes_unref (bytes);
+    }
+  else
+    {
+      texture = gdk_texture_new_for_pixbuf (pixbuf);
+    }
+
+  g_object_unref (pixbuf);
+
+  return texture;
+}
+
+static GdkTexture *
+make_symbolic_texture_from_resource (const char  *path,
+                                     int          width,
+                                     int          height,
+                                     double       scale,
+                                     GError     **error)
 {
   GBytes *bytes;
   const char *data;
   gsize size;
-  GdkPixbuf *pixbuf;
+  GdkTexture *texture;
 
   bytes = g_resources_lookup_data (path, G_RESOURCE_LOOKUP_FLAGS_NONE, error);
   if (bytes == NULL)
@@ -401,53 +536,53 @@ make_symbolic_pixbuf_from_resource (const char  *path,
 
   data = g_bytes_get_data (bytes, &size);
 
-  pixbuf = gtk_make_symbolic_pixbuf_from_data (data, size, width, height, scale, NULL, error);
+  texture = make_symbolic_texture_from_data (data, size, width, height, scale, error);
 
   g_bytes_unref (bytes);
 
-  return pixbuf;
+  return texture;
 }
 
-static GdkPixbuf *
-make_symbolic_pixbuf_from_path (const char  *path,
-                                int          width,
-                                int          height,
-                                double       scale,
-                                GError     **error)
+static GdkTexture *
+make_symbolic_texture_from_path (const char  *path,
+                                 int          width,
+                                 int          height,
+                                 double       scale,
+                                 GError     **error)
 {
   char *data;
   gsize size;
-  GdkPixbuf *pixbuf;
+  GdkTexture *texture;
 
   if (!g_file_get_contents (path, &data, &size, error))
     return NULL;
 
-  pixbuf = gtk_make_symbolic_pixbuf_from_data (data, size, width, height, scale, NULL, error);
+  texture = make_symbolic_texture_from_data (data, size, width, height, scale, error);
 
   g_free (data);
 
-  return pixbuf;
+  return texture;
 }
 
-static GdkPixbuf *
-make_symbolic_pixbuf_from_file (GFile       *file,
-                                int          width,
-                                int          height,
-                                double       scale,
-                                GError     **error)
+static GdkTexture *
+make_symbolic_texture_from_file (GFile       *file,
+                                 int          width,
+                                 int          height,
+                                 double       scale,
+                                 GError     **error)
 {
   char *data;
   gsize size;
-  GdkPixbuf *pixbuf;
+  GdkTexture *texture;
 
   if (!g_file_load_contents (file, NULL, &data, &size, NULL, error))
     return NULL;
 
-  pixbuf = gtk_make_symbolic_pixbuf_from_data (data, size, width, height, scale, NULL, error);
+  texture = make_symbolic_texture_from_data (data, size, width, height, scale, error);
 
   g_free (data);
 
-  return pixbuf;
+  return texture;
 }
 
 /* }}} */
@@ -522,17 +657,7 @@ gdk_texture_new_from_path_symbolic (const char    *path,
                                     double         scale,
                                     GError       **error)
 {
-  GdkPixbuf *pixbuf;
-  GdkTexture *texture = NULL;
-
-  pixbuf = make_symbolic_pixbuf_from_path (path, width, height, scale, error);
-  if (pixbuf)
-    {
-      texture = gdk_texture_new_for_pixbuf (pixbuf);
-      g_object_unref (pixbuf);
-    }
-
-  return texture;
+  return make_symbolic_texture_from_path (path, width, height, scale, error);
 }
 
 GdkTexture *
@@ -548,17 +673,7 @@ gdk_texture_new_from_resource_symbolic (const char  *path,
                                         double       scale,
                                         GError     **error)
 {
-  GdkPixbuf *pixbuf;
-  GdkTexture *texture = NULL;
-
-  pixbuf = make_symbolic_pixbuf_from_resource (path, width, height, scale, error);
-  if (pixbuf)
-    {
-      texture = gdk_texture_new_for_pixbuf (pixbuf);
-      g_object_unref (pixbuf);
-    }
-
-  return texture;
+  return make_symbolic_texture_from_resource (path, width, height, scale, error);
 }
 
 GdkTexture *
@@ -590,14 +705,7 @@ gdk_texture_new_from_file_symbolic (GFile       *file,
                                     double       scale,
                                     GError     **error)
 {
-  GdkPixbuf *pixbuf;
-  GdkTexture *texture;
-
-  pixbuf = make_symbolic_pixbuf_from_file (file, width, height, scale, error);
-  texture = gdk_texture_new_for_pixbuf (pixbuf);
-  g_object_unref (pixbuf);
-
-  return texture;
+  return make_symbolic_texture_from_file (file, width, height, scale, error);
 }
 
 /* }}} */
@@ -52,6 +52,7 @@
 #include "gtksymbolicpaintable.h"
 #include "gtkwidgetprivate.h"
 #include "gdktextureutilsprivate.h"
+#include "gdk/gdkmemoryformatprivate.h"
 #include "gdk/gdktextureprivate.h"
 #include "gdk/gdkprofilerprivate.h"
 
@@ -264,9 +265,10 @@ gtk_string_set_add (GtkStringSet *set,
  *
  * There is a global "icon_cache" G_LOCK, which protects icon_cache
  * and lru_cache in GtkIconTheme as well as its reverse pointer
- * GtkIcon->in_cache. This is sometimes taken with the theme lock held
- * (from the theme side) and sometimes not (from the icon side),
- * but we never take another lock after taking it, so this is safe.
+ * GtkIcon->in_cache and the LRU bookkeeping in the icons. This is
+ * sometimes taken with the theme lock held (from the theme side)
+ * and sometimes not (from the icon side), but we never take another
+ * lock after taking it, so this is safe.
  * Since this is a global (not per icon/theme) lock we should never
  * block while holding it.
  *
@@ -302,8 +304,10 @@ typedef enum
 #define DEBUG_CACHE(args)
 #endif
 
-#define LRU_CACHE_SIZE 100
-#define MAX_LRU_TEXTURE_SIZE 128
+/* The LRU cache keeps recently used icons alive, bounded by
+ * the memory their textures take up.
+ */
+#define LRU_CACHE_MAX_BYTES (16 * 1024 * 1024)
 
 typedef struct _GtkIconPaintableClass GtkIconPaintableClass;
 typedef struct _GtkIconThemeClass     GtkIconThemeClass;
@@ -326,11 +330,18 @@ struct _GtkIconTheme
 
   GHashTable *icon_cache;                       /* Protected by icon_cache lock */
 
-  GtkIconPaintable *lru_cache[LRU_CACHE_SIZE];  /* Protected by icon_cache lock */
-  int lru_cache_current;                        /* Protected by icon_cache lock */
+  GQueue lru_cache;                             /* Protected by icon_cache lock */
+  gsize lru_cache_bytes;                        /* Protected by icon_cache lock */
+  guint64 cache_hits;                           /* Protected by icon_cache lock */
+  guint64 cache_misses;                         /* Protected by icon_cache lock */
 
   GtkStringSet icons;
 
+  /* All places an icon name can be found in, over all themes.
+   * Filled in on demand, for the names that are looked up.
+   */
+  GHashTable *icon_index;                       /* name (interned) -> GArray of IconIndexEntry */
+
   char *current_theme;
   char **search_path;
   char **resource_path;
@@ -397,6 +408,8 @@ struct _GtkIconPaintable
    */
   IconKey key;
   GtkIconTheme *in_cache; /* Protected by icon_cache lock */
+  GList lru_link;         /* Protected by icon_cache lock */
+  gsize lru_size;         /* Protected by icon_cache lock */
 
   char *icon_name;
   char *filename;
@@ -462,6 +475,20 @@ typedef struct
   char *path;  /* e.g. "/usr/share/icons/hicolor/32x32/apps" */
 } IconThemeDir;
 
+/* The icon index has the entries for each name in theme
+ * search order, so a lookup only ever visits the directories
+ * that actually contain the icon, and the entries of a single
+ * theme can be found with a binary search on theme_index.
+ */
+typedef struct
+{
+  const char *name;     /* interned */
+  IconTheme *theme;
+  guint16 theme_index;  /* index in GtkIconTheme.themes */
+  guint16 dir_size;     /* index in theme->dir_sizes */
+  guint32 file_index;   /* index in dir_size->icon_files */
+} IconIndexEntry;
+
 typedef struct
 {
   char *svg_filename;
@@ -486,6 +513,8 @@ static void              theme_dir_destroy                (IconThemeDir     *dir
 static void              theme_destroy                    (IconTheme        *theme);
 static GtkIconPaintable *theme_lookup_icon                (IconTheme        *theme,
                                                            const char       *icon_name,
+                                                           const IconIndexEntry *entries,
+                                                           guint             n_entries,
                                                            int               size,
                                                            int               scale,
                                                            gboolean          allow_svg);
@@ -659,37 +688,83 @@ icon_key_equal (gconstpointer _a,
  * because that will take the lock when removing from the icon cache.
  */
 
+/* A guess at the texture size until the icon is loaded */
+static gsize
+icon_estimate_size (GtkIconPaintable *icon)
+{
+  gsize pixel_size = icon->desired_size * icon->desired_scale;
+
+  return pixel_size * pixel_size * 4;
+}
+
 /* This is called with icon_cache lock held so must not take any locks */
 static gboolean
-_icon_cache_should_lru_cache (GtkIconPaintable *icon)
+_icon_cache_should_lru_cache (GtkIconTheme     *theme,
+                              GtkIconPaintable *icon)
 {
-  return icon->desired_size <= MAX_LRU_TEXTURE_SIZE;
+  /* Don't let a single huge icon flush the whole cache */
+  return icon->lru_size <= LRU_CACHE_MAX_BYTES / 4;
 }
 
-/* This returns the old lru element because we can't unref it with
- * the lock held */
-static GtkIconPaintable *
+static inline gboolean
+_icon_cache_is_in_lru_cache (GtkIconPaintable *icon)
+{
+  return icon->lru_link.data != NULL;
+}
+
+static void
+_icon_cache_remove_from_lru_cache (GtkIconTheme     *theme,
+                                   GtkIconPaintable *icon,
+                                   GSList          **old_icons)
+{
+  g_queue_unlink (&theme->lru_cache, &icon->lru_link);
+  icon->lru_link.data = NULL;
+  theme->lru_cache_bytes -= icon->lru_size;
+  *old_icons = g_slist_prepend (*old_icons, icon);
+}
+
+static void
+_icon_cache_trim_lru_cache (GtkIconTheme  *theme,
+                            GSList       **old_icons)
+{
+  while (theme->lru_cache_bytes > LRU_CACHE_MAX_BYTES &&
+         theme->lru_cache.tail != NULL)
+    _icon_cache_remove_from_lru_cache (theme, theme->lru_cache.tail->data, old_icons);
+}
+
+/* This returns the icons that dropped out of the lru cache
+ * because we can't unref them with the lock held */
+static GSList *
 _icon_cache_add_to_lru_cache (GtkIconTheme     *theme,
                               GtkIconPaintable *icon)
 {
-  GtkIconPaintable *old_icon = NULL;
+  GSList *old_icons = NULL;
 
-  /* Avoid storing the same info multiple times in a row */
-  if (theme->lru_cache[theme->lru_cache_current] != icon)
+  if (_icon_cache_is_in_lru_cache (icon))
     {
-      theme->lru_cache_current = (theme->lru_cache_current + 1) % LRU_CACHE_SIZE;
-      old_icon = theme->lru_cache[theme->lru_cache_current];
-      theme->lru_cache[theme->lru_cache_current] = g_object_ref (icon);
+      /* Move item to front */
+      if (theme->lru_cache.head != &icon->lru_link)
+        {
+          g_queue_unlink (&theme->lru_cache, &icon->lru_link);
+          g_queue_push_head_link (&theme->lru_cache, &icon->lru_link);
+        }
+    }
+  else if (_icon_cache_should_lru_cache (theme, icon))
+    {
+      icon->lru_link.data = g_object_ref (icon);
+      g_queue_push_head_link (&theme->lru_cache, &icon->lru_link);
+      theme->lru_cache_bytes += icon->lru_size;
+      _icon_cache_trim_lru_cache (theme, &old_icons);
     }
 
-  return old_icon;
+  return old_icons;
 }
 
 static GtkIconPaintable *
 icon_cache_lookup (GtkIconTheme *theme,
                    IconKey      *key)
 {
-  GtkIconPaintable *old_icon = NULL;
+  GSList *old_icons = NULL;
   GtkIconPaintable *icon;
 
   G_LOCK (icon_cache);
@@ -705,16 +780,16 @@ icon_cache_lookup (GtkIconTheme *theme,
 
       icon = g_object_ref (icon);
 
-      /* Move item to front in LRU cache */
-      if (_icon_cache_should_lru_cache (icon))
-        old_icon = _icon_cache_add_to_lru_cache (theme, icon);
+      old_icons = _icon_cache_add_to_lru_cache (theme, icon);
+      theme->cache_hits++;
     }
+  else
+    theme->cache_misses++;
 
   G_UNLOCK (icon_cache);
 
-  /* Call potential finalizer outside the lock */
-  if (old_icon)
-    g_object_unref (old_icon);
+  /* Call potential finalizers outside the lock */
+  g_slist_free_full (old_icons, g_object_unref);
 
   return icon;
 }
@@ -738,33 +813,57 @@ icon_uncached_cb (GtkIconPaintable *icon)
 static void
 icon_cache_mark_used_if_cached (GtkIconPaintable *icon)
 {
-  GtkIconPaintable *old_icon = NULL;
-
-  if (!_icon_cache_should_lru_cache (icon))
-    return;
+  GSList *old_icons = NULL;
 
   G_LOCK (icon_cache);
   if (icon->in_cache)
-    old_icon = _icon_cache_add_to_lru_cache (icon->in_cache, icon);
+    old_icons = _icon_cache_add_to_lru_cache (icon->in_cache, icon);
+  G_UNLOCK (icon_cache);
+
+  /* Call potential finalizers outside the lock */
+  g_slist_free_full (old_icons, g_object_unref);
+}
+
+/* Called once the texture is loaded, to replace the
+ * estimated size with the real one */
+static void
+icon_cache_update_size (GtkIconPaintable *icon,
+                        gsize             size)
+{
+  GSList *old_icons = NULL;
+
+  G_LOCK (icon_cache);
+  if (icon->in_cache && _icon_cache_is_in_lru_cache (icon))
+    {
+      GtkIconTheme *theme = icon->in_cache;
+
+      theme->lru_cache_bytes = theme->lru_cache_bytes - icon->lru_size + size;
+      icon->lru_size = size;
+      if (!_icon_cache_should_lru_cache (theme, icon))
+        _icon_cache_remove_from_lru_cache (theme, icon, &old_icons);
+      _icon_cache_trim_lru_cache (theme, &old_icons);
+    }
+  else
+    icon->lru_size = size;
   G_UNLOCK (icon_cache);
 
   /* Call potential finalizers outside the lock */
-  if (old_icon)
-    g_object_unref (old_icon);
+  g_slist_free_full (old_icons, g_object_unref);
 }
 
 static void
 icon_cache_add (GtkIconTheme     *theme,
                 GtkIconPaintable *icon)
 {
-  GtkIconPaintable *old_icon = NULL;
+  GSList *old_icons = NULL;
 
   G_LOCK (icon_cache);
   icon->in_cache = theme;
   g_hash_table_insert (theme->icon_cache, &icon->key, icon);
 
-  if (_icon_cache_should_lru_cache (icon))
-    old_icon = _icon_cache_add_to_lru_cache (theme, icon);
+  if (icon->lru_size == 0)
+    icon->lru_size = icon_estimate_size (icon);
+  old_icons = _icon_cache_add_to_lru_cache (theme, icon);
   DEBUG_CACHE (("adding %p (%s %d 0x%x) to cache (cache size %d)\n",
                 icon,
                 g_strjoinv (",", icon->key.icon_names),
@@ -772,9 +871,8 @@ icon_cache_add (GtkIconTheme     *theme,
                 g_hash_table_size (theme->icon_cache)));
   G_UNLOCK (icon_cache);
 
-  /* Call potential finalizer outside the lock */
-  if (old_icon)
-    g_object_unref (old_icon);
+  /* Call potential finalizers outside the lock */
+  g_slist_free_full (old_icons, g_object_unref);
 }
 
 static void
@@ -789,24 +887,47 @@ icon_cache_remove (GtkIconPaintable *icon)
 static void
 icon_cache_clear (GtkIconTheme *theme)
 {
-  int i;
-  GtkIconPaintable *old_icons[LRU_CACHE_SIZE];
+  GSList *old_icons = NULL;
 
   G_LOCK (icon_cache);
   g_hash_table_remove_all (theme->icon_cache);
-  for (i = 0; i < LRU_CACHE_SIZE; i ++)
-    {
-      old_icons[i] = theme->lru_cache[i];
-      theme->lru_cache[i] = NULL;
-    }
+  while (theme->lru_cache.head != NULL)
+    _icon_cache_remove_from_lru_cache (theme, theme->lru_cache.head->data, &old_icons);
   G_UNLOCK (icon_cache);
 
   /* Call potential finalizers outside the lock */
-  for (i = 0; i < LRU_CACHE_SIZE; i ++)
-    {
-      if (old_icons[i] != NULL)
-        g_object_unref (old_icons[i]);
-    }
+  g_slist_free_full (old_icons, g_object_unref);
+}
+
+/*< private >
+ * gtk_icon_theme_get_cache_stats:
+ * @self: a `GtkIconTheme`
+ * @n_icons: (out) (optional): return location for the number of icons in the LRU cache
+ * @n_bytes: (out) (optional): return location for the size of the LRU cache
+ * @hits: (out) (optional): return location for the number of cache hits
+ * @misses: (out) (optional): return location for the number of cache misses
+ *
+ * Gets statistics about the icon cache, for the inspector.
+ */
+void
+gtk_icon_theme_get_cache_stats (GtkIconTheme *self,
+                                guint        *n_icons,
+                                gsize        *n_bytes,
+                                guint64      *hits,
+                                guint64      *misses)
+{
+  g_return_if_fail (GTK_IS_ICON_THEME (self));
+
+  G_LOCK (icon_cache);
+  if (n_icons)
+    *n_icons = self->lru_cache.length;
+  if (n_bytes)
+    *n_bytes = self->lru_cache_bytes;
+  if (hits)
+    *hits = self->cache_hits;
+  if (misses)
+    *misses = self->cache_misses;
+  G_UNLOCK (icon_cache);
 }
 
 /****************** End of icon cache ***********************/
@@ -1273,6 +1394,7 @@ gtk_icon_theme_init (GtkIconTheme *self)
 
   self->icon_cache = g_hash_table_new_full (icon_key_hash, icon_key_equal, NULL,
                                             (GDestroyNotify)icon_uncached_cb);
+  g_queue_init (&self->lru_cache);
 
   self->custom_theme = FALSE;
   self->dir_mtimes = g_array_new (FALSE, TRUE, sizeof (IconThemeDirMtime));
@@ -1381,6 +1503,7 @@ blow_themes (GtkIconTheme *self)
       g_list_free_full (self->themes, (GDestroyNotify) theme_destroy);
       g_array_set_size (self->dir_mtimes, 0);
       g_hash_table_destroy (self->unthemed_icons);
+      g_clear_pointer (&self->icon_index, g_hash_table_destroy);
       gtk_string_set_destroy (&self->icons);
     }
   self->themes = NULL;
@@ -1727,6 +1850,93 @@ gtk_icon_theme_get_theme_name (GtkIconTheme *self)
   return theme_name;
 }
 
+/* Returns the index entries for an interned icon name,
+ * in theme order and then in directory size order
+ */
+static const IconIndexEntry *
+lookup_icon_index (GtkIconTheme *self,
+                   const char   *icon_name,
+                   guint        *n_entries)
+{
+  GArray *entries;
+  GList *l;
+  guint theme_index, i;
+
+  entries = g_hash_table_lookup (self->icon_index, icon_name);
+  if (entries == NULL)
+    {
+      entries = g_array_new (FALSE, FALSE, sizeof (IconIndexEntry));
+
+      for (l = self->themes, theme_index = 0; l; l = l->next, theme_index++)
+        {
+          IconTheme *theme = l->data;
+
+          for (i = 0; i < theme->dir_sizes->len; i++)
+            {
+              IconThemeDirSize *dir_size = &g_array_index (theme->dir_sizes, IconThemeDirSize, i);
+              gpointer value;
+              IconIndexEntry entry;
+
+              if (!g_hash_table_lookup_extended (dir_size->icon_hash, icon_name, NULL, &value))
+                continue;
+
+              entry.name = icon_name;
+              entry.theme = theme;
+              entry.theme_index = theme_index;
+              entry.dir_size = i;
+              entry.file_index = GPOINTER_TO_UINT (value);
+
+              g_array_append_val (entries, entry);
+            }
+        }
+
+      g_hash_table_insert (self->icon_index, (char *) icon_name, entries);
+    }
+
+  *n_entries = entries->len;
+  return entries->len > 0 ? (const IconIndexEntry *) entries->data : NULL;
+}
+
+/* Returns the index entries for an interned icon name in
+ * the theme at @theme_index in the theme list
+ */
+static const IconIndexEntry *
+lookup_theme_icon_index (GtkIconTheme *self,
+                         const char   *icon_name,
+                         guint         theme_index,
+                         guint        *n_entries)
+{
+  const IconIndexEntry *entries;
+  guint n, lo, hi, mid, start;
+
+  entries = lookup_icon_index (self, icon_name, &n);
+
+  lo = 0;
+  hi = n;
+  while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if (entries[mid].theme_index < theme_index)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  start = lo;
+
+  hi = n;
+  while (lo < hi)
+    {
+      mid = (lo + hi) / 2;
+      if (entries[mid].theme_index <= theme_index)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  *n_entries = lo - start;
+  return *n_entries > 0 ? &entries[start] : NULL;
+}
+
 static void
 insert_theme (GtkIconTheme *self,
               const char   *theme_name)
@@ -1962,6 +2172,9 @@ load_themes (GtkIconTheme *self)
   insert_theme (self, FALLBACK_ICON_THEME);
   self->themes = g_list_reverse (self->themes);
 
+  self->icon_index = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                            NULL, (GDestroyNotify) g_array_unref);
+
   self->unthemed_icons = g_hash_table_new_full (g_str_hash, g_str_equal,
                                                 g_free, (GDestroyNotify)free_unthemed_icon);
 
@@ -2139,6 +2352,8 @@ real_choose_icon (GtkIconTheme      *self,
   UnthemedIcon *unthemed_icon = NULL;
   const char *icon_name = NULL;
   IconTheme *theme = NULL;
+  const IconIndexEntry *entries;
+  guint n_entries, theme_index;
   int i;
   IconKey key;
 
@@ -2169,7 +2384,7 @@ real_choose_icon (GtkIconTheme      *self,
    * In other words: We prefer symbolic icons in inherited themes over
    * generic icons in the theme.
    */
-  for (l = self->themes; l; l = l->next)
+  for (l = self->themes, theme_index = 0; l; l = l->next, theme_index++)
     {
       theme = l->data;
       for (i = 0; icon_names[i] && icon_name_is_symbolic (icon_names[i], -1); i++)
@@ -2177,14 +2392,15 @@ real_choose_icon (GtkIconTheme      *self,
           icon_name = gtk_string_set_lookup (&self->icons, icon_names[i]);
           if (icon_name)
             {
-              icon = theme_lookup_icon (theme, icon_name, size, scale, self->pixbuf_supports_svg);
+              entries = lookup_theme_icon_index (self, icon_name, theme_index, &n_entries);
+              icon = theme_lookup_icon (theme, icon_name, entries, n_entries, size, scale, self->pixbuf_supports_svg);
               if (icon)
                 goto out;
             }
         }
     }
 
-  for (l = self->themes; l; l = l->next)
+  for (l = self->themes, theme_index = 0; l; l = l->next, theme_index++)
     {
       theme = l->data;
 
@@ -2193,7 +2409,8 @@ real_choose_icon (GtkIconTheme      *self,
           icon_name = gtk_string_set_lookup (&self->icons, icon_names[i]);
           if (icon_name)
             {
-              icon = theme_lookup_icon (theme, icon_name, size, scale, self->pixbuf_supports_svg);
+              entries = lookup_theme_icon_index (self, icon_name, theme_index, &n_entries);
+              icon = theme_lookup_icon (theme, icon_name, entries, n_entries, size, scale, self->pixbuf_supports_svg);
               if (icon)
                 goto out;
             }
@@ -2673,8 +2890,8 @@ int *
 gtk_icon_theme_get_icon_sizes (GtkIconTheme *self,
                                const char   *icon_name)
 {
-  GList *l;
-  int i;
+  const IconIndexEntry *entries;
+  guint i, n_entries;
   GHashTable *sizes;
   int *result, *r;
   const char *interned_icon_name;
@@ -2687,27 +2904,20 @@ gtk_icon_theme_get_icon_sizes (GtkIconTheme *self,
 
   sizes = g_hash_table_new (g_direct_hash, g_direct_equal);
 
+  entries = NULL;
+  n_entries = 0;
   interned_icon_name = gtk_string_set_lookup (&self->icons, icon_name);
+  if (interned_icon_name)
+    entries = lookup_icon_index (self, interned_icon_name, &n_entries);
 
-  for (l = self->themes; l; l = l->next)
+  for (i = 0; i < n_entries; i++)
     {
-      IconTheme *theme = l->data;
-
-      for (i = 0; i < theme->dir_sizes->len; i++)
-        {
-          IconThemeDirSize *dir_size = &g_array_index (theme->dir_sizes, IconThemeDirSize, i);
+      IconThemeDirSize *dir_size = &g_array_index (entries[i].theme->dir_sizes, IconThemeDirSize, entries[i].dir_size);
 
-          if (dir_size->type != ICON_THEME_DIR_SCALABLE && g_hash_table_lookup_extended (sizes, GINT_TO_POINTER (dir_size->size), NULL, NULL))
-            continue;
-
-          if (!g_hash_table_contains (dir_size->icon_hash, interned_icon_name))
-            continue;
-
-          if (dir_size->type == ICON_THEME_DIR_SCALABLE)
-            g_hash_table_insert (sizes, GINT_TO_POINTER (-1), NULL);
-          else
-            g_hash_table_insert (sizes, GINT_TO_POINTER (dir_size->size), NULL);
-        }
+      if (dir_size->type == ICON_THEME_DIR_SCALABLE)
+        g_hash_table_insert (sizes, GINT_TO_POINTER (-1), NULL);
+      else
+        g_hash_table_insert (sizes, GINT_TO_POINTER (dir_size->size), NULL);
     }
 
   r = result = g_new0 (int, g_hash_table_size (sizes) + 1);
@@ -3031,34 +3241,35 @@ compare_dir_size_matches (IconThemeDirSize *dir_a, int difference_a,
 }
 
 static GtkIconPaintable *
-theme_lookup_icon (IconTheme   *theme,
-                   const char *icon_name, /* interned */
-                   int          size,
-                   int          scale,
-                   gboolean     allow_svg)
+theme_lookup_icon (IconTheme            *theme,
+                   const char           *icon_name, /* interned */
+                   const IconIndexEntry *entries,
+                   guint                 n_entries,
+                   int                   size,
+                   int                   scale,
+                   gboolean              allow_svg)
 {
   IconThemeDirSize *min_dir_size;
   IconThemeFile *min_file;
   int min_difference;
   IconCacheFlag min_suffix = ICON_CACHE_FLAG_PNG_SUFFIX;
-  int i;
+  guint i;
 
   min_difference = G_MAXINT;
   min_dir_size = NULL;
   min_file = NULL;
 
-  for (i = 0; i < theme->dir_sizes->len; i++)
+  for (i = 0; i < n_entries; i++)
     {
-      IconThemeDirSize *dir_size = &g_array_index (theme->dir_sizes, IconThemeDirSize, i);
+      IconThemeDirSize *dir_size;
       IconThemeFile *file;
       guint best_suffix;
       int difference;
-      gpointer file_index;
 
-      if (!g_hash_table_lookup_extended (dir_size->icon_hash, icon_name, NULL, &file_index))
-        continue;
+      g_assert (entries[i].theme == theme);
 
-      file = &g_array_index (dir_size->icon_files, IconThemeFile, GPOINTER_TO_INT(file_index));
+      dir_size = &g_array_index (theme->dir_sizes, IconThemeDirSize, entries[i].dir_size);
+      file = &g_array_index (dir_size->icon_files, IconThemeFile, entries[i].file_index);
 
 
       if (allow_svg)
@@ -3816,6 +4027,11 @@ icon_ensure_texture__locked (GtkIconPaintable *icon,
       icon->is_symbolic = FALSE;
     }
 
+  icon_cache_update_size (icon,
+                          (gsize) gdk_texture_get_width (icon->texture) *
+                          gdk_texture_get_height (icon->texture) *
+                          gdk_memory_format_bytes_per_pixel (gdk_texture_get_format (icon->texture)));
+
   if (GDK_PROFILER_IS_RUNNING)
     {
       gint64 end = GDK_PROFILER_CURRENT_TIME;
@@ -3896,12 +4112,21 @@ gtk_icon_paintable_snapshot_symbolic (GtkSymbolicPaintable *paintable,
   int texture_width, texture_height;
   double render_width;
   double render_height;
-  gboolean symbolic;
+  graphene_rect_t bounds;
+  gboolean symbolic, mask;
 
   texture = gtk_icon_paintable_ensure_texture (icon);
   symbolic = gtk_icon_paintable_is_symbolic (icon);
+  mask = symbolic && gdk_texture_get_format (texture) == GDK_MEMORY_A8;
 
-  if (symbolic)
+  if (mask)
+    {
+      /* Single color symbolic icons are just a mask, so the
+       * renderer can colorize them directly.
+       */
+      gtk_snapshot_push_mask (snapshot, GSK_MASK_MODE_ALPHA);
+    }
+  else if (symbolic)
     {
       graphene_matrix_t matrix;
       graphene_vec4_t offset;
@@ -3928,13 +4153,20 @@ gtk_icon_paintable_snapshot_symbolic (GtkSymbolicPaintable *paintable,
       render_height = height;
     }
 
-  gtk_snapshot_append_texture (snapshot, texture,
-                               &GRAPHENE_RECT_INIT ((width - render_width) / 2,
-                                                    (height - render_height) / 2,
-                                                    render_width,
-                                                    render_height));
+  bounds = GRAPHENE_RECT_INIT ((width - render_width) / 2,
+                               (height - render_height) / 2,
+                               render_width,
+                               render_height);
 
-  if (symbolic)
+  gtk_snapshot_append_texture (snapshot, texture, &bounds);
+
+  if (mask)
+    {
+      gtk_snapshot_pop (snapshot);
+      gtk_snapshot_append_color (snapshot, &colors[GTK_SYMBOLIC_COLOR_FOREGROUND], &bounds);
+      gtk_snapshot_pop (snapshot);
+    }
+  else if (symbolic)
     gtk_snapshot_pop (snapshot);
 }
 
@@ -31,3 +31,9 @@ void gtk_icon_theme_lookup_symbolic_colors   (GtkCssStyle      *style,
 
 int gtk_icon_theme_get_serial (GtkIconTheme *self);
 
+void gtk_icon_theme_get_cache_stats          (GtkIconTheme     *self,
+                                              guint            *n_icons,
+                                              gsize            *n_bytes,
+                                              guint64          *hits,
+                                              guint64          *misses);
+
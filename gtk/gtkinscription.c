@@ -76,6 +76,10 @@ struct _GtkInscription
   GtkInscriptionOverflow overflow;
 
   PangoLayout *layout;
+  /* shared with other inscriptions showing the same text, see
+   * gtk_inscription_get_shaped_layout() */
+  PangoLayout *shaped_layout;
+  guint shaped_serial;
 };
 
 enum
@@ -116,10 +120,38 @@ gtk_inscription_finalize (GObject *object)
   GtkInscription *self = GTK_INSCRIPTION (object);
 
   g_clear_object (&self->layout);
+  g_clear_object (&self->shaped_layout);
 
   G_OBJECT_CLASS (gtk_inscription_parent_class)->finalize (object);
 }
 
+/*
+ * gtk_inscription_get_shaped_layout:
+ * @self: a `GtkInscription`
+ *
+ * All settings are done on self->layout, but it is never laid out.
+ * Instead, this function looks up a laid out layout with the same
+ * settings in the layout cache, so that inscriptions in recycled
+ * list rows don't need to shape the same text over and over.
+ *
+ * Returns: (transfer none): the layout to measure and draw. It
+ *   must not be modified.
+ */
+static PangoLayout *
+gtk_inscription_get_shaped_layout (GtkInscription *self)
+{
+  guint serial = pango_layout_get_serial (self->layout);
+
+  if (self->shaped_layout == NULL || self->shaped_serial != serial)
+    {
+      g_clear_object (&self->shaped_layout);
+      self->shaped_layout = gtk_pango_layout_cache_lookup (self->layout);
+      self->shaped_serial = serial;
+    }
+
+  return self->shaped_layout;
+}
+
 static void
 gtk_inscription_get_property (GObject    *object,
                               guint       property_id,
@@ -414,6 +446,7 @@ gtk_inscription_get_layout_location (GtkInscription *self,
   GtkWidget *widget = GTK_WIDGET (self);
   const int widget_width = gtk_widget_get_width (widget);
   const int widget_height = gtk_widget_get_height (widget);
+  PangoLayout *layout = gtk_inscription_get_shaped_layout (self);
   PangoRectangle logical;
   float xalign;
   int baseline;
@@ -426,8 +459,8 @@ gtk_inscription_get_layout_location (GtkInscription *self,
   if (_gtk_widget_get_direction (widget) != GTK_TEXT_DIR_LTR)
     xalign = 1.0 - xalign;
 
-  pango_layout_get_pixel_extents (self->layout, NULL, &logical);
-  if (pango_layout_get_width (self->layout) > 0)
+  pango_layout_get_pixel_extents (layout, NULL, &logical);
+  if (pango_layout_get_width (layout) > 0)
     x = 0.f;
   else
     x = floor ((xalign * (widget_width - logical.width)) - logical.x);
@@ -435,11 +468,11 @@ gtk_inscription_get_layout_location (GtkInscription *self,
   baseline = gtk_widget_get_baseline (widget);
   if (baseline != -1)
     {
-      int layout_baseline = pango_layout_get_baseline (self->layout) / PANGO_SCALE;
+      int layout_baseline = pango_layout_get_baseline (layout) / PANGO_SCALE;
       /* yalign is 0 because we can't support yalign while baseline aligning */
       y = baseline - layout_baseline;
     }
-  else if (pango_layout_is_ellipsized (self->layout))
+  else if (pango_layout_is_ellipsized (layout))
     {
       y = 0.f;
     }
@@ -473,7 +506,7 @@ gtk_inscription_allocate (GtkWidget *widget,
        * If we can't fit 2 rows, we're single line.
        */
       {
-        PangoLayoutIter *iter = pango_layout_get_iter (self->layout);
+        PangoLayoutIter *iter = pango_layout_get_iter (gtk_inscription_get_shaped_layout (self));
         if (pango_layout_iter_next_line (iter))
           {
             PangoRectangle rect;
@@ -521,7 +554,7 @@ gtk_inscription_snapshot (GtkWidget   *widget,
   gtk_inscription_get_layout_location (self, &lx, &ly);
 
   gtk_css_boxes_init (&boxes, widget);
-  gtk_css_style_snapshot_layout (&boxes, snapshot, lx, ly, self->layout);
+  gtk_css_style_snapshot_layout (&boxes, snapshot, lx, ly, gtk_inscription_get_shaped_layout (self));
 
   gtk_snapshot_pop (snapshot);
 }
@@ -751,11 +784,15 @@ gtk_inscription_init (GtkInscription *self)
   update_pango_alignment (self);
 }
 
-/* for a11y */
+/* for a11y
+ *
+ * This is the shaped layout from the layout cache, which is shared
+ * with other inscriptions. Callers must only read from it.
+ */
 PangoLayout *
 gtk_inscription_get_layout (GtkInscription *self)
 {
-  return self->layout;
+  return gtk_inscription_get_shaped_layout (self);
 }
 
 /**
@@ -26,6 +26,7 @@
 #include "gtkpangoprivate.h"
 #include <pango/pangocairo.h>
 #include "gtkbuilderprivate.h"
+#include "gtkprivate.h"
 
 static gboolean
 attr_list_merge_filter (PangoAttribute *attribute,
@@ -504,3 +505,310 @@ pango_align_to_string (PangoAlignment align)
       g_assert_not_reached ();
     }
 }
+
+/* A cache of laid out layouts, so that widgets showing the same
+ * text with the same settings, like recycled rows in a list, can
+ * share the shaping work.
+ *
+ * The layouts in the cache are shared and must not be modified.
+ */
+
+#define LAYOUT_CACHE_MAX_ENTRIES 256
+
+/* The memory of a layout is estimated from its text: per character,
+ * the text, a glyph with its cluster and the log attrs, plus a fixed
+ * amount for the layout, its context and lines.
+ */
+#define LAYOUT_CACHE_MAX_BYTES (1024 * 1024)
+#define LAYOUT_CACHE_BYTES_PER_CHAR 32
+#define LAYOUT_CACHE_BYTES_PER_LAYOUT 1024
+
+/* Longer texts are rarely repeated, and their lines and glyphs
+ * would take up most of the memory of the cache */
+#define LAYOUT_CACHE_MAX_TEXT_LENGTH 1024
+
+typedef struct _LayoutCacheEntry LayoutCacheEntry;
+
+struct _LayoutCacheEntry
+{
+  PangoLayout *layout;
+  guint hash;
+  gsize bytes;
+  GList link;
+};
+
+static GHashTable *layout_cache;
+static GQueue layout_cache_lru = G_QUEUE_INIT;
+static gsize layout_cache_bytes;
+static guint layout_cache_hits;
+static guint layout_cache_misses;
+
+static guint
+layout_hash (PangoLayout *layout)
+{
+  const PangoFontDescription *desc;
+  guint hash;
+
+  hash = g_str_hash (pango_layout_get_text (layout));
+  hash = hash * 31 + pango_layout_get_width (layout);
+  hash = hash * 31 + pango_layout_get_height (layout);
+  hash = hash * 31 + pango_layout_get_ellipsize (layout);
+  hash = hash * 31 + pango_layout_get_wrap (layout);
+
+  desc = pango_layout_get_font_description (layout);
+  if (desc)
+    hash ^= pango_font_description_hash (desc);
+
+  desc = pango_context_get_font_description (pango_layout_get_context (layout));
+  if (desc)
+    hash ^= pango_font_description_hash (desc);
+
+  return hash;
+}
+
+static gboolean
+font_description_equal (const PangoFontDescription *a,
+                        const PangoFontDescription *b)
+{
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  return pango_font_description_equal (a, b);
+}
+
+static gboolean
+matrix_equal (const PangoMatrix *a,
+              const PangoMatrix *b)
+{
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  return a->xx == b->xx && a->xy == b->xy &&
+         a->yx == b->yx && a->yy == b->yy &&
+         a->x0 == b->x0 && a->y0 == b->y0;
+}
+
+static gboolean
+font_options_equal (const cairo_font_options_t *a,
+                    const cairo_font_options_t *b)
+{
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  return cairo_font_options_equal (a, b);
+}
+
+/* Checks all the context settings that affect the layout */
+static gboolean
+context_equal (PangoContext *a,
+               PangoContext *b)
+{
+  if (a == b)
+    return TRUE;
+
+  return pango_context_get_font_map (a) == pango_context_get_font_map (b) &&
+         pango_context_get_language (a) == pango_context_get_language (b) &&
+         pango_context_get_base_dir (a) == pango_context_get_base_dir (b) &&
+         pango_context_get_base_gravity (a) == pango_context_get_base_gravity (b) &&
+         pango_context_get_gravity_hint (a) == pango_context_get_gravity_hint (b) &&
+         pango_context_get_round_glyph_positions (a) == pango_context_get_round_glyph_positions (b) &&
+         pango_cairo_context_get_resolution (a) == pango_cairo_context_get_resolution (b) &&
+         matrix_equal (pango_context_get_matrix (a), pango_context_get_matrix (b)) &&
+         font_options_equal (pango_cairo_context_get_font_options (a), pango_cairo_context_get_font_options (b)) &&
+         font_description_equal (pango_context_get_font_description (a), pango_context_get_font_description (b));
+}
+
+static gboolean
+attr_list_equal (PangoAttrList *a,
+                 PangoAttrList *b)
+{
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  return pango_attr_list_equal (a, b);
+}
+
+static gboolean
+layout_equal (PangoLayout *a,
+              PangoLayout *b)
+{
+  return strcmp (pango_layout_get_text (a), pango_layout_get_text (b)) == 0 &&
+         pango_layout_get_width (a) == pango_layout_get_width (b) &&
+         pango_layout_get_height (a) == pango_layout_get_height (b) &&
+         pango_layout_get_wrap (a) == pango_layout_get_wrap (b) &&
+         pango_layout_get_ellipsize (a) == pango_layout_get_ellipsize (b) &&
+         pango_layout_get_alignment (a) == pango_layout_get_alignment (b) &&
+         pango_layout_get_justify (a) == pango_layout_get_justify (b) &&
+         pango_layout_get_justify_last_line (a) == pango_layout_get_justify_last_line (b) &&
+         pango_layout_get_indent (a) == pango_layout_get_indent (b) &&
+         pango_layout_get_spacing (a) == pango_layout_get_spacing (b) &&
+         pango_layout_get_line_spacing (a) == pango_layout_get_line_spacing (b) &&
+         pango_layout_get_single_paragraph_mode (a) == pango_layout_get_single_paragraph_mode (b) &&
+         pango_layout_get_auto_dir (a) == pango_layout_get_auto_dir (b) &&
+         font_description_equal (pango_layout_get_font_description (a), pango_layout_get_font_description (b)) &&
+         attr_list_equal (pango_layout_get_attributes (a), pango_layout_get_attributes (b)) &&
+         context_equal (pango_layout_get_context (a), pango_layout_get_context (b));
+}
+
+/* Copies everything that layout_equal() compares. The copy gets
+ * its own context, so that changes to the context of @layout
+ * don't affect it.
+ */
+static PangoLayout *
+layout_copy_for_cache (PangoLayout *layout)
+{
+  PangoContext *context, *copy_context;
+  PangoAttrList *attrs;
+  PangoLayout *copy;
+
+  context = pango_layout_get_context (layout);
+  copy_context = pango_font_map_create_context (pango_context_get_font_map (context));
+  pango_context_set_language (copy_context, pango_context_get_language (context));
+  pango_context_set_base_dir (copy_context, pango_context_get_base_dir (context));
+  pango_context_set_base_gravity (copy_context, pango_context_get_base_gravity (context));
+  pango_context_set_gravity_hint (copy_context, pango_context_get_gravity_hint (context));
+  pango_context_set_round_glyph_positions (copy_context, pango_context_get_round_glyph_positions (context));
+  pango_context_set_matrix (copy_context, pango_context_get_matrix (context));
+  pango_context_set_font_description (copy_context, pango_context_get_font_description (context));
+  pango_cairo_context_set_resolution (copy_context, pango_cairo_context_get_resolution (context));
+  pango_cairo_context_set_font_options (copy_context, pango_cairo_context_get_font_options (context));
+
+  copy = pango_layout_new (copy_context);
+  g_object_unref (copy_context);
+
+  pango_layout_set_text (copy, pango_layout_get_text (layout), -1);
+  attrs = pango_layout_get_attributes (layout);
+  if (attrs)
+    {
+      /* Attribute lists can be modified, so don't share them */
+      attrs = pango_attr_list_copy (attrs);
+      pango_layout_set_attributes (copy, attrs);
+      pango_attr_list_unref (attrs);
+    }
+  pango_layout_set_font_description (copy, pango_layout_get_font_description (layout));
+  pango_layout_set_width (copy, pango_layout_get_width (layout));
+  pango_layout_set_height (copy, pango_layout_get_height (layout));
+  pango_layout_set_wrap (copy, pango_layout_get_wrap (layout));
+  pango_layout_set_ellipsize (copy, pango_layout_get_ellipsize (layout));
+  pango_layout_set_alignment (copy, pango_layout_get_alignment (layout));
+  pango_layout_set_justify (copy, pango_layout_get_justify (layout));
+  pango_layout_set_justify_last_line (copy, pango_layout_get_justify_last_line (layout));
+  pango_layout_set_indent (copy, pango_layout_get_indent (layout));
+  pango_layout_set_spacing (copy, pango_layout_get_spacing (layout));
+  pango_layout_set_line_spacing (copy, pango_layout_get_line_spacing (layout));
+  pango_layout_set_single_paragraph_mode (copy, pango_layout_get_single_paragraph_mode (layout));
+  pango_layout_set_auto_dir (copy, pango_layout_get_auto_dir (layout));
+
+  return copy;
+}
+
+static guint
+layout_cache_entry_hash (gconstpointer data)
+{
+  const LayoutCacheEntry *entry = data;
+
+  return entry->hash;
+}
+
+static gboolean
+layout_cache_entry_equal (gconstpointer data1,
+                          gconstpointer data2)
+{
+  const LayoutCacheEntry *entry1 = data1;
+  const LayoutCacheEntry *entry2 = data2;
+
+  return entry1->hash == entry2->hash &&
+         layout_equal (entry1->layout, entry2->layout);
+}
+
+static void
+layout_cache_entry_free (gpointer data)
+{
+  LayoutCacheEntry *entry = data;
+
+  g_object_unref (entry->layout);
+  g_free (entry);
+}
+
+static void
+layout_cache_print_stats (void)
+{
+  guint lookups = layout_cache_hits + layout_cache_misses;
+
+  gdk_debug_message ("Layout cache: %u entries, %zu bytes, %u lookups, %.1f%% hits",
+                     g_hash_table_size (layout_cache),
+                     layout_cache_bytes,
+                     lookups,
+                     100.0 * layout_cache_hits / MAX (lookups, 1));
+}
+
+/*
+ * gtk_pango_layout_cache_lookup:
+ * @layout: a layout with the text and settings to use
+ *
+ * Looks for a laid out layout that is equal to @layout in
+ * the cache, and adds a copy of @layout if there is none.
+ *
+ * The returned layout is shared with other users of the
+ * cache and must not be modified. Layouts with tabs or long
+ * texts are not cached, for those a reference to @layout is
+ * returned.
+ *
+ * Returns: (transfer full): a layout equal to @layout
+ */
+PangoLayout *
+gtk_pango_layout_cache_lookup (PangoLayout *layout)
+{
+  LayoutCacheEntry lookup, *entry;
+  gsize text_length;
+
+  text_length = strlen (pango_layout_get_text (layout));
+  if (pango_layout_get_tabs (layout) != NULL ||
+      text_length > LAYOUT_CACHE_MAX_TEXT_LENGTH)
+    return g_object_ref (layout);
+
+  if (layout_cache == NULL)
+    layout_cache = g_hash_table_new_full (layout_cache_entry_hash,
+                                          layout_cache_entry_equal,
+                                          layout_cache_entry_free,
+                                          NULL);
+
+  lookup.layout = layout;
+  lookup.hash = layout_hash (layout);
+
+  entry = g_hash_table_lookup (layout_cache, &lookup);
+  if (entry)
+    {
+      layout_cache_hits++;
+      g_queue_unlink (&layout_cache_lru, &entry->link);
+      g_queue_push_head_link (&layout_cache_lru, &entry->link);
+      return g_object_ref (entry->layout);
+    }
+
+  layout_cache_misses++;
+  if (GTK_DEBUG_CHECK (TEXT) && layout_cache_misses % 1000 == 0)
+    layout_cache_print_stats ();
+
+  entry = g_new (LayoutCacheEntry, 1);
+  entry->layout = layout_copy_for_cache (layout);
+  entry->hash = lookup.hash;
+  entry->bytes = LAYOUT_CACHE_BYTES_PER_LAYOUT + text_length * LAYOUT_CACHE_BYTES_PER_CHAR;
+  entry->link.data = entry;
+
+  g_hash_table_add (layout_cache, entry);
+  g_queue_push_head_link (&layout_cache_lru, &entry->link);
+  layout_cache_bytes += entry->bytes;
+
+  while (layout_cache_lru.length > LAYOUT_CACHE_MAX_ENTRIES ||
+         layout_cache_bytes > LAYOUT_CACHE_MAX_BYTES)
+    {
+      LayoutCacheEntry *last = g_queue_peek_tail (&layout_cache_lru);
+
+      g_queue_unlink (&layout_cache_lru, &last->link);
+      layout_cache_bytes -= last->bytes;
+      g_hash_table_remove (layout_cache, last);
+    }
+
+  return g_object_ref (entry->layout);
+}
+
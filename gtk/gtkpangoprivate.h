@@ -60,5 +60,7 @@ const char *pango_style_to_string (PangoStyle style);
 const char *pango_variant_to_string (PangoVariant variant);
 const char *pango_align_to_string (PangoAlignment align);
 
+PangoLayout *gtk_pango_layout_cache_lookup (PangoLayout *layout);
+
 G_END_DECLS
 
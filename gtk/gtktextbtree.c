@@ -1073,6 +1073,28 @@ _gtk_text_btree_delete (GtkTextIter *start,
   gtk_text_btree_resolve_bidi (start, end);
 }
 
+/* Returns how many bytes of @text go into the next character
+ * segment, without splitting characters or CRLF pairs.
+ */
+static int
+char_segment_piece_length (const char *text,
+                           int         len)
+{
+  const char *p;
+
+  if (len <= GTK_TEXT_CHAR_SEGMENT_MAX_BYTES)
+    return len;
+
+  p = text + GTK_TEXT_CHAR_SEGMENT_MAX_BYTES;
+  while ((*p & 0xc0) == 0x80)
+    p--;
+
+  if (*p == '\n' && p[-1] == '\r')
+    p--;
+
+  return p - text;
+}
+
 void
 _gtk_text_btree_insert (GtkTextIter *iter,
                         const char *text,
@@ -1090,6 +1112,8 @@ _gtk_text_btree_insert (GtkTextIter *iter,
   GtkTextLineSegment *seg;
   GtkTextLine *newline;
   int chunk_len;                        /* # characters in current chunk. */
+  int piece;                            /* start of the current segment */
+  int piece_len;                        /* # bytes in the current segment */
   int sol;                           /* start of line */
   int eol;                           /* Pointer to character just after last
                                        * one in current chunk.
@@ -1161,20 +1185,33 @@ _gtk_text_btree_insert (GtkTextIter *iter,
       chunk_len = eol - sol;
 
       g_assert (g_utf8_validate (&text[sol], chunk_len, NULL));
-      seg = _gtk_char_segment_new (&text[sol], chunk_len);
 
-      char_count_delta += seg->char_count;
-
-      if (cur_seg == NULL)
-        {
-          seg->next = line->segments;
-          line->segments = seg;
-        }
-      else
+      /* Long lines are stored in several segments, so that
+       * inserting into them later copies a bounded amount of text.
+       */
+      piece = sol;
+      do
         {
-          seg->next = cur_seg->next;
-          cur_seg->next = seg;
+          piece_len = char_segment_piece_length (&text[piece], eol - piece);
+          seg = _gtk_char_segment_new (&text[piece], piece_len);
+          piece += piece_len;
+
+          char_count_delta += seg->char_count;
+
+          if (cur_seg == NULL)
+            {
+              seg->next = line->segments;
+              line->segments = seg;
+            }
+          else
+            {
+              seg->next = cur_seg->next;
+              cur_seg->next = seg;
+            }
+
+          cur_seg = seg;
         }
+      while (piece < eol);
 
       if (delim == eol)
         {
@@ -1180,6 +1180,305 @@ gtk_text_buffer_set_text (GtkTextBuffer *buffer,
   gtk_text_history_end_irreversible_action (buffer->priv->history);
 }
 
+#define LOAD_CHUNK_SIZE (64 * 1024)
+
+/* How much validated text may wait to be inserted before
+ * reading pauses until the buffer has caught up
+ */
+#define LOAD_MAX_PENDING_SIZE (4 * LOAD_CHUNK_SIZE)
+
+typedef struct
+{
+  GInputStream *stream;
+
+  /* a character that was split across reads is carried over
+   * to the start of the read buffer */
+  char *read_buffer;
+  gsize carry;
+
+  GString *pending;     /* validated text, not inserted yet */
+  gboolean reading;     /* a read is in progress */
+  gboolean idle_queued;
+
+  gboolean reading_done;
+  GError *error;
+  gboolean started;
+} LoadStream;
+
+static void
+load_stream_free (gpointer data)
+{
+  LoadStream *load = data;
+
+  g_object_unref (load->stream);
+  g_free (load->read_buffer);
+  g_string_free (load->pending, TRUE);
+  g_clear_error (&load->error);
+
+  g_free (load);
+}
+
+static void gtk_text_buffer_load_stream_read (GTask *task);
+
+static void
+gtk_text_buffer_load_stream_maybe_finish (GTask *task)
+{
+  GtkTextBuffer *buffer = g_task_get_source_object (task);
+  LoadStream *load = g_task_get_task_data (task);
+
+  if (!load->reading_done || load->idle_queued || load->pending->len > 0)
+    return;
+
+  if (load->error == NULL && !load->started)
+    {
+      /* An empty stream */
+      gtk_text_buffer_set_text (buffer, "", 0);
+    }
+  else if (load->started)
+    {
+      gtk_text_history_end_irreversible_action (buffer->priv->history);
+    }
+
+  if (load->error)
+    g_task_return_error (task, g_steal_pointer (&load->error));
+  else
+    g_task_return_boolean (task, TRUE);
+}
+
+/* Inserts all the text that was read since the last time
+ * with a single insertion.
+ */
+static gboolean
+gtk_text_buffer_load_stream_idle (gpointer data)
+{
+  GTask *task = data;
+  GtkTextBuffer *buffer = g_task_get_source_object (task);
+  LoadStream *load = g_task_get_task_data (task);
+  GtkTextIter start, end;
+
+  load->idle_queued = FALSE;
+
+  if (g_cancellable_is_cancelled (g_task_get_cancellable (task)))
+    {
+      /* A read in progress fails as well and finishes the load,
+       * otherwise reading is paused and it needs to be done here.
+       */
+      g_string_truncate (load->pending, 0);
+      if (!load->reading && !load->reading_done)
+        {
+          load->reading_done = TRUE;
+          if (load->error == NULL)
+            g_cancellable_set_error_if_cancelled (g_task_get_cancellable (task), &load->error);
+        }
+
+      gtk_text_buffer_load_stream_maybe_finish (task);
+      return G_SOURCE_REMOVE;
+    }
+
+  if (load->pending->len > 0)
+    {
+      /* Only clear the buffer once there is text to replace it with,
+       * so errors at the start of the stream leave it alone.
+       */
+      if (!load->started)
+        {
+          gtk_text_history_begin_irreversible_action (buffer->priv->history);
+          gtk_text_buffer_get_bounds (buffer, &start, &end);
+          gtk_text_buffer_delete (buffer, &start, &end);
+          load->started = TRUE;
+        }
+
+      gtk_text_buffer_get_end_iter (buffer, &end);
+      gtk_text_buffer_insert (buffer, &end, load->pending->str, load->pending->len);
+      g_string_truncate (load->pending, 0);
+    }
+
+  if (!load->reading && !load->reading_done)
+    gtk_text_buffer_load_stream_read (task);
+
+  gtk_text_buffer_load_stream_maybe_finish (task);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gtk_text_buffer_load_stream_queue_idle (GTask *task)
+{
+  LoadStream *load = g_task_get_task_data (task);
+  GSource *source;
+
+  if (load->idle_queued)
+    return;
+
+  source = g_idle_source_new ();
+  g_source_set_callback (source, gtk_text_buffer_load_stream_idle, g_object_ref (task), g_object_unref);
+  g_source_set_static_name (source, "[gtk] gtk_text_buffer_load_stream_idle");
+  g_source_attach (source, g_task_get_context (task));
+  g_source_unref (source);
+  load->idle_queued = TRUE;
+}
+
+static gboolean
+load_stream_validate (LoadStream  *load,
+                      gsize        len,
+                      GError     **error)
+{
+  const char *end;
+  gsize remaining;
+
+  if (!g_utf8_validate (load->read_buffer, len, &end))
+    {
+      remaining = len - (end - load->read_buffer);
+
+      /* Only an incomplete character at the end of a read
+       * may be completed by the next one.
+       */
+      if (g_utf8_get_char_validated (end, remaining) != (gunichar) -2)
+        {
+          g_set_error_literal (error,
+                               G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                               "Invalid UTF-8 data in stream");
+          return FALSE;
+        }
+    }
+
+  g_string_append_len (load->pending, load->read_buffer, end - load->read_buffer);
+  load->carry = len - (end - load->read_buffer);
+  memmove (load->read_buffer, end, load->carry);
+
+  return TRUE;
+}
+
+static void
+gtk_text_buffer_load_stream_read_done (GObject      *source,
+                                       GAsyncResult *result,
+                                       gpointer      data)
+{
+  GTask *task = data;
+  LoadStream *load = g_task_get_task_data (task);
+  gssize n_read;
+
+  load->reading = FALSE;
+
+  n_read = g_input_stream_read_finish (G_INPUT_STREAM (source), result, &load->error);
+  if (n_read <= 0 ||
+      !load_stream_validate (load, load->carry + n_read, &load->error))
+    load->reading_done = TRUE;
+
+  /* At the end, anything that was carried over is invalid */
+  if (n_read == 0 && load->carry > 0)
+    g_set_error_literal (&load->error,
+                         G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                         "Invalid UTF-8 data in stream");
+
+  if (load->pending->len > 0)
+    gtk_text_buffer_load_stream_queue_idle (task);
+
+  /* Keep reading until enough text is waiting for the idle */
+  if (!load->reading_done && load->pending->len < LOAD_MAX_PENDING_SIZE)
+    gtk_text_buffer_load_stream_read (task);
+
+  gtk_text_buffer_load_stream_maybe_finish (task);
+  g_object_unref (task);
+}
+
+static void
+gtk_text_buffer_load_stream_read (GTask *task)
+{
+  LoadStream *load = g_task_get_task_data (task);
+
+  load->reading = TRUE;
+  g_input_stream_read_async (load->stream,
+                             load->read_buffer + load->carry,
+                             LOAD_CHUNK_SIZE,
+                             g_task_get_priority (task),
+                             g_task_get_cancellable (task),
+                             gtk_text_buffer_load_stream_read_done,
+                             g_object_ref (task));
+}
+
+/**
+ * gtk_text_buffer_load_stream_async:
+ * @buffer: a `GtkTextBuffer`
+ * @stream: a `GInputStream` to read UTF-8 text from
+ * @io_priority: the I/O priority of the request
+ * @cancellable: (nullable): optional `GCancellable` object
+ * @callback: (scope async): callback to call when the buffer has been loaded
+ * @user_data: (closure): data to pass to @callback
+ *
+ * Replaces the contents of @buffer with the text read from @stream.
+ *
+ * The stream is read asynchronously in chunks, and the text is
+ * appended to the buffer from idle callbacks, so the main loop keeps
+ * running while large files are loaded, and only a few chunks are
+ * kept in memory in addition to the buffer. All the text that was
+ * read since the previous idle callback is appended with a single
+ * insertion, emitting [signal@Gtk.TextBuffer::insert-text]. The
+ * whole load is one irreversible action in the undo stack.
+ *
+ * The previous contents are removed when the first text is
+ * inserted. If @stream does not contain valid UTF-8 or reading
+ * fails, %G_IO_ERROR_INVALID_DATA or the read error is returned.
+ * In that case the buffer keeps the text that was read before
+ * the failing read, or its previous contents if the error happened
+ * in the first one.
+ *
+ * Since: 4.14
+ */
+void
+gtk_text_buffer_load_stream_async (GtkTextBuffer       *buffer,
+                                   GInputStream        *stream,
+                                   int                  io_priority,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             user_data)
+{
+  GTask *task;
+  LoadStream *load;
+
+  g_return_if_fail (GTK_IS_TEXT_BUFFER (buffer));
+  g_return_if_fail (G_IS_INPUT_STREAM (stream));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  load = g_new0 (LoadStream, 1);
+  load->stream = g_object_ref (stream);
+  /* room for a chunk after an incomplete character */
+  load->read_buffer = g_malloc (LOAD_CHUNK_SIZE + 4);
+  load->pending = g_string_new (NULL);
+
+  task = g_task_new (buffer, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gtk_text_buffer_load_stream_async);
+  g_task_set_priority (task, io_priority);
+  g_task_set_task_data (task, load, load_stream_free);
+
+  gtk_text_buffer_load_stream_read (task);
+  g_object_unref (task);
+}
+
+/**
+ * gtk_text_buffer_load_stream_finish:
+ * @buffer: a `GtkTextBuffer`
+ * @result: a `GAsyncResult`
+ * @error: return location for an error
+ *
+ * Finishes an operation started with [method@Gtk.TextBuffer.load_stream_async].
+ *
+ * Returns: %TRUE if the buffer was loaded
+ *
+ * Since: 4.14
+ */
+gboolean
+gtk_text_buffer_load_stream_finish (GtkTextBuffer  *buffer,
+                                    GAsyncResult   *result,
+                                    GError        **error)
+{
+  g_return_val_if_fail (GTK_IS_TEXT_BUFFER (buffer), FALSE);
+  g_return_val_if_fail (g_task_is_valid (result, buffer), FALSE);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == gtk_text_buffer_load_stream_async, FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
 /*
  * Insertion
  */
@@ -3001,6 +3300,141 @@ gtk_text_buffer_apply_tag (GtkTextBuffer     *buffer,
   gtk_text_buffer_emit_tag (buffer, tag, TRUE, start, end);
 }
 
+static gboolean
+tag_state_matches (GtkTextTag        *tag,
+                   gboolean           on,
+                   const GtkTextIter *start,
+                   const GtkTextIter *end)
+{
+  GtkTextIter iter;
+
+  if (gtk_text_iter_has_tag (start, tag) != on)
+    return FALSE;
+
+  /* This uses the per-node toggle counts in the btree, so it
+   * is cheap even for large ranges.
+   */
+  iter = *start;
+  if (!gtk_text_iter_forward_to_tag_toggle (&iter, tag))
+    return TRUE;
+
+  return gtk_text_iter_compare (&iter, end) >= 0;
+}
+
+static void
+gtk_text_buffer_set_tag_state (GtkTextBuffer     *buffer,
+                               GtkTextTag        *tag,
+                               gboolean           on,
+                               const GtkTextIter *start,
+                               const GtkTextIter *end)
+{
+  if (gtk_text_iter_equal (start, end))
+    return;
+
+  if (tag_state_matches (tag, on, start, end))
+    return;
+
+  gtk_text_buffer_emit_tag (buffer, tag, on, start, end);
+}
+
+static gboolean
+tag_runs_are_valid (const int *offsets,
+                    gsize      n_offsets)
+{
+  int pos_offset = 0;
+  gsize i;
+
+  for (i = 0; i < n_offsets; i += 2)
+    {
+      if (offsets[i] < pos_offset || offsets[i + 1] < offsets[i])
+        return FALSE;
+
+      pos_offset = offsets[i + 1];
+    }
+
+  return TRUE;
+}
+
+/**
+ * gtk_text_buffer_apply_tag_runs:
+ * @buffer: a `GtkTextBuffer`
+ * @tag: a `GtkTextTag`
+ * @start: start of the range to retag
+ * @end: end of the range to retag
+ * @offsets: (array length=n_offsets): pairs of start and end character
+ *   offsets relative to @start, sorted and not overlapping
+ * @n_offsets: the number of elements in @offsets, twice the number of runs
+ *
+ * Makes @tag apply to exactly the given runs between @start and @end.
+ *
+ * This is meant for syntax highlighters that recompute the runs of a
+ * tag for a region after every change. It is equivalent to removing
+ * @tag from the range and applying it to each run, but only emits
+ * [signal@Gtk.TextBuffer::apply-tag] and [signal@Gtk.TextBuffer::remove-tag]
+ * for the parts of the range where the tag actually changes, so
+ * runs that were already tagged are neither retagged nor redrawn.
+ *
+ * Since: 4.14
+ */
+void
+gtk_text_buffer_apply_tag_runs (GtkTextBuffer     *buffer,
+                                GtkTextTag        *tag,
+                                const GtkTextIter *start,
+                                const GtkTextIter *end,
+                                const int         *offsets,
+                                gsize              n_offsets)
+{
+  GtkTextIter range_start, range_end;
+  GtkTextIter pos, run_start, run_end;
+  int pos_offset;
+  gsize i;
+
+  g_return_if_fail (GTK_IS_TEXT_BUFFER (buffer));
+  g_return_if_fail (GTK_IS_TEXT_TAG (tag));
+  g_return_if_fail (start != NULL);
+  g_return_if_fail (end != NULL);
+  g_return_if_fail (gtk_text_iter_get_buffer (start) == buffer);
+  g_return_if_fail (gtk_text_iter_get_buffer (end) == buffer);
+  g_return_if_fail (tag->priv->table == buffer->priv->tag_table);
+  g_return_if_fail (offsets != NULL || n_offsets == 0);
+  g_return_if_fail (n_offsets % 2 == 0);
+  /* Check all runs before changing anything, so that bad
+   * input doesn't leave the range partially retagged.
+   */
+  g_return_if_fail (tag_runs_are_valid (offsets, n_offsets));
+
+  range_start = *start;
+  range_end = *end;
+  gtk_text_iter_order (&range_start, &range_end);
+
+  /* Tagging does not invalidate iters, so we can walk forward
+   * from run to run instead of looking up each offset.
+   */
+  pos = range_start;
+  pos_offset = 0;
+
+  for (i = 0; i < n_offsets; i += 2)
+    {
+      run_start = pos;
+      gtk_text_iter_forward_chars (&run_start, offsets[i] - pos_offset);
+      if (gtk_text_iter_compare (&run_start, &range_end) > 0)
+        run_start = range_end;
+
+      run_end = run_start;
+      gtk_text_iter_forward_chars (&run_end, offsets[i + 1] - offsets[i]);
+      if (gtk_text_iter_compare (&run_end, &range_end) > 0)
+        run_end = range_end;
+
+      gtk_text_buffer_set_tag_state (buffer, tag, FALSE, &pos, &run_start);
+      gtk_text_buffer_set_tag_state (buffer, tag, TRUE, &run_start, &run_end);
+
+      pos = run_end;
+      pos_offset = offsets[i + 1];
+    }
+
+  gtk_text_buffer_set_tag_state (buffer, tag, FALSE, &pos, &range_end);
+}
+
 /**
  * gtk_text_buffer_remove_tag:
  * @buffer: a `GtkTextBuffer`
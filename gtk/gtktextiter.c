@@ -4761,6 +4761,202 @@ utf8_caselessnmatch (const char *s1,
   return ret;
 }
 
+static gboolean
+is_ascii (const char *str,
+          gsize       len)
+{
+  gsize i;
+
+  for (i = 0; i < len; i++)
+    {
+      if ((guchar) str[i] >= 0x80)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Finds @needle in the first @haystack_len bytes of @haystack,
+ * using memchr() (which libc vectorizes) to skip to candidates.
+ */
+static const char *
+find_bytes (const char *haystack,
+            gsize       haystack_len,
+            const char *needle,
+            gsize       needle_len)
+{
+  const char *p, *end;
+
+  if (needle_len == 0)
+    return haystack;
+
+  p = haystack;
+  end = haystack + haystack_len;
+
+  while ((gsize) (end - p) >= needle_len)
+    {
+      p = memchr (p, needle[0], (end - p) - needle_len + 1);
+      if (p == NULL)
+        return NULL;
+
+      if (memcmp (p + 1, needle + 1, needle_len - 1) == 0)
+        return p;
+
+      p++;
+    }
+
+  return NULL;
+}
+
+/* Like find_bytes(), but ignoring ASCII case. @needle must be
+ * casefolded already.
+ */
+static const char *
+find_bytes_ascii_caseless (const char *haystack,
+                           gsize       haystack_len,
+                           const char *needle,
+                           gsize       needle_len)
+{
+  gsize i;
+
+  if (needle_len == 0)
+    return haystack;
+
+  for (i = 0; i + needle_len <= haystack_len; i++)
+    {
+      if (g_ascii_tolower (haystack[i]) == needle[0] &&
+          g_ascii_strncasecmp (haystack + i + 1, needle + 1, needle_len - 1) == 0)
+        return haystack + i;
+    }
+
+  return NULL;
+}
+
+/* Like find_bytes(), but finds the last occurrence of @needle */
+static const char *
+find_last_bytes (const char *haystack,
+                 gsize       haystack_len,
+                 const char *needle,
+                 gsize       needle_len)
+{
+  gsize i;
+
+  if (needle_len == 0)
+    return haystack + haystack_len;
+
+  if (needle_len > haystack_len)
+    return NULL;
+
+  for (i = haystack_len - needle_len + 1; i > 0; i--)
+    {
+      if (haystack[i - 1] == needle[0] &&
+          memcmp (haystack + i, needle + 1, needle_len - 1) == 0)
+        return haystack + i - 1;
+    }
+
+  return NULL;
+}
+
+/* Like find_bytes_ascii_caseless(), but finds the last occurrence */
+static const char *
+find_last_bytes_ascii_caseless (const char *haystack,
+                                gsize       haystack_len,
+                                const char *needle,
+                                gsize       needle_len)
+{
+  gsize i;
+
+  if (needle_len == 0)
+    return haystack + haystack_len;
+
+  if (needle_len > haystack_len)
+    return NULL;
+
+  for (i = haystack_len - needle_len + 1; i > 0; i--)
+    {
+      if (g_ascii_tolower (haystack[i - 1]) == needle[0] &&
+          g_ascii_strncasecmp (haystack + i, needle + 1, needle_len - 1) == 0)
+        return haystack + i - 1;
+    }
+
+  return NULL;
+}
+
+/* Fast path for the first line of lines_match(): if everything
+ * between @start and @line_end is a single character segment, we can
+ * search the segment text in place instead of copying the line and
+ * then walking to the match one character at a time.
+ *
+ * Returns FALSE if the fast path does not apply, otherwise sets
+ * @found and, if a match was found, @match_start and @match_end.
+ */
+static gboolean
+first_line_match_contiguous (const GtkTextIter *start,
+                             const GtkTextIter *line_end,
+                             const char        *needle,
+                             gboolean           case_insensitive,
+                             gboolean          *found,
+                             GtkTextIter       *match_start,
+                             GtkTextIter       *match_end)
+{
+  GtkTextRealIter *real;
+  GtkTextLineSegment *seg;
+  const char *text;
+  const char *p;
+  gsize len;
+  gsize needle_len;
+  int start_index;
+
+  real = gtk_text_iter_make_real (start);
+  if (real == NULL || real->segment->type != &gtk_text_char_type)
+    return FALSE;
+
+  /* Zero-length segments such as marks and toggles don't matter */
+  for (seg = real->segment->next; seg != NULL; seg = seg->next)
+    {
+      if (seg->byte_count > 0)
+        return FALSE;
+    }
+
+  ensure_byte_offsets (real);
+
+  text = real->segment->body.chars + real->segment_byte_offset;
+  start_index = real->line_byte_offset;
+
+  /* On the last line, the segment includes a newline that is
+   * not part of the buffer contents.
+   */
+  if (_gtk_text_iter_get_text_line (line_end) == real->line)
+    len = gtk_text_iter_get_line_index (line_end) - start_index;
+  else
+    len = real->segment->byte_count - real->segment_byte_offset;
+
+  needle_len = strlen (needle);
+
+  if (!case_insensitive)
+    p = find_bytes (text, len, needle, needle_len);
+  else if (is_ascii (needle, needle_len) && is_ascii (text, len))
+    p = find_bytes_ascii_caseless (text, len, needle, needle_len);
+  else
+    return FALSE;
+
+  *found = p != NULL;
+
+  if (p != NULL)
+    {
+      *match_start = *start;
+      gtk_text_iter_set_line_index (match_start, start_index + (p - text));
+
+      *match_end = *match_start;
+      if (p + needle_len == text + len)
+        *match_end = *line_end;
+      else
+        gtk_text_iter_set_line_index (match_end, start_index + (p - text) + needle_len);
+    }
+
+  return TRUE;
+}
+
 static gboolean
 lines_match (const GtkTextIter *start,
              const char **lines,
@@ -4794,6 +4990,25 @@ lines_match (const GtkTextIter *start,
       return FALSE;
     }
 
+  if (match_start && !visible_only)
+    {
+      GtkTextIter fast_start, fast_end;
+      gboolean found_fast;
+
+      if (first_line_match_contiguous (start, &next, *lines, case_insensitive,
+                                       &found_fast, &fast_start, &fast_end))
+        {
+          if (!found_fast)
+            return FALSE;
+
+          *match_start = fast_start;
+          if (match_end)
+            *match_end = fast_end;
+
+          return lines_match (&fast_end, lines + 1, visible_only, slice, case_insensitive, NULL, match_end);
+        }
+    }
+
   if (slice)
     {
       if (visible_only)
@@ -4949,6 +5164,57 @@ strbreakup (const char *string,
   return str_array;
 }
 
+static gboolean
+forward_search_lines (const GtkTextIter  *iter,
+                      const char        **lines,
+                      gboolean            visible_only,
+                      gboolean            slice,
+                      gboolean            case_insensitive,
+                      GtkTextIter        *match_start,
+                      GtkTextIter        *match_end,
+                      const GtkTextIter  *limit)
+{
+  GtkTextIter match;
+  GtkTextIter search;
+
+  search = *iter;
+
+  do
+    {
+      /* This loop has an inefficient worst-case, where
+       * gtk_text_iter_get_text() is called repeatedly on
+       * a single line.
+       */
+      GtkTextIter end;
+
+      if (limit &&
+          gtk_text_iter_compare (&search, limit) >= 0)
+        break;
+
+      if (lines_match (&search, lines,
+                       visible_only, slice, case_insensitive, &match, &end))
+        {
+          if (limit == NULL ||
+              (limit &&
+               gtk_text_iter_compare (&end, limit) <= 0))
+            {
+              if (match_start)
+                *match_start = match;
+
+              if (match_end)
+                *match_end = end;
+
+              return TRUE;
+            }
+
+          break;
+        }
+    }
+  while (gtk_text_iter_forward_line (&search));
+
+  return FALSE;
+}
+
 /**
  * gtk_text_iter_forward_search:
  * @iter: start of search
@@ -4982,7 +5248,6 @@ gtk_text_iter_forward_search (const GtkTextIter *iter,
   char **lines = NULL;
   GtkTextIter match;
   gboolean retval = FALSE;
-  GtkTextIter search;
   gboolean visible_only;
   gboolean slice;
   gboolean case_insensitive;
@@ -5023,44 +5288,114 @@ gtk_text_iter_forward_search (const GtkTextIter *iter,
 
   lines = strbreakup (str, "\n", -1, NULL, case_insensitive);
 
+  retval = forward_search_lines (iter, (const char **) lines,
+                                 visible_only, slice, case_insensitive,
+                                 match_start, match_end, limit);
+
+  g_strfreev ((char **)lines);
+
+  return retval;
+}
+
+/**
+ * gtk_text_iter_forward_search_all:
+ * @iter: start of search
+ * @str: a search string
+ * @flags: flags affecting how the search is done
+ * @limit: (nullable): location of last possible match end, or %NULL for the end of the buffer
+ * @match_starts: (out) (optional) (array length=n_matches) (transfer full): return
+ *   location for the starts of the matches
+ * @match_ends: (out) (optional) (array length=n_matches) (transfer full): return
+ *   location for the ends of the matches
+ * @n_matches: (out): return location for the number of matches
+ *
+ * Finds all non-overlapping occurrences of @str after @iter.
+ *
+ * This gives the same results as calling [method@Gtk.TextIter.forward_search]
+ * repeatedly, starting each search at the end of the previous match, but
+ * does all the work in a single pass over the buffer. It is meant for
+ * features like highlighting all matches of a search.
+ *
+ * The arrays are set to %NULL if there are no matches. Free them
+ * with g_free().
+ *
+ * Returns: whether any match was found
+ *
+ * Since: 4.14
+ */
+gboolean
+gtk_text_iter_forward_search_all (const GtkTextIter  *iter,
+                                  const char         *str,
+                                  GtkTextSearchFlags  flags,
+                                  const GtkTextIter  *limit,
+                                  GtkTextIter       **match_starts,
+                                  GtkTextIter       **match_ends,
+                                  guint              *n_matches)
+{
+  char **lines;
+  GArray *starts;
+  GArray *ends;
+  GtkTextIter search;
+  GtkTextIter match_start;
+  GtkTextIter match_end;
+  gboolean visible_only;
+  gboolean slice;
+  gboolean case_insensitive;
+
+  if (match_starts)
+    *match_starts = NULL;
+  if (match_ends)
+    *match_ends = NULL;
+
+  g_return_val_if_fail (iter != NULL, FALSE);
+  g_return_val_if_fail (str != NULL, FALSE);
+  g_return_val_if_fail (n_matches != NULL, FALSE);
+
+  *n_matches = 0;
+
+  if (*str == '\0')
+    return FALSE;
+
+  visible_only = (flags & GTK_TEXT_SEARCH_VISIBLE_ONLY) != 0;
+  slice = (flags & GTK_TEXT_SEARCH_TEXT_ONLY) == 0;
+  case_insensitive = (flags & GTK_TEXT_SEARCH_CASE_INSENSITIVE) != 0;
+
+  lines = strbreakup (str, "\n", -1, NULL, case_insensitive);
+  starts = g_array_new (FALSE, FALSE, sizeof (GtkTextIter));
+  ends = g_array_new (FALSE, FALSE, sizeof (GtkTextIter));
+
   search = *iter;
 
-  do
+  while (forward_search_lines (&search, (const char **) lines,
+                               visible_only, slice, case_insensitive,
+                               &match_start, &match_end, limit))
     {
-      /* This loop has an inefficient worst-case, where
-       * gtk_text_iter_get_text() is called repeatedly on
-       * a single line.
-       */
-      GtkTextIter end;
+      g_array_append_val (starts, match_start);
+      g_array_append_val (ends, match_end);
 
-      if (limit &&
-          gtk_text_iter_compare (&search, limit) >= 0)
-        break;
+      search = match_end;
 
-      if (lines_match (&search, (const char **)lines,
-                       visible_only, slice, case_insensitive, &match, &end))
-        {
-          if (limit == NULL ||
-              (limit &&
-               gtk_text_iter_compare (&end, limit) <= 0))
-            {
-              retval = TRUE;
+      /* Can't happen for non-empty search strings, but never loop forever */
+      if (gtk_text_iter_equal (&match_start, &match_end) &&
+          !gtk_text_iter_forward_char (&search))
+        break;
+    }
 
-              if (match_start)
-                *match_start = match;
+  g_strfreev (lines);
 
-              if (match_end)
-                *match_end = end;
-            }
+  *n_matches = starts->len;
 
-          break;
-        }
-    }
-  while (gtk_text_iter_forward_line (&search));
+  if (match_starts && starts->len > 0)
+    *match_starts = (GtkTextIter *) g_array_free (starts, FALSE);
+  else
+    g_array_free (starts, TRUE);
 
-  g_strfreev ((char **)lines);
+  if (match_ends && ends->len > 0)
+    *match_ends = (GtkTextIter *) g_array_free (ends, FALSE);
+  else
+    g_array_free (ends, TRUE);
 
-  return retval;
+  return *n_matches > 0;
 }
 
 static gboolean
@@ -5279,6 +5614,174 @@ lines_window_free (LinesWindow *win)
   g_strfreev (win->lines);
 }
 
+/* Fast path for single line searches: if the text between
+ * @line_start and @end is a single character segment, search
+ * it in place instead of copying it.
+ *
+ * Returns FALSE if the fast path does not apply, otherwise sets
+ * @found and, if a match was found, @match_start and @match_end.
+ */
+static gboolean
+last_line_match_contiguous (const GtkTextIter *line_start,
+                            const GtkTextIter *end,
+                            const char        *needle,
+                            gboolean           case_insensitive,
+                            gboolean          *found,
+                            GtkTextIter       *match_start,
+                            GtkTextIter       *match_end)
+{
+  GtkTextRealIter *real;
+  GtkTextLineSegment *seg;
+  const char *p;
+  gsize len;
+  gsize needle_len;
+
+  real = gtk_text_iter_make_real (line_start);
+  if (real == NULL || real->segment->type != &gtk_text_char_type)
+    return FALSE;
+
+  /* Zero-length segments such as marks and toggles don't matter */
+  for (seg = real->line->segments; seg != NULL; seg = seg->next)
+    {
+      if (seg != real->segment && seg->byte_count > 0)
+        return FALSE;
+    }
+
+  /* @end is either on the same line or at the start of the next one */
+  if (_gtk_text_iter_get_text_line (end) == real->line)
+    len = gtk_text_iter_get_line_index (end);
+  else
+    len = real->segment->byte_count;
+
+  needle_len = strlen (needle);
+
+  if (!case_insensitive)
+    p = find_last_bytes (real->segment->body.chars, len, needle, needle_len);
+  else if (is_ascii (needle, needle_len) && is_ascii (real->segment->body.chars, len))
+    p = find_last_bytes_ascii_caseless (real->segment->body.chars, len, needle, needle_len);
+  else
+    return FALSE;
+
+  *found = p != NULL;
+
+  if (p != NULL)
+    {
+      *match_start = *line_start;
+      gtk_text_iter_set_line_index (match_start, p - real->segment->body.chars);
+
+      *match_end = *match_start;
+      gtk_text_iter_set_line_index (match_end, p - real->segment->body.chars + needle_len);
+    }
+
+  return TRUE;
+}
+
+/* Finds the last match of @needle between @line_start and @end,
+ * which are at most one line apart.
+ */
+static gboolean
+backward_search_line (const GtkTextIter *line_start,
+                      const GtkTextIter *end,
+                      const char        *needle,
+                      gboolean           slice,
+                      gboolean           case_insensitive,
+                      GtkTextIter       *match_start,
+                      GtkTextIter       *match_end)
+{
+  char *text;
+  const char *p;
+  gboolean found;
+
+  if (last_line_match_contiguous (line_start, end, needle, case_insensitive,
+                                  &found, match_start, match_end))
+    return found;
+
+  if (slice)
+    text = gtk_text_iter_get_slice (line_start, end);
+  else
+    text = gtk_text_iter_get_text (line_start, end);
+
+  if (!case_insensitive)
+    p = g_strrstr (text, needle);
+  else
+    p = utf8_strrcasestr (text, needle);
+
+  if (p != NULL)
+    {
+      *match_start = *line_start;
+      forward_chars_with_skipping (match_start, g_utf8_strlen (text, p - text),
+                                   FALSE, !slice, FALSE);
+
+      *match_end = *match_start;
+      forward_chars_with_skipping (match_end, g_utf8_strlen (needle, -1),
+                                   FALSE, !slice, case_insensitive);
+    }
+
+  g_free (text);
+
+  return p != NULL;
+}
+
+/* Backward search for a search string without newlines, going
+ * one line at a time. This gives the same results as the
+ * LinesWindow search, but can search most lines in place.
+ */
+static gboolean
+backward_search_single_line (const GtkTextIter *iter,
+                             const char        *needle,
+                             gboolean           slice,
+                             gboolean           case_insensitive,
+                             GtkTextIter       *match_start,
+                             GtkTextIter       *match_end,
+                             const GtkTextIter *limit)
+{
+  GtkTextIter line_start;
+  GtkTextIter end;
+  GtkTextIter start_tmp;
+  GtkTextIter end_tmp;
+
+  if (gtk_text_iter_is_start (iter))
+    return FALSE;
+
+  end = *iter;
+  line_start = *iter;
+  gtk_text_iter_set_line_offset (&line_start, 0);
+
+  /* We were already at the start; so go back one line */
+  if (gtk_text_iter_equal (&line_start, &end))
+    gtk_text_iter_backward_line (&line_start);
+
+  do
+    {
+      /* We're now before the search limit, abort. */
+      if (limit &&
+          gtk_text_iter_compare (limit, &end) > 0)
+        return FALSE;
+
+      if (backward_search_line (&line_start, &end, needle,
+                                slice, case_insensitive,
+                                &start_tmp, &end_tmp))
+        {
+          if (limit &&
+              gtk_text_iter_compare (limit, &start_tmp) > 0)
+            return FALSE;
+
+          if (match_start)
+            *match_start = start_tmp;
+
+          if (match_end)
+            *match_end = end_tmp;
+
+          return TRUE;
+        }
+
+      end = line_start;
+    }
+  while (gtk_text_iter_backward_line (&line_start));
+
+  return FALSE;
+}
+
 /**
  * gtk_text_iter_backward_search:
  * @iter: a `GtkTextIter` where the search begins
@@ -5347,6 +5850,15 @@ gtk_text_iter_backward_search (const GtkTextIter *iter,
 
   lines = strbreakup (str, "\n", -1, &n_lines, case_insensitive);
 
+  if (n_lines == 1 && !visible_only)
+    {
+      retval = backward_search_single_line (iter, *lines, slice, case_insensitive,
+                                            match_start, match_end, limit);
+      g_strfreev (lines);
+
+      return retval;
+    }
+
   win.n_lines = n_lines;
   win.slice = slice;
   win.visible_only = visible_only;
@@ -386,6 +386,15 @@ gboolean gtk_text_iter_forward_search  (const GtkTextIter *iter,
                                         GtkTextIter       *match_end,
                                         const GtkTextIter *limit);
 
+GDK_AVAILABLE_IN_4_14
+gboolean gtk_text_iter_forward_search_all (const GtkTextIter  *iter,
+                                           const char         *str,
+                                           GtkTextSearchFlags  flags,
+                                           const GtkTextIter  *limit,
+                                           GtkTextIter       **match_starts,
+                                           GtkTextIter       **match_ends,
+                                           guint              *n_matches);
+
 GDK_AVAILABLE_IN_ALL
 gboolean gtk_text_iter_backward_search (const GtkTextIter *iter,
                                         const char        *str,
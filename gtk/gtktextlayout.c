@@ -109,8 +109,24 @@ struct _GtkTextLayoutPrivate
 
   /* Cache for GtkTextLineDisplay to reduce overhead creating layouts */
   GtkTextLineDisplayCache *cache;
+
+  /* Attributes computed for a set of tags, so that runs with the same
+   * tags don't recompute them. Maps StyleCacheKey to GtkTextAttributes.
+   */
+  GHashTable *style_cache;
+};
+
+typedef struct _StyleCacheKey StyleCacheKey;
+
+struct _StyleCacheKey
+{
+  guint n_tags;
+  GtkTextTag **tags; /* sorted by priority */
 };
 
+/* The cache is dropped when it grows beyond this */
+#define MAX_STYLE_CACHE_SIZE 256
+
 static void gtk_text_layout_invalidated     (GtkTextLayout     *layout);
 
 static void gtk_text_layout_invalidate_cache       (GtkTextLayout     *layout,
@@ -197,6 +213,8 @@ gtk_text_layout_dispose (GObject *object)
 
   gtk_text_layout_set_buffer (layout, NULL);
 
+  g_clear_pointer (&priv->style_cache, g_hash_table_unref);
+
   if (layout->default_style != NULL)
     {
       gtk_text_attributes_unref (layout->default_style);
@@ -301,6 +319,70 @@ free_style_cache (GtkTextLayout *text_layout)
     }
 }
 
+static guint
+style_cache_key_hash (gconstpointer data)
+{
+  const StyleCacheKey *key = data;
+  guint hash = key->n_tags;
+  guint i;
+
+  for (i = 0; i < key->n_tags; i++)
+    hash = (hash << 5) - hash + g_direct_hash (key->tags[i]);
+
+  return hash;
+}
+
+static gboolean
+style_cache_key_equal (gconstpointer a,
+                       gconstpointer b)
+{
+  const StyleCacheKey *key_a = a;
+  const StyleCacheKey *key_b = b;
+
+  return key_a->n_tags == key_b->n_tags &&
+         memcmp (key_a->tags, key_b->tags, key_a->n_tags * sizeof (GtkTextTag *)) == 0;
+}
+
+static StyleCacheKey *
+style_cache_key_copy (const StyleCacheKey *key)
+{
+  StyleCacheKey *copy;
+
+  copy = g_malloc (sizeof (StyleCacheKey) + key->n_tags * sizeof (GtkTextTag *));
+  copy->n_tags = key->n_tags;
+  copy->tags = (GtkTextTag **) (copy + 1);
+  memcpy (copy->tags, key->tags, key->n_tags * sizeof (GtkTextTag *));
+
+  return copy;
+}
+
+static void
+clear_tag_style_cache (GtkTextLayout *layout)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
+  if (priv->style_cache)
+    g_hash_table_remove_all (priv->style_cache);
+}
+
+static void
+gtk_text_layout_tag_changed (GtkTextTagTable *table,
+                             GtkTextTag      *tag,
+                             gboolean         size_changed,
+                             GtkTextLayout   *layout)
+{
+  clear_tag_style_cache (layout);
+}
+
+static void
+gtk_text_layout_tag_removed (GtkTextTagTable *table,
+                             GtkTextTag      *tag,
+                             GtkTextLayout   *layout)
+{
+  /* The key holds the tag pointer without a reference */
+  clear_tag_style_cache (layout);
+}
+
 /*
  * gtk_text_layout_set_buffer:
  * @buffer: (nullable):
@@ -316,9 +398,19 @@ gtk_text_layout_set_buffer (GtkTextLayout *layout,
     return;
 
   free_style_cache (layout);
+  clear_tag_style_cache (layout);
 
   if (layout->buffer)
     {
+      GtkTextTagTable *table = gtk_text_buffer_get_tag_table (layout->buffer);
+
+      g_signal_handlers_disconnect_by_func (table,
+                                            G_CALLBACK (gtk_text_layout_tag_changed),
+                                            layout);
+      g_signal_handlers_disconnect_by_func (table,
+                                            G_CALLBACK (gtk_text_layout_tag_removed),
+                                            layout);
+
       _gtk_text_btree_remove_view (_gtk_text_buffer_get_btree (layout->buffer),
                                   layout);
 
@@ -369,6 +461,11 @@ gtk_text_layout_set_buffer (GtkTextLayout *layout,
       g_signal_connect (layout->buffer, "delete-range",
                         G_CALLBACK (gtk_text_layout_before_buffer_delete_range), layout);
 
+      g_signal_connect (gtk_text_buffer_get_tag_table (buffer), "tag-changed",
+                        G_CALLBACK (gtk_text_layout_tag_changed), layout);
+      g_signal_connect (gtk_text_buffer_get_tag_table (buffer), "tag-removed",
+                        G_CALLBACK (gtk_text_layout_tag_removed), layout);
+
       gtk_text_layout_update_cursor_line (layout);
     }
 }
@@ -379,6 +476,7 @@ gtk_text_layout_default_style_changed (GtkTextLayout *layout)
   g_return_if_fail (GTK_IS_TEXT_LAYOUT (layout));
 
   DV (g_print ("invalidating all due to default style change (%s)\n", G_STRLOC));
+  clear_tag_style_cache (layout);
   gtk_text_layout_invalidate_all (layout);
 }
 
@@ -1093,7 +1191,9 @@ static GtkTextAttributes*
 get_style (GtkTextLayout *layout,
 	   GPtrArray     *tags)
 {
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
   GtkTextAttributes *style;
+  StyleCacheKey key;
 
   /* If we have the one-style cache, then it means
      that we haven't seen a toggle since we filled in the
@@ -1119,14 +1219,41 @@ get_style (GtkTextLayout *layout,
       return layout->default_style;
     }
 
-  style = gtk_text_attributes_new ();
+  key.n_tags = tags->len;
+  key.tags = (GtkTextTag **) tags->pdata;
+
+  if (priv->style_cache != NULL)
+    style = g_hash_table_lookup (priv->style_cache, &key);
+  else
+    style = NULL;
+
+  if (style != NULL)
+    {
+      gtk_text_attributes_ref (style);
+    }
+  else
+    {
+      style = gtk_text_attributes_new ();
+
+      gtk_text_attributes_copy_values (layout->default_style,
+                                       style);
+
+      _gtk_text_attributes_fill_from_tags (style, tags);
 
-  gtk_text_attributes_copy_values (layout->default_style,
-                                   style);
+      g_assert (style->refcount == 1);
 
-  _gtk_text_attributes_fill_from_tags (style, tags);
+      if (priv->style_cache == NULL)
+        priv->style_cache = g_hash_table_new_full (style_cache_key_hash,
+                                                   style_cache_key_equal,
+                                                   g_free,
+                                                   (GDestroyNotify) gtk_text_attributes_unref);
+      else if (g_hash_table_size (priv->style_cache) >= MAX_STYLE_CACHE_SIZE)
+        g_hash_table_remove_all (priv->style_cache);
 
-  g_assert (style->refcount == 1);
+      g_hash_table_insert (priv->style_cache,
+                           style_cache_key_copy (&key),
+                           gtk_text_attributes_ref (style));
+    }
 
   /* Leave this style as the last one seen */
   g_assert (layout->one_style_cache == NULL);
@@ -2568,6 +2695,12 @@ gtk_text_layout_create_display (GtkTextLayout *layout,
   pango_layout_set_text (display->layout, text, layout_byte_offset);
   pango_layout_set_attributes (display->layout, attrs);
 
+  /* Reuse the shaping done for other views of the buffer, unless
+   * the line shows things that belong to this view only.
+   */
+  if (!saw_widget && !(layout->preedit_len > 0 && display->insert_index >= 0))
+    display->layout = gtk_text_line_display_cache_share_layout (line, display->layout);
+
   tmp_list1 = cursor_byte_offsets;
   tmp_list2 = cursor_segs;
   while (tmp_list1)
@@ -4342,3 +4475,15 @@ gtk_text_layout_set_mru_size (GtkTextLayout *layout,
 
   gtk_text_line_display_cache_set_mru_size (priv->cache, mru_size);
 }
+
+void
+gtk_text_layout_get_cache_stats (GtkTextLayout *layout,
+                                 guint         *n_displays,
+                                 gsize         *n_bytes,
+                                 guint64       *hits,
+                                 guint64       *misses)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
+  gtk_text_line_display_cache_get_stats (priv->cache, n_displays, n_bytes, hits, misses);
+}
@@ -187,6 +187,9 @@ struct _GtkTextLineDisplay
   /* GQueue link for use in MRU to help cull cache */
   GList          mru_link;
 
+  /* Estimated memory use, accounted for while in the cache */
+  gsize          cache_size;
+
   GtkTextDirection direction;
 
   int width;                   /* Width of layout */
@@ -380,6 +383,11 @@ void gtk_text_layout_snapshot (GtkTextLayout        *layout,
 
 void gtk_text_layout_set_mru_size (GtkTextLayout *layout,
                                    guint          mru_size);
+void gtk_text_layout_get_cache_stats (GtkTextLayout *layout,
+                                      guint         *n_displays,
+                                      gsize         *n_bytes,
+                                      guint64       *hits,
+                                      guint64       *misses);
 
 G_END_DECLS
 
@@ -25,7 +25,11 @@
 #include "gtktextlinedisplaycacheprivate.h"
 #include "gtkprivate.h"
 
+#include <string.h>
+#include <pango/pangocairo.h>
+
 #define DEFAULT_MRU_SIZE         250
+#define MAX_BYTES                (8 * 1024 * 1024)
 #define BLOW_CACHE_TIMEOUT_SEC   20
 #define DEBUG_LINE_DISPLAY_CACHE 0
 
@@ -37,11 +41,12 @@ struct _GtkTextLineDisplayCache
   GQueue       mru;
   GSource     *evict_source;
   guint        mru_size;
+  gsize        n_bytes;
+  guint64      hits;
+  guint64      misses;
 
 #if DEBUG_LINE_DISPLAY_CACHE
   guint       log_source;
-  int         hits;
-  int         misses;
   int         inval;
   int         inval_cursors;
   int         inval_by_line;
@@ -57,11 +62,12 @@ static gboolean
 dump_stats (gpointer data)
 {
   GtkTextLineDisplayCache *cache = data;
-  g_printerr ("%p: size=%u hits=%d misses=%d inval_total=%d "
+  g_printerr ("%p: size=%u bytes=%" G_GSIZE_FORMAT " hits=%" G_GUINT64_FORMAT
+              " misses=%" G_GUINT64_FORMAT " inval_total=%d "
               "inval_cursors=%d inval_by_line=%d "
               "inval_by_range=%d inval_by_y_range=%d\n",
               cache, g_hash_table_size (cache->line_to_display),
-              cache->hits, cache->misses,
+              cache->n_bytes, cache->hits, cache->misses,
               cache->inval, cache->inval_cursors,
               cache->inval_by_line, cache->inval_by_range,
               cache->inval_by_y_range);
@@ -176,6 +182,23 @@ check_disposition (GtkTextLineDisplayCache *cache,
 }
 #endif
 
+/* A rough estimate of the memory held by a display, dominated
+ * by the text, log attrs and glyphs of its PangoLayout.
+ */
+#define LAYOUT_OVERHEAD       512
+#define LAYOUT_BYTES_PER_CHAR (4 + sizeof (PangoLogAttr) + sizeof (PangoGlyphInfo) + sizeof (int))
+
+static gsize
+estimate_display_size (GtkTextLineDisplay *display)
+{
+  gsize size = sizeof (GtkTextLineDisplay);
+
+  if (display->layout != NULL)
+    size += LAYOUT_OVERHEAD + LAYOUT_BYTES_PER_CHAR * pango_layout_get_character_count (display->layout);
+
+  return size;
+}
+
 static void
 gtk_text_line_display_cache_take_display (GtkTextLineDisplayCache *cache,
                                           GtkTextLineDisplay      *display,
@@ -202,8 +225,14 @@ gtk_text_line_display_cache_take_display (GtkTextLineDisplayCache *cache,
   g_hash_table_insert (cache->line_to_display, display->line, display);
   g_queue_push_head_link (&cache->mru, &display->mru_link);
 
-  /* Cull the cache if we're at capacity */
-  while (cache->mru.length > cache->mru_size)
+  display->cache_size = estimate_display_size (display);
+  cache->n_bytes += display->cache_size;
+
+  /* Cull the cache if we're at capacity, but always keep the
+   * display we just added, even if it is over budget on its own.
+   */
+  while (cache->mru.length > cache->mru_size ||
+         (cache->n_bytes > MAX_BYTES && cache->mru.length > 1))
     {
       display = g_queue_peek_tail (&cache->mru);
 
@@ -249,6 +278,9 @@ gtk_text_line_display_cache_invalidate_display (GtkTextLineDisplayCache *cache,
       g_hash_table_remove (cache->line_to_display, display->line);
       g_queue_unlink (&cache->mru, &display->mru_link);
 
+      cache->n_bytes -= display->cache_size;
+      display->cache_size = 0;
+
       if (iter != NULL)
         g_sequence_remove (iter);
     }
@@ -256,6 +288,228 @@ gtk_text_line_display_cache_invalidate_display (GtkTextLineDisplayCache *cache,
   STAT_INC (cache->inval);
 }
 
+/* Views of the same buffer lay out the same lines, so shaped layouts
+ * are shared between them when their text, attributes, paragraph
+ * settings and context settings match. Shared layouts are created on
+ * a private copy of the view's context, so that a view updating its
+ * own context doesn't change the layouts that other views are using.
+ *
+ * The tables don't hold references: entries go away together with
+ * the last display using the layout.
+ */
+static GHashTable *shared_layouts;
+static GPtrArray *shared_contexts;
+
+static gboolean
+contexts_equal (PangoContext *a,
+                PangoContext *b)
+{
+  const PangoMatrix *matrix_a, *matrix_b;
+  const cairo_font_options_t *options_a, *options_b;
+
+  if (a == b)
+    return TRUE;
+
+  if (pango_context_get_font_map (a) != pango_context_get_font_map (b) ||
+      pango_context_get_base_dir (a) != pango_context_get_base_dir (b) ||
+      pango_context_get_base_gravity (a) != pango_context_get_base_gravity (b) ||
+      pango_context_get_gravity_hint (a) != pango_context_get_gravity_hint (b) ||
+      pango_context_get_language (a) != pango_context_get_language (b) ||
+      pango_context_get_round_glyph_positions (a) != pango_context_get_round_glyph_positions (b) ||
+      pango_cairo_context_get_resolution (a) != pango_cairo_context_get_resolution (b) ||
+      !pango_font_description_equal (pango_context_get_font_description (a),
+                                     pango_context_get_font_description (b)))
+    return FALSE;
+
+  matrix_a = pango_context_get_matrix (a);
+  matrix_b = pango_context_get_matrix (b);
+  if (matrix_a == NULL || matrix_b == NULL)
+    {
+      if (matrix_a != matrix_b)
+        return FALSE;
+    }
+  else if (memcmp (matrix_a, matrix_b, sizeof (PangoMatrix)) != 0)
+    return FALSE;
+
+  options_a = pango_cairo_context_get_font_options (a);
+  options_b = pango_cairo_context_get_font_options (b);
+  if (options_a == NULL || options_b == NULL)
+    return options_a == options_b;
+
+  return cairo_font_options_equal (options_a, options_b);
+}
+
+static void
+shared_context_finalized (gpointer  data,
+                          GObject  *where_the_object_was)
+{
+  g_ptr_array_remove_fast (shared_contexts, where_the_object_was);
+}
+
+static PangoContext *
+get_shared_context (PangoContext *context)
+{
+  PangoContext *copy;
+  guint i;
+
+  if (shared_contexts == NULL)
+    shared_contexts = g_ptr_array_new ();
+
+  for (i = 0; i < shared_contexts->len; i++)
+    {
+      copy = g_ptr_array_index (shared_contexts, i);
+      if (contexts_equal (copy, context))
+        return g_object_ref (copy);
+    }
+
+  copy = pango_context_new ();
+  pango_context_set_font_map (copy, pango_context_get_font_map (context));
+  pango_context_set_font_description (copy, pango_context_get_font_description (context));
+  pango_context_set_language (copy, pango_context_get_language (context));
+  pango_context_set_base_dir (copy, pango_context_get_base_dir (context));
+  pango_context_set_base_gravity (copy, pango_context_get_base_gravity (context));
+  pango_context_set_gravity_hint (copy, pango_context_get_gravity_hint (context));
+  pango_context_set_matrix (copy, pango_context_get_matrix (context));
+  pango_context_set_round_glyph_positions (copy, pango_context_get_round_glyph_positions (context));
+  pango_cairo_context_set_resolution (copy, pango_cairo_context_get_resolution (context));
+  pango_cairo_context_set_font_options (copy, pango_cairo_context_get_font_options (context));
+
+  g_object_weak_ref (G_OBJECT (copy), shared_context_finalized, NULL);
+  g_ptr_array_add (shared_contexts, copy);
+
+  return copy;
+}
+
+static gboolean
+tab_arrays_equal (PangoTabArray *a,
+                  PangoTabArray *b)
+{
+  char *str_a, *str_b;
+  gboolean equal;
+
+  if (a == NULL || b == NULL)
+    return a == b;
+
+  str_a = pango_tab_array_to_string (a);
+  str_b = pango_tab_array_to_string (b);
+  equal = strcmp (str_a, str_b) == 0;
+  g_free (str_a);
+  g_free (str_b);
+
+  return equal;
+}
+
+static gboolean
+layouts_equal (PangoLayout *a,
+               PangoLayout *b)
+{
+  PangoTabArray *tabs_a, *tabs_b;
+  gboolean equal;
+
+  if (pango_layout_get_width (a) != pango_layout_get_width (b) ||
+      pango_layout_get_wrap (a) != pango_layout_get_wrap (b) ||
+      pango_layout_get_indent (a) != pango_layout_get_indent (b) ||
+      pango_layout_get_spacing (a) != pango_layout_get_spacing (b) ||
+      pango_layout_get_justify (a) != pango_layout_get_justify (b) ||
+      pango_layout_get_alignment (a) != pango_layout_get_alignment (b) ||
+      strcmp (pango_layout_get_text (a), pango_layout_get_text (b)) != 0 ||
+      !pango_attr_list_equal (pango_layout_get_attributes (a), pango_layout_get_attributes (b)) ||
+      !contexts_equal (pango_layout_get_context (a), pango_layout_get_context (b)))
+    return FALSE;
+
+  tabs_a = pango_layout_get_tabs (a);
+  tabs_b = pango_layout_get_tabs (b);
+  equal = tab_arrays_equal (tabs_a, tabs_b);
+  g_clear_pointer (&tabs_a, pango_tab_array_free);
+  g_clear_pointer (&tabs_b, pango_tab_array_free);
+
+  return equal;
+}
+
+static PangoLayout *
+copy_layout_to_shared_context (PangoLayout *layout)
+{
+  PangoContext *context;
+  PangoLayout *copy;
+  PangoTabArray *tabs;
+
+  context = get_shared_context (pango_layout_get_context (layout));
+  copy = pango_layout_new (context);
+  g_object_unref (context);
+
+  pango_layout_set_text (copy, pango_layout_get_text (layout), -1);
+  pango_layout_set_attributes (copy, pango_layout_get_attributes (layout));
+  pango_layout_set_width (copy, pango_layout_get_width (layout));
+  pango_layout_set_wrap (copy, pango_layout_get_wrap (layout));
+  pango_layout_set_indent (copy, pango_layout_get_indent (layout));
+  pango_layout_set_spacing (copy, pango_layout_get_spacing (layout));
+  pango_layout_set_justify (copy, pango_layout_get_justify (layout));
+  pango_layout_set_alignment (copy, pango_layout_get_alignment (layout));
+
+  tabs = pango_layout_get_tabs (layout);
+  if (tabs != NULL)
+    {
+      pango_layout_set_tabs (copy, tabs);
+      pango_tab_array_free (tabs);
+    }
+
+  return copy;
+}
+
+static void
+shared_layout_finalized (gpointer  data,
+                         GObject  *where_the_object_was)
+{
+  GtkTextLine *line = data;
+
+  /* The line may have been given a newer layout in the meantime */
+  if (g_hash_table_lookup (shared_layouts, line) == (gpointer) where_the_object_was)
+    g_hash_table_remove (shared_layouts, line);
+}
+
+/*
+ * gtk_text_line_display_cache_share_layout:
+ * @line: the `GtkTextLine` that @layout displays
+ * @layout: (transfer full): a `PangoLayout` that has not been laid out yet
+ *
+ * Looks for a layout of @line with the same text, attributes and
+ * settings as @layout that another display, possibly of another
+ * view of the same buffer, already uses. If there is none, @layout
+ * is copied into a shared context and made available to others.
+ *
+ * Lines are only compared by their contents, so this is safe even
+ * if @line was modified or freed since a layout was shared for it.
+ *
+ * Returns: (transfer full): the layout to use in place of @layout
+ */
+PangoLayout *
+gtk_text_line_display_cache_share_layout (GtkTextLine *line,
+                                          PangoLayout *layout)
+{
+  PangoLayout *shared;
+
+  g_assert (line != NULL);
+  g_assert (PANGO_IS_LAYOUT (layout));
+
+  if (shared_layouts == NULL)
+    shared_layouts = g_hash_table_new (NULL, NULL);
+
+  shared = g_hash_table_lookup (shared_layouts, line);
+  if (shared != NULL && layouts_equal (shared, layout))
+    {
+      g_object_unref (layout);
+      return g_object_ref (shared);
+    }
+
+  shared = copy_layout_to_shared_context (layout);
+  g_object_unref (layout);
+
+  g_object_weak_ref (G_OBJECT (shared), shared_layout_finalized, line);
+  g_hash_table_insert (shared_layouts, line, shared);
+
+  return shared;
+}
+
 /*
  * gtk_text_line_display_cache_get:
  * @cache: a `GtkTextLineDisplayCache`
@@ -290,7 +544,7 @@ gtk_text_line_display_cache_get (GtkTextLineDisplayCache *cache,
     {
       if (size_only || !display->size_only)
         {
-          STAT_INC (cache->hits);
+          cache->hits++;
 
           if (!size_only && display->line == cache->cursor_line)
             gtk_text_layout_update_display_cursors (layout, display->line, display);
@@ -312,7 +566,7 @@ gtk_text_line_display_cache_get (GtkTextLineDisplayCache *cache,
       gtk_text_line_display_cache_invalidate_display (cache, display, FALSE);
     }
 
-  STAT_INC (cache->misses);
+  cache->misses++;
 
   g_assert (!g_hash_table_lookup (cache->line_to_display, line));
 
@@ -762,3 +1016,22 @@ gtk_text_line_display_cache_set_mru_size (GtkTextLineDisplayCache *cache,
         }
     }
 }
+
+void
+gtk_text_line_display_cache_get_stats (GtkTextLineDisplayCache *cache,
+                                       guint                   *n_displays,
+                                       gsize                   *n_bytes,
+                                       guint64                 *hits,
+                                       guint64                 *misses)
+{
+  g_assert (cache != NULL);
+
+  if (n_displays)
+    *n_displays = cache->mru.length;
+  if (n_bytes)
+    *n_bytes = cache->n_bytes;
+  if (hits)
+    *hits = cache->hits;
+  if (misses)
+    *misses = cache->misses;
+}
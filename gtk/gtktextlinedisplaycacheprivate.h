@@ -55,6 +55,13 @@ void                     gtk_text_line_display_cache_invalidate_y_range (GtkText
                                                                          gboolean                 cursors_only);
 void                     gtk_text_line_display_cache_set_mru_size       (GtkTextLineDisplayCache *cache,
                                                                          guint                    mru_size);
+void                     gtk_text_line_display_cache_get_stats          (GtkTextLineDisplayCache *cache,
+                                                                         guint                   *n_displays,
+                                                                         gsize                   *n_bytes,
+                                                                         guint64                 *hits,
+                                                                         guint64                 *misses);
+PangoLayout             *gtk_text_line_display_cache_share_layout       (GtkTextLine             *line,
+                                                                         PangoLayout             *layout);
 
 G_END_DECLS
 
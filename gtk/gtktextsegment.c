@@ -157,6 +157,38 @@ gtk_text_line_segment_split (const GtkTextIter *iter)
 #define TSEG_SIZE ((unsigned) (G_STRUCT_OFFSET (GtkTextLineSegment, body) \
         + sizeof (GtkTextToggleBody)))
 
+/*
+ * Character segments longer than CSEG_SLACK_THRESHOLD bytes are
+ * allocated with some slack, so that appending to a long run (a
+ * minified file or a log that keeps growing on a single line) can
+ * extend the segment in place instead of copying the whole run on
+ * every insertion.
+ *
+ * The allocation size is a monotonic function of the byte count and
+ * segments are only ever shrunk in place, so a segment's allocation is
+ * always at least cseg_alloc_size (seg->byte_count).
+ */
+#define CSEG_SLACK_THRESHOLD 256
+
+static inline gsize
+cseg_alloc_size (guint len)
+{
+  gsize size = CSEG_SIZE (len);
+  gsize step;
+
+  if (len < CSEG_SLACK_THRESHOLD)
+    return size;
+
+  /* Round up to a multiple of 1/8 to 1/4 of the size, which keeps the
+   * waste below 25% while growing geometrically.
+   */
+  step = 1;
+  while (step * 8 <= size)
+    step <<= 1;
+
+  return (size + step - 1) & ~(step - 1);
+}
+
 /*
  * Type functions
  */
@@ -186,21 +218,23 @@ char_segment_self_check (GtkTextLineSegment *seg)
     }
 }
 
-GtkTextLineSegment*
-_gtk_char_segment_new (const char *text, guint len)
+static GtkTextLineSegment *
+char_segment_new_with_count (const char *text,
+                             guint       len,
+                             int         chars)
 {
   GtkTextLineSegment *seg;
 
   g_assert (gtk_text_byte_begins_utf8_char (text));
 
-  seg = g_malloc (CSEG_SIZE (len));
+  seg = g_malloc (cseg_alloc_size (len));
   seg->type = (GtkTextLineSegmentClass *)&gtk_text_char_type;
   seg->next = NULL;
   seg->byte_count = len;
   memcpy (seg->body.chars, text, len);
   seg->body.chars[len] = '\0';
 
-  seg->char_count = g_utf8_strlen (seg->body.chars, seg->byte_count);
+  seg->char_count = chars;
 
   if (GTK_DEBUG_CHECK (TEXT))
     char_segment_self_check (seg);
@@ -208,6 +242,12 @@ _gtk_char_segment_new (const char *text, guint len)
   return seg;
 }
 
+GtkTextLineSegment*
+_gtk_char_segment_new (const char *text, guint len)
+{
+  return char_segment_new_with_count (text, len, g_utf8_strlen (text, len));
+}
+
 GtkTextLineSegment*
 _gtk_char_segment_new_from_two_strings (const char *text1, 
 					guint        len1, 
@@ -221,7 +261,7 @@ _gtk_char_segment_new_from_two_strings (const char *text1,
   g_assert (gtk_text_byte_begins_utf8_char (text1));
   g_assert (gtk_text_byte_begins_utf8_char (text2));
 
-  seg = g_malloc (CSEG_SIZE (len1+len2));
+  seg = g_malloc (cseg_alloc_size (len1 + len2));
   seg->type = &gtk_text_char_type;
   seg->next = NULL;
   seg->byte_count = len1 + len2;
@@ -270,6 +310,7 @@ static GtkTextLineSegment *
 char_segment_split_func (GtkTextLineSegment *seg, int index)
 {
   GtkTextLineSegment *new1, *new2;
+  int tail_len, tail_chars;
 
   g_assert (index < seg->byte_count);
 
@@ -278,16 +319,27 @@ char_segment_split_func (GtkTextLineSegment *seg, int index)
       char_segment_self_check (seg);
     }
 
-  new1 = _gtk_char_segment_new (seg->body.chars, index);
-  new2 = _gtk_char_segment_new (seg->body.chars + index, seg->byte_count - index);
+  /* Only count the characters in the shorter half */
+  tail_len = seg->byte_count - index;
+  if (index < tail_len)
+    tail_chars = seg->char_count - g_utf8_strlen (seg->body.chars, index);
+  else
+    tail_chars = g_utf8_strlen (seg->body.chars + index, tail_len);
+
+  /* The head keeps the original allocation and is truncated in place,
+   * so only the tail needs to be copied.
+   */
+  new2 = char_segment_new_with_count (seg->body.chars + index, tail_len, tail_chars);
+  new1 = seg;
+  new1->byte_count = index;
+  new1->char_count -= tail_chars;
+  new1->body.chars[index] = '\0';
 
   g_assert (gtk_text_byte_begins_utf8_char (new1->body.chars));
   g_assert (gtk_text_byte_begins_utf8_char (new2->body.chars));
-  g_assert (new1->byte_count + new2->byte_count == seg->byte_count);
-  g_assert (new1->char_count + new2->char_count == seg->char_count);
 
-  new1->next = new2;
   new2->next = seg->next;
+  new1->next = new2;
 
   if (GTK_DEBUG_CHECK (TEXT))
     {
@@ -295,7 +347,6 @@ char_segment_split_func (GtkTextLineSegment *seg, int index)
       char_segment_self_check (new2);
     }
 
-  _gtk_char_segment_free (seg);
   return new1;
 }
 
@@ -317,7 +368,9 @@ char_segment_split_func (GtkTextLineSegment *seg, int index)
  *      the (new) list of segments that used to start with segPtr.
  *
  * Side effects:
- *      Storage for the segments may be allocated and freed.
+ *      segPtr is grown in place if possible, and the character
+ *      segments following it are appended to it and freed, as long
+ *      as the result stays within GTK_TEXT_CHAR_SEGMENT_MAX_BYTES.
  *
  *--------------------------------------------------------------
  */
@@ -327,31 +380,52 @@ static GtkTextLineSegment *
 char_segment_cleanup_func (GtkTextLineSegment *segPtr, GtkTextLine *line)
 {
   GtkTextLineSegment *segPtr2, *newPtr;
+  guint byte_count;
 
   if (GTK_DEBUG_CHECK (TEXT))
     char_segment_self_check (segPtr);
 
   segPtr2 = segPtr->next;
-  if ((segPtr2 == NULL) || (segPtr2->type != &gtk_text_char_type))
+  if ((segPtr2 == NULL) || (segPtr2->type != &gtk_text_char_type) ||
+      segPtr->byte_count + segPtr2->byte_count > GTK_TEXT_CHAR_SEGMENT_MAX_BYTES)
     {
       return segPtr;
     }
 
-  newPtr =
-    _gtk_char_segment_new_from_two_strings (segPtr->body.chars, 
-					    segPtr->byte_count,
-					    segPtr->char_count,
-                                            segPtr2->body.chars, 
-					    segPtr2->byte_count,
-					    segPtr2->char_count);
+  /* Merge the run of character segments at once, up to the maximum
+   * segment size. cleanup_line() only notices a change when the
+   * returned segment differs from segPtr, which is not the case when
+   * the segment could be grown in place.
+   */
+  byte_count = segPtr->byte_count;
+  for (;
+       segPtr2 != NULL && segPtr2->type == &gtk_text_char_type &&
+       byte_count + segPtr2->byte_count <= GTK_TEXT_CHAR_SEGMENT_MAX_BYTES;
+       segPtr2 = segPtr2->next)
+    byte_count += segPtr2->byte_count;
+
+  newPtr = segPtr;
+  if (cseg_alloc_size (byte_count) > cseg_alloc_size (newPtr->byte_count))
+    newPtr = g_realloc (newPtr, cseg_alloc_size (byte_count));
+
+  while ((segPtr2 = newPtr->next) != NULL && segPtr2->type == &gtk_text_char_type &&
+         newPtr->byte_count + segPtr2->byte_count <= GTK_TEXT_CHAR_SEGMENT_MAX_BYTES)
+    {
+      memcpy (newPtr->body.chars + newPtr->byte_count,
+              segPtr2->body.chars,
+              segPtr2->byte_count);
+      newPtr->byte_count += segPtr2->byte_count;
+      newPtr->char_count += segPtr2->char_count;
+      newPtr->next = segPtr2->next;
+
+      _gtk_char_segment_free (segPtr2);
+    }
 
-  newPtr->next = segPtr2->next;
+  newPtr->body.chars[newPtr->byte_count] = '\0';
 
   if (GTK_DEBUG_CHECK (TEXT))
     char_segment_self_check (newPtr);
 
-  _gtk_char_segment_free (segPtr);
-  _gtk_char_segment_free (segPtr2);
   return newPtr;
 }
 
@@ -415,7 +489,8 @@ char_segment_check_func (GtkTextLineSegment *segPtr, GtkTextLine *line)
 
   if (segPtr->next != NULL)
     {
-      if (segPtr->next->type == &gtk_text_char_type)
+      if (segPtr->next->type == &gtk_text_char_type &&
+          segPtr->byte_count + segPtr->next->byte_count <= GTK_TEXT_CHAR_SEGMENT_MAX_BYTES)
         {
           g_error ("adjacent character segments weren't merged");
         }
@@ -149,6 +149,13 @@ struct _GtkTextLineSegment {
 };
 
 
+/*
+ * Adjacent character segments are merged only up to this size, so
+ * long lines are stored as several segments and inserting into the
+ * middle of one copies at most this many bytes.
+ */
+#define GTK_TEXT_CHAR_SEGMENT_MAX_BYTES (16 * 1024)
+
 GtkTextLineSegment  *gtk_text_line_segment_split (const GtkTextIter *iter);
 
 GtkTextLineSegment *_gtk_char_segment_new                  (const char     *text,
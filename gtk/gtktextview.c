@@ -10301,3 +10301,9 @@ gtk_text_view_get_key_controller (GtkTextView *text_view)
 {
   return text_view->priv->key_controller;
 }
+
+GtkTextLayout *
+gtk_text_view_get_layout (GtkTextView *text_view)
+{
+  return text_view->priv->layout;
+}
@@ -21,6 +21,7 @@
 #include "gtktextview.h"
 #include "gtktextattributesprivate.h"
 #include "gtkcssnodeprivate.h"
+#include "gtktextlayoutprivate.h"
 
 G_BEGIN_DECLS
 
@@ -31,6 +32,8 @@ GtkTextAttributes * gtk_text_view_get_default_attributes (GtkTextView *text_view
 
 GtkEventController *gtk_text_view_get_key_controller    (GtkTextView *text_view);
 
+GtkTextLayout * gtk_text_view_get_layout                (GtkTextView *text_view);
+
 
 G_END_DECLS
 
@@ -32,6 +32,9 @@
 #include "gtkmenubutton.h"
 #include "gtkwidgetprivate.h"
 #include "gtkbinlayout.h"
+#include "gtktextviewprivate.h"
+#include "gtkiconthemeprivate.h"
+#include "gtkimage.h"
 #include "gtkwidgetprivate.h"
 
 struct _GtkInspectorMiscInfo
@@ -90,6 +93,10 @@ struct _GtkInspectorMiscInfo
   GtkWidget *is_toplevel;
   GtkWidget *child_visible_row;
   GtkWidget *child_visible;
+  GtkWidget *text_cache_row;
+  GtkWidget *text_cache;
+  GtkWidget *icon_cache_row;
+  GtkWidget *icon_cache;
 
   guint update_source_id;
   gint64 last_frame;
@@ -450,6 +457,53 @@ update_info (gpointer data)
       sl->last_frame = frame;
     }
 
+  if (GTK_IS_TEXT_VIEW (sl->object))
+    {
+      GtkTextLayout *layout;
+
+      layout = gtk_text_view_get_layout (GTK_TEXT_VIEW (sl->object));
+      if (layout != NULL)
+        {
+          guint n_displays;
+          gsize n_bytes;
+          guint64 hits, misses;
+          char *size;
+
+          gtk_text_layout_get_cache_stats (layout, &n_displays, &n_bytes, &hits, &misses);
+          size = g_format_size (n_bytes);
+          /* Translators: the number of cached text lines, their size and the cache hit rate */
+          tmp = g_strdup_printf (_("%u lines, %s, %.0f%% hits"),
+                                 n_displays, size,
+                                 hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0);
+          gtk_label_set_label (GTK_LABEL (sl->text_cache), tmp);
+          g_free (tmp);
+          g_free (size);
+        }
+      else
+        {
+          gtk_label_set_label (GTK_LABEL (sl->text_cache), C_("text cache", "None"));
+        }
+    }
+
+  if (GTK_IS_IMAGE (sl->object))
+    {
+      GtkIconTheme *icon_theme;
+      guint n_icons;
+      gsize n_bytes;
+      guint64 hits, misses;
+      char *size;
+
+      icon_theme = gtk_icon_theme_get_for_display (gtk_widget_get_display (GTK_WIDGET (sl->object)));
+      gtk_icon_theme_get_cache_stats (icon_theme, &n_icons, &n_bytes, &hits, &misses);
+      size = g_format_size (n_bytes);
+      tmp = g_strdup_printf ("%u icons, %s, %.0f%% hits",
+                             n_icons, size,
+                             hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0.0);
+      gtk_label_set_label (GTK_LABEL (sl->icon_cache), tmp);
+      g_free (tmp);
+      g_free (size);
+    }
+
   if (GDK_IS_SURFACE (sl->object))
     {
       char buf[64];
@@ -518,6 +572,8 @@ gtk_inspector_misc_info_set_object (GtkInspectorMiscInfo *sl,
   gtk_widget_set_visible (sl->realized_row, GTK_IS_WIDGET (object));
   gtk_widget_set_visible (sl->is_toplevel_row, GTK_IS_WIDGET (object));
   gtk_widget_set_visible (sl->child_visible_row, GTK_IS_WIDGET (object));
+  gtk_widget_set_visible (sl->text_cache_row, GTK_IS_TEXT_VIEW (object));
+  gtk_widget_set_visible (sl->icon_cache_row, GTK_IS_IMAGE (object));
   gtk_widget_set_visible (sl->frame_clock_row, GTK_IS_WIDGET (object));
   gtk_widget_set_visible (sl->buildable_id_row, GTK_IS_BUILDABLE (object));
   gtk_widget_set_visible (sl->framecount_row, GDK_IS_FRAME_CLOCK (object));
@@ -644,6 +700,10 @@ gtk_inspector_misc_info_class_init (GtkInspectorMiscInfoClass *klass)
   gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, is_toplevel);
   gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, child_visible_row);
   gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, child_visible);
+  gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, text_cache_row);
+  gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, text_cache);
+  gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, icon_cache_row);
+  gtk_widget_class_bind_template_child (widget_class, GtkInspectorMiscInfo, icon_cache);
 
   gtk_widget_class_bind_template_callback (widget_class, update_measure_picture);
   gtk_widget_class_bind_template_callback (widget_class, measure_picture_drag_prepare);
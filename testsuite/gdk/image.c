@@ -2,6 +2,7 @@
 #include "gdk/loaders/gdkpngprivate.h"
 #include "gdk/loaders/gdktiffprivate.h"
 #include "gdk/loaders/gdkjpegprivate.h"
+#include "gdk/loaders/gdkgtexprivate.h"
 
 static void
 assert_texture_equal (GdkTexture *t1,
@@ -68,6 +69,58 @@ test_load_image (gconstpointer data)
   g_free (path);
 }
 
+static void
+test_load_image_at_size (gconstpointer data)
+{
+  const char *filename = data;
+  GdkTexture *texture;
+  char *path;
+  GFile *file;
+  GBytes *bytes;
+  GError *error = NULL;
+
+  path = g_test_build_filename (G_TEST_DIST, "image-data", filename, NULL);
+  file = g_file_new_for_path (path);
+  bytes = g_file_load_bytes (file, NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  if (g_str_has_suffix (filename, ".png"))
+    texture = gdk_load_png_at_size (bytes, 8, 8, &error);
+  else if (g_str_has_suffix (filename, ".tiff"))
+    texture = gdk_load_tiff_at_size (bytes, 8, 8, &error);
+  else if (g_str_has_suffix (filename, ".jpeg"))
+    texture = gdk_load_jpeg_at_size (bytes, 8, 8, &error);
+  else
+    g_assert_not_reached ();
+
+  g_assert_no_error (error);
+  g_assert_true (GDK_IS_TEXTURE (texture));
+
+  /* tiff only has reduced-resolution subfiles to offer */
+  if (g_str_has_suffix (filename, ".tiff"))
+    {
+      g_assert_cmpint (gdk_texture_get_width (texture), >=, 8);
+      g_assert_cmpint (gdk_texture_get_height (texture), >=, 8);
+    }
+  else
+    {
+      g_assert_cmpint (gdk_texture_get_width (texture), ==, 8);
+      g_assert_cmpint (gdk_texture_get_height (texture), ==, 8);
+    }
+  g_object_unref (texture);
+
+  /* Never scale up */
+  texture = gdk_texture_new_from_bytes_at_size (bytes, 64, -1, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (gdk_texture_get_width (texture), ==, 32);
+  g_assert_cmpint (gdk_texture_get_height (texture), ==, 32);
+  g_object_unref (texture);
+
+  g_bytes_unref (bytes);
+  g_object_unref (file);
+  g_free (path);
+}
+
 static void
 test_save_image (gconstpointer test_data)
 {
@@ -117,6 +170,126 @@ test_save_image (gconstpointer test_data)
   g_free (path);
 }
 
+static void
+test_save_png_fast (void)
+{
+  static const GdkMemoryFormat formats[] = {
+    GDK_MEMORY_R8G8B8A8,
+    GDK_MEMORY_B8G8R8A8,
+    GDK_MEMORY_A8R8G8B8,
+    GDK_MEMORY_A8B8G8R8,
+    GDK_MEMORY_R8G8B8,
+    GDK_MEMORY_B8G8R8,
+    GDK_MEMORY_R8G8B8X8,
+    GDK_MEMORY_B8G8R8X8,
+    GDK_MEMORY_X8R8G8B8,
+    GDK_MEMORY_X8B8G8R8,
+    GDK_MEMORY_R16G16B16A16,
+  };
+  const int width = 13, height = 7;
+  guint i;
+  gsize j;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++)
+    {
+      GdkTexture *texture, *texture2;
+      GBytes *bytes, *png;
+      GError *error = NULL;
+      guchar *data;
+      gsize bpp, size;
+
+      bpp = formats[i] == GDK_MEMORY_R16G16B16A16 ? 8
+          : (formats[i] == GDK_MEMORY_R8G8B8 || formats[i] == GDK_MEMORY_B8G8R8) ? 3
+          : 4;
+      size = bpp * width * height;
+      data = g_malloc (size);
+      for (j = 0; j < size; j++)
+        data[j] = g_test_rand_int_range (0, 256);
+      bytes = g_bytes_new_take (data, size);
+      texture = gdk_memory_texture_new (width, height, formats[i], bytes, bpp * width);
+      g_bytes_unref (bytes);
+
+      png = gdk_save_png_with_flags (texture, GDK_PNG_SAVE_FAST);
+      g_assert_nonnull (png);
+
+      texture2 = gdk_load_png (png, &error);
+      g_assert_no_error (error);
+
+      assert_texture_equal (texture, texture2);
+
+      g_object_unref (texture2);
+      g_object_unref (texture);
+      g_bytes_unref (png);
+    }
+}
+
+static void
+test_load_gtex (void)
+{
+  char *path;
+  GdkTexture *texture, *texture2;
+  GdkTextureDownloader *downloader;
+  GError *error = NULL;
+  GBytes *bytes, *pixels;
+  const guchar *data, *pixel_data;
+  gsize size, stride;
+  const guint32 bad_offsets[] = { 33, 40, 0, 0xfffffff0 };
+  guint i;
+
+  path = g_test_build_filename (G_TEST_DIST, "image-data", "image.png", NULL);
+  texture = gdk_texture_new_from_filename (path, &error);
+  g_assert_no_error (error);
+
+  bytes = gdk_save_gtex (texture);
+  g_assert_true (gdk_is_gtex (bytes));
+
+  texture2 = gdk_texture_new_from_bytes (bytes, &error);
+  g_assert_no_error (error);
+  g_assert_true (GDK_IS_MEMORY_TEXTURE (texture2));
+  g_assert_cmpint (gdk_texture_get_format (texture2), ==, gdk_texture_get_format (texture));
+  assert_texture_equal (texture, texture2);
+
+  /* The pixels are used in place */
+  downloader = gdk_texture_downloader_new (texture2);
+  gdk_texture_downloader_set_format (downloader, gdk_texture_get_format (texture2));
+  pixels = gdk_texture_downloader_download_bytes (downloader, &stride);
+  data = g_bytes_get_data (bytes, &size);
+  pixel_data = g_bytes_get_data (pixels, NULL);
+  g_assert_true (pixel_data > data && pixel_data < data + size);
+
+  g_bytes_unref (pixels);
+  gdk_texture_downloader_free (downloader);
+  g_object_unref (texture2);
+
+  /* Truncated data must be rejected */
+  pixels = g_bytes_new_from_bytes (bytes, 0, size - 1);
+  texture2 = gdk_load_gtex (pixels, &error);
+  g_assert_error (error, GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_CORRUPT_IMAGE);
+  g_assert_null (texture2);
+  g_clear_error (&error);
+  g_bytes_unref (pixels);
+
+  /* So must headers with a misaligned or out of bounds data offset.
+   * The offset is the last field of the 32 byte header.
+   */
+  for (i = 0; i < G_N_ELEMENTS (bad_offsets); i++)
+    {
+      guchar *copy = g_memdup2 (data, size);
+
+      memcpy (copy + 28, &bad_offsets[i], sizeof (guint32));
+      pixels = g_bytes_new_take (copy, size);
+      texture2 = gdk_load_gtex (pixels, &error);
+      g_assert_error (error, GDK_TEXTURE_ERROR, GDK_TEXTURE_ERROR_CORRUPT_IMAGE);
+      g_assert_null (texture2);
+      g_clear_error (&error);
+      g_bytes_unref (pixels);
+    }
+
+  g_bytes_unref (bytes);
+  g_object_unref (texture);
+  g_free (path);
+}
+
 static void
 test_load_image_fail (gconstpointer data)
 {
@@ -135,6 +308,245 @@ test_load_image_fail (gconstpointer data)
   g_free (path);
 }
 
+typedef struct
+{
+  GPtrArray *order;
+  guint n_pending;
+  guint n_cancelled;
+} LoaderData;
+
+typedef struct
+{
+  LoaderData *ld;
+  const char *name;
+} LoaderRequest;
+
+static void
+loader_done (GObject      *source,
+             GAsyncResult *result,
+             gpointer      data)
+{
+  LoaderRequest *request = data;
+  LoaderData *ld = request->ld;
+  GdkTexture *texture;
+  GError *error = NULL;
+
+  texture = gdk_texture_loader_load_finish (GDK_TEXTURE_LOADER (source), result, &error);
+  if (texture)
+    {
+      g_assert_no_error (error);
+      g_assert_cmpint (gdk_texture_get_width (texture), ==, 8);
+      g_ptr_array_add (ld->order, (gpointer) request->name);
+      g_object_unref (texture);
+    }
+  else
+    {
+      g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+      g_error_free (error);
+      ld->n_cancelled++;
+    }
+
+  ld->n_pending--;
+  g_main_context_wakeup (NULL);
+}
+
+static void
+test_texture_loader (void)
+{
+  GdkTextureLoader *loader;
+  GCancellable *cancellable;
+  LoaderData ld;
+  const char *names[] = { "image.png", "image.jpeg", "image-gray.png", "image.tiff", "image-palette.png" };
+  const char *expected[] = { "image.png", "image-palette.png", "image.tiff", "image.jpeg", "image.tiff" };
+  LoaderRequest requests[G_N_ELEMENTS (names)];
+  guint ids[G_N_ELEMENTS (names)];
+  guint extra_id;
+  GFile *files[G_N_ELEMENTS (names)];
+  char *path;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (files); i++)
+    {
+      path = g_test_build_filename (G_TEST_DIST, "image-data", names[i], NULL);
+      files[i] = g_file_new_for_path (path);
+      requests[i].ld = &ld;
+      requests[i].name = names[i];
+      g_free (path);
+    }
+
+  ld.order = g_ptr_array_new ();
+  ld.n_pending = 0;
+  ld.n_cancelled = 0;
+
+  /* With a single worker and a budget of 1 byte, the worker waits
+   * after the first image until it has been delivered, which needs
+   * the main loop. So everything queued before iterating the main
+   * loop is still pending when we change priorities.
+   */
+  loader = gdk_texture_loader_new (1);
+  gdk_texture_loader_set_memory_budget (loader, 1);
+  cancellable = g_cancellable_new ();
+
+  /* The gate goes first, no matter when the worker starts */
+  gdk_texture_loader_load_async (loader, files[0], 8, 8,
+                                 G_PRIORITY_HIGH, NULL,
+                                 loader_done, &requests[0]);
+  ld.n_pending++;
+
+  for (i = 1; i < G_N_ELEMENTS (files); i++)
+    {
+      ids[i] = gdk_texture_loader_load_async (loader, files[i], 8, 8,
+                                              G_PRIORITY_LOW,
+                                              i == 2 ? cancellable : NULL,
+                                              loader_done, &requests[i]);
+      g_assert_cmpuint (ids[i], !=, 0);
+      ld.n_pending++;
+    }
+
+  /* Priorities are per request, so this doesn't move the
+   * first request for the same file.
+   */
+  extra_id = gdk_texture_loader_load_async (loader, files[3], 8, 8,
+                                            G_PRIORITY_LOW, NULL,
+                                            loader_done, &requests[3]);
+  ld.n_pending++;
+
+  gdk_texture_loader_set_priority (loader, ids[4], G_PRIORITY_HIGH);
+  gdk_texture_loader_set_priority (loader, extra_id, G_PRIORITY_HIGH);
+  g_cancellable_cancel (cancellable);
+
+  /* Cancelled requests are dropped from the queue right away,
+   * they don't wait for the worker, which is still blocked on
+   * the gate.
+   */
+  while (ld.n_cancelled == 0)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_cmpuint (ld.order->len, <=, 1);
+
+  while (ld.n_pending > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (ld.order->len, ==, G_N_ELEMENTS (expected));
+  for (i = 0; i < G_N_ELEMENTS (expected); i++)
+    g_assert_cmpstr (g_ptr_array_index (ld.order, i), ==, expected[i]);
+
+  g_ptr_array_unref (ld.order);
+  g_object_unref (cancellable);
+  g_object_unref (loader);
+  for (i = 0; i < G_N_ELEMENTS (files); i++)
+    g_object_unref (files[i]);
+}
+
+static void
+test_stream_paintable (gconstpointer data)
+{
+  const char *filename = data;
+  GdkStreamPaintable *paintable;
+  GInputStream *stream;
+  GdkTexture *texture;
+  char *path;
+  GFile *file;
+  GError *error = NULL;
+
+  path = g_test_build_filename (G_TEST_DIST, "image-data", filename, NULL);
+  file = g_file_new_for_path (path);
+  stream = G_INPUT_STREAM (g_file_read (file, NULL, &error));
+  g_assert_no_error (error);
+
+  paintable = gdk_stream_paintable_new (stream, NULL);
+  g_assert_true (gdk_stream_paintable_is_loading (paintable));
+
+  while (gdk_stream_paintable_is_loading (paintable))
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_null (gdk_stream_paintable_get_error (paintable));
+  texture = gdk_stream_paintable_get_texture (paintable);
+  g_assert_true (GDK_IS_TEXTURE (texture));
+  g_assert_cmpint (gdk_texture_get_width (texture), ==, 32);
+  g_assert_cmpint (gdk_texture_get_height (texture), ==, 32);
+  g_assert_cmpint (gdk_paintable_get_intrinsic_width (GDK_PAINTABLE (paintable)), ==, 32);
+  g_assert_cmpint (gdk_paintable_get_intrinsic_height (GDK_PAINTABLE (paintable)), ==, 32);
+
+  g_object_unref (paintable);
+  g_object_unref (stream);
+  g_object_unref (file);
+  g_free (path);
+}
+
+static void
+test_progressive_png (gconstpointer data)
+{
+  const char *filename = data;
+  GdkProgressiveImage image = { 0, };
+  GdkTextureDownloader *downloader;
+  GdkPngDecoder *decoder;
+  GdkTexture *reference;
+  GBytes *bytes;
+  guchar *expected;
+  const guchar *png;
+  gboolean seen_partial = FALSE;
+  char *path;
+  gsize i, size;
+  GError *error = NULL;
+
+  path = g_test_build_filename (G_TEST_DIST, "image-data", filename, NULL);
+  g_file_get_contents (path, (char **) &png, &size, &error);
+  g_assert_no_error (error);
+  bytes = g_bytes_new_take ((gpointer) png, size);
+
+  reference = gdk_load_png (bytes, &error);
+  g_assert_no_error (error);
+
+  decoder = gdk_png_decoder_new (&image);
+
+  /* Feed the data byte by byte and check every intermediate state */
+  for (i = 0; i < size; i++)
+    {
+      int row;
+
+      g_assert_true (gdk_png_decoder_feed (decoder, png + i, 1, &error));
+      g_assert_no_error (error);
+
+      if (image.data == NULL || image.done)
+        continue;
+
+      g_assert_cmpint (image.n_final_rows, <=, image.n_rows);
+      g_assert_cmpint (image.n_rows, <=, image.height);
+
+      if (image.n_rows == 0 || seen_partial)
+        continue;
+
+      /* The first rows that show up are never blank, in interlaced
+       * images the first pass fills the rows it skips.
+       */
+      seen_partial = TRUE;
+      for (row = 1; row < image.n_rows; row++)
+        g_assert_cmpmem (image.data + row * image.stride, image.stride,
+                         image.data, image.stride);
+    }
+
+  g_assert_true (seen_partial);
+  g_assert_true (gdk_png_decoder_finish (decoder, &error));
+  g_assert_no_error (error);
+  g_assert_cmpint (image.n_rows, ==, image.height);
+  g_assert_cmpint (image.n_final_rows, ==, image.height);
+
+  expected = g_malloc0 (image.height * image.stride);
+  downloader = gdk_texture_downloader_new (reference);
+  gdk_texture_downloader_set_format (downloader, image.format);
+  gdk_texture_downloader_download_into (downloader, expected, image.stride);
+  g_assert_cmpmem (image.data, image.height * image.stride,
+                   expected, image.height * image.stride);
+
+  gdk_texture_downloader_free (downloader);
+  g_free (expected);
+  g_free (image.data);
+  gdk_png_decoder_free (decoder);
+  g_object_unref (reference);
+  g_bytes_unref (bytes);
+  g_free (path);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -155,6 +567,12 @@ main (int argc, char *argv[])
      char *test = g_strconcat ("/image/load/", name, NULL);
      g_test_add_data_func (test, name, test_load_image);
      g_free (test);
+     test = g_strconcat ("/image/load-at-size/", name, NULL);
+     g_test_add_data_func (test, name, test_load_image_at_size);
+     g_free (test);
+     test = g_strconcat ("/image/stream/", name, NULL);
+     g_test_add_data_func (test, name, test_stream_paintable);
+     g_free (test);
    }
 
   path = g_test_build_filename (G_TEST_DIST, "bad-image-data", NULL);
@@ -172,6 +590,11 @@ main (int argc, char *argv[])
   g_test_add_data_func ("/image/save/image.png", "image.png", test_save_image);
   g_test_add_data_func ("/image/save/image.tiff", "image.tiff", test_save_image);
   g_test_add_data_func ("/image/save/image.jpeg", "image.jpeg", test_save_image);
+  g_test_add_func ("/image/save/fast-png", test_save_png_fast);
+  g_test_add_func ("/image/load/gtex", test_load_gtex);
+  g_test_add_func ("/image/loader", test_texture_loader);
+  g_test_add_data_func ("/image/progressive/image.png", "image.png", test_progressive_png);
+  g_test_add_data_func ("/image/progressive/image-palette.png", "image-palette.png", test_progressive_png);
 
   return g_test_run ();
 }
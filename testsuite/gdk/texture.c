@@ -399,6 +399,72 @@ test_texture_diff (void)
   g_object_unref (texture0);
 }
 
+static void
+test_texture_mipmap (void)
+{
+  static const guint32 pixels[] = {
+    0xFF000000, 0xFF040404, 0xFF080808, 0xFF0C0C0C,
+    0xFF101010, 0xFF141414, 0xFF181818, 0xFF1C1C1C,
+  };
+  GdkTexture *texture, *mipmap, *mipmap2;
+  cairo_surface_t *surface, *surface2;
+  const guint32 *data;
+  guint32 downloaded[2];
+  GBytes *bytes;
+
+  bytes = g_bytes_new_static (pixels, sizeof (pixels));
+  texture = gdk_memory_texture_new (4, 2, GDK_MEMORY_DEFAULT, bytes, 16);
+  g_bytes_unref (bytes);
+
+  g_assert_cmpuint (gdk_texture_get_mipmap_level (texture, 4, 2), ==, 0);
+  g_assert_cmpuint (gdk_texture_get_mipmap_level (texture, 3, 2), ==, 0);
+  g_assert_cmpuint (gdk_texture_get_mipmap_level (texture, 2, 1), ==, 1);
+  g_assert_cmpuint (gdk_texture_get_mipmap_level (texture, 1, 1), ==, 1);
+  g_assert_cmpuint (gdk_texture_get_mipmap_level (texture, 0.5, 0.5), ==, 0);
+
+  /* Each level averages 2x2 blocks of the previous one */
+  surface = gdk_texture_get_mipmap_surface (texture, 1);
+  g_assert_cmpint (cairo_image_surface_get_width (surface), ==, 2);
+  g_assert_cmpint (cairo_image_surface_get_height (surface), ==, 1);
+  data = (const guint32 *) cairo_image_surface_get_data (surface);
+  g_assert_cmphex (data[0], ==, 0xFF0A0A0A);
+  g_assert_cmphex (data[1], ==, 0xFF121212);
+
+  /* Odd sizes repeat the last row */
+  surface2 = gdk_texture_get_mipmap_surface (texture, 2);
+  g_assert_cmpint (cairo_image_surface_get_width (surface2), ==, 1);
+  g_assert_cmpint (cairo_image_surface_get_height (surface2), ==, 1);
+  data = (const guint32 *) cairo_image_surface_get_data (surface2);
+  g_assert_cmphex (data[0], ==, 0xFF0E0E0E);
+  cairo_surface_destroy (surface2);
+
+  /* Levels are cached */
+  surface2 = gdk_texture_get_mipmap_surface (texture, 1);
+  g_assert_true (surface2 == surface);
+  cairo_surface_destroy (surface2);
+
+  /* The texture of a level shares its pixels and is cached, too */
+  mipmap = gdk_texture_get_mipmap (texture, 1);
+  g_assert_cmpint (gdk_texture_get_width (mipmap), ==, 2);
+  g_assert_cmpint (gdk_texture_get_height (mipmap), ==, 1);
+  gdk_texture_download (mipmap, (guchar *) downloaded, sizeof (downloaded));
+  g_assert_cmphex (downloaded[0], ==, 0xFF0A0A0A);
+  g_assert_cmphex (downloaded[1], ==, 0xFF121212);
+
+  mipmap2 = gdk_texture_get_mipmap (texture, 1);
+  g_assert_true (mipmap2 == mipmap);
+  g_object_unref (mipmap2);
+
+  /* Dropping the texture drops its levels */
+  g_object_add_weak_pointer (G_OBJECT (mipmap), (gpointer *) &mipmap);
+  g_object_unref (mipmap);
+  g_assert_nonnull (mipmap);
+  g_object_unref (texture);
+  g_assert_null (mipmap);
+
+  cairo_surface_destroy (surface);
+}
+
 static void
 test_texture_downloader (void)
 {
@@ -457,6 +523,7 @@ main (int argc, char *argv[])
   g_test_add_func ("/texture/icon/serialize", test_texture_icon_serialize);
   g_test_add_func ("/texture/diff", test_texture_diff);
   g_test_add_func ("/texture/downloader", test_texture_downloader);
+  g_test_add_func ("/texture/mipmap", test_texture_mipmap);
 
   return g_test_run ();
 }
@@ -0,0 +1,488 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+#include "gdk/gdktextureprivate.h"
+#include "gsk/gpu/gskgpudeviceprivate.h"
+#include "gsk/gpu/gskgpuframeprivate.h"
+#include "gsk/gpu/gskgpuimageprivate.h"
+#include "gsk/gpu/gskgpurendererprivate.h"
+#ifdef GDK_RENDERING_VULKAN
+#include "gsk/gpu/gskvulkanframeprivate.h"
+#endif
+
+static GskRenderer *
+create_renderer (GskRenderer *renderer)
+{
+  GError *error = NULL;
+
+  if (!gsk_renderer_realize_for_display (renderer, gdk_display_get_default (), &error))
+    {
+      g_test_skip_printf ("Could not realize renderer: %s", error->message);
+      g_clear_error (&error);
+      g_object_unref (renderer);
+      return NULL;
+    }
+
+  GSK_GPU_RENDERER_GET_CLASS (renderer)->make_current (GSK_GPU_RENDERER (renderer));
+
+  return renderer;
+}
+
+static GskPath *
+create_square (float size)
+{
+  GskPathBuilder *builder;
+
+  builder = gsk_path_builder_new ();
+  gsk_path_builder_add_rect (builder, &GRAPHENE_RECT_INIT (0, 0, size, size));
+
+  return gsk_path_builder_free_to_path (builder);
+}
+
+static void
+test_path_cache_second_frame (void)
+{
+  GskRenderer *renderer;
+  GskGpuDevice *device;
+  GskGpuImage *image, *cached;
+  GskPath *path;
+  graphene_vec2_t scale;
+  graphene_rect_t rect = GRAPHENE_RECT_INIT (0, 0, 64, 64);
+
+  renderer = create_renderer (gsk_ngl_renderer_new ());
+  if (renderer == NULL)
+    return;
+
+  device = gsk_gpu_renderer_get_device (GSK_GPU_RENDERER (renderer));
+  graphene_vec2_init (&scale, 1, 1);
+  path = create_square (64);
+  image = gsk_gpu_device_create_offscreen_image (device, FALSE, GDK_MEMORY_U8, 64, 64);
+
+  /* First frame: the path is only remembered */
+  g_assert_null (gsk_gpu_device_lookup_path_image (device, path, NULL, GSK_FILL_RULE_WINDING, &scale, &rect, 1000));
+  gsk_gpu_device_cache_path_image (device, path, NULL, GSK_FILL_RULE_WINDING, &scale, &rect, 1000, image);
+  g_assert_null (gsk_gpu_device_lookup_path_image (device, path, NULL, GSK_FILL_RULE_WINDING, &scale, &rect, 1000));
+
+  /* Drawing it again in the same frame doesn't count */
+  gsk_gpu_device_cache_path_image (device, path, NULL, GSK_FILL_RULE_WINDING, &scale, &rect, 1000, image);
+  g_assert_null (gsk_gpu_device_lookup_path_image (device, path, NULL, GSK_FILL_RULE_WINDING, &scale, &rect, 1000));
+
+  /* Second frame: the mask is kept */
+  gsk_gpu_device_cache_path_image (device, path, NULL, GSK_FILL_RULE_WINDING, &scale, &rect, 2000, image);
+  cached = gsk_gpu_device_lookup_path_image (device, path, NULL, GSK_FILL_RULE_WINDING, &scale, &rect, 3000);
+  g_assert_true (cached == image);
+  g_object_unref (cached);
+
+  /* Different fill rules, scales or areas miss */
+  g_assert_null (gsk_gpu_device_lookup_path_image (device, path, NULL, GSK_FILL_RULE_EVEN_ODD, &scale, &rect, 3000));
+  g_assert_null (gsk_gpu_device_lookup_path_image (device, path, NULL, GSK_FILL_RULE_WINDING, &scale,
+                                                   &GRAPHENE_RECT_INIT (1, 0, 64, 64), 3000));
+  graphene_vec2_init (&scale, 2, 2);
+  g_assert_null (gsk_gpu_device_lookup_path_image (device, path, NULL, GSK_FILL_RULE_WINDING, &scale, &rect, 3000));
+
+  g_object_unref (image);
+  gsk_path_unref (path);
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+}
+
+#define N_BIG_PATHS 16
+
+static void
+test_path_cache_evict (void)
+{
+  GskRenderer *renderer;
+  GskGpuDevice *device;
+  GskGpuImage *image, *cached;
+  GskPath *paths[N_BIG_PATHS];
+  graphene_vec2_t scale;
+  graphene_rect_t rect = GRAPHENE_RECT_INIT (0, 0, 1024, 1024);
+  guint i;
+
+  renderer = create_renderer (gsk_ngl_renderer_new ());
+  if (renderer == NULL)
+    return;
+
+  device = gsk_gpu_renderer_get_device (GSK_GPU_RENDERER (renderer));
+  graphene_vec2_init (&scale, 1, 1);
+
+  /* 4 MB per mask, so these go way over the budget of the cache */
+  for (i = 0; i < N_BIG_PATHS; i++)
+    {
+      paths[i] = create_square (1024);
+      image = gsk_gpu_device_create_offscreen_image (device, FALSE, GDK_MEMORY_U8, 1024, 1024);
+      gsk_gpu_device_cache_path_image (device, paths[i], NULL, GSK_FILL_RULE_WINDING, &scale, &rect, 1000, image);
+      gsk_gpu_device_cache_path_image (device, paths[i], NULL, GSK_FILL_RULE_WINDING, &scale, &rect, 2000 + i, image);
+      g_object_unref (image);
+
+      /* Keep using the first path, so it stays cached */
+      cached = gsk_gpu_device_lookup_path_image (device, paths[0], NULL, GSK_FILL_RULE_WINDING, &scale, &rect, 2000 + i);
+      g_assert_nonnull (cached);
+      g_object_unref (cached);
+    }
+
+  /* The oldest ones got evicted */
+  g_assert_null (gsk_gpu_device_lookup_path_image (device, paths[1], NULL, GSK_FILL_RULE_WINDING, &scale, &rect, 3000));
+  g_assert_null (gsk_gpu_device_lookup_path_image (device, paths[2], NULL, GSK_FILL_RULE_WINDING, &scale, &rect, 3000));
+
+  cached = gsk_gpu_device_lookup_path_image (device, paths[N_BIG_PATHS - 1], NULL, GSK_FILL_RULE_WINDING, &scale, &rect, 3000);
+  g_assert_nonnull (cached);
+  g_object_unref (cached);
+
+  for (i = 0; i < N_BIG_PATHS; i++)
+    gsk_path_unref (paths[i]);
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+}
+
+static void
+test_texture_scale_mipmap (void)
+{
+  GskRenderer *renderer;
+  GskGpuDevice *device;
+  GskGpuImage *image, *cached;
+  GdkTexture *texture, *mipmap, *result;
+  GskRenderNode *node;
+  GBytes *bytes;
+
+  renderer = create_renderer (gsk_ngl_renderer_new ());
+  if (renderer == NULL)
+    return;
+
+  device = gsk_gpu_renderer_get_device (GSK_GPU_RENDERER (renderer));
+  bytes = g_bytes_new_take (g_malloc0 (256 * 256 * 4), 256 * 256 * 4);
+  texture = gdk_memory_texture_new (256, 256, GDK_MEMORY_DEFAULT, bytes, 256 * 4);
+  g_bytes_unref (bytes);
+  node = gsk_texture_scale_node_new (texture, &GRAPHENE_RECT_INIT (0, 0, 32, 32), GSK_SCALING_FILTER_TRILINEAR);
+
+  result = gsk_renderer_render_texture (renderer, node, NULL);
+  g_object_unref (result);
+
+  /* Only the mipmap level shared with cairo got uploaded */
+  g_assert_null (gsk_gpu_device_lookup_texture_image (device, texture, g_get_monotonic_time ()));
+  mipmap = gdk_texture_get_mipmap (texture, 3);
+  g_assert_cmpint (gdk_texture_get_width (mipmap), ==, 32);
+  image = gsk_gpu_device_lookup_texture_image (device, mipmap, g_get_monotonic_time ());
+  g_assert_nonnull (image);
+  g_assert_true (gsk_gpu_image_get_flags (image) & GSK_GPU_IMAGE_MIPMAP);
+
+  /* The second frame reuses the mipmapped image */
+  result = gsk_renderer_render_texture (renderer, node, NULL);
+  g_object_unref (result);
+
+  cached = gsk_gpu_device_lookup_texture_image (device, mipmap, g_get_monotonic_time ());
+  g_assert_true (cached == image);
+  g_object_unref (cached);
+
+  g_object_unref (image);
+  g_object_unref (mipmap);
+  gsk_render_node_unref (node);
+  g_object_unref (texture);
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+}
+
+#define N_FONT_SIZES 20
+#define N_DEAD_FONT_SIZES 6
+#define GRID_WIDTH 1440
+#define GRID_HEIGHT 1150
+
+/* Loads the color glyph test font at big sizes, so a few of its
+ * glyphs fill an atlas.
+ */
+static void
+load_color_fonts (PangoFont **fonts)
+{
+  GskRenderNode *node;
+  PangoFontMap *fontmap;
+  PangoContext *context;
+  PangoFontDescription *desc;
+  char *filename, *contents;
+  GBytes *bytes;
+  gsize length;
+  guint i;
+
+  filename = g_test_build_filename (G_TEST_DIST, "compare", "text-mixed-color-colrv1.node", NULL);
+  g_file_get_contents (filename, &contents, &length, NULL);
+  bytes = g_bytes_new_take (contents, length);
+  node = gsk_render_node_deserialize (bytes, NULL, NULL);
+  g_assert_true (gsk_render_node_get_node_type (node) == GSK_TEXT_NODE);
+
+  fontmap = pango_font_get_font_map (gsk_text_node_get_font (node));
+  context = pango_font_map_create_context (fontmap);
+  desc = pango_font_describe (gsk_text_node_get_font (node));
+
+  for (i = 0; i < N_FONT_SIZES; i++)
+    {
+      pango_font_description_set_absolute_size (desc, (200 + i) * PANGO_SCALE);
+      fonts[i] = pango_font_map_load_font (fontmap, context, desc);
+    }
+
+  pango_font_description_free (desc);
+  g_object_unref (context);
+  gsk_render_node_unref (node);
+  g_bytes_unref (bytes);
+  g_free (filename);
+}
+
+/* Draws the color glyphs of fonts[first] to fonts[N_FONT_SIZES - 1],
+ * each font keeps its place in the grid.
+ */
+static GskRenderNode *
+create_glyph_grid (PangoFont **fonts,
+                   guint       first)
+{
+  GskRenderNode *nodes[N_FONT_SIZES], *result;
+  PangoGlyphString *glyphs;
+  guint i, j;
+
+  glyphs = pango_glyph_string_new ();
+  pango_glyph_string_set_size (glyphs, 3);
+  for (j = 0; j < 3; j++)
+    {
+      glyphs->glyphs[j].glyph = 4 + j;
+      glyphs->glyphs[j].geometry = (PangoGlyphGeometry) { 120 * PANGO_SCALE, 0, 0 };
+      glyphs->glyphs[j].attr.is_cluster_start = 1;
+      glyphs->glyphs[j].attr.is_color = 1;
+    }
+
+  for (i = first; i < N_FONT_SIZES; i++)
+    nodes[i - first] = gsk_text_node_new (fonts[i],
+                                          glyphs,
+                                          &(GdkRGBA) { 0, 0, 0, 1 },
+                                          &GRAPHENE_POINT_INIT (360 * (i % 4), 230 * (i / 4 + 1)));
+
+  result = gsk_container_node_new (nodes, N_FONT_SIZES - first);
+
+  for (i = first; i < N_FONT_SIZES; i++)
+    gsk_render_node_unref (nodes[i - first]);
+  pango_glyph_string_free (glyphs);
+
+  return result;
+}
+
+static GdkTexture *
+render_at (GskRenderer   *renderer,
+           GskRenderNode *node,
+           gint64         timestamp)
+{
+  GskGpuDevice *device;
+  GskGpuFrame *frame;
+  GskGpuImage *image;
+  GdkTexture *texture = NULL;
+
+  device = gsk_gpu_renderer_get_device (GSK_GPU_RENDERER (renderer));
+  image = gsk_gpu_device_create_download_image (device, GDK_MEMORY_U8, GRID_WIDTH, GRID_HEIGHT);
+  frame = gsk_gpu_renderer_create_frame (GSK_GPU_RENDERER (renderer));
+
+  gsk_gpu_frame_render (frame,
+                        timestamp,
+                        image,
+                        NULL,
+                        node,
+                        &GRAPHENE_RECT_INIT (0, 0, GRID_WIDTH, GRID_HEIGHT),
+                        &texture);
+
+  g_object_unref (frame);
+  g_object_unref (image);
+  g_assert_nonnull (texture);
+
+  return texture;
+}
+
+static void
+assert_textures_equal (GdkTexture *texture1,
+                       GdkTexture *texture2)
+{
+  guchar *data1, *data2;
+
+  data1 = g_malloc (GRID_WIDTH * GRID_HEIGHT * 4);
+  data2 = g_malloc (GRID_WIDTH * GRID_HEIGHT * 4);
+  gdk_texture_download (texture1, data1, GRID_WIDTH * 4);
+  gdk_texture_download (texture2, data2, GRID_WIDTH * 4);
+
+  g_assert_true (memcmp (data1, data2, GRID_WIDTH * GRID_HEIGHT * 4) == 0);
+
+  g_free (data1);
+  g_free (data2);
+}
+
+static void
+get_atlas_stats (GskGpuDevice     *device,
+                 GskGpuAtlasStats *stats)
+{
+  gsk_gpu_device_get_atlas_stats (device, stats);
+
+  g_assert_cmpuint (stats->used_pixels, >=, stats->dead_pixels);
+  g_assert_cmpuint (stats->used_pixels - stats->dead_pixels, ==, stats->live_pixels);
+}
+
+static void
+test_glyph_cache_compact (void)
+{
+  GskRenderer *renderer;
+  GskGpuDevice *device;
+  PangoFont *fonts[N_FONT_SIZES];
+  GskRenderNode *all, *survivors;
+  GdkTexture *expected, *texture;
+  GskGpuAtlasStats stats;
+  gint64 start;
+  guint i, n_atlases;
+
+  renderer = create_renderer (gsk_ngl_renderer_new ());
+  if (renderer == NULL)
+    return;
+
+  if (!(GSK_GPU_RENDERER_GET_CLASS (renderer)->optimizations & GSK_GPU_OPTIMIZE_BLIT))
+    {
+      g_test_skip ("Compacting atlases needs blits");
+      gsk_renderer_unrealize (renderer);
+      g_object_unref (renderer);
+      return;
+    }
+
+  device = gsk_gpu_renderer_get_device (GSK_GPU_RENDERER (renderer));
+  load_color_fonts (fonts);
+  all = create_glyph_grid (fonts, 0);
+  survivors = create_glyph_grid (fonts, N_DEAD_FONT_SIZES);
+  start = g_get_monotonic_time ();
+
+  /* The glyphs don't fit into one atlas, and the first fonts end up
+   * on the first one.
+   */
+  texture = render_at (renderer, all, start);
+  g_object_unref (texture);
+  get_atlas_stats (device, &stats);
+  g_assert_cmpuint (stats.n_atlases, >=, 2);
+  g_assert_cmpuint (stats.dead_pixels, ==, 0);
+
+  /* After a while, only some glyphs are still used. The dead ones
+   * fragment the first atlas, so it gets compacted.
+   */
+  expected = render_at (renderer, survivors, start + 5 * G_USEC_PER_SEC);
+  gsk_gpu_device_gc (device, start + 5 * G_USEC_PER_SEC);
+  get_atlas_stats (device, &stats);
+  g_assert_cmpuint (stats.n_compacting, ==, 1);
+  g_assert_cmpuint (stats.dead_pixels, >, 1024 * 1024 / 4);
+
+  /* Using the glyphs moves them to the current atlas */
+  texture = render_at (renderer, survivors, start + 6 * G_USEC_PER_SEC);
+  assert_textures_equal (texture, expected);
+  g_object_unref (texture);
+  get_atlas_stats (device, &stats);
+  g_assert_cmpuint (stats.compacted_glyphs, >, 0);
+  n_atlases = stats.n_atlases;
+
+  /* Then the old atlas goes away */
+  gsk_gpu_device_gc (device, start + 6 * G_USEC_PER_SEC);
+  get_atlas_stats (device, &stats);
+  g_assert_cmpuint (stats.n_compacting, ==, 0);
+  g_assert_cmpuint (stats.n_atlases, ==, n_atlases - 1);
+
+  /* And the moved glyphs still draw the same */
+  texture = render_at (renderer, survivors, start + 7 * G_USEC_PER_SEC);
+  assert_textures_equal (texture, expected);
+  g_object_unref (texture);
+  get_atlas_stats (device, &stats);
+  g_assert_cmpuint (stats.compacted_glyphs, ==, 0);
+
+  g_object_unref (expected);
+  gsk_render_node_unref (survivors);
+  gsk_render_node_unref (all);
+  for (i = 0; i < N_FONT_SIZES; i++)
+    g_object_unref (fonts[i]);
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+}
+
+#ifdef GDK_RENDERING_VULKAN
+static void
+next_frame (GskGpuFrame *frame)
+{
+  GskVulkanDevice *device = GSK_VULKAN_DEVICE (gsk_gpu_frame_get_device (frame));
+  VkFence fence;
+
+  GSK_GPU_FRAME_GET_CLASS (frame)->cleanup (frame);
+
+  /* Nothing gets drawn, but the next cleanup waits for the fence */
+  fence = gsk_vulkan_frame_get_vk_fence (GSK_VULKAN_FRAME (frame));
+  g_assert_cmpint (vkQueueSubmit (gsk_vulkan_device_get_vk_queue (device), 0, NULL, fence), ==, VK_SUCCESS);
+}
+
+#define BIG_UPLOAD (20 * 1024 * 1024)
+
+static void
+test_upload_buffer_shrink (void)
+{
+  GskRenderer *renderer;
+  GskGpuDevice *device;
+  GskGpuFrame *frame;
+  gsize offset;
+  guint i;
+
+  renderer = create_renderer (gsk_vulkan_renderer_new ());
+  if (renderer == NULL)
+    return;
+
+  device = gsk_gpu_renderer_get_device (GSK_GPU_RENDERER (renderer));
+  frame = g_object_new (GSK_TYPE_VULKAN_FRAME, NULL);
+  gsk_gpu_frame_setup (frame, GSK_GPU_RENDERER (renderer), device, 0);
+
+  /* Too big for the default buffer, but the next frame grows it */
+  g_assert_null (gsk_vulkan_frame_reserve_upload_data (GSK_VULKAN_FRAME (frame), BIG_UPLOAD, 4, &offset));
+  next_frame (frame);
+  g_assert_nonnull (gsk_vulkan_frame_reserve_upload_data (GSK_VULKAN_FRAME (frame), BIG_UPLOAD, 4, &offset));
+  next_frame (frame);
+
+  /* A few small frames keep the big buffer around */
+  for (i = 0; i < 10; i++)
+    {
+      g_assert_nonnull (gsk_vulkan_frame_reserve_upload_data (GSK_VULKAN_FRAME (frame), 1024, 4, &offset));
+      next_frame (frame);
+    }
+  g_assert_nonnull (gsk_vulkan_frame_reserve_upload_data (GSK_VULKAN_FRAME (frame), BIG_UPLOAD, 4, &offset));
+  next_frame (frame);
+
+  /* Many of them shrink it back */
+  for (i = 0; i < 100; i++)
+    {
+      g_assert_nonnull (gsk_vulkan_frame_reserve_upload_data (GSK_VULKAN_FRAME (frame), 1024, 4, &offset));
+      next_frame (frame);
+    }
+  g_assert_null (gsk_vulkan_frame_reserve_upload_data (GSK_VULKAN_FRAME (frame), BIG_UPLOAD, 4, &offset));
+  next_frame (frame);
+
+  g_object_unref (frame);
+  gsk_renderer_unrealize (renderer);
+  g_object_unref (renderer);
+}
+#endif
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/gpu/path-cache/second-frame", test_path_cache_second_frame);
+  g_test_add_func ("/gpu/path-cache/evict", test_path_cache_evict);
+  g_test_add_func ("/gpu/texture-cache/scale-mipmap", test_texture_scale_mipmap);
+  g_test_add_func ("/gpu/glyph-cache/compact", test_glyph_cache_compact);
+#ifdef GDK_RENDERING_VULKAN
+  g_test_add_func ("/gpu/vulkan/upload-buffer-shrink", test_upload_buffer_shrink);
+#endif
+
+  return g_test_run ();
+}
@@ -0,0 +1,87 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+#include "gsk/gpu/gskgpuuploadopprivate.h"
+
+#define SIZE 16
+
+static guint
+get_alpha (const guint32 *pixels,
+           int            x,
+           int            y)
+{
+  return pixels[y * SIZE + x] >> 24;
+}
+
+static void
+test_sdf_square (void)
+{
+  guint32 pixels[SIZE * SIZE];
+  int x, y;
+
+  /* A square from 4 to 11 */
+  for (y = 0; y < SIZE; y++)
+    for (x = 0; x < SIZE; x++)
+      pixels[y * SIZE + x] = (x >= 4 && x < 12 && y >= 4 && y < 12) ? 0xffffffff : 0;
+
+  gsk_gpu_glyph_convert_to_sdf ((guchar *) pixels, SIZE, SIZE, SIZE * 4);
+
+  /* The outline is at 0.5, half a pixel from the edge pixels */
+  g_assert_cmpint (get_alpha (pixels, 4, 8), >, 128);
+  g_assert_cmpint (get_alpha (pixels, 3, 8), <, 128);
+  g_assert_cmpint (get_alpha (pixels, 4, 8) - 128, ==, 127 - get_alpha (pixels, 3, 8));
+
+  /* It grows towards the inside and shrinks towards the outside */
+  g_assert_cmpint (get_alpha (pixels, 6, 8), >, get_alpha (pixels, 5, 8));
+  g_assert_cmpint (get_alpha (pixels, 5, 8), >, get_alpha (pixels, 4, 8));
+  g_assert_cmpint (get_alpha (pixels, 2, 8), <, get_alpha (pixels, 3, 8));
+
+  /* Beyond the spread, it is clamped */
+  g_assert_cmpint (get_alpha (pixels, 0, 0), ==, 0);
+
+  /* All sides are the same */
+  for (x = 0; x < SIZE; x++)
+    {
+      g_assert_cmpint (get_alpha (pixels, x, 8), ==, get_alpha (pixels, SIZE - 1 - x, 8));
+      g_assert_cmpint (get_alpha (pixels, x, 8), ==, get_alpha (pixels, 8, x));
+    }
+
+  /* All channels get the value */
+  g_assert_cmphex (pixels[8 * SIZE + 8], ==, get_alpha (pixels, 8, 8) * 0x01010101u);
+}
+
+static void
+test_sdf_empty (void)
+{
+  guint32 pixels[SIZE * SIZE] = { 0, };
+  int i;
+
+  gsk_gpu_glyph_convert_to_sdf ((guchar *) pixels, SIZE, SIZE, SIZE * 4);
+
+  for (i = 0; i < SIZE * SIZE; i++)
+    g_assert_cmphex (pixels[i], ==, 0);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/gpu/glyph/sdf-square", test_sdf_square);
+  g_test_add_func ("/gpu/glyph/sdf-empty", test_sdf_empty);
+
+  return g_test_run ();
+}
@@ -263,6 +263,129 @@ test_rect_winding (void)
   gsk_path_unref (path1);
 }
 
+static void
+test_stroke (void)
+{
+  GskPath *path, *outline;
+  GskStroke *stroke;
+  const float dashes[] = { 10, 10 };
+
+  path = gsk_path_parse ("M 10 10 L 90 10 L 90 90");
+  stroke = gsk_stroke_new (10);
+
+  gsk_stroke_set_line_join (stroke, GSK_LINE_JOIN_MITER);
+  outline = gsk_path_stroke_with_tolerance (path, stroke, GSK_PATH_TOLERANCE_DEFAULT);
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (50, 6), GSK_FILL_RULE_WINDING));
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (50, 14), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (50, 4), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (50, 16), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (50, 50), GSK_FILL_RULE_WINDING));
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (94, 6), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (7, 10), GSK_FILL_RULE_WINDING));
+  gsk_path_unref (outline);
+
+  gsk_stroke_set_line_join (stroke, GSK_LINE_JOIN_BEVEL);
+  outline = gsk_path_stroke_with_tolerance (path, stroke, GSK_PATH_TOLERANCE_DEFAULT);
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (94, 6), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (93.5, 6.5), GSK_FILL_RULE_WINDING));
+  gsk_path_unref (outline);
+
+  gsk_stroke_set_line_join (stroke, GSK_LINE_JOIN_ROUND);
+  gsk_stroke_set_line_cap (stroke, GSK_LINE_CAP_SQUARE);
+  outline = gsk_path_stroke_with_tolerance (path, stroke, GSK_PATH_TOLERANCE_DEFAULT);
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (94, 6), GSK_FILL_RULE_WINDING));
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (93.5, 6.5), GSK_FILL_RULE_WINDING));
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (7, 10), GSK_FILL_RULE_WINDING));
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (90, 93), GSK_FILL_RULE_WINDING));
+  gsk_path_unref (outline);
+
+  gsk_path_unref (path);
+  gsk_stroke_free (stroke);
+
+  path = gsk_path_parse ("M 0 0 L 100 0");
+  stroke = gsk_stroke_new (2);
+  gsk_stroke_set_dash (stroke, dashes, G_N_ELEMENTS (dashes));
+
+  outline = gsk_path_stroke_with_tolerance (path, stroke, GSK_PATH_TOLERANCE_DEFAULT);
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (5, 0), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (15, 0), GSK_FILL_RULE_WINDING));
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (25, 0), GSK_FILL_RULE_WINDING));
+  gsk_path_unref (outline);
+
+  gsk_stroke_set_dash_offset (stroke, 5);
+  outline = gsk_path_stroke_with_tolerance (path, stroke, GSK_PATH_TOLERANCE_DEFAULT);
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (2, 0), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (8, 0), GSK_FILL_RULE_WINDING));
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (12, 0), GSK_FILL_RULE_WINDING));
+  gsk_path_unref (outline);
+
+  gsk_path_unref (path);
+  gsk_stroke_free (stroke);
+
+  /* The last dash of a closed contour continues in the first one */
+  path = gsk_path_parse ("M 0 0 L 100 0 L 100 100 L 0 100 Z");
+  stroke = gsk_stroke_new (10);
+  gsk_stroke_set_line_join (stroke, GSK_LINE_JOIN_MITER);
+  gsk_stroke_set_dash (stroke, (float[2]) { 30, 10 }, 2);
+  gsk_stroke_set_dash_offset (stroke, 20);
+
+  outline = gsk_path_stroke_with_tolerance (path, stroke, GSK_PATH_TOLERANCE_DEFAULT);
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (-4, -4), GSK_FILL_RULE_WINDING));
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (5, 0), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (15, 0), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (50, 50), GSK_FILL_RULE_WINDING));
+  gsk_path_unref (outline);
+
+  /* Without dashes, the inside of a closed contour stays empty */
+  gsk_stroke_set_dash (stroke, NULL, 0);
+  outline = gsk_path_stroke_with_tolerance (path, stroke, GSK_PATH_TOLERANCE_DEFAULT);
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (-4, -4), GSK_FILL_RULE_WINDING));
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (50, 4), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (50, 6), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (50, 50), GSK_FILL_RULE_WINDING));
+  gsk_path_unref (outline);
+
+  gsk_path_unref (path);
+  gsk_stroke_free (stroke);
+}
+
+static void
+test_stroke_contours (void)
+{
+  GskPath *path, *outline;
+  GskStroke *stroke;
+
+  /* The dot in the second contour must not take the direction
+   * of the diagonal in the first one for its caps
+   */
+  path = gsk_path_parse ("M 0 0 L 30 30 M 60 10 L 60 10");
+  stroke = gsk_stroke_new (10);
+  gsk_stroke_set_line_cap (stroke, GSK_LINE_CAP_SQUARE);
+
+  outline = gsk_path_stroke_with_tolerance (path, stroke, GSK_PATH_TOLERANCE_DEFAULT);
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (64, 14), GSK_FILL_RULE_WINDING));
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (56, 6), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (66, 10), GSK_FILL_RULE_WINDING));
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (15, 15), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (45, 10), GSK_FILL_RULE_WINDING));
+  gsk_path_unref (outline);
+
+  /* Each contour gets its own caps */
+  gsk_path_unref (path);
+  path = gsk_path_parse ("M 10 10 L 50 10 M 10 30 L 50 30");
+  gsk_stroke_set_line_cap (stroke, GSK_LINE_CAP_BUTT);
+
+  outline = gsk_path_stroke_with_tolerance (path, stroke, GSK_PATH_TOLERANCE_DEFAULT);
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (30, 10), GSK_FILL_RULE_WINDING));
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (30, 30), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (30, 20), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (8, 30), GSK_FILL_RULE_WINDING));
+  gsk_path_unref (outline);
+
+  gsk_path_unref (path);
+  gsk_stroke_free (stroke);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -274,6 +397,8 @@ main (int argc, char *argv[])
   g_test_add_func ("/path/rounded-rect/winding", test_rounded_rect_winding);
   g_test_add_func ("/path/rect/roundtrip", test_rect_roundtrip);
   g_test_add_func ("/path/rect/winding", test_rect_winding);
+  g_test_add_func ("/path/stroke", test_stroke);
+  g_test_add_func ("/path/stroke/contours", test_stroke_contours);
 
   return g_test_run ();
 }
@@ -762,6 +762,59 @@ test_segment (void)
     }
 }
 
+static void
+test_closest_point (void)
+{
+  GskPath *path;
+  GskPathMeasure *measure;
+  GskPathPoint point1, point2;
+  float distance1, distance2;
+  gboolean found1, found2;
+
+  for (int i = 0; i < 100; i++)
+    {
+      path = create_random_path (G_MAXUINT);
+      measure = gsk_path_measure_new (path);
+
+      for (int j = 0; j < 20; j++)
+        {
+          graphene_point_t p = GRAPHENE_POINT_INIT (g_test_rand_double_range (-1000, 1000),
+                                                    g_test_rand_double_range (-1000, 1000));
+
+          found1 = gsk_path_get_closest_point (path, &p, INFINITY, &point1, &distance1);
+          found2 = gsk_path_measure_get_closest_point (measure, &p, INFINITY, &point2, &distance2);
+
+          g_assert_cmpint (found1, ==, found2);
+          if (found1)
+            g_assert_cmpfloat_with_epsilon (distance1, distance2, 0.5);
+        }
+
+      gsk_path_measure_unref (measure);
+      gsk_path_unref (path);
+    }
+}
+
+static void
+test_stroke (void)
+{
+  GskPath *path, *outline;
+  GskStroke *stroke;
+
+  path = gsk_path_parse ("M 10 10 L 90 10 L 90 90");
+  stroke = gsk_stroke_new (10);
+
+  outline = gsk_path_stroke (path, stroke);
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (50, 6), GSK_FILL_RULE_WINDING));
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (50, 14), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (50, 16), GSK_FILL_RULE_WINDING));
+  g_assert_true (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (86, 50), GSK_FILL_RULE_WINDING));
+  g_assert_false (gsk_path_in_fill (outline, &GRAPHENE_POINT_INIT (50, 50), GSK_FILL_RULE_WINDING));
+  gsk_path_unref (outline);
+
+  gsk_path_unref (path);
+  gsk_stroke_free (stroke);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -775,6 +828,8 @@ main (int   argc,
   g_test_add_func ("/path/measure/split", test_split);
   g_test_add_func ("/path/measure/roundtrip", test_roundtrip);
   g_test_add_func ("/path/measure/segment", test_segment);
+  g_test_add_func ("/path/measure/closest-point", test_closest_point);
+  g_test_add_func ("/path/stroke", test_stroke);
 
   return g_test_run ();
 }
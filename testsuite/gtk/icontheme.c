@@ -577,6 +577,76 @@ test_svg_size (void)
   assert_icon_lookup_size ("twosize",  8, GTK_TEXT_DIR_NONE, 0, FALSE, "/icons/16x16s/twosize.svg", 8);
 }
 
+static void
+test_cache_large (void)
+{
+  GtkIconTheme *icon_theme;
+  GtkIconPaintable *icon, *icon2;
+
+  /* Large icons are kept in the cache too, once they are unused */
+  icon_theme = get_test_icontheme (FALSE);
+  icon = gtk_icon_theme_lookup_icon (icon_theme, "twosize", NULL, 256, 1, GTK_TEXT_DIR_NONE, 0);
+  g_assert_nonnull (icon);
+  g_object_add_weak_pointer (G_OBJECT (icon), (gpointer *) &icon);
+  icon2 = icon;
+  g_object_unref (icon2);
+  g_assert_nonnull (icon);
+
+  icon2 = gtk_icon_theme_lookup_icon (icon_theme, "twosize", NULL, 256, 1, GTK_TEXT_DIR_NONE, 0);
+  g_assert_true (icon2 == icon);
+
+  g_object_remove_weak_pointer (G_OBJECT (icon), (gpointer *) &icon);
+  g_object_unref (icon2);
+}
+
+static void
+test_cache_evict (void)
+{
+  GtkIconTheme *icon_theme;
+  GtkIconPaintable *icon, *first;
+  GtkSnapshot *snapshot;
+  GskRenderNode *node;
+  int size;
+
+  icon_theme = get_test_icontheme (TRUE);
+
+  /* Load more than the 16 MiB that the cache keeps around,
+   * about 30 MiB of textures at 4 bytes per pixel. */
+  first = NULL;
+  for (size = 200; size < 240; size++)
+    {
+      icon = gtk_icon_theme_lookup_icon (icon_theme, "everything", NULL, size, 2, GTK_TEXT_DIR_NONE, 0);
+      g_assert_nonnull (icon);
+
+      snapshot = gtk_snapshot_new ();
+      gdk_paintable_snapshot (GDK_PAINTABLE (icon), snapshot, size, size);
+      node = gtk_snapshot_free_to_node (snapshot);
+      g_clear_pointer (&node, gsk_render_node_unref);
+
+      if (size == 200)
+        {
+          first = icon;
+          g_object_add_weak_pointer (G_OBJECT (first), (gpointer *) &first);
+        }
+
+      g_object_unref (icon);
+
+      /* The first icon is kept alive by the cache for a while */
+      if (size == 201)
+        g_assert_nonnull (first);
+    }
+
+  /* ... until newer icons push it out */
+  g_assert_null (first);
+
+  /* The most recently used icon is still cached */
+  icon = gtk_icon_theme_lookup_icon (icon_theme, "everything", NULL, 239, 2, GTK_TEXT_DIR_NONE, 0);
+  g_object_add_weak_pointer (G_OBJECT (icon), (gpointer *) &icon);
+  g_object_unref (icon);
+  g_assert_nonnull (icon);
+  g_object_remove_weak_pointer (G_OBJECT (icon), (gpointer *) &icon);
+}
+
 static void
 test_size (void)
 {
@@ -685,6 +755,126 @@ test_inherit (void)
                       "/icons2/scalable/one-two-symbolic-rtl.svg");
 }
 
+static void
+write_index_theme (const char  *base,
+                   const char  *name,
+                   const char  *inherits,
+                   const char **icons)
+{
+  char *dir, *path, *contents;
+  const char *size;
+  int i;
+
+  contents = g_strdup_printf ("[Icon Theme]\n"
+                              "Name=%s\n"
+                              "%s%s%s"
+                              "Directories=16x16,32x32\n"
+                              "\n"
+                              "[16x16]\n"
+                              "Size=16\n"
+                              "Type=Fixed\n"
+                              "\n"
+                              "[32x32]\n"
+                              "Size=32\n"
+                              "Type=Fixed\n",
+                              name,
+                              inherits ? "Inherits=" : "",
+                              inherits ? inherits : "",
+                              inherits ? "\n" : "");
+  dir = g_build_filename (base, name, NULL);
+  g_mkdir_with_parents (dir, 0755);
+  path = g_build_filename (dir, "index.theme", NULL);
+  g_assert_true (g_file_set_contents (path, contents, -1, NULL));
+  g_free (path);
+  g_free (dir);
+  g_free (contents);
+
+  /* icons come in pairs of directory and name */
+  for (i = 0; icons[i]; i += 2)
+    {
+      size = icons[i];
+      dir = g_build_filename (base, name, size, NULL);
+      g_mkdir_with_parents (dir, 0755);
+      path = g_strconcat (dir, G_DIR_SEPARATOR_S, icons[i + 1], ".png", NULL);
+      g_assert_true (g_file_set_contents (path, "", 0, NULL));
+      g_free (path);
+      g_free (dir);
+    }
+}
+
+static void
+assert_index_lookup (GtkIconTheme  *icon_theme,
+                     const char   **icon_names,
+                     int            size,
+                     const char    *filename)
+{
+  GtkIconPaintable *icon;
+  GFile *file;
+  char *path;
+
+  icon = gtk_icon_theme_lookup_icon (icon_theme, icon_names[0], &icon_names[1], size, 1, GTK_TEXT_DIR_NONE, 0);
+  g_assert_nonnull (icon);
+  file = gtk_icon_paintable_get_file (icon);
+  path = g_file_get_path (file);
+  g_assert_true (g_str_has_suffix (path, filename));
+  g_free (path);
+  g_object_unref (file);
+  g_object_unref (icon);
+}
+
+static void
+test_index (void)
+{
+  GtkIconTheme *icon_theme;
+  char *base, *base2;
+  const char *search_path[2] = { NULL, NULL };
+  int *sizes;
+
+  base = g_dir_make_tmp ("icontheme-XXXXXX", NULL);
+  g_assert_nonnull (base);
+
+  write_index_theme (base, "child", "parent",
+                     (const char *[]) { "16x16", "shared", "16x16", "child-only", NULL });
+  write_index_theme (base, "parent", NULL,
+                     (const char *[]) { "32x32", "shared", "16x16", "parent-only", "32x32", "parent-only", NULL });
+
+  icon_theme = gtk_icon_theme_new ();
+  gtk_icon_theme_set_theme_name (icon_theme, "child");
+  search_path[0] = base;
+  gtk_icon_theme_set_search_path (icon_theme, search_path);
+
+  /* The inheriting theme wins, even with a worse size */
+  assert_index_lookup (icon_theme, (const char *[]) { "shared", NULL }, 32, "/child/16x16/shared.png");
+  /* Icons that are only in the parent are found there, at the best size */
+  assert_index_lookup (icon_theme, (const char *[]) { "parent-only", NULL }, 16, "/parent/16x16/parent-only.png");
+  assert_index_lookup (icon_theme, (const char *[]) { "parent-only", NULL }, 32, "/parent/32x32/parent-only.png");
+  /* Fallback names are tried in each theme before moving to the parent */
+  assert_index_lookup (icon_theme, (const char *[]) { "missing", "parent-only", "child-only", NULL }, 16, "/child/16x16/child-only.png");
+  assert_index_lookup (icon_theme, (const char *[]) { "missing", "parent-only", "shared", NULL }, 32, "/child/16x16/shared.png");
+
+  /* The sizes come from all themes */
+  sizes = gtk_icon_theme_get_icon_sizes (icon_theme, "shared");
+  g_assert_true ((sizes[0] == 16 && sizes[1] == 32) || (sizes[0] == 32 && sizes[1] == 16));
+  g_assert_cmpint (sizes[2], ==, 0);
+  g_free (sizes);
+
+  /* Changing the search path rebuilds the index */
+  base2 = g_dir_make_tmp ("icontheme-XXXXXX", NULL);
+  g_assert_nonnull (base2);
+  write_index_theme (base2, "child", NULL,
+                     (const char *[]) { "32x32", "child-only", NULL });
+  search_path[0] = base2;
+  gtk_icon_theme_set_search_path (icon_theme, search_path);
+
+  g_assert_false (gtk_icon_theme_has_icon (icon_theme, "shared"));
+  g_assert_false (gtk_icon_theme_has_icon (icon_theme, "parent-only"));
+  assert_index_lookup (icon_theme, (const char *[]) { "child-only", NULL }, 16, "/child/32x32/child-only.png");
+
+  g_object_unref (icon_theme);
+  g_free (base);
+  g_free (base2);
+}
+
 static void
 test_nonsquare_symbolic (void)
 {
@@ -743,6 +933,31 @@ test_nonsquare_symbolic (void)
   g_object_unref (info);
 }
 
+static void
+test_symbolic_mask (void)
+{
+  GtkIconTheme *icon_theme;
+  GtkIconPaintable *icon;
+  GtkSnapshot *snapshot;
+  GskRenderNode *node;
+
+  /* Single color symbolic icons are drawn as a mask */
+  icon_theme = get_test_icontheme (FALSE);
+  icon = gtk_icon_theme_lookup_icon (icon_theme, "only32-symbolic", NULL, 32, 1, GTK_TEXT_DIR_NONE, 0);
+  g_assert_nonnull (icon);
+  g_assert_true (gtk_icon_paintable_is_symbolic (icon));
+
+  snapshot = gtk_snapshot_new ();
+  gdk_paintable_snapshot (GDK_PAINTABLE (icon), snapshot, 32, 32);
+  node = gtk_snapshot_free_to_node (snapshot);
+
+  g_assert_cmpint (gsk_render_node_get_node_type (node), ==, GSK_MASK_NODE);
+  g_assert_cmpint (gsk_render_node_get_node_type (gsk_mask_node_get_source (node)), ==, GSK_COLOR_NODE);
+
+  gsk_render_node_unref (node);
+  g_object_unref (icon);
+}
+
 static void
 require_env (const char *var)
 {
@@ -765,9 +980,13 @@ main (int argc, char *argv[])
   g_test_add_func ("/icontheme/symbolic-single-size", test_symbolic_single_size);
   g_test_add_func ("/icontheme/svg-size", test_svg_size);
   g_test_add_func ("/icontheme/size", test_size);
+  g_test_add_func ("/icontheme/cache-large", test_cache_large);
+  g_test_add_func ("/icontheme/cache-evict", test_cache_evict);
   g_test_add_func ("/icontheme/list", test_list);
   g_test_add_func ("/icontheme/inherit", test_inherit);
+  g_test_add_func ("/icontheme/index", test_index);
   g_test_add_func ("/icontheme/nonsquare-symbolic", test_nonsquare_symbolic);
+  g_test_add_func ("/icontheme/symbolic-mask", test_symbolic_mask);
   g_test_add_func ("/icontheme/lookup_order0", test_lookup_order0);
   g_test_add_func ("/icontheme/lookup_order1", test_lookup_order1);
   g_test_add_func ("/icontheme/lookup_order2", test_lookup_order2);
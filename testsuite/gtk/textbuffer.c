@@ -23,6 +23,9 @@
 #include <gtk/gtk.h>
 #include "gtk/gtktexttypesprivate.h" /* Private header, for UNKNOWN_CHAR */
 #include "gtk/gtktextbufferprivate.h" /* Private header */
+#include "gtk/gtktextiterprivate.h"
+#include "gtk/gtktextlayoutprivate.h"
+#include "gtk/gtktextviewprivate.h"
 
 static void
 gtk_text_iter_spew (const GtkTextIter *iter, const char *desc)
@@ -1349,6 +1352,82 @@ test_tag (void)
   g_object_unref (buffer);
 }
 
+static void
+count_tag_signal (GtkTextBuffer     *buffer,
+                  GtkTextTag        *tag,
+                  const GtkTextIter *start,
+                  const GtkTextIter *end,
+                  int               *count)
+{
+  (*count)++;
+}
+
+static void
+check_tag_runs (GtkTextBuffer *buffer,
+                GtkTextTag    *tag,
+                const char    *expected)
+{
+  GtkTextIter iter;
+  int i;
+
+  for (i = 0; expected[i]; i++)
+    {
+      gtk_text_buffer_get_iter_at_offset (buffer, &iter, i);
+      g_assert_cmpint (gtk_text_iter_has_tag (&iter, tag), ==, expected[i] == 'x');
+    }
+}
+
+static void
+test_tag_runs (void)
+{
+  GtkTextBuffer *buffer;
+  GtkTextTag *tag;
+  GtkTextIter start, end;
+  const int runs1[] = { 1, 3, 5, 6 };
+  const int runs2[] = { 0, 3, 7, 8 };
+  const int runs3[] = { 4, 5, 1, 2 };
+  int n_signals = 0;
+
+  buffer = gtk_text_buffer_new (NULL);
+  tag = gtk_text_buffer_create_tag (buffer, NULL, "weight", PANGO_WEIGHT_BOLD, NULL);
+  gtk_text_buffer_set_text (buffer, "0123456789", -1);
+
+  g_signal_connect (buffer, "apply-tag", G_CALLBACK (count_tag_signal), &n_signals);
+  g_signal_connect (buffer, "remove-tag", G_CALLBACK (count_tag_signal), &n_signals);
+
+  gtk_text_buffer_get_iter_at_offset (buffer, &start, 2);
+  gtk_text_buffer_get_iter_at_offset (buffer, &end, 10);
+
+  gtk_text_buffer_apply_tag_runs (buffer, tag, &start, &end, runs1, G_N_ELEMENTS (runs1));
+  check_tag_runs (buffer, tag, "...xx..x..");
+  g_assert_cmpint (n_signals, ==, 2);
+
+  /* Applying the same runs again doesn't touch the buffer */
+  n_signals = 0;
+  gtk_text_buffer_apply_tag_runs (buffer, tag, &start, &end, runs1, G_N_ELEMENTS (runs1));
+  check_tag_runs (buffer, tag, "...xx..x..");
+  g_assert_cmpint (n_signals, ==, 0);
+
+  n_signals = 0;
+  gtk_text_buffer_apply_tag_runs (buffer, tag, &start, &end, runs2, G_N_ELEMENTS (runs2));
+  check_tag_runs (buffer, tag, "..xxx....x");
+  g_assert_cmpint (n_signals, ==, 3);
+
+  /* Runs that are out of order are rejected before anything changes */
+  n_signals = 0;
+  g_test_expect_message ("Gtk", G_LOG_LEVEL_CRITICAL, "*tag_runs_are_valid*");
+  gtk_text_buffer_apply_tag_runs (buffer, tag, &start, &end, runs3, G_N_ELEMENTS (runs3));
+  g_test_assert_expected_messages ();
+  check_tag_runs (buffer, tag, "..xxx....x");
+  g_assert_cmpint (n_signals, ==, 0);
+
+  /* No runs clears the range */
+  gtk_text_buffer_apply_tag_runs (buffer, tag, &start, &end, NULL, 0);
+  check_tag_runs (buffer, tag, "..........");
+
+  g_object_unref (buffer);
+}
+
 static void
 check_buffer_contents (GtkTextBuffer *buffer,
                        const char    *contents)
@@ -1956,6 +2035,271 @@ test_serialize_wrap_mode (void)
   g_assert_finalize_object (buffer);
 }
 
+static void
+test_long_line (void)
+{
+  GtkTextBuffer *buffer;
+  GtkTextIter iter;
+  GString *expected;
+  GtkDebugFlags flags;
+  guint n, i;
+  double elapsed;
+
+  /* The btree consistency checks are linear in the size of the
+   * buffer, so leave them out when measuring.
+   */
+  flags = gtk_get_debug_flags ();
+  if (g_test_perf ())
+    gtk_set_debug_flags (flags & ~GTK_DEBUG_TEXT);
+
+  n = g_test_perf () ? 200000 : 500;
+
+  buffer = gtk_text_buffer_new (NULL);
+  expected = g_string_new (NULL);
+
+  /* Append to a single ever-growing line, like a streaming log */
+  g_test_timer_start ();
+  for (i = 0; i < n; i++)
+    {
+      gtk_text_buffer_get_end_iter (buffer, &iter);
+      gtk_text_buffer_insert (buffer, &iter, "{\"k\":\"v\xc3\xa9\"},", -1);
+      g_string_append (expected, "{\"k\":\"v\xc3\xa9\"},");
+    }
+  elapsed = g_test_timer_elapsed ();
+  if (g_test_perf ())
+    g_test_minimized_result (elapsed, "appending %u chunks to a single line: %gsec", n, elapsed);
+
+  g_assert_cmpint (gtk_text_buffer_get_line_count (buffer), ==, 1);
+  check_buffer_contents (buffer, expected->str);
+
+  /* Insert repeatedly in the middle of the line, like typing */
+  g_test_timer_start ();
+  for (i = 0; i < n / 10; i++)
+    {
+      gtk_text_buffer_get_iter_at_offset (buffer, &iter, i + 10);
+      gtk_text_buffer_insert (buffer, &iter, "\xe2\x82\xac", -1);
+      g_string_insert (expected,
+                       g_utf8_offset_to_pointer (expected->str, i + 10) - expected->str,
+                       "\xe2\x82\xac");
+    }
+  elapsed = g_test_timer_elapsed ();
+  if (g_test_perf ())
+    g_test_minimized_result (elapsed, "inserting %u chars into a long line: %gsec", n / 10, elapsed);
+
+  check_buffer_contents (buffer, expected->str);
+
+  /* Break the line up and join it again */
+  gtk_text_buffer_get_iter_at_offset (buffer, &iter, n / 2);
+  gtk_text_buffer_insert (buffer, &iter, "\n", -1);
+  g_assert_cmpint (gtk_text_buffer_get_line_count (buffer), ==, 2);
+  gtk_text_buffer_backspace (buffer, &iter, FALSE, TRUE);
+  g_assert_cmpint (gtk_text_buffer_get_line_count (buffer), ==, 1);
+  check_buffer_contents (buffer, expected->str);
+
+  g_string_free (expected, TRUE);
+  g_object_unref (buffer);
+
+  gtk_set_debug_flags (flags);
+}
+
+static void
+check_segment_sizes (GtkTextBuffer *buffer)
+{
+  GtkTextIter iter;
+  GtkTextLineSegment *seg;
+  guint n_segments = 0;
+
+  gtk_text_buffer_get_start_iter (buffer, &iter);
+  for (seg = _gtk_text_iter_get_text_line (&iter)->segments; seg; seg = seg->next)
+    {
+      g_assert_cmpint (seg->byte_count, <=, GTK_TEXT_CHAR_SEGMENT_MAX_BYTES);
+      n_segments++;
+    }
+
+  g_assert_cmpuint (n_segments, >, 1);
+}
+
+static void
+test_long_line_segments (void)
+{
+  GtkTextBuffer *buffer;
+  GtkTextIter iter;
+  GString *text;
+  char *contents;
+  guint i;
+
+  /* A single line a lot longer than a segment, with multi-byte
+   * characters and a CRLF that could end up on a segment boundary
+   */
+  text = g_string_new (NULL);
+  for (i = 0; i < 10 * GTK_TEXT_CHAR_SEGMENT_MAX_BYTES / 8; i++)
+    g_string_append (text, i % 3 ? "abcdefg\xc3\xa9" : "abcd\xe2\x82\xac");
+  g_string_append (text, "\r\n");
+
+  buffer = gtk_text_buffer_new (NULL);
+  gtk_text_buffer_set_text (buffer, text->str, -1);
+  g_assert_cmpint (gtk_text_buffer_get_line_count (buffer), ==, 2);
+  check_buffer_contents (buffer, text->str);
+  check_segment_sizes (buffer);
+
+  /* Inserting in the middle keeps the segments bounded */
+  for (i = 0; i < 100; i++)
+    {
+      gtk_text_buffer_get_iter_at_offset (buffer, &iter, 5 * GTK_TEXT_CHAR_SEGMENT_MAX_BYTES + i * 17);
+      gtk_text_buffer_insert (buffer, &iter, "0123456789", -1);
+    }
+  check_segment_sizes (buffer);
+  g_assert_cmpint (gtk_text_buffer_get_char_count (buffer), ==,
+                   g_utf8_strlen (text->str, -1) + 100 * 10);
+
+  /* Deleting it again merges what fits */
+  for (i = 100; i > 0; i--)
+    {
+      GtkTextIter end;
+
+      gtk_text_buffer_get_iter_at_offset (buffer, &iter, 5 * GTK_TEXT_CHAR_SEGMENT_MAX_BYTES + (i - 1) * 17);
+      gtk_text_buffer_get_iter_at_offset (buffer, &end, 5 * GTK_TEXT_CHAR_SEGMENT_MAX_BYTES + (i - 1) * 17 + 10);
+      contents = gtk_text_buffer_get_text (buffer, &iter, &end, TRUE);
+      g_assert_cmpstr (contents, ==, "0123456789");
+      g_free (contents);
+      gtk_text_buffer_delete (buffer, &iter, &end);
+    }
+  check_segment_sizes (buffer);
+  check_buffer_contents (buffer, text->str);
+
+  g_string_free (text, TRUE);
+  g_object_unref (buffer);
+}
+
+typedef struct {
+  gboolean done;
+  gboolean success;
+  GError *error;
+} LoadData;
+
+static void
+load_stream_done (GObject      *source,
+                  GAsyncResult *result,
+                  gpointer      data)
+{
+  LoadData *load = data;
+
+  load->success = gtk_text_buffer_load_stream_finish (GTK_TEXT_BUFFER (source), result, &load->error);
+  load->done = TRUE;
+
+  g_main_context_wakeup (NULL);
+}
+
+static gboolean
+load_stream (GtkTextBuffer  *buffer,
+             const char     *data,
+             gsize           len,
+             GError        **error)
+{
+  GInputStream *stream;
+  LoadData load = { FALSE, FALSE, NULL };
+
+  stream = g_memory_input_stream_new_from_data (data, len, NULL);
+  gtk_text_buffer_load_stream_async (buffer, stream, G_PRIORITY_DEFAULT, NULL,
+                                     load_stream_done, &load);
+  g_object_unref (stream);
+
+  while (!load.done)
+    g_main_context_iteration (NULL, TRUE);
+
+  if (load.error)
+    g_propagate_error (error, load.error);
+
+  return load.success;
+}
+
+static void
+test_load_stream (void)
+{
+  GtkTextBuffer *buffer;
+  GString *expected;
+  GError *error = NULL;
+  guint i;
+
+  buffer = gtk_text_buffer_new (NULL);
+
+  /* Large enough to span several chunks, with multibyte
+   * characters straddling the chunk boundaries.
+   */
+  expected = g_string_new (NULL);
+  for (i = 0; i < 50000; i++)
+    g_string_append_printf (expected, "line %u \xe2\x82\xac\n", i);
+
+  gtk_text_buffer_set_text (buffer, "old contents", -1);
+
+  g_assert_true (load_stream (buffer, expected->str, expected->len, &error));
+  g_assert_no_error (error);
+  check_buffer_contents (buffer, expected->str);
+  g_assert_cmpint (gtk_text_buffer_get_line_count (buffer), ==, 50001);
+  g_assert_false (gtk_text_buffer_get_can_undo (buffer));
+
+  /* Invalid UTF-8 in the first read leaves the buffer alone */
+  g_assert_false (load_stream (buffer, "abc\xff\xfe", 5, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_clear_error (&error);
+  check_buffer_contents (buffer, expected->str);
+
+  g_string_free (expected, TRUE);
+  g_object_unref (buffer);
+}
+
+static GtkTextLineDisplay *
+get_first_line_display (GtkTextView *view)
+{
+  GtkTextBuffer *buffer = gtk_text_view_get_buffer (view);
+  GtkTextIter iter;
+  GdkRectangle rect;
+
+  /* Makes sure that the view has a layout */
+  gtk_text_buffer_get_start_iter (buffer, &iter);
+  gtk_text_view_get_iter_location (view, &iter, &rect);
+
+  return gtk_text_layout_get_line_display (gtk_text_view_get_layout (view),
+                                           _gtk_text_iter_get_text_line (&iter),
+                                           FALSE);
+}
+
+static void
+test_shared_layouts (void)
+{
+  GtkTextBuffer *buffer;
+  GtkWidget *view1, *view2;
+  GtkTextLineDisplay *display1, *display2;
+
+  buffer = gtk_text_buffer_new (NULL);
+  gtk_text_buffer_set_text (buffer, "Two views, one layout", -1);
+
+  view1 = g_object_ref_sink (gtk_text_view_new_with_buffer (buffer));
+  view2 = g_object_ref_sink (gtk_text_view_new_with_buffer (buffer));
+
+  /* Both views show the line the same way, so it is only shaped once */
+  display1 = get_first_line_display (GTK_TEXT_VIEW (view1));
+  display2 = get_first_line_display (GTK_TEXT_VIEW (view2));
+  g_assert_true (display1 != display2);
+  g_assert_true (display1->layout == display2->layout);
+  gtk_text_line_display_unref (display1);
+  gtk_text_line_display_unref (display2);
+
+  /* Changing how one view shows it doesn't affect the other one */
+  gtk_text_view_set_indent (GTK_TEXT_VIEW (view2), 10);
+  display1 = get_first_line_display (GTK_TEXT_VIEW (view1));
+  display2 = get_first_line_display (GTK_TEXT_VIEW (view2));
+  g_assert_true (display1->layout != display2->layout);
+  g_assert_cmpint (pango_layout_get_indent (display1->layout), ==, 0);
+  g_assert_cmpint (pango_layout_get_indent (display2->layout), ==, 10 * PANGO_SCALE);
+  gtk_text_line_display_unref (display1);
+  gtk_text_line_display_unref (display2);
+
+  g_object_unref (view1);
+  g_object_unref (view2);
+  g_object_unref (buffer);
+}
+
 int
 main (int argc, char** argv)
 {
@@ -1972,7 +2316,12 @@ main (int argc, char** argv)
   g_test_add_func ("/TextBuffer/Empty buffer", test_empty_buffer);
   g_test_add_func ("/TextBuffer/Get and Set", test_get_set);
   g_test_add_func ("/TextBuffer/Fill and Empty", test_fill_empty);
+  g_test_add_func ("/TextBuffer/Long line", test_long_line);
+  g_test_add_func ("/TextBuffer/Long line segments", test_long_line_segments);
+  g_test_add_func ("/TextBuffer/Load stream", test_load_stream);
+  g_test_add_func ("/TextBuffer/Shared layouts", test_shared_layouts);
   g_test_add_func ("/TextBuffer/Tag", test_tag);
+  g_test_add_func ("/TextBuffer/Tag runs", test_tag_runs);
   g_test_add_func ("/TextBuffer/Clipboard", test_clipboard);
   g_test_add_func ("/TextBuffer/Get iter", test_get_iter);
   g_test_add_func ("/TextBuffer/Iter with anchor", test_iter_with_anchor);
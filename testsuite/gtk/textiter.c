@@ -279,6 +279,106 @@ test_search_caseless (void)
   check_found_backward ("aa \303\200", "aa", flags, 0, 2, "aa");
 }
 
+static void
+check_found_all (const char         *haystack,
+                 const char         *needle,
+                 GtkTextSearchFlags  flags,
+                 const int          *expected,
+                 guint               n_expected)
+{
+  GtkTextBuffer *buffer;
+  GtkTextIter i;
+  GtkTextIter *starts, *ends;
+  guint n_matches, j;
+  gboolean found;
+
+  buffer = gtk_text_buffer_new (NULL);
+
+  gtk_text_buffer_set_text (buffer, haystack, -1);
+
+  gtk_text_buffer_get_start_iter (buffer, &i);
+  found = gtk_text_iter_forward_search_all (&i, needle, flags, NULL, &starts, &ends, &n_matches);
+  g_assert_true (found == (n_expected > 0));
+  g_assert_cmpuint (n_matches, ==, n_expected);
+  if (n_expected == 0)
+    {
+      g_assert_null (starts);
+      g_assert_null (ends);
+    }
+
+  for (j = 0; j < n_matches; j++)
+    {
+      g_assert_cmpint (gtk_text_iter_get_offset (&starts[j]), ==, expected[2 * j]);
+      g_assert_cmpint (gtk_text_iter_get_offset (&ends[j]), ==, expected[2 * j + 1]);
+    }
+
+  g_free (starts);
+  g_free (ends);
+  g_object_unref (buffer);
+}
+
+static void
+test_search_all (void)
+{
+  const int simple[] = { 0, 3, 4, 7, 12, 15 };
+  const int cased[] = { 0, 3, 12, 15 };
+  const int multiline[] = { 4, 11 };
+  const int newlines[] = { 4, 8, 8, 12 };
+  const int caseless[] = { 0, 3, 4, 7, 14, 17 };
+
+  check_found_all ("foo foo bar foo", "foo", 0, simple, 3);
+  check_found_all ("foo Foo bar foo", "foo", 0, cased, 2);
+  check_found_all ("foo foo bar foo", "baz", 0, NULL, 0);
+  check_found_all ("foo foo\nfoo foo", "foo\nfoo", 0, multiline, 1);
+  check_found_all ("bar foo\nfoo\nfoo", "foo\n", 0, newlines, 2);
+  check_found_all ("Foo fOO bar FOO", "foo", GTK_TEXT_SEARCH_CASE_INSENSITIVE, simple, 3);
+  check_found_all ("Foo fOO bar \303\200 FOO", "foo", GTK_TEXT_SEARCH_CASE_INSENSITIVE, caseless, 3);
+}
+
+static void
+test_search_backward_lines (void)
+{
+  GtkTextBuffer *buffer;
+  GtkTextTag *tag;
+  GtkTextIter iter, start, end, limit;
+
+  buffer = gtk_text_buffer_new (NULL);
+  gtk_text_buffer_set_text (buffer, "foo bar\nbar foo baz\nbaz", -1);
+
+  /* Split the second line into several segments */
+  tag = gtk_text_buffer_create_tag (buffer, NULL, "weight", PANGO_WEIGHT_BOLD, NULL);
+  gtk_text_buffer_get_iter_at_offset (buffer, &start, 10);
+  gtk_text_buffer_get_iter_at_offset (buffer, &end, 14);
+  gtk_text_buffer_apply_tag (buffer, tag, &start, &end);
+
+  gtk_text_buffer_get_end_iter (buffer, &iter);
+  g_assert_true (gtk_text_iter_backward_search (&iter, "foo", 0, &start, &end, NULL));
+  g_assert_cmpint (gtk_text_iter_get_offset (&start), ==, 12);
+  g_assert_cmpint (gtk_text_iter_get_offset (&end), ==, 15);
+
+  g_assert_true (gtk_text_iter_backward_search (&start, "FOO", GTK_TEXT_SEARCH_CASE_INSENSITIVE, &start, &end, NULL));
+  g_assert_cmpint (gtk_text_iter_get_offset (&start), ==, 0);
+  g_assert_cmpint (gtk_text_iter_get_offset (&end), ==, 3);
+
+  /* A match can't end after the iter */
+  gtk_text_buffer_get_iter_at_offset (buffer, &iter, 14);
+  g_assert_true (gtk_text_iter_backward_search (&iter, "foo", 0, &start, &end, NULL));
+  g_assert_cmpint (gtk_text_iter_get_offset (&start), ==, 0);
+
+  /* Or start before the limit */
+  gtk_text_buffer_get_iter_at_offset (buffer, &limit, 1);
+  g_assert_false (gtk_text_iter_backward_search (&iter, "foo", 0, &start, &end, &limit));
+
+  /* Starting at the start of a line searches the previous line */
+  gtk_text_buffer_get_iter_at_offset (buffer, &iter, 20);
+  g_assert_true (gtk_text_iter_starts_line (&iter));
+  g_assert_true (gtk_text_iter_backward_search (&iter, "baz", 0, &start, &end, NULL));
+  g_assert_cmpint (gtk_text_iter_get_offset (&start), ==, 16);
+  g_assert_cmpint (gtk_text_iter_get_offset (&end), ==, 19);
+
+  g_object_unref (buffer);
+}
+
 static void
 test_forward_to_tag_toggle (void)
 {
@@ -841,6 +941,8 @@ main (int argc, char** argv)
   g_test_add_func ("/TextIter/Search Full Buffer", test_search_full_buffer);
   g_test_add_func ("/TextIter/Search", test_search);
   g_test_add_func ("/TextIter/Search Caseless", test_search_caseless);
+  g_test_add_func ("/TextIter/Search All", test_search_all);
+  g_test_add_func ("/TextIter/Search Backward Lines", test_search_backward_lines);
   g_test_add_func ("/TextIter/Forward To Tag Toggle", test_forward_to_tag_toggle);
   g_test_add_func ("/TextIter/Forward To Line End", test_forward_to_line_end);
   g_test_add_func ("/TextIter/Word Boundaries", test_word_boundaries);
@@ -0,0 +1,87 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+#include "gtk/gdktextureutilsprivate.h"
+
+static GdkTexture *
+load_symbolic (const char *svg)
+{
+  GFileIOStream *stream;
+  GFile *file;
+  GdkTexture *texture;
+  GError *error = NULL;
+
+  file = g_file_new_tmp ("textureutils-XXXXXX-symbolic.svg", &stream, &error);
+  g_assert_no_error (error);
+  g_io_stream_close (G_IO_STREAM (stream), NULL, NULL);
+  g_object_unref (stream);
+
+  g_file_replace_contents (file, svg, strlen (svg), NULL, FALSE, G_FILE_CREATE_NONE, NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  texture = gdk_texture_new_from_file_symbolic (file, 16, 16, 1.0, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (texture);
+
+  g_file_delete (file, NULL, NULL);
+  g_object_unref (file);
+
+  return texture;
+}
+
+static void
+test_symbolic_single_color (void)
+{
+  GdkTexture *texture;
+
+  texture = load_symbolic ("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"16\" height=\"16\">"
+                           "<rect width=\"16\" height=\"8\"/>"
+                           "</svg>");
+  g_assert_cmpint (gdk_texture_get_format (texture), ==, GDK_MEMORY_A8);
+  g_object_unref (texture);
+
+  /* Only classes select other colors, not ids or text */
+  texture = load_symbolic ("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"16\" height=\"16\">"
+                           "<title>warning</title>"
+                           "<rect id=\"error\" class=\"errors\" width=\"16\" height=\"8\"/>"
+                           "</svg>");
+  g_assert_cmpint (gdk_texture_get_format (texture), ==, GDK_MEMORY_A8);
+  g_object_unref (texture);
+}
+
+static void
+test_symbolic_multi_color (void)
+{
+  GdkTexture *texture;
+
+  texture = load_symbolic ("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"16\" height=\"16\">"
+                           "<rect width=\"16\" height=\"8\"/>"
+                           "<rect class=\"big error\" y=\"8\" width=\"16\" height=\"8\"/>"
+                           "</svg>");
+  g_assert_cmpint (gdk_texture_get_format (texture), !=, GDK_MEMORY_A8);
+  g_object_unref (texture);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/textureutils/symbolic/single-color", test_symbolic_single_color);
+  g_test_add_func ("/textureutils/symbolic/multi-color", test_symbolic_multi_color);
+
+  return g_test_run ();
+}
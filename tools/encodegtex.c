@@ -0,0 +1,120 @@
+/* encodegtex.c
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <gdk/gdk.h>
+#include <glib/gi18n.h>
+
+#include <string.h>
+#include <locale.h>
+
+#include "gdk/loaders/gdkgtexprivate.h"
+
+static char *output_dir = NULL;
+
+static GOptionEntry args[] = {
+  { "output", 'o', 0, G_OPTION_ARG_FILENAME, &output_dir, N_("Output to this directory instead of cwd"), NULL },
+  { NULL }
+};
+
+static gboolean
+encode_file (const char *path)
+{
+  GdkTexture *texture;
+  GBytes *bytes;
+  GError *error = NULL;
+  char *basename, *dot, *gtexfile, *gtexpath;
+  gboolean result;
+
+  texture = gdk_texture_new_from_filename (path, &error);
+  if (texture == NULL)
+    {
+      g_printerr (_("Can’t load file: %s\n"), error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+
+  bytes = gdk_save_gtex (texture);
+  g_object_unref (texture);
+
+  basename = g_path_get_basename (path);
+  dot = strrchr (basename, '.');
+  if (dot != NULL)
+    *dot = 0;
+  gtexfile = g_strconcat (basename, ".gtex", NULL);
+  g_free (basename);
+
+  if (output_dir != NULL)
+    gtexpath = g_build_filename (output_dir, gtexfile, NULL);
+  else
+    gtexpath = g_strdup (gtexfile);
+  g_free (gtexfile);
+
+  result = g_file_set_contents (gtexpath,
+                                g_bytes_get_data (bytes, NULL),
+                                g_bytes_get_size (bytes),
+                                &error);
+  if (!result)
+    {
+      g_printerr (_("Can’t save file %s: %s\n"), gtexpath, error->message);
+      g_error_free (error);
+    }
+
+  g_free (gtexpath);
+  g_bytes_unref (bytes);
+
+  return result;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  int i, status;
+
+  setlocale (LC_ALL, "");
+
+  bindtextdomain (GETTEXT_PACKAGE, GTK_LOCALEDIR);
+#ifdef HAVE_BIND_TEXTDOMAIN_CODESET
+  bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
+#endif
+
+  g_set_prgname ("gtk-encode-gtex");
+
+  context = g_option_context_new ("[OPTION…] PATH…");
+  g_option_context_add_main_entries (context, args, GETTEXT_PACKAGE);
+
+  g_option_context_parse (context, &argc, &argv, NULL);
+
+  if (argc < 2)
+    {
+      g_printerr ("%s\n", g_option_context_get_help (context, FALSE, NULL));
+      return 1;
+    }
+
+  status = 0;
+  for (i = 1; i < argc; i++)
+    {
+      if (!encode_file (argv[i]))
+        status = 1;
+    }
+
+  g_option_context_free (context);
+
+  return status;
+}